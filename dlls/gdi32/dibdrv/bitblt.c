@@ -21,6 +21,7 @@
 #include <assert.h>
 
 #include "gdi_private.h"
+#include "winreg.h"
 #include "dibdrv.h"
 
 #include "wine/debug.h"
@@ -552,19 +553,199 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* minimum number of pixels in a band processed by a separate thread */
+#define BAND_PIXELS 65536
+#define MAX_BANDS   16
+
+struct band
+{
+    BOOL  (*proc)( void *arg );
+    void   *arg;
+    BOOL    ret;
+    LONG   *pending;
+    HANDLE  done;
+};
+
+static CRITICAL_SECTION render_threads_cs;
+static CRITICAL_SECTION_DEBUG render_threads_cs_debug =
+{
+    0, 0, &render_threads_cs,
+    { &render_threads_cs_debug.ProcessLocksList, &render_threads_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": render_threads_cs") }
+};
+static CRITICAL_SECTION render_threads_cs = { &render_threads_cs_debug, -1, 0, 0, 0, 0 };
+
+static HKEY render_key;         /* the GDI key, or HKCU\Software while it doesn't exist */
+static HANDLE render_changed;   /* signaled when render_key is changed */
+static int render_threads = -1;
+
+/* read the setting and watch its key for changes; render_threads_cs must be held */
+static int read_render_threads(void)
+{
+    char buffer[16];
+    DWORD type, size = sizeof(buffer) - 1;
+    BOOL found;
+    int threads = 1;
+
+    if (!render_changed && !(render_changed = CreateEventW( NULL, FALSE, FALSE, NULL ))) return threads;
+
+    if (render_key) RegCloseKey( render_key );
+    found = !RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\GDI", &render_key );
+    if (!found && RegOpenKeyA( HKEY_CURRENT_USER, "Software", &render_key )) render_key = 0;
+    if (!render_key) return threads;
+
+    /* arm the notification before reading, so that no change is missed */
+    RegNotifyChangeKeyValue( render_key, !found, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+                             render_changed, TRUE );
+    if (!found) return threads;
+
+    memset( buffer, 0, sizeof(buffer) );
+    if (!RegQueryValueExA( render_key, "RenderThreads", NULL, &type, (BYTE *)buffer, &size ))
+    {
+        if (type == REG_DWORD && size == sizeof(DWORD)) threads = *(DWORD *)buffer;
+        else if (type == REG_SZ) threads = atoi( buffer );
+    }
+    return threads;
+}
+
+/* number of threads used to render large operations, HKCU\Software\Wine\GDI\RenderThreads.
+ * The value is cached, and only read again once the key has been changed. */
+static int get_render_threads(void)
+{
+    int threads;
+
+    EnterCriticalSection( &render_threads_cs );
+    if (render_threads == -1 || (render_changed && !WaitForSingleObject( render_changed, 0 )))
+        render_threads = read_render_threads();
+    threads = render_threads;
+    LeaveCriticalSection( &render_threads_cs );
+    return threads;
+}
+
+/* number of horizontal bands to split an operation on width x height pixels into */
+static int get_band_count( int width, int height )
+{
+    SYSTEM_INFO info;
+    int count;
+
+    if ((LONGLONG)width * height < 2 * BAND_PIXELS) return 1;
+    if ((count = get_render_threads()) < 2) return 1;
+
+    GetSystemInfo( &info );
+    count = min( count, info.dwNumberOfProcessors );
+    count = min( count, MAX_BANDS );
+    count = min( count, height );
+    return min( count, (LONGLONG)width * height / BAND_PIXELS );
+}
+
+static DWORD WINAPI band_thread_proc( void *arg )
+{
+    struct band *band = arg;
+
+    band->ret = band->proc( band->arg );
+    if (!InterlockedDecrement( band->pending )) SetEvent( band->done );
+    return 0;
+}
+
+/* call proc on each of the count elements of args, in parallel on the thread pool.
+ * The bands must not overlap; the first one is processed by the calling thread. */
+static BOOL run_bands( BOOL (*proc)( void *arg ), void *args, size_t size, int count )
+{
+    struct band bands[MAX_BANDS];
+    HANDLE done = NULL;
+    LONG pending = count - 1;
+    BOOL ret = TRUE;
+    int i;
+
+    assert( count >= 1 && count <= MAX_BANDS );
+    if (count > 1) done = CreateEventW( NULL, TRUE, FALSE, NULL );
+
+    for (i = 0; i < count; i++)
+    {
+        bands[i].proc    = proc;
+        bands[i].arg     = (char *)args + i * size;
+        bands[i].pending = &pending;
+        bands[i].done    = done;
+    }
+
+    for (i = 1; i < count; i++)
+    {
+        if (done && QueueUserWorkItem( band_thread_proc, &bands[i], WT_EXECUTEDEFAULT )) continue;
+        bands[i].ret = proc( bands[i].arg );
+        if (done && !InterlockedDecrement( &pending )) SetEvent( done );
+    }
+
+    bands[0].ret = proc( bands[0].arg );
+
+    if (done)
+    {
+        WaitForSingleObject( done, INFINITE );
+        CloseHandle( done );
+    }
+    for (i = 0; i < count; i++) if (!bands[i].ret) ret = FALSE;
+    return ret;
+}
+
+/* split rect in count horizontal bands of similar height */
+static void get_band_rect( const RECT *rect, int index, int count, RECT *band )
+{
+    int height = rect->bottom - rect->top;
+
+    band->left   = rect->left;
+    band->right  = rect->right;
+    band->top    = rect->top + (LONGLONG)height * index / count;
+    band->bottom = rect->top + (LONGLONG)height * (index + 1) / count;
+}
+
+struct blend_band
+{
+    const dib_info *dst;
+    const dib_info *src;
+    RECT            rect;
+    POINT           origin;
+    BLENDFUNCTION   blend;
+};
+
+static BOOL blend_band_proc( void *arg )
+{
+    struct blend_band *band = arg;
+
+    band->dst->funcs->blend_rect( band->dst, &band->rect, band->src, &band->origin, band->blend );
+    return TRUE;
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
     POINT origin;
     struct clipped_rects clipped_rects;
-    int i;
+    struct blend_band bands[MAX_BANDS];
+    int i, j, count;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        const RECT *rc = &clipped_rects.rects[i];
+
+        origin.x = src_rect->left + rc->left - dst_rect->left;
+        origin.y = src_rect->top  + rc->top  - dst_rect->top;
+
+        count = get_band_count( rc->right - rc->left, rc->bottom - rc->top );
+        if (count < 2)
+        {
+            dst->funcs->blend_rect( dst, rc, src, &origin, blend );
+            continue;
+        }
+        for (j = 0; j < count; j++)
+        {
+            bands[j].dst = dst;
+            bands[j].src = src;
+            bands[j].blend = blend;
+            get_band_rect( rc, j, count, &bands[j].rect );
+            bands[j].origin.x = origin.x;
+            bands[j].origin.y = origin.y + bands[j].rect.top - rc->top;
+        }
+        run_bands( blend_band_proc, bands, sizeof(bands[0]), count );
     }
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -649,16 +830,47 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_band
+{
+    const dib_info *dib;
+    RECT            rect;
+    const TRIVERTEX *v;
+    int             mode;
+};
+
+static BOOL gradient_band_proc( void *arg )
+{
+    struct gradient_band *band = arg;
+
+    return band->dib->funcs->gradient_rect( band->dib, &band->rect, band->v, band->mode );
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
-    int i;
+    int i, j, count;
     struct clipped_rects clipped_rects;
+    struct gradient_band bands[MAX_BANDS];
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        const RECT *rc = &clipped_rects.rects[i];
+
+        count = get_band_count( rc->right - rc->left, rc->bottom - rc->top );
+        if (count < 2)
+        {
+            if (!(ret = dib->funcs->gradient_rect( dib, rc, v, mode ))) break;
+            continue;
+        }
+        for (j = 0; j < count; j++)
+        {
+            bands[j].dib = dib;
+            bands[j].v = v;
+            bands[j].mode = mode;
+            get_band_rect( rc, j, count, &bands[j].rect );
+        }
+        if (!(ret = run_bands( gradient_band_proc, bands, sizeof(bands[0]), count ))) break;
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1146,6 +1358,123 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
+struct stretch_band
+{
+    dib_info                    *dst_dib;
+    const dib_info              *src_dib;
+    const struct stretch_params *h_params;
+    const struct stretch_params *v_params;
+    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
+                    const dib_info *src_dib, const POINT *src_start,
+                    const struct stretch_params *params, int mode, BOOL keep_dst);
+    POINT                        dst_start;
+    POINT                        src_start;
+    int                          err;
+    int                          length;  /* number of source (shrink) or destination (stretch) rows */
+    int                          width;
+    int                          mode;
+    BOOL                         vstretch;
+};
+
+static BOOL stretch_rows( void *arg )
+{
+    struct stretch_band *band = arg;
+    const struct stretch_params *v_params = band->v_params;
+    POINT dst_start = band->dst_start, src_start = band->src_start;
+    int err = band->err, length = band->length;
+
+    if (band->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = band->width;
+
+        while (length--)
+        {
+            if (need_row)
+            {
+                band->row_fn( band->dst_dib, &dst_start, band->src_dib, &src_start, band->h_params,
+                              band->mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - v_params->dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                offset_rect( &this_row, 0, v_params->dst_inc );
+                copy_rect( band->dst_dib, &this_row, band->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += v_params->src_inc;
+                need_row = TRUE;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            if (band->mode != STRETCH_DELETESCANS || !merged_rows)
+                band->row_fn( band->dst_dib, &dst_start, band->src_dib, &src_start, band->h_params,
+                              band->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += v_params->dst_inc;
+                merged_rows = 0;
+                err += v_params->err_add_1;
+            }
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
+        }
+    }
+    return TRUE;
+}
+
+/* Split the rows of a stretch in count bands by stepping through the vertical
+ * parameters ahead of time. Bands only start on a new destination row, and
+ * always draw their first row instead of copying it from the previous band. */
+static int split_stretch_rows( const struct stretch_band *all, struct stretch_band *bands, int count )
+{
+    const struct stretch_params *v_params = all->v_params;
+    struct stretch_band state = *all;
+    BOOL row_start = TRUE;
+    int i, n = 0, first = 0;
+
+    for (i = 0; i < all->length && n < count; i++)
+    {
+        if (row_start && (LONGLONG)all->length * n <= (LONGLONG)i * count)
+        {
+            if (n) bands[n - 1].length = i - first;
+            bands[n++] = state;
+            first = i;
+        }
+
+        row_start = all->vstretch || state.err > 0;
+        if (state.err > 0)
+        {
+            if (all->vstretch) state.src_start.y += v_params->src_inc;
+            else state.dst_start.y += v_params->dst_inc;
+            state.err += v_params->err_add_1;
+        }
+        else state.err += v_params->err_add_2;
+        if (all->vstretch) state.dst_start.y += v_params->dst_inc;
+        else state.src_start.y += v_params->src_inc;
+    }
+    bands[n - 1].length = all->length - first;
+    return n;
+}
+
 DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
                           const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
                           INT mode )
@@ -1155,11 +1484,9 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_band all, bands[MAX_BANDS];
+    int count;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
@@ -1193,64 +1520,26 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
+    all.dst_dib   = &dst_dib;
+    all.src_dib   = &src_dib;
+    all.h_params  = &h_params;
+    all.v_params  = &v_params;
+    all.row_fn    = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    all.dst_start = dst_start;
+    all.src_start = src_start;
+    all.err       = v_params.err_start;
+    all.length    = v_params.length;
+    all.width     = dst->visrect.right - dst->visrect.left;
+    all.mode      = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    all.vstretch  = vstretch;
+
+    count = get_band_count( all.width, dst->visrect.bottom - dst->visrect.top );
+    if (count > 1 && all.length > 1)
     {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
+        count = split_stretch_rows( &all, bands, count );
+        run_bands( stretch_rows, bands, sizeof(bands[0]), count );
     }
+    else stretch_rows( &all );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
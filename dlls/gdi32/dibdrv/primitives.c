@@ -19,6 +19,9 @@
  */
 
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "gdi_private.h"
 #include "dibdrv.h"
@@ -147,35 +150,101 @@ static inline void do_rop_codes_mask_8(BYTE *dst, BYTE src, struct rop_codes *co
     do_rop_mask_8( dst, (src & codes->a1) ^ codes->a2, (src & codes->x1) ^ codes->x2, mask );
 }
 
+#ifdef __SSE2__
+/* The rop codes are either all zeros or all ones, so they can be applied to
+ * 16 bytes at a time whatever the pixel size. Return the number of bytes done. */
+static inline int do_rop_codes_bytes_sse2(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
+{
+    const __m128i a1 = _mm_set1_epi32( codes->a1 ), a2 = _mm_set1_epi32( codes->a2 );
+    const __m128i x1 = _mm_set1_epi32( codes->x1 ), x2 = _mm_set1_epi32( codes->x2 );
+    int done;
+
+    for (done = 0; done + 16 <= len; done += 16)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + done) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + done) );
+        __m128i and = _mm_xor_si128( _mm_and_si128( s, a1 ), a2 );
+        __m128i xor = _mm_xor_si128( _mm_and_si128( s, x1 ), x2 );
+        _mm_storeu_si128( (__m128i *)(dst + done), _mm_xor_si128( _mm_and_si128( d, and ), xor ));
+    }
+    return done;
+}
+
+/* Same as do_rop_codes_bytes_sse2, starting from the end of the line. */
+static inline int do_rop_codes_bytes_rev_sse2(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
+{
+    const __m128i a1 = _mm_set1_epi32( codes->a1 ), a2 = _mm_set1_epi32( codes->a2 );
+    const __m128i x1 = _mm_set1_epi32( codes->x1 ), x2 = _mm_set1_epi32( codes->x2 );
+    int done;
+
+    for (done = 0; done + 16 <= len; done += 16)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + len - done - 16) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + len - done - 16) );
+        __m128i and = _mm_xor_si128( _mm_and_si128( s, a1 ), a2 );
+        __m128i xor = _mm_xor_si128( _mm_and_si128( s, x1 ), x2 );
+        _mm_storeu_si128( (__m128i *)(dst + len - done - 16), _mm_xor_si128( _mm_and_si128( d, and ), xor ));
+    }
+    return done;
+}
+#endif
+
 static inline void do_rop_codes_line_32(DWORD *dst, const DWORD *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    int done = do_rop_codes_bytes_sse2( (BYTE *)dst, (const BYTE *)src, codes, len * 4 ) / 4;
+    dst += done;
+    src += done;
+    len -= done;
+#endif
     for (; len > 0; len--, src++, dst++) do_rop_codes_32( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_rev_32(DWORD *dst, const DWORD *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    len -= do_rop_codes_bytes_rev_sse2( (BYTE *)dst, (const BYTE *)src, codes, len * 4 ) / 4;
+#endif
     for (src += len - 1, dst += len - 1; len > 0; len--, src--, dst--)
         do_rop_codes_32( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_16(WORD *dst, const WORD *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    int done = do_rop_codes_bytes_sse2( (BYTE *)dst, (const BYTE *)src, codes, len * 2 ) / 2;
+    dst += done;
+    src += done;
+    len -= done;
+#endif
     for (; len > 0; len--, src++, dst++) do_rop_codes_16( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_rev_16(WORD *dst, const WORD *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    len -= do_rop_codes_bytes_rev_sse2( (BYTE *)dst, (const BYTE *)src, codes, len * 2 ) / 2;
+#endif
     for (src += len - 1, dst += len - 1; len > 0; len--, src--, dst--)
         do_rop_codes_16( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_8(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    int done = do_rop_codes_bytes_sse2( dst, src, codes, len );
+    dst += done;
+    src += done;
+    len -= done;
+#endif
     for (; len > 0; len--, src++, dst++) do_rop_codes_8( dst, *src, codes );
 }
 
 static inline void do_rop_codes_line_rev_8(BYTE *dst, const BYTE *src, struct rop_codes *codes, int len)
 {
+#ifdef __SSE2__
+    len -= do_rop_codes_bytes_rev_sse2( dst, src, codes, len );
+#endif
     for (src += len - 1, dst += len - 1; len > 0; len--, src--, dst--)
         do_rop_codes_8( dst, *src, codes );
 }
@@ -1801,6 +1870,20 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+#ifdef __SSE2__
+/* expand 4 555 pixels held in 32-bit values to 888 */
+static inline __m128i convert_555_to_8888_sse2( __m128i val )
+{
+    __m128i r = _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 9 ), _mm_set1_epi32( 0xf80000 )),
+                              _mm_and_si128( _mm_slli_epi32( val, 4 ), _mm_set1_epi32( 0x070000 )));
+    __m128i g = _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 6 ), _mm_set1_epi32( 0x00f800 )),
+                              _mm_and_si128( _mm_slli_epi32( val, 1 ), _mm_set1_epi32( 0x000700 )));
+    __m128i b = _mm_or_si128( _mm_and_si128( _mm_slli_epi32( val, 3 ), _mm_set1_epi32( 0x0000f8 )),
+                              _mm_and_si128( _mm_srli_epi32( val, 2 ), _mm_set1_epi32( 0x000007 )));
+    return _mm_or_si128( r, _mm_or_si128( g, b ));
+}
+#endif
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -1898,7 +1981,18 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
             {
                 dst_pixel = dst_start;
                 src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
+                x = src_rect->left;
+#ifdef __SSE2__
+                for (; x + 8 <= src_rect->right; x += 8, src_pixel += 8, dst_pixel += 8)
+                {
+                    __m128i val = _mm_loadu_si128( (const __m128i *)src_pixel );
+                    _mm_storeu_si128( (__m128i *)dst_pixel,
+                                      convert_555_to_8888_sse2( _mm_unpacklo_epi16( val, _mm_setzero_si128() )));
+                    _mm_storeu_si128( (__m128i *)(dst_pixel + 4),
+                                      convert_555_to_8888_sse2( _mm_unpackhi_epi16( val, _mm_setzero_si128() )));
+                }
+#endif
+                for(; x < src_rect->right; x++)
                 {
                     src_val = *src_pixel++;
                     *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
@@ -4182,32 +4276,127 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+#ifdef __SSE2__
+/* (val + 127) / 255 for each 16-bit value up to 255 * 255 */
+static inline __m128i div_255_sse2( __m128i val )
+{
+    val = _mm_add_epi16( val, _mm_set1_epi16( 127 ));
+    val = _mm_add_epi16( val, _mm_add_epi16( _mm_srli_epi16( val, 8 ), _mm_set1_epi16( 1 )));
+    return _mm_srli_epi16( val, 8 );
+}
+
+/* broadcast the alpha value of the two pixels held in 16-bit channels */
+static inline __m128i get_alpha_sse2( __m128i pixels )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( pixels, 0xff ), 0xff );
+}
+
+/* Pack 16-bit channels back to pixels. Like the C code, which ORs together
+ * the channels shifted into place, a channel overflowing 8 bits sets the
+ * lowest bit of the next one. */
+static inline __m128i pack_channels_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i byte_mask = _mm_set1_epi16( 0xff );
+    __m128i pixels = _mm_packus_epi16( _mm_and_si128( lo, byte_mask ), _mm_and_si128( hi, byte_mask ));
+    __m128i carry = _mm_packus_epi16( _mm_srli_epi16( lo, 8 ), _mm_srli_epi16( hi, 8 ));
+    return _mm_or_si128( pixels, _mm_slli_epi32( carry, 8 ));
+}
+
+/* blend_argb() on 4 pixels */
+static inline __m128i blend_argb_sse2( __m128i dst, __m128i src )
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+    __m128i src_lo = _mm_unpacklo_epi8( src, zero ), src_hi = _mm_unpackhi_epi8( src, zero );
+    __m128i dst_lo = _mm_unpacklo_epi8( dst, zero ), dst_hi = _mm_unpackhi_epi8( dst, zero );
+
+    dst_lo = div_255_sse2( _mm_mullo_epi16( dst_lo, _mm_sub_epi16( max, get_alpha_sse2( src_lo ))));
+    dst_hi = div_255_sse2( _mm_mullo_epi16( dst_hi, _mm_sub_epi16( max, get_alpha_sse2( src_hi ))));
+    return pack_channels_sse2( _mm_add_epi16( src_lo, dst_lo ), _mm_add_epi16( src_hi, dst_hi ));
+}
+
+/* blend_argb_alpha() on 4 pixels */
+static inline __m128i blend_argb_alpha_sse2( __m128i dst, __m128i src, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i src_lo = _mm_unpacklo_epi8( src, zero ), src_hi = _mm_unpackhi_epi8( src, zero );
+
+    src_lo = div_255_sse2( _mm_mullo_epi16( src_lo, _mm_set1_epi16( alpha )));
+    src_hi = div_255_sse2( _mm_mullo_epi16( src_hi, _mm_set1_epi16( alpha )));
+    return blend_argb_sse2( dst, _mm_packus_epi16( src_lo, src_hi ));
+}
+
+/* blend_argb_constant_alpha() on 4 pixels, the alpha value is in all the 16-bit channels */
+static inline __m128i blend_argb_constant_alpha_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    __m128i lo = _mm_add_epi16( _mm_mullo_epi16( _mm_unpacklo_epi8( src, zero ), alpha ),
+                                _mm_mullo_epi16( _mm_unpacklo_epi8( dst, zero ), inv_alpha ));
+    __m128i hi = _mm_add_epi16( _mm_mullo_epi16( _mm_unpackhi_epi8( src, zero ), alpha ),
+                                _mm_mullo_epi16( _mm_unpackhi_epi8( dst, zero ), inv_alpha ));
+    return _mm_packus_epi16( div_255_sse2( lo ), div_255_sse2( hi ));
+}
+
+/* Blend 4 pixels at a time, return the number of pixels done. */
+static inline int blend_line_8888_sse2( DWORD *dst, const DWORD *src, int len, BLENDFUNCTION blend,
+                                        BOOL src_alpha )
+{
+    const __m128i alpha_mask = _mm_set1_epi32( 0xff000000 );
+    const __m128i alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha == 255)
+                d = blend_argb_sse2( d, s );
+            else
+                d = blend_argb_alpha_sse2( d, s, blend.SourceConstantAlpha );
+        }
+        else
+        {
+            if (!src_alpha) s = _mm_or_si128( s, alpha_mask );
+            d = blend_argb_constant_alpha_sse2( d, s, alpha );
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), d );
+    }
+    return x;
+}
+#endif
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, start = 0;
 
-    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
     {
-	if (blend.SourceConstantAlpha == 255)
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+#ifdef __SSE2__
+        start = blend_line_8888_sse2( dst_ptr, src_ptr, rc->right - rc->left, blend,
+                                      src->compression == BI_RGB );
+#endif
+        if (blend.AlphaFormat & AC_SRC_ALPHA)
+        {
+            if (blend.SourceConstantAlpha == 255)
+                for (x = start; x < rc->right - rc->left; x++)
+                    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+            else
+                for (x = start; x < rc->right - rc->left; x++)
+                    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+        }
+        else if (src->compression == BI_RGB)
+            for (x = start; x < rc->right - rc->left; x++)
+                dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
         else
-	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-    }
-    else if (src->compression == BI_RGB)
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
-    else
-	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
-		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+            for (x = start; x < rc->right - rc->left; x++)
+                dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+    }
 }
 
 static void blend_rect_32(const dib_info *dst, const RECT *rc,
@@ -26,6 +26,7 @@
 #include "winbase.h"
 #include "wingdi.h"
 #include "winuser.h"
+#include "winreg.h"
 #include "wincrypt.h"
 #include "mmsystem.h" /* DIBINDEX */
 
@@ -3330,6 +3331,268 @@ static void test_simple_graphics(void)
     DeleteDC(mem_dc);
 }
 
+static void test_dib_performance(void)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog";
+    static const struct
+    {
+        DWORD rop;
+        const char *name;
+    } rops[] =
+    {
+        { SRCCOPY, "SRCCOPY" },
+        { SRCINVERT, "SRCINVERT" },
+        { SRCAND, "SRCAND" },
+        { SRCPAINT, "SRCPAINT" },
+    };
+    static const WORD bpps[] = { 32, 16, 24 };
+    const int width = 1024, height = 768, loops = 20;
+    char bmibuf[sizeof(BITMAPINFO) + 3 * sizeof(DWORD)];
+    BITMAPINFO *bmi = (BITMAPINFO *)bmibuf;
+    HBITMAP dst_dib, src_dib, old_dst, old_src;
+    HDC dst_dc, src_dc;
+    BLENDFUNCTION blend;
+    DWORD *bits, start;
+    int i, j, k;
+    BOOL ret;
+
+    dst_dc = CreateCompatibleDC( 0 );
+    src_dc = CreateCompatibleDC( 0 );
+
+    for (i = 0; i < sizeof(bpps) / sizeof(bpps[0]); i++)
+    {
+        memset( bmibuf, 0, sizeof(bmibuf) );
+        bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+        bmi->bmiHeader.biWidth = width;
+        bmi->bmiHeader.biHeight = -height;
+        bmi->bmiHeader.biPlanes = 1;
+        bmi->bmiHeader.biBitCount = bpps[i];
+        bmi->bmiHeader.biCompression = BI_RGB;
+        dst_dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, NULL, NULL, 0 );
+        ok( dst_dib != NULL, "%u bpp: CreateDIBSection failed\n", bpps[i] );
+
+        bmi->bmiHeader.biBitCount = 32;
+        src_dib = CreateDIBSection( 0, bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+        ok( src_dib != NULL, "CreateDIBSection failed\n" );
+        /* premultiplied pixels with varying alpha */
+        for (j = 0; j < width * height; j++)
+        {
+            DWORD alpha = j & 0xff;
+            bits[j] = (alpha << 24) | (alpha / 2 << 16) | (alpha / 3 << 8) | (alpha / 4);
+        }
+
+        old_dst = SelectObject( dst_dc, dst_dib );
+        old_src = SelectObject( src_dc, src_dib );
+        PatBlt( dst_dc, 0, 0, width, height, WHITENESS );
+
+        for (k = 0; k < sizeof(rops) / sizeof(rops[0]); k++)
+        {
+            start = GetTickCount();
+            for (j = 0; j < loops; j++)
+            {
+                ret = BitBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, rops[k].rop );
+                ok( ret, "%u bpp: BitBlt %s failed\n", bpps[i], rops[k].name );
+            }
+            trace( "%u bpp: BitBlt %s: %u ms\n", bpps[i], rops[k].name, GetTickCount() - start );
+        }
+
+        start = GetTickCount();
+        for (j = 0; j < loops; j++)
+        {
+            ret = StretchBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, SRCCOPY );
+            ok( ret, "%u bpp: StretchBlt failed\n", bpps[i] );
+        }
+        trace( "%u bpp: StretchBlt: %u ms\n", bpps[i], GetTickCount() - start );
+
+        if (pGdiAlphaBlend)
+        {
+            blend.BlendOp = AC_SRC_OVER;
+            blend.BlendFlags = 0;
+            blend.SourceConstantAlpha = 255;
+            blend.AlphaFormat = AC_SRC_ALPHA;
+            start = GetTickCount();
+            for (j = 0; j < loops; j++)
+            {
+                ret = pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+                ok( ret, "%u bpp: GdiAlphaBlend failed\n", bpps[i] );
+            }
+            trace( "%u bpp: GdiAlphaBlend per-pixel alpha: %u ms\n", bpps[i], GetTickCount() - start );
+
+            blend.SourceConstantAlpha = 128;
+            blend.AlphaFormat = 0;
+            start = GetTickCount();
+            for (j = 0; j < loops; j++)
+            {
+                ret = pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+                ok( ret, "%u bpp: GdiAlphaBlend failed\n", bpps[i] );
+            }
+            trace( "%u bpp: GdiAlphaBlend constant alpha: %u ms\n", bpps[i], GetTickCount() - start );
+        }
+
+        start = GetTickCount();
+        for (j = 0; j < loops; j++)
+            for (k = 0; k < height; k += 16)
+                ExtTextOutA( dst_dc, 0, k, ETO_OPAQUE, NULL, text, sizeof(text) - 1, NULL );
+        trace( "%u bpp: ExtTextOut: %u ms\n", bpps[i], GetTickCount() - start );
+
+        SelectObject( dst_dc, old_dst );
+        SelectObject( src_dc, old_src );
+        DeleteObject( dst_dib );
+        DeleteObject( src_dib );
+    }
+
+    DeleteDC( dst_dc );
+    DeleteDC( src_dc );
+}
+
+static void draw_large_operations( HDC dst_dc, HDC src_dc, int width, int height, DWORD threads )
+{
+    static const char * const names[] = { "StretchBlt", "shrinking StretchBlt", "GdiGradientFill rect",
+                                          "GdiGradientFill triangle", "GdiAlphaBlend" };
+    TRIVERTEX vrect[] =
+    {
+        { 0,     0,      0xff00, 0x0000, 0x0000, 0x8000 },
+        { width, height, 0x0000, 0x8000, 0xff00, 0x0000 },
+        { 0,     height, 0x0000, 0xff00, 0x4000, 0xff00 },
+    };
+    GRADIENT_RECT rect = { 0, 1 };
+    GRADIENT_TRIANGLE tri = { 0, 1, 2 };
+    BLENDFUNCTION blend;
+    DWORD start;
+    int i;
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+    blend.SourceConstantAlpha = 255;
+    blend.AlphaFormat = AC_SRC_ALPHA;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        start = GetTickCount();
+        switch (i)
+        {
+        case 0:
+            StretchBlt( dst_dc, 0, 0, width, height, src_dc, 0, 0, width / 2, height / 2, SRCCOPY );
+            break;
+        case 1:
+            StretchBlt( dst_dc, width / 8, height / 8, width / 3, height / 3,
+                        src_dc, 0, 0, width / 2, height / 2, SRCCOPY );
+            break;
+        case 2:
+            if (pGdiGradientFill) pGdiGradientFill( dst_dc, vrect, 2, &rect, 1, GRADIENT_FILL_RECT_H );
+            break;
+        case 3:
+            if (pGdiGradientFill) pGdiGradientFill( dst_dc, vrect, 3, &tri, 1, GRADIENT_FILL_TRIANGLE );
+            break;
+        case 4:
+            if (pGdiAlphaBlend) pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0,
+                                                width / 2, height / 2, blend );
+            break;
+        }
+        trace( "%u threads: %s: %u ms\n", threads, names[i], GetTickCount() - start );
+    }
+}
+
+static void test_band_rendering(void)
+{
+    static const DWORD thread_counts[] = { 1, 2, 4, 8 };
+    const int width = 3840, height = 2160;
+    BITMAPINFO bmi;
+    HBITMAP dst_dib, src_dib, old_dst, old_src;
+    HDC dst_dc, src_dc;
+    HRGN clip, hole;
+    DWORD *dst_bits, *ref_bits, *src_bits, old_value, type, size, wine_disp, gdi_disp;
+    BOOL has_old_value;
+    HKEY wine_key, key;
+    int i, j;
+
+    /* the number of rendering threads is a Wine specific setting */
+    if (RegCreateKeyExA( HKEY_CURRENT_USER, "Software\\Wine", 0, NULL, 0,
+                         KEY_CREATE_SUB_KEY | DELETE, NULL, &wine_key, &wine_disp ))
+    {
+        skip( "can't open the Wine settings key\n" );
+        return;
+    }
+    if (RegCreateKeyExA( wine_key, "GDI", 0, NULL, 0,
+                         KEY_QUERY_VALUE | KEY_SET_VALUE | DELETE, NULL, &key, &gdi_disp ))
+    {
+        skip( "can't open the GDI settings key\n" );
+        if (wine_disp == REG_CREATED_NEW_KEY) RegDeleteKeyA( wine_key, "" );
+        RegCloseKey( wine_key );
+        return;
+    }
+    size = sizeof(old_value);
+    has_old_value = !RegQueryValueExA( key, "RenderThreads", NULL, &type, (BYTE *)&old_value, &size ) &&
+                    type == REG_DWORD;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    dst_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    ok( dst_dib != NULL, "CreateDIBSection failed\n" );
+    src_dib = CreateDIBSection( 0, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    ok( src_dib != NULL, "CreateDIBSection failed\n" );
+    ref_bits = HeapAlloc( GetProcessHeap(), 0, width * height * 4 );
+
+    /* premultiplied pixels with varying alpha */
+    for (i = 0; i < width * height; i++)
+    {
+        DWORD alpha = (i / 3) & 0xff;
+        src_bits[i] = (alpha << 24) | (alpha / 2 << 16) | ((i % width) * alpha / width << 8) | (alpha / 4);
+    }
+
+    dst_dc = CreateCompatibleDC( 0 );
+    src_dc = CreateCompatibleDC( 0 );
+    old_dst = SelectObject( dst_dc, dst_dib );
+    old_src = SelectObject( src_dc, src_dib );
+
+    /* bands must respect the clipping of each rectangle */
+    clip = CreateRectRgn( 16, 9, width - 33, height - 7 );
+    hole = CreateRectRgn( width / 2, 0, width / 2 + 5, height );
+    CombineRgn( clip, clip, hole, RGN_DIFF );
+    SelectClipRgn( dst_dc, clip );
+    DeleteObject( hole );
+    DeleteObject( clip );
+
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+    {
+        RegSetValueExA( key, "RenderThreads", 0, REG_DWORD, (const BYTE *)&thread_counts[i],
+                        sizeof(thread_counts[i]) );
+        memset( dst_bits, 0x55, width * height * 4 );
+        draw_large_operations( dst_dc, src_dc, width, height, thread_counts[i] );
+        GdiFlush();
+
+        if (!i) memcpy( ref_bits, dst_bits, width * height * 4 );
+        else
+        {
+            for (j = 0; j < width * height; j++) if (dst_bits[j] != ref_bits[j]) break;
+            ok( j == width * height, "%u threads: got %08x at %d,%d, expected %08x\n", thread_counts[i],
+                dst_bits[j % (width * height)], j % width, j / width, ref_bits[j % (width * height)] );
+        }
+    }
+
+    if (has_old_value)
+        RegSetValueExA( key, "RenderThreads", 0, REG_DWORD, (const BYTE *)&old_value, sizeof(old_value) );
+    else
+        RegDeleteValueA( key, "RenderThreads" );
+    if (gdi_disp == REG_CREATED_NEW_KEY) RegDeleteKeyA( key, "" );
+    RegCloseKey( key );
+    if (wine_disp == REG_CREATED_NEW_KEY) RegDeleteKeyA( wine_key, "" );
+    RegCloseKey( wine_key );
+
+    SelectObject( dst_dc, old_dst );
+    SelectObject( src_dc, old_src );
+    DeleteObject( dst_dib );
+    DeleteObject( src_dib );
+    DeleteDC( dst_dc );
+    DeleteDC( src_dc );
+    HeapFree( GetProcessHeap(), 0, ref_bits );
+}
+
 START_TEST(dib)
 {
     HMODULE mod = GetModuleHandleA("gdi32.dll");
@@ -3340,6 +3603,8 @@ START_TEST(dib)
     CryptAcquireContextW(&crypt_prov, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT);
 
     test_simple_graphics();
+    test_dib_performance();
+    test_band_rendering();
 
     CryptReleaseContext(crypt_prov, 0);
 }
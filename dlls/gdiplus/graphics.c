@@ -19,6 +19,9 @@
 #include <stdarg.h>
 #include <math.h>
 #include <limits.h>
+#if defined(__SSE2__) && defined(__SSE2_MATH__)
+#include <emmintrin.h>
+#endif
 
 #include "windef.h"
 #include "winbase.h"
@@ -939,6 +942,323 @@ static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT
     }
 }
 
+/* Source position of a destination column or row when drawing a bitmap
+ * without rotation or skew. */
+struct resample_axis
+{
+    INT   first;    /* index of the first (or only) source pixel, relative to src_rect */
+    INT   second;   /* index of the second source pixel for bilinear filtering */
+    REAL  offset;   /* weight of the second source pixel */
+    BOOL  inside;   /* whether the position is inside the drawn source area */
+};
+
+/* indices used in struct resample_axis for pixels not read from the bitmap */
+#define RESAMPLE_OUTSIDE_COLOR  -1
+#define RESAMPLE_OUT_OF_RANGE   -2
+
+struct resample_params
+{
+    GDIPCONST GpRect *src_rect;
+    const ARGB *src;
+    ARGB *dst;
+    INT dst_stride;   /* in pixels */
+    const struct resample_axis *cols;
+    const struct resample_axis *rows;
+    INT width;
+    ARGB outside_color;
+    BOOL bilinear;
+};
+
+struct resample_band
+{
+    const struct resample_params *params;
+    INT top, bottom;
+    LONG *pending;
+    HANDLE done;
+};
+
+/* Same computation as blend_colors(), using SSE2 for the four channels at once
+ * when the FPU also uses SSE, so that the results are identical. */
+static inline ARGB resample_blend(ARGB start, ARGB end, REAL position)
+{
+#if defined(__SSE2__) && defined(__SSE2_MATH__)
+    const __m128i mask = _mm_set_epi32(0xff, 0xff0000, 0xff00, 0xff);
+    const __m128i rgb_mask = _mm_set_epi32(0, 0xff0000, 0xff00, 0xff);
+    __m128i s = _mm_and_si128(_mm_set_epi32(start >> 24, start, start, start), mask);
+    __m128i e = _mm_and_si128(_mm_set_epi32(end >> 24, end, end, end), mask);
+    __m128 res = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(1.0f - position)),
+                            _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(position)));
+    __m128i channels = _mm_cvttps_epi32(res);
+    __m128i rgb = _mm_and_si128(channels, rgb_mask);
+
+    rgb = _mm_or_si128(rgb, _mm_shuffle_epi32(rgb, _MM_SHUFFLE(1, 0, 3, 2)));
+    rgb = _mm_or_si128(rgb, _mm_shuffle_epi32(rgb, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(rgb) |
+           ((ARGB)_mm_cvtsi128_si32(_mm_shuffle_epi32(channels, _MM_SHUFFLE(3, 3, 3, 3))) << 24);
+#else
+    return blend_colors(start, end, position);
+#endif
+}
+
+/* Map a source coordinate to an index in the locked source area, the same way
+ * sample_bitmap_pixel() does. */
+static INT resample_axis_index(INT pos, UINT size, INT rect_pos, INT rect_size,
+    WrapMode wrap, BOOL flip)
+{
+    if (wrap == WrapModeClamp)
+    {
+        if (pos < 0 || pos >= size)
+            return RESAMPLE_OUTSIDE_COLOR;
+    }
+    else
+    {
+        if (pos < 0)
+            pos = size*2 + pos % (size * 2);
+
+        if (flip && (pos / size) % 2 != 0)
+            pos = size - 1 - pos % size;
+        else
+            pos = pos % size;
+    }
+
+    if (pos < rect_pos || pos >= rect_pos + rect_size)
+        return RESAMPLE_OUT_OF_RANGE;
+
+    return pos - rect_pos;
+}
+
+/* Compute the source pixels needed for each destination column or row, with
+ * the same rounding as resample_bitmap_pixel(). */
+static void init_resample_axis(struct resample_axis *axis, INT first, INT count, REAL origin,
+    REAL step, REAL src_pos, REAL src_size, UINT size, INT rect_pos, INT rect_size, WrapMode wrap, BOOL flip,
+    InterpolationMode interpolation, PixelOffsetMode offset_mode)
+{
+    INT i;
+
+    for (i = 0; i < count; i++)
+    {
+        REAL pos = origin + (first + i) * step;
+
+        axis[i].inside = pos >= src_pos && pos < src_pos + src_size;
+
+        if (interpolation == InterpolationModeNearestNeighbor)
+        {
+            FLOAT pixel_offset = (offset_mode == PixelOffsetModeHalf ||
+                                  offset_mode == PixelOffsetModeHighQuality) ? 0.0 : 0.5;
+
+            axis[i].first = axis[i].second = resample_axis_index(floorf(pos + pixel_offset),
+                size, rect_pos, rect_size, wrap, flip);
+            axis[i].offset = 0.0;
+        }
+        else
+        {
+            REAL posf = floorf(pos);
+
+            axis[i].first = resample_axis_index((INT)posf, size, rect_pos, rect_size, wrap, flip);
+            axis[i].second = resample_axis_index((INT)ceilf(pos), size, rect_pos, rect_size, wrap, flip);
+            axis[i].offset = pos - posf;
+        }
+    }
+}
+
+static inline ARGB resample_fetch(const struct resample_params *params, INT x, INT y)
+{
+    if (x < 0 || y < 0)
+    {
+        if (x == RESAMPLE_OUTSIDE_COLOR || y == RESAMPLE_OUTSIDE_COLOR)
+            return params->outside_color;
+        return 0xffcd0084;
+    }
+    return params->src[x + y * params->src_rect->Width];
+}
+
+/* Filter one source row horizontally into a row of destination width. */
+static void resample_row(const struct resample_params *params, INT y, ARGB *row)
+{
+    INT x;
+
+    for (x = 0; x < params->width; x++)
+    {
+        const struct resample_axis *col = &params->cols[x];
+        ARGB left;
+
+        if (!col->inside) continue;
+
+        /* a zero offset always gives back the first color */
+        left = resample_fetch(params, col->first, y);
+        if (col->offset == 0.0 || !params->bilinear)
+            row[x] = left;
+        else
+            row[x] = resample_blend(left, resample_fetch(params, col->second, y), col->offset);
+    }
+}
+
+static void resample_rows(const struct resample_params *params, INT top, INT bottom, ARGB *buffer)
+{
+    ARGB *row1 = buffer, *row2 = buffer + params->width, *tmp;
+    INT y, x, row1_y = INT_MIN, row2_y = INT_MIN;
+
+    for (y = top; y < bottom; y++)
+    {
+        const struct resample_axis *row = &params->rows[y];
+        ARGB *dst = params->dst + y * params->dst_stride;
+
+        if (!row->inside)
+        {
+            memset(dst, 0, params->width * sizeof(ARGB));
+            continue;
+        }
+
+        /* source rows are filtered horizontally only once, and reused for
+         * all the destination rows they contribute to */
+        if (row->first != row1_y)
+        {
+            if (row->first == row2_y)
+            {
+                tmp = row1; row1 = row2; row2 = tmp;
+                row2_y = row1_y;
+                row1_y = row->first;
+            }
+            else
+            {
+                resample_row(params, row->first, row1);
+                row1_y = row->first;
+            }
+        }
+
+        if (row->offset == 0.0 || !params->bilinear)
+        {
+            for (x = 0; x < params->width; x++)
+                dst[x] = params->cols[x].inside ? row1[x] : 0;
+            continue;
+        }
+
+        if (row->second != row2_y)
+        {
+            resample_row(params, row->second, row2);
+            row2_y = row->second;
+        }
+
+        for (x = 0; x < params->width; x++)
+            dst[x] = params->cols[x].inside ? resample_blend(row1[x], row2[x], row->offset) : 0;
+    }
+}
+
+static DWORD WINAPI resample_band_proc(void *arg)
+{
+    struct resample_band *band = arg;
+    ARGB *buffer = HeapAlloc(GetProcessHeap(), 0, 2 * band->params->width * sizeof(ARGB));
+
+    if (buffer)
+        resample_rows(band->params, band->top, band->bottom, buffer);
+    else
+        ERR("out of memory, band %d-%d not drawn\n", band->top, band->bottom);
+
+    HeapFree(GetProcessHeap(), 0, buffer);
+    if (!InterlockedDecrement(band->pending)) SetEvent(band->done);
+    return 0;
+}
+
+/* minimum number of destination pixels in a band processed by a separate thread */
+#define RESAMPLE_BAND_PIXELS 65536
+#define RESAMPLE_MAX_BANDS   16
+
+/* Scale a bitmap without rotation or skew. Since the filter is separable, each
+ * source row only needs to be filtered horizontally once, and the destination
+ * is split in bands of rows that are resampled in parallel. */
+static GpStatus resample_bitmap_scaled(GDIPCONST GpRect *src_rect, const ARGB *src, UINT width,
+    UINT height, REAL srcx, REAL srcy, REAL srcwidth, REAL srcheight, const RECT *dst_area,
+    ARGB *dst, const GpPointF *origin, REAL x_dx, REAL y_dy,
+    GDIPCONST GpImageAttributes *attributes, InterpolationMode interpolation,
+    PixelOffsetMode offset_mode)
+{
+    struct resample_params params;
+    struct resample_band bands[RESAMPLE_MAX_BANDS];
+    struct resample_axis *axes;
+    INT dst_width = dst_area->right - dst_area->left;
+    INT dst_height = dst_area->bottom - dst_area->top;
+    INT i, count;
+    SYSTEM_INFO info;
+    LONG pending;
+    ARGB *buffer;
+
+    static int fixme;
+
+    if (interpolation != InterpolationModeNearestNeighbor && interpolation != InterpolationModeBilinear)
+    {
+        if (!fixme++)
+            FIXME("Unimplemented interpolation %i\n", interpolation);
+        interpolation = InterpolationModeBilinear;
+    }
+
+    axes = GdipAlloc((dst_width + dst_height) * sizeof(*axes));
+    buffer = GdipAlloc(2 * dst_width * sizeof(ARGB));
+    if (!axes || !buffer)
+    {
+        GdipFree(axes);
+        GdipFree(buffer);
+        return OutOfMemory;
+    }
+
+    init_resample_axis(axes, dst_area->left, dst_width, origin->X, x_dx, srcx, srcwidth,
+        width, src_rect->X, src_rect->Width, attributes->wrap, (attributes->wrap & 1) == 1,
+        interpolation, offset_mode);
+    init_resample_axis(axes + dst_width, dst_area->top, dst_height, origin->Y, y_dy, srcy, srcheight,
+        height, src_rect->Y, src_rect->Height, attributes->wrap, (attributes->wrap & 2) == 2,
+        interpolation, offset_mode);
+
+    params.src_rect = src_rect;
+    params.src = src;
+    params.dst = dst;
+    params.dst_stride = dst_width;
+    params.cols = axes;
+    params.rows = axes + dst_width;
+    params.width = dst_width;
+    params.outside_color = attributes->outside_color;
+    params.bilinear = interpolation == InterpolationModeBilinear;
+
+    GetSystemInfo(&info);
+    count = min(info.dwNumberOfProcessors, RESAMPLE_MAX_BANDS);
+    count = min(count, (INT)((LONGLONG)dst_width * dst_height / RESAMPLE_BAND_PIXELS));
+    if (count < 2) count = 1;
+
+    pending = count - 1;
+    bands[0].done = NULL;
+    if (count > 1 && !(bands[0].done = CreateEventW(NULL, TRUE, FALSE, NULL)))
+        count = 1;
+
+    for (i = 0; i < count; i++)
+    {
+        bands[i].params = &params;
+        bands[i].top = (LONGLONG)dst_height * i / count;
+        bands[i].bottom = (LONGLONG)dst_height * (i + 1) / count;
+        bands[i].pending = &pending;
+        bands[i].done = bands[0].done;
+    }
+
+    /* the calling thread handles the first band itself */
+    for (i = 1; i < count; i++)
+    {
+        if (!QueueUserWorkItem(resample_band_proc, &bands[i], WT_EXECUTEDEFAULT))
+        {
+            resample_rows(&params, bands[i].top, bands[i].bottom, buffer);
+            if (!InterlockedDecrement(&pending)) SetEvent(bands[0].done);
+        }
+    }
+
+    resample_rows(&params, bands[0].top, bands[0].bottom, buffer);
+
+    if (bands[0].done)
+    {
+        WaitForSingleObject(bands[0].done, INFINITE);
+        CloseHandle(bands[0].done);
+    }
+
+    GdipFree(buffer);
+    GdipFree(axes);
+    return Ok;
+}
+
 static REAL intersect_line_scanline(const GpPointF *p1, const GpPointF *p2, REAL y)
 {
     return (p1->X - p2->X) * (p2->Y - y) / (p2->Y - p1->Y) + p2->X;
@@ -2958,23 +3278,30 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
             y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
 
-            for (x=dst_area.left; x<dst_area.right; x++)
+            /* rotations and skews need the generic code below */
+            if (x_dy != 0.0 || y_dx != 0.0 ||
+                resample_bitmap_scaled(&src_area, (const ARGB *)src_data, bitmap->width, bitmap->height,
+                    srcx, srcy, srcwidth, srcheight, &dst_area, (ARGB *)dst_data, &dst_to_src_points[0],
+                    x_dx, y_dy, imageAttributes, interpolation, offset_mode) != Ok)
             {
-                for (y=dst_area.top; y<dst_area.bottom; y++)
+                for (x=dst_area.left; x<dst_area.right; x++)
                 {
-                    GpPointF src_pointf;
-                    ARGB *dst_color;
+                    for (y=dst_area.top; y<dst_area.bottom; y++)
+                    {
+                        GpPointF src_pointf;
+                        ARGB *dst_color;
 
-                    src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
-                    src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
+                        src_pointf.X = dst_to_src_points[0].X + x * x_dx + y * y_dx;
+                        src_pointf.Y = dst_to_src_points[0].Y + x * x_dy + y * y_dy;
 
-                    dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
+                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
 
-                    if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                        *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                           imageAttributes, interpolation, offset_mode);
-                    else
-                        *dst_color = 0;
+                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
+                            *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
+                                                               imageAttributes, interpolation, offset_mode);
+                        else
+                            *dst_color = 0;
+                    }
                 }
             }
 
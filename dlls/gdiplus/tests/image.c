@@ -3983,6 +3983,68 @@ static void test_DrawImage_scale(void)
     expect(Ok, status);
 }
 
+static void test_DrawImage_scale_performance(void)
+{
+    static const struct
+    {
+        InterpolationMode mode;
+        const char *name;
+    } modes[] =
+    {
+        { InterpolationModeDefault, "Default" },
+        { InterpolationModeLowQuality, "LowQuality" },
+        { InterpolationModeHighQuality, "HighQuality" },
+        { InterpolationModeBilinear, "Bilinear" },
+        { InterpolationModeBicubic, "Bicubic" },
+        { InterpolationModeNearestNeighbor, "NearestNeighbor" },
+        { InterpolationModeHighQualityBilinear, "HighQualityBilinear" },
+        { InterpolationModeHighQualityBicubic, "HighQualityBicubic" },
+    };
+    const INT src_width = 1024, src_height = 768, dst_width = 2560, dst_height = 1440;
+    GpStatus status;
+    GpBitmap *src, *dst;
+    GpGraphics *graphics;
+    ARGB color;
+    DWORD start;
+    int i;
+
+    status = GdipCreateBitmapFromScan0(src_width, src_height, 0, PixelFormat32bppARGB, NULL, &src);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)src, &graphics);
+    expect(Ok, status);
+    status = GdipGraphicsClear(graphics, 0xff408020);
+    expect(Ok, status);
+    GdipDeleteGraphics(graphics);
+
+    status = GdipCreateBitmapFromScan0(dst_width, dst_height, 0, PixelFormat32bppARGB, NULL, &dst);
+    expect(Ok, status);
+    status = GdipGetImageGraphicsContext((GpImage *)dst, &graphics);
+    expect(Ok, status);
+
+    for (i = 0; i < sizeof(modes)/sizeof(modes[0]); i++)
+    {
+        status = GdipSetInterpolationMode(graphics, modes[i].mode);
+        expect(Ok, status);
+        status = GdipGraphicsClear(graphics, 0xff000000);
+        expect(Ok, status);
+
+        start = GetTickCount();
+        status = GdipDrawImageRectI(graphics, (GpImage *)src, 0, 0, dst_width, dst_height);
+        expect(Ok, status);
+        trace("%s: scaling %dx%d to %dx%d took %u ms\n", modes[i].name,
+              src_width, src_height, dst_width, dst_height, GetTickCount() - start);
+
+        /* a uniform image must stay uniform whatever the filter */
+        status = GdipBitmapGetPixel(dst, dst_width / 3, dst_height / 3, &color);
+        expect(Ok, status);
+        ok(color_match(0xff408020, color, 1), "%s: got color %08x\n", modes[i].name, color);
+    }
+
+    GdipDeleteGraphics(graphics);
+    GdipDisposeImage((GpImage *)src);
+    GdipDisposeImage((GpImage *)dst);
+}
+
 static const BYTE animatedgif[] = {
 'G','I','F','8','9','a',0x01,0x00,0x01,0x00,0xA1,0x02,0x00,
 0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,
@@ -4283,6 +4345,7 @@ START_TEST(image)
     test_CloneBitmapArea();
     test_ARGB_conversion();
     test_DrawImage_scale();
+    test_DrawImage_scale_performance();
     test_image_format();
     test_DrawImage();
     test_GdipDrawImagePointRect();
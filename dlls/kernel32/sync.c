@@ -2158,6 +2158,44 @@ BOOL WINAPI GetQueuedCompletionStatus( HANDLE CompletionPort, LPDWORD lpNumberOf
 }
 
 
+/******************************************************************************
+ *		GetQueuedCompletionStatusEx (KERNEL32.@)
+ */
+C_ASSERT( sizeof(OVERLAPPED_ENTRY) == sizeof(FILE_IO_COMPLETION_INFORMATION) );
+
+BOOL WINAPI GetQueuedCompletionStatusEx( HANDLE port, OVERLAPPED_ENTRY *entries, ULONG count,
+                                         ULONG *written, DWORD timeout, BOOL alertable )
+{
+    LARGE_INTEGER time;
+    NTSTATUS ret;
+    ULONG i;
+
+    TRACE("%p %p %u %p %u %u\n", port, entries, count, written, timeout, alertable);
+
+    ret = NtRemoveIoCompletionEx( port, (FILE_IO_COMPLETION_INFORMATION *)entries, count,
+                                  written, get_nt_timeout( &time, timeout ), alertable );
+    if (ret == STATUS_SUCCESS)
+    {
+        /* the entries have the same size, convert them in place */
+        for (i = 0; i < *written; i++)
+        {
+            FILE_IO_COMPLETION_INFORMATION info = ((FILE_IO_COMPLETION_INFORMATION *)entries)[i];
+
+            entries[i].lpCompletionKey            = info.CompletionKey;
+            entries[i].lpOverlapped               = (LPOVERLAPPED)info.CompletionValue;
+            entries[i].Internal                   = info.IoStatusBlock.u.Status;
+            entries[i].dwNumberOfBytesTransferred = info.IoStatusBlock.Information;
+        }
+        return TRUE;
+    }
+
+    if (ret == STATUS_TIMEOUT) SetLastError( WAIT_TIMEOUT );
+    else if (ret == STATUS_USER_APC) SetLastError( WAIT_IO_COMPLETION );
+    else SetLastError( RtlNtStatusToDosError(ret) );
+    return FALSE;
+}
+
+
 /******************************************************************************
  *		PostQueuedCompletionStatus (KERNEL32.@)
  */
@@ -2374,3 +2412,21 @@ BOOL WINAPI SleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable, RTL_SRW
     }
     return TRUE;
 }
+
+/***********************************************************************
+ *           WaitOnAddress   (KERNEL32.@)
+ */
+BOOL WINAPI WaitOnAddress( volatile void *addr, void *cmp, SIZE_T size, DWORD timeout )
+{
+    NTSTATUS status;
+    LARGE_INTEGER time;
+
+    status = RtlWaitOnAddress( (const void *)addr, cmp, size, get_nt_timeout( &time, timeout ) );
+
+    if (status != STATUS_SUCCESS)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return FALSE;
+    }
+    return TRUE;
+}
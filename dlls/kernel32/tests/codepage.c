@@ -603,6 +603,62 @@ static void test_threadcp(void)
     SetThreadLocale(last);
 }
 
+static void test_conversion_throughput(void)
+{
+    static const struct
+    {
+        const char *name;
+        UINT cp;
+        WCHAR first, range;  /* characters used to fill the text */
+    } tests[] =
+    {
+        { "ASCII UTF-8",   CP_UTF8, 0x20,   0x5f },
+        { "Latin-1 UTF-8", CP_UTF8, 0xa0,   0x60 },
+        { "CJK UTF-8",     CP_UTF8, 0x4e00, 0x5000 },
+        { "ASCII 1252",    1252,    0x20,   0x5f },
+        { "Latin-1 1252",  1252,    0xa0,   0x60 },
+    };
+    const int count = 0x10000, loops = 100;
+    WCHAR *text, *bufW;
+    char *bufA;
+    DWORD start, mb_ticks, wc_ticks;
+    int i, j, len, lenW;
+
+    text = HeapAlloc(GetProcessHeap(), 0, count * sizeof(WCHAR));
+    bufW = HeapAlloc(GetProcessHeap(), 0, count * sizeof(WCHAR));
+    bufA = HeapAlloc(GetProcessHeap(), 0, count * 3);
+
+    for (i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        /* mostly the given characters, with some spaces as in real text */
+        for (j = 0; j < count; j++)
+            text[j] = (j % 8 == 7) ? ' ' : tests[i].first + (j * 7) % tests[i].range;
+
+        len = WideCharToMultiByte(tests[i].cp, 0, text, count, bufA, count * 3, NULL, NULL);
+        ok(len > 0, "%s: WideCharToMultiByte failed %u\n", tests[i].name, GetLastError());
+        lenW = MultiByteToWideChar(tests[i].cp, 0, bufA, len, bufW, count);
+        ok(lenW == count, "%s: wrong length %d\n", tests[i].name, lenW);
+        ok(!memcmp(text, bufW, count * sizeof(WCHAR)), "%s: round trip failed\n", tests[i].name);
+
+        start = GetTickCount();
+        for (j = 0; j < loops; j++)
+            WideCharToMultiByte(tests[i].cp, 0, text, count, bufA, count * 3, NULL, NULL);
+        wc_ticks = GetTickCount() - start;
+
+        start = GetTickCount();
+        for (j = 0; j < loops; j++)
+            MultiByteToWideChar(tests[i].cp, 0, bufA, len, bufW, count);
+        mb_ticks = GetTickCount() - start;
+
+        trace("%s: %u chars x %u: WideCharToMultiByte %u ms, MultiByteToWideChar %u ms\n",
+              tests[i].name, count, loops, wc_ticks, mb_ticks);
+    }
+
+    HeapFree(GetProcessHeap(), 0, text);
+    HeapFree(GetProcessHeap(), 0, bufW);
+    HeapFree(GetProcessHeap(), 0, bufA);
+}
+
 START_TEST(codepage)
 {
     BOOL bUsedDefaultChar;
@@ -620,4 +676,5 @@ START_TEST(codepage)
 
     test_undefined_byte_char();
     test_threadcp();
+    test_conversion_throughput();
 }
@@ -4088,6 +4088,172 @@ todo_wine
     }
 }
 
+static void test_mixed_case_lookup(void)
+{
+    static const unsigned int nb_files = 1000, nb_opens = 100000;
+    char temp_path[MAX_PATH], dir[MAX_PATH + 16], path[MAX_PATH + 64];
+    WIN32_FIND_DATAA data;
+    unsigned int i, failures = 0;
+    HANDLE handle;
+    DWORD start;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    sprintf( dir, "%swinetest_case", temp_path );
+    ret = CreateDirectoryA( dir, NULL );
+    ok( ret, "CreateDirectory failed with error %u\n", GetLastError() );
+
+    for (i = 0; i < nb_files; i++)
+    {
+        sprintf( path, "%s\\file_%04u.txt", dir, i );
+        handle = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, NULL );
+        ok( handle != INVALID_HANDLE_VALUE, "failed to create %s, error %u\n", path, GetLastError() );
+        CloseHandle( handle );
+    }
+
+    start = GetTickCount();
+    for (i = 0; i < nb_opens; i++)
+    {
+        sprintf( path, "%s\\%s_%04u.%s", dir, (i & 1) ? "FILE" : "File",
+                 (i * 7919) % nb_files, (i & 2) ? "TXT" : "txt" );
+        handle = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, 0, NULL );
+        if (handle == INVALID_HANDLE_VALUE) failures++;
+        else CloseHandle( handle );
+    }
+    ok( !failures, "%u opens failed\n", failures );
+    trace( "opening %u mixed-case paths: %u ms\n", nb_opens, GetTickCount() - start );
+
+    sprintf( path, "%s\\FILE_0042.TXT", dir );
+    handle = FindFirstFileA( path, &data );
+    ok( handle != INVALID_HANDLE_VALUE, "FindFirstFile failed with error %u\n", GetLastError() );
+    ok( !strcmp( data.cFileName, "file_0042.txt" ), "got %s\n", data.cFileName );
+    FindClose( handle );
+
+    sprintf( path, "%s\\NO_SUCH_FILE.TXT", dir );
+    handle = FindFirstFileA( path, &data );
+    ok( handle == INVALID_HANDLE_VALUE, "FindFirstFile succeeded\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "got error %u\n", GetLastError() );
+
+    /* the listing must be updated when files are added or removed */
+    sprintf( path, "%s\\NEW_FILE.TXT", dir );
+    ok( GetFileAttributesA( path ) == INVALID_FILE_ATTRIBUTES, "%s exists\n", path );
+    sprintf( path, "%s\\new_file.txt", dir );
+    handle = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_NEW, 0, NULL );
+    ok( handle != INVALID_HANDLE_VALUE, "failed to create %s, error %u\n", path, GetLastError() );
+    CloseHandle( handle );
+    sprintf( path, "%s\\New_File.Txt", dir );
+    ok( GetFileAttributesA( path ) != INVALID_FILE_ATTRIBUTES, "%s doesn't exist\n", path );
+    sprintf( path, "%s\\new_file.txt", dir );
+    ret = DeleteFileA( path );
+    ok( ret, "DeleteFile failed with error %u\n", GetLastError() );
+    sprintf( path, "%s\\NEW_FILE.TXT", dir );
+    ok( GetFileAttributesA( path ) == INVALID_FILE_ATTRIBUTES, "%s exists\n", path );
+
+    for (i = 0; i < nb_files; i++)
+    {
+        sprintf( path, "%s\\file_%04u.txt", dir, i );
+        DeleteFileA( path );
+    }
+    ret = RemoveDirectoryA( dir );
+    ok( ret, "RemoveDirectory failed with error %u\n", GetLastError() );
+}
+
+#define NB_READ_HANDLES 1024
+#define NB_READ_THREADS 4
+
+struct read_thread_params
+{
+    HANDLE *handles;
+    unsigned int first;
+    unsigned int failures;
+    char path[MAX_PATH];
+};
+
+static DWORD WINAPI read_thread( void *arg )
+{
+    struct read_thread_params *params = arg;
+    OVERLAPPED ov;
+    unsigned int i, idx;
+    DWORD count;
+    char ch;
+
+    for (i = 0; i < 50000; i++)
+    {
+        /* the first handles belong to each thread, the others are shared */
+        idx = (i % 8) ? NB_READ_THREADS + (params->first + i * 7) % (NB_READ_HANDLES - NB_READ_THREADS)
+                      : params->first;
+        memset( &ov, 0, sizeof(ov) );
+        ov.Offset = i % 256;
+        if (!ReadFile( params->handles[idx], &ch, 1, &count, &ov ) || count != 1 ||
+            (unsigned char)ch != ov.Offset)
+            params->failures++;
+
+        /* reopen one of our own handles from time to time, the handle values get reused */
+        if (!(i % 1000))
+        {
+            idx = params->first;
+            CloseHandle( params->handles[idx] );
+            params->handles[idx] = CreateFileA( params->path, GENERIC_READ,
+                                                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                                OPEN_EXISTING, 0, NULL );
+            if (params->handles[idx] == INVALID_HANDLE_VALUE) params->failures++;
+        }
+    }
+    return 0;
+}
+
+static void test_concurrent_reads(void)
+{
+    struct read_thread_params params[NB_READ_THREADS];
+    HANDLE threads[NB_READ_THREADS], *handles;
+    char temp_path[MAX_PATH], path[MAX_PATH], data[256];
+    unsigned int i;
+    DWORD count, start;
+    HANDLE file;
+    BOOL ret;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "wt", 0, path );
+    file = CreateFileA( path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed with error %u\n", GetLastError() );
+    for (i = 0; i < sizeof(data); i++) data[i] = i;
+    ret = WriteFile( file, data, sizeof(data), &count, NULL );
+    ok( ret && count == sizeof(data), "WriteFile failed with error %u\n", GetLastError() );
+    CloseHandle( file );
+
+    handles = HeapAlloc( GetProcessHeap(), 0, NB_READ_HANDLES * sizeof(*handles) );
+    for (i = 0; i < NB_READ_HANDLES; i++)
+    {
+        handles[i] = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                  OPEN_EXISTING, 0, NULL );
+        ok( handles[i] != INVALID_HANDLE_VALUE, "CreateFile failed with error %u\n", GetLastError() );
+    }
+
+    start = GetTickCount();
+    for (i = 0; i < NB_READ_THREADS; i++)
+    {
+        params[i].handles = handles;
+        params[i].first = i;
+        params[i].failures = 0;
+        strcpy( params[i].path, path );
+        threads[i] = CreateThread( NULL, 0, read_thread, &params[i], 0, NULL );
+        ok( threads[i] != NULL, "CreateThread failed with error %u\n", GetLastError() );
+    }
+    WaitForMultipleObjects( NB_READ_THREADS, threads, TRUE, INFINITE );
+    trace( "%u threads reading from %u handles: %u ms\n", NB_READ_THREADS, NB_READ_HANDLES,
+           GetTickCount() - start );
+
+    for (i = 0; i < NB_READ_THREADS; i++)
+    {
+        ok( !params[i].failures, "thread %u: %u reads failed\n", i, params[i].failures );
+        CloseHandle( threads[i] );
+    }
+    for (i = 0; i < NB_READ_HANDLES; i++) CloseHandle( handles[i] );
+    HeapFree( GetProcessHeap(), 0, handles );
+    DeleteFileA( path );
+}
+
 START_TEST(file)
 {
     InitFunctionPointers();
@@ -4133,4 +4299,6 @@ START_TEST(file)
     test_OpenFileById();
     test_SetFileValidData();
     test_file_access();
+    test_mixed_case_lookup();
+    test_concurrent_reads();
 }
@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
 struct heap_layout
@@ -853,6 +854,129 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+#define LFH_ITERATIONS 2000
+#define LFH_BLOCKS     64
+
+static DWORD WINAPI lfh_thread( void *arg )
+{
+    HANDLE heap = arg;
+    BYTE *ptrs[LFH_BLOCKS];
+    unsigned int i, j;
+
+    for (i = 0; i < LFH_ITERATIONS; i++)
+    {
+        for (j = 0; j < LFH_BLOCKS; j++)
+        {
+            SIZE_T size = 1 + (i * 37 + j * 13) % 600;
+            if (!(ptrs[j] = HeapAlloc( heap, 0, size ))) return 1;
+            memset( ptrs[j], j, size );
+        }
+        for (j = 0; j < LFH_BLOCKS; j++)
+        {
+            if (ptrs[j][0] != j) return 2;
+            if (!HeapFree( heap, 0, ptrs[j] )) return 3;
+        }
+    }
+    return 0;
+}
+
+static DWORD run_lfh_threads( HANDLE heap, unsigned int count )
+{
+    HANDLE threads[8];
+    DWORD start, code;
+    unsigned int i;
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        threads[i] = CreateThread( NULL, 0, lfh_thread, heap, 0, NULL );
+        ok( threads[i] != NULL, "CreateThread failed %u\n", GetLastError() );
+    }
+    WaitForMultipleObjects( count, threads, TRUE, INFINITE );
+    for (i = 0; i < count; i++)
+    {
+        GetExitCodeThread( threads[i], &code );
+        ok( !code, "thread %u failed with %u\n", i, code );
+        CloseHandle( threads[i] );
+    }
+    return GetTickCount() - start;
+}
+
+static void test_HeapSetInformation(void)
+{
+    static const unsigned int thread_counts[] = { 1, 2, 4, 8 };
+    HANDLE heap;
+    ULONG info;
+    BYTE *ptr, *ptr2;
+    unsigned int i, j;
+    DWORD time[2];
+    BOOL ret;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed %u\n", GetLastError() );
+
+    info = 2;
+    SetLastError(0xdeadbeef);
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, 0 );
+    ok( !ret, "HeapSetInformation should fail\n" );
+
+    info = 2;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    if (!ret)
+    {
+        skip( "low-fragmentation heap not available, heap debugging enabled?\n" );
+        HeapDestroy( heap );
+        return;
+    }
+
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    info = 0;
+    ret = pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "low-fragmentation heap should not be disabled\n" );
+
+    /* freed blocks are reused with the new size and contents */
+    ptr = HeapAlloc( heap, 0, 100 );
+    ok( ptr != NULL, "HeapAlloc failed\n" );
+    memset( ptr, 0xcc, 100 );
+    ok( HeapFree( heap, 0, ptr ), "HeapFree failed\n" );
+    ptr2 = HeapAlloc( heap, HEAP_ZERO_MEMORY, 99 );
+    ok( ptr2 != NULL, "HeapAlloc failed\n" );
+    ok( HeapSize( heap, 0, ptr2 ) == 99, "wrong size %lu\n", HeapSize( heap, 0, ptr2 ) );
+    for (j = 0; j < 99; j++) if (ptr2[j]) break;
+    ok( j == 99, "block not zeroed at %u\n", j );
+    ok( HeapFree( heap, 0, ptr2 ), "HeapFree failed\n" );
+    ok( HeapValidate( heap, 0, NULL ), "heap is not valid\n" );
+
+    HeapDestroy( heap );
+
+    /* compare the allocation throughput of the standard and low-fragmentation heaps */
+    for (i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+    {
+        for (j = 0; j < 2; j++)
+        {
+            heap = HeapCreate( 0, 0, 0 );
+            info = 2;
+            if (j) pHeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+            time[j] = run_lfh_threads( heap, thread_counts[i] );
+            ok( HeapValidate( heap, 0, NULL ), "heap is not valid\n" );
+            HeapDestroy( heap );
+        }
+        trace( "%u threads: standard heap %u ms, low-fragmentation heap %u ms\n",
+               thread_counts[i], time[0], time[1] );
+    }
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1173,6 +1297,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), (2 << 20));
     test_sized_HeapReAlloc((1 << 20), 1);
     test_HeapQueryInformation();
+    test_HeapSetInformation();
 
     if (pRtlGetNtGlobalFlags)
     {
@@ -1671,6 +1671,111 @@ static void test_CompareStringEx(void)
 
 }
 
+/* check properties any collation has for every BMP character; this doesn't compare
+ * against expected results, so it also runs on Windows */
+static void test_CompareStringW_bmp(void)
+{
+    static const DWORD flags[] = { 0, NORM_IGNORECASE, NORM_IGNORENONSPACE, SORT_STRINGSORT };
+    WCHAR str1[4], str2[4];
+    int i, ret, ret2, failures;
+    unsigned int ch;
+
+    for (i = 0; i < sizeof(flags)/sizeof(flags[0]); i++)
+    {
+        /* a common leading char must never change the result */
+        for (ch = 1, failures = 0; ch <= 0xffff; ch++)
+        {
+            str1[0] = str2[0] = ch;
+            str1[1] = 'x';
+            str2[1] = 'y';
+            ret = CompareStringW(LOCALE_USER_DEFAULT, flags[i], str1, 2, str2, 2);
+            if (ret != CSTR_LESS_THAN && !failures++)
+                ok(0, "flags %#x: char %04x: got %d\n", flags[i], ch, ret);
+        }
+        ok(!failures, "flags %#x: %d failures with a common prefix\n", flags[i], failures);
+
+        /* comparing in either order must give opposite results */
+        for (ch = 1, failures = 0; ch <= 0xffff; ch++)
+        {
+            str1[0] = 'a';
+            str1[1] = ch;
+            str1[2] = 'b';
+            str2[0] = 'a';
+            str2[1] = (ch & 1) ? '-' : 0xe9;
+            str2[2] = 'B';
+            ret = CompareStringW(LOCALE_USER_DEFAULT, flags[i], str1, 3, str2, 3);
+            ret2 = CompareStringW(LOCALE_USER_DEFAULT, flags[i], str2, 3, str1, 3);
+            if (ret + ret2 != CSTR_LESS_THAN + CSTR_GREATER_THAN && !failures++)
+                ok(0, "flags %#x: char %04x: got %d and %d\n", flags[i], ch, ret, ret2);
+        }
+        ok(!failures, "flags %#x: %d asymmetric results\n", flags[i], failures);
+    }
+}
+
+static WCHAR sort_strings[2000][16];
+static char sort_keys[2000][64];
+
+static int compare_sort_strings(const void *e1, const void *e2)
+{
+    const WCHAR *s1 = sort_strings[*(const int *)e1];
+    const WCHAR *s2 = sort_strings[*(const int *)e2];
+
+    return CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORECASE, s1, -1, s2, -1) - CSTR_EQUAL;
+}
+
+static int compare_sort_keys(const void *e1, const void *e2)
+{
+    return strcmp(sort_keys[*(const int *)e1], sort_keys[*(const int *)e2]);
+}
+
+static void test_sort_performance(void)
+{
+    static const char prefix[] = "Item_";
+    const int count = sizeof(sort_strings)/sizeof(sort_strings[0]);
+    int order[sizeof(sort_strings)/sizeof(sort_strings[0])];
+    DWORD start, compare_ticks, key_ticks;
+    int i, j, ret;
+
+    /* file name like strings sharing a common prefix, as in a list view */
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; prefix[j]; j++) sort_strings[i][j] = prefix[j];
+        sort_strings[i][j++] = (i % 3) ? 'a' + (i * 7) % 26 : 'A' + (i * 7) % 26;
+        sort_strings[i][j++] = '0' + (i / 100) % 10;
+        sort_strings[i][j++] = '0' + (i / 10) % 10;
+        sort_strings[i][j++] = '0' + i % 10;
+        sort_strings[i][j] = 0;
+    }
+
+    for (i = 0; i < count; i++) order[i] = i;
+    start = GetTickCount();
+    qsort(order, count, sizeof(order[0]), compare_sort_strings);
+    compare_ticks = GetTickCount() - start;
+
+    for (i = 1; i < count; i++)
+    {
+        ret = CompareStringW(LOCALE_USER_DEFAULT, NORM_IGNORECASE,
+                             sort_strings[order[i - 1]], -1, sort_strings[order[i]], -1);
+        if (ret == CSTR_GREATER_THAN) break;
+    }
+    ok(i == count, "strings are not sorted at %d\n", i);
+
+    /* precomputed sort keys only need to be generated once per string */
+    for (i = 0; i < count; i++) order[i] = i;
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        ret = LCMapStringW(LOCALE_USER_DEFAULT, LCMAP_SORTKEY | NORM_IGNORECASE, sort_strings[i], -1,
+                           (WCHAR *)sort_keys[i], sizeof(sort_keys[i]));
+        ok(ret, "LCMapStringW failed for %s: %u\n", wine_dbgstr_w(sort_strings[i]), GetLastError());
+    }
+    qsort(order, count, sizeof(order[0]), compare_sort_keys);
+    key_ticks = GetTickCount() - start;
+
+    trace("sorting %d strings: CompareStringW %u ms, sort keys %u ms\n",
+          count, compare_ticks, key_ticks);
+}
+
 static void test_LCMapStringA(void)
 {
     int ret, ret2;
@@ -3842,6 +3947,8 @@ START_TEST(locale)
   test_GetNumberFormatA();   /* Also tests the W version */
   test_CompareStringA();
   test_CompareStringEx();
+  test_CompareStringW_bmp();
+  test_sort_performance();
   test_LCMapStringA();
   test_LCMapStringW();
   test_LCMapStringEx();
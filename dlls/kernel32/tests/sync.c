@@ -56,6 +56,12 @@ static VOID   (WINAPI *pReleaseSRWLockShared)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockExclusive)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockShared)(PSRWLOCK);
 
+static BOOL   (WINAPI *pWaitOnAddress)(volatile void *,void *,SIZE_T,DWORD);
+static VOID   (WINAPI *pWakeByAddressAll)(void *);
+static VOID   (WINAPI *pWakeByAddressSingle)(void *);
+
+static BOOL   (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,OVERLAPPED_ENTRY*,ULONG,ULONG*,DWORD,BOOL);
+
 static void test_signalandwait(void)
 {
     DWORD (WINAPI *pSignalObjectAndWait)(HANDLE, HANDLE, DWORD, BOOL);
@@ -489,6 +495,226 @@ static void test_semaphore(void)
     CloseHandle( handle );
 }
 
+static DWORD WINAPI wait_object_thread(void *arg)
+{
+    return WaitForSingleObject( arg, 5000 );
+}
+
+static void test_signal_and_wait_mix(void)
+{
+    HANDLE sem, sem2, event, handles[2], thread;
+    LONG prev;
+    DWORD r;
+    BOOL ret;
+
+    /* releasing and waiting through different handles of the same semaphore */
+    sem = CreateSemaphoreA( NULL, 0, 3, NULL );
+    ok( sem != NULL, "CreateSemaphore failed with error %u\n", GetLastError() );
+    ret = DuplicateHandle( GetCurrentProcess(), sem, GetCurrentProcess(), &sem2, 0, FALSE, DUPLICATE_SAME_ACCESS );
+    ok( ret, "DuplicateHandle failed with error %u\n", GetLastError() );
+
+    prev = 0xdeadbeef;
+    ret = ReleaseSemaphore( sem, 2, &prev );
+    ok( ret, "ReleaseSemaphore failed with error %u\n", GetLastError() );
+    ok( prev == 0, "wrong previous count %d\n", prev );
+    SetLastError( 0xdeadbeef );
+    prev = 0xdeadbeef;
+    ret = ReleaseSemaphore( sem2, 2, &prev );
+    ok( !ret, "ReleaseSemaphore succeeded\n" );
+    ok( GetLastError() == ERROR_TOO_MANY_POSTS, "wrong error %u\n", GetLastError() );
+    ok( prev == 0xdeadbeef, "previous count changed to %d\n", prev );
+
+    r = WaitForSingleObject( sem2, 0 );
+    ok( r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r );
+    r = WaitForMultipleObjects( 1, &sem, FALSE, 0 );
+    ok( r == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", r );
+    r = WaitForSingleObject( sem, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", r );
+
+    ret = ReleaseSemaphore( sem2, 1, &prev );
+    ok( ret, "ReleaseSemaphore failed with error %u\n", GetLastError() );
+    ok( prev == 0, "wrong previous count %d\n", prev );
+    CloseHandle( sem2 );
+
+    /* a handle without modify access can only be waited on */
+    ret = DuplicateHandle( GetCurrentProcess(), sem, GetCurrentProcess(), &sem2, SYNCHRONIZE, FALSE, 0 );
+    ok( ret, "DuplicateHandle failed with error %u\n", GetLastError() );
+    SetLastError( 0xdeadbeef );
+    ret = ReleaseSemaphore( sem2, 1, NULL );
+    ok( !ret, "ReleaseSemaphore succeeded\n" );
+    ok( GetLastError() == ERROR_ACCESS_DENIED, "wrong error %u\n", GetLastError() );
+    r = WaitForSingleObject( sem2, 0 );
+    ok( r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r );
+    CloseHandle( sem2 );
+
+    /* waking up a thread blocked on the semaphore */
+    thread = CreateThread( NULL, 0, wait_object_thread, sem, 0, NULL );
+    Sleep( 100 );
+    ret = ReleaseSemaphore( sem, 1, NULL );
+    ok( ret, "ReleaseSemaphore failed with error %u\n", GetLastError() );
+    r = WaitForSingleObject( thread, 5000 );
+    ok( r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r );
+    GetExitCodeThread( thread, &r );
+    ok( r == WAIT_OBJECT_0, "thread wait returned %u\n", r );
+    CloseHandle( thread );
+    r = WaitForSingleObject( sem, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", r );
+
+    /* waking up a thread blocked on an auto-reset event */
+    event = CreateEventA( NULL, FALSE, FALSE, NULL );
+    ok( event != NULL, "CreateEvent failed with error %u\n", GetLastError() );
+    thread = CreateThread( NULL, 0, wait_object_thread, event, 0, NULL );
+    Sleep( 100 );
+    ret = SetEvent( event );
+    ok( ret, "SetEvent failed with error %u\n", GetLastError() );
+    r = WaitForSingleObject( thread, 5000 );
+    ok( r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r );
+    GetExitCodeThread( thread, &r );
+    ok( r == WAIT_OBJECT_0, "thread wait returned %u\n", r );
+    CloseHandle( thread );
+    r = WaitForSingleObject( event, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", r );
+
+    /* waiting for all objects consumes both of them */
+    handles[0] = event;
+    handles[1] = sem;
+    SetEvent( event );
+    r = WaitForMultipleObjects( 2, handles, TRUE, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForMultipleObjects returned %u\n", r );
+    r = WaitForSingleObject( event, 0 );
+    ok( r == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", r );
+    SetEvent( event );
+    ReleaseSemaphore( sem, 1, NULL );
+    r = WaitForMultipleObjects( 2, handles, TRUE, 0 );
+    ok( r == WAIT_OBJECT_0, "WaitForMultipleObjects returned %u\n", r );
+    r = WaitForSingleObject( event, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", r );
+    r = WaitForSingleObject( sem, 0 );
+    ok( r == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", r );
+
+    CloseHandle( event );
+    CloseHandle( sem );
+}
+
+struct wait_all_race
+{
+    HANDLE handles[2];  /* auto-reset event and semaphore */
+    HANDLE start;
+    HANDLE done;
+    DWORD  result[2];  /* wait-all in the thread, single wait in the main thread */
+};
+
+static DWORD WINAPI wait_all_race_thread(void *arg)
+{
+    struct wait_all_race *race = arg;
+    int i;
+
+    for (i = 0; i < 200; i++)
+    {
+        WaitForSingleObject( race->start, INFINITE );
+        race->result[0] = WaitForMultipleObjects( 2, race->handles, TRUE, 0 );
+        SetEvent( race->done );
+    }
+    return 0;
+}
+
+static void test_wait_all_race(void)
+{
+    struct wait_all_race race;
+    HANDLE thread;
+    int i, both = 0;
+    DWORD r;
+
+    race.handles[0] = CreateEventA( NULL, FALSE, FALSE, NULL );
+    race.handles[1] = CreateSemaphoreA( NULL, 1000, 1000, NULL );
+    race.start = CreateEventA( NULL, FALSE, FALSE, NULL );
+    race.done = CreateEventA( NULL, FALSE, FALSE, NULL );
+    thread = CreateThread( NULL, 0, wait_all_race_thread, &race, 0, NULL );
+
+    /* a wait-all and a single wait racing for an auto-reset event can't both get it */
+    for (i = 0; i < 200; i++)
+    {
+        SetEvent( race.handles[0] );
+        SetEvent( race.start );
+        race.result[1] = WaitForSingleObject( race.handles[0], 0 );
+        WaitForSingleObject( race.done, INFINITE );
+        if (race.result[0] == WAIT_OBJECT_0 && race.result[1] == WAIT_OBJECT_0) both++;
+        ok( race.result[0] == WAIT_OBJECT_0 || race.result[1] == WAIT_OBJECT_0,
+            "nobody got the event, results %u %u\n", race.result[0], race.result[1] );
+        r = WaitForSingleObject( race.handles[0], 0 );
+        ok( r == WAIT_TIMEOUT, "event still signaled, results %u %u\n", race.result[0], race.result[1] );
+    }
+    ok( !both, "event acquired by both waiters %d times\n", both );
+
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    CloseHandle( race.handles[0] );
+    CloseHandle( race.handles[1] );
+    CloseHandle( race.start );
+    CloseHandle( race.done );
+}
+
+static const int ping_pong_count = 10000;
+
+static void event_ping_pong_child(void)
+{
+    HANDLE ping = OpenEventA( SYNCHRONIZE, FALSE, "wine_test_sync_ping" );
+    HANDLE pong = OpenEventA( EVENT_MODIFY_STATE, FALSE, "wine_test_sync_pong" );
+    int i;
+
+    ok( ping && pong, "OpenEvent failed with error %u\n", GetLastError() );
+    for (i = 0; i < ping_pong_count; i++)
+    {
+        if (WaitForSingleObject( ping, 10000 )) break;
+        SetEvent( pong );
+    }
+    CloseHandle( ping );
+    CloseHandle( pong );
+}
+
+static void test_event_ping_pong(void)
+{
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA si = { sizeof(si) };
+    LARGE_INTEGER freq, start, end;
+    HANDLE ping, pong;
+    char cmdline[MAX_PATH];
+    char **argv;
+    int i;
+    DWORD r = 0;
+    BOOL ret;
+
+    ping = CreateEventA( NULL, FALSE, FALSE, "wine_test_sync_ping" );
+    pong = CreateEventA( NULL, FALSE, FALSE, "wine_test_sync_pong" );
+    ok( ping && pong, "CreateEvent failed with error %u\n", GetLastError() );
+
+    winetest_get_mainargs( &argv );
+    sprintf( cmdline, "\"%s\" sync ping_pong", argv[0] );
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    ok( ret, "CreateProcess failed with error %u\n", GetLastError() );
+    if (!ret) goto done;
+
+    /* round trips between two processes, the child answers each event with another */
+    QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &start );
+    for (i = 0; i < ping_pong_count; i++)
+    {
+        SetEvent( ping );
+        if ((r = WaitForSingleObject( pong, 10000 ))) break;
+    }
+    QueryPerformanceCounter( &end );
+    ok( !r, "WaitForSingleObject returned %u after %d round trips\n", r, i );
+    trace( "cross-process event round trip: %.2f us\n",
+           (double)(end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart / ping_pong_count );
+
+    winetest_wait_child_process( pi.hProcess );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+done:
+    CloseHandle( ping );
+    CloseHandle( pong );
+}
+
 static void test_waitable_timer(void)
 {
     HANDLE handle, handle2;
@@ -634,6 +860,111 @@ static void test_iocp_callback(void)
        "Last error is %d\n", GetLastError());
 }
 
+static HANDLE pingpong_ports[2];
+
+static DWORD WINAPI iocp_pingpong_thread( void *arg )
+{
+    DWORD count = (DWORD_PTR)arg, i, bytes;
+    ULONG_PTR key;
+    OVERLAPPED *ovl;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!GetQueuedCompletionStatus( pingpong_ports[1], &bytes, &key, &ovl, 5000 )) break;
+        if (!PostQueuedCompletionStatus( pingpong_ports[0], bytes, key, ovl )) break;
+    }
+    return i;
+}
+
+static void CALLBACK iocp_user_apc( ULONG_PTR arg )
+{
+    *(BOOL *)arg = TRUE;
+}
+
+static void test_completion_port_ex(void)
+{
+    static const DWORD count = 20000;
+    OVERLAPPED_ENTRY entries[8];
+    OVERLAPPED *ovl;
+    HANDLE port, thread;
+    DWORD i, bytes, start, elapsed, ret;
+    ULONG_PTR key;
+    ULONG removed;
+    BOOL bret, apc_called = FALSE;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip( "GetQueuedCompletionStatusEx not available\n" );
+        return;
+    }
+
+    port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed %u\n", GetLastError() );
+
+    /* packets are removed in a batch, in the order they were posted */
+    for (i = 0; i < 3; i++)
+    {
+        bret = PostQueuedCompletionStatus( port, 100 + i, 10 + i, (OVERLAPPED *)(ULONG_PTR)(0x1000 + i) );
+        ok( bret, "PostQueuedCompletionStatus failed %u\n", GetLastError() );
+    }
+    removed = 0xdeadbeef;
+    bret = pGetQueuedCompletionStatusEx( port, entries, 8, &removed, 0, FALSE );
+    ok( bret, "GetQueuedCompletionStatusEx failed %u\n", GetLastError() );
+    ok( removed == 3, "removed %u packets\n", removed );
+    for (i = 0; i < removed; i++)
+    {
+        ok( entries[i].lpCompletionKey == 10 + i, "%u: wrong key %lu\n", i, entries[i].lpCompletionKey );
+        ok( entries[i].lpOverlapped == (OVERLAPPED *)(ULONG_PTR)(0x1000 + i), "%u: wrong overlapped %p\n",
+            i, entries[i].lpOverlapped );
+        ok( entries[i].dwNumberOfBytesTransferred == 100 + i, "%u: wrong size %u\n",
+            i, entries[i].dwNumberOfBytesTransferred );
+    }
+
+    SetLastError( 0xdeadbeef );
+    bret = pGetQueuedCompletionStatusEx( port, entries, 8, &removed, 0, FALSE );
+    ok( !bret && GetLastError() == WAIT_TIMEOUT, "got %d, error %u\n", bret, GetLastError() );
+
+    /* alertable waits return when an APC is queued */
+    QueueUserAPC( iocp_user_apc, GetCurrentThread(), (ULONG_PTR)&apc_called );
+    SetLastError( 0xdeadbeef );
+    bret = pGetQueuedCompletionStatusEx( port, entries, 8, &removed, 1000, TRUE );
+    ok( !bret && GetLastError() == WAIT_IO_COMPLETION, "got %d, error %u\n", bret, GetLastError() );
+    ok( apc_called, "APC wasn't called\n" );
+
+    /* many more packets than fit in memory shared with the server */
+    for (i = 0; i < 3000; i++) PostQueuedCompletionStatus( port, i, 0, NULL );
+    for (i = 0; i < 3000; i++)
+    {
+        bret = GetQueuedCompletionStatus( port, &bytes, &key, &ovl, 0 );
+        if (!bret || bytes != i) break;
+    }
+    ok( i == 3000, "got packet %u out of order, size %u, error %u\n", i, bytes, GetLastError() );
+    bret = GetQueuedCompletionStatus( port, &bytes, &key, &ovl, 0 );
+    ok( !bret && GetLastError() == WAIT_TIMEOUT, "got %d, error %u\n", bret, GetLastError() );
+
+    /* ping-pong between two threads, measuring the round trips */
+    pingpong_ports[0] = port;
+    pingpong_ports[1] = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    thread = CreateThread( NULL, 0, iocp_pingpong_thread, (void *)(DWORD_PTR)count, 0, NULL );
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        if (!PostQueuedCompletionStatus( pingpong_ports[1], i, 0, NULL )) break;
+        if (!GetQueuedCompletionStatus( port, &bytes, &key, &ovl, 5000 ) || bytes != i) break;
+    }
+    elapsed = GetTickCount() - start;
+    ok( i == count, "ping-pong stopped after %u round trips\n", i );
+    WaitForSingleObject( thread, 5000 );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == count, "thread did %u round trips\n", ret );
+    trace( "%u completion port round trips in %u ms, %u per second\n", i, elapsed,
+           elapsed ? (DWORD)(i * 1000.0 / elapsed) : 0 );
+
+    CloseHandle( thread );
+    CloseHandle( pingpong_ports[1] );
+    CloseHandle( port );
+}
+
 static void CALLBACK timer_queue_cb1(PVOID p, BOOLEAN timedOut)
 {
     int *pn = p;
@@ -2284,9 +2615,173 @@ static void test_srwlock_example(void)
     trace("number of total exclusive accesses is %d\n", srwlock_protected_value);
 }
 
+static SRWLOCK srwlock_stress;
+static LONG srwlock_stress_writers, srwlock_stress_readers, srwlock_stress_errors;
+static DWORD srwlock_stress_value;
+
+struct srwlock_stress_params
+{
+    int iterations;
+    int read_percent;
+};
+
+static DWORD WINAPI srwlock_stress_thread(void *arg)
+{
+    const struct srwlock_stress_params *params = arg;
+    unsigned int seed = GetCurrentThreadId();
+    int i;
+
+    for (i = 0; i < params->iterations; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 100 < params->read_percent)
+        {
+            pAcquireSRWLockShared(&srwlock_stress);
+            InterlockedIncrement(&srwlock_stress_readers);
+            if (srwlock_stress_writers) InterlockedIncrement(&srwlock_stress_errors);
+            InterlockedDecrement(&srwlock_stress_readers);
+            pReleaseSRWLockShared(&srwlock_stress);
+        }
+        else
+        {
+            pAcquireSRWLockExclusive(&srwlock_stress);
+            if (InterlockedIncrement(&srwlock_stress_writers) != 1 || srwlock_stress_readers)
+                InterlockedIncrement(&srwlock_stress_errors);
+            srwlock_stress_value++;
+            InterlockedDecrement(&srwlock_stress_writers);
+            pReleaseSRWLockExclusive(&srwlock_stress);
+        }
+    }
+    return 0;
+}
+
+static void test_srwlock_stress(void)
+{
+    static const int read_percents[] = { 0, 50, 90 };
+    static const int thread_counts[] = { 1, 2, 4, 8 };
+    struct srwlock_stress_params params;
+    HANDLE threads[8];
+    DWORD start, expected;
+    int i, j, k;
+
+    if (!pInitializeSRWLock)
+    {
+        win_skip("no srw lock support.\n");
+        return;
+    }
+
+    params.iterations = 20000;
+    for (i = 0; i < sizeof(read_percents)/sizeof(read_percents[0]); i++)
+    {
+        params.read_percent = read_percents[i];
+        for (j = 0; j < sizeof(thread_counts)/sizeof(thread_counts[0]); j++)
+        {
+            pInitializeSRWLock(&srwlock_stress);
+            srwlock_stress_value = srwlock_stress_errors = 0;
+
+            start = GetTickCount();
+            for (k = 0; k < thread_counts[j]; k++)
+                threads[k] = CreateThread(NULL, 0, srwlock_stress_thread, &params, 0, NULL);
+            for (k = 0; k < thread_counts[j]; k++)
+            {
+                ok(!WaitForSingleObject(threads[k], 60000), "thread %d didn't finish\n", k);
+                CloseHandle(threads[k]);
+            }
+            trace("%d threads, %d%% readers: %u ms\n", thread_counts[j], params.read_percent,
+                  GetTickCount() - start);
+
+            ok(!srwlock_stress_errors, "%d threads, %d%% readers: %d errors\n",
+               thread_counts[j], params.read_percent, srwlock_stress_errors);
+            expected = params.iterations * thread_counts[j];
+            if (!params.read_percent)
+                ok(srwlock_stress_value == expected, "got %u exclusive accesses, expected %u\n",
+                   srwlock_stress_value, expected);
+            else
+                ok(srwlock_stress_value <= expected, "got %u exclusive accesses\n", srwlock_stress_value);
+            ok(pTryAcquireSRWLockExclusive(&srwlock_stress), "lock is still owned\n");
+            pReleaseSRWLockExclusive(&srwlock_stress);
+        }
+    }
+}
+
+static LONG address_value;
+
+static DWORD WINAPI wake_address_thread(void *arg)
+{
+    Sleep(100);
+    InterlockedExchange(&address_value, 1);
+    pWakeByAddressAll(&address_value);
+    return 0;
+}
+
+static void test_WaitOnAddress(void)
+{
+    LONG compare;
+    WORD small = 0x1234, small_compare;
+    HANDLE thread;
+    DWORD start;
+    BOOL ret;
+
+    if (!pWaitOnAddress)
+    {
+        win_skip("WaitOnAddress not available.\n");
+        return;
+    }
+
+    /* invalid size */
+    address_value = compare = 0;
+    SetLastError(0xdeadbeef);
+    ret = pWaitOnAddress(&address_value, &compare, 3, 0);
+    ok(!ret, "WaitOnAddress succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "wrong error %u\n", GetLastError());
+
+    /* the value is already different */
+    compare = 1;
+    ret = pWaitOnAddress(&address_value, &compare, sizeof(compare), INFINITE);
+    ok(ret, "WaitOnAddress failed with error %u\n", GetLastError());
+    small_compare = 0x4321;
+    ret = pWaitOnAddress(&small, &small_compare, sizeof(small), INFINITE);
+    ok(ret, "WaitOnAddress failed with error %u\n", GetLastError());
+
+    /* timeout */
+    compare = 0;
+    SetLastError(0xdeadbeef);
+    start = GetTickCount();
+    ret = pWaitOnAddress(&address_value, &compare, sizeof(compare), 100);
+    ok(!ret, "WaitOnAddress succeeded\n");
+    ok(GetLastError() == ERROR_TIMEOUT, "wrong error %u\n", GetLastError());
+    ok(GetTickCount() - start >= 90, "returned too early\n");
+
+    /* waking up nobody is fine */
+    pWakeByAddressSingle(&address_value);
+    pWakeByAddressAll(&address_value);
+
+    /* woken up by another thread, spurious wakeups are allowed */
+    thread = CreateThread(NULL, 0, wake_address_thread, NULL, 0, NULL);
+    while (address_value == compare)
+    {
+        ret = pWaitOnAddress(&address_value, &compare, sizeof(compare), 5000);
+        ok(ret, "WaitOnAddress failed with error %u\n", GetLastError());
+        if (!ret) break;
+    }
+    ok(address_value == 1, "got %d\n", address_value);
+    WaitForSingleObject(thread, 1000);
+    CloseHandle(thread);
+}
+
 START_TEST(sync)
 {
     HMODULE hdll = GetModuleHandleA("kernel32.dll");
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs( &argv );
+    if (argc >= 3 && !strcmp( argv[2], "ping_pong" ))
+    {
+        event_ping_pong_child();
+        return;
+    }
+
     pChangeTimerQueueTimer = (void*)GetProcAddress(hdll, "ChangeTimerQueueTimer");
     pCreateTimerQueue = (void*)GetProcAddress(hdll, "CreateTimerQueue");
     pCreateTimerQueueTimer = (void*)GetProcAddress(hdll, "CreateTimerQueueTimer");
@@ -2312,14 +2807,22 @@ START_TEST(sync)
     pReleaseSRWLockShared = (void *)GetProcAddress(hdll, "ReleaseSRWLockShared");
     pTryAcquireSRWLockExclusive = (void *)GetProcAddress(hdll, "TryAcquireSRWLockExclusive");
     pTryAcquireSRWLockShared = (void *)GetProcAddress(hdll, "TryAcquireSRWLockShared");
+    pWaitOnAddress = (void *)GetProcAddress(hdll, "WaitOnAddress");
+    pWakeByAddressAll = (void *)GetProcAddress(hdll, "WakeByAddressAll");
+    pWakeByAddressSingle = (void *)GetProcAddress(hdll, "WakeByAddressSingle");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
 
     test_signalandwait();
     test_mutex();
     test_slist();
     test_event();
     test_semaphore();
+    test_signal_and_wait_mix();
+    test_wait_all_race();
+    test_event_ping_pong();
     test_waitable_timer();
     test_iocp_callback();
+    test_completion_port_ex();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
@@ -2328,4 +2831,6 @@ START_TEST(sync)
     test_condvars_consumer_producer();
     test_srwlock_base();
     test_srwlock_example();
+    test_srwlock_stress();
+    test_WaitOnAddress();
 }
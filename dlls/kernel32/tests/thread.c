@@ -33,6 +33,8 @@
 #include <winnt.h>
 #include <winerror.h>
 #include <winnls.h>
+#include <tlhelp32.h>
+#include <psapi.h>
 #include "wine/test.h"
 
 /* THREAD_ALL_ACCESS in Vista+ PSDKs is incompatible with older Windows versions */
@@ -76,6 +78,7 @@ static DWORD (WINAPI *pSetThreadIdealProcessor)(HANDLE,DWORD);
 static BOOL (WINAPI *pSetThreadPriorityBoost)(HANDLE,BOOL);
 static BOOL (WINAPI *pRegisterWaitForSingleObject)(PHANDLE,HANDLE,WAITORTIMERCALLBACK,PVOID,ULONG,ULONG);
 static BOOL (WINAPI *pUnregisterWait)(HANDLE);
+static BOOL (WINAPI *pK32GetProcessMemoryInfo)(HANDLE,PPROCESS_MEMORY_COUNTERS,DWORD);
 static BOOL (WINAPI *pIsWow64Process)(HANDLE,PBOOL);
 static BOOL (WINAPI *pSetThreadErrorMode)(DWORD,PDWORD);
 static DWORD (WINAPI *pGetThreadErrorMode)(void);
@@ -90,6 +93,7 @@ static PTP_WORK (WINAPI *pCreateThreadpoolWork)(PTP_WORK_CALLBACK,PVOID,PTP_CALL
 static void (WINAPI *pSubmitThreadpoolWork)(PTP_WORK);
 static void (WINAPI *pWaitForThreadpoolWorkCallbacks)(PTP_WORK,BOOL);
 static void (WINAPI *pCloseThreadpoolWork)(PTP_WORK);
+static void (WINAPI *pCloseThreadpool)(PTP_POOL);
 
 static HANDLE create_target_process(const char *arg)
 {
@@ -1129,6 +1133,111 @@ static void test_RegisterWaitForSingleObject(void)
     ok(ret, "UnregisterWait failed with error %d\n", GetLastError());
 }
 
+static DWORD count_process_threads(void)
+{
+    THREADENTRY32 entry;
+    HANDLE snapshot;
+    DWORD count = 0;
+
+    snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) return 0;
+    entry.dwSize = sizeof(entry);
+    if (Thread32First(snapshot, &entry))
+    {
+        do
+        {
+            if (entry.th32OwnerProcessID == GetCurrentProcessId()) count++;
+        } while (Thread32Next(snapshot, &entry));
+    }
+    CloseHandle(snapshot);
+    return count;
+}
+
+static SIZE_T get_process_memory(void)
+{
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!pK32GetProcessMemoryInfo ||
+        !pK32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.PagefileUsage;
+}
+
+#define NUM_WAITS 10000
+
+static LONG many_waits_signaled;
+
+static void CALLBACK many_waits_function(PVOID p, BOOLEAN TimerOrWaitFired)
+{
+    ok(!TimerOrWaitFired, "wait shouldn't have timed out\n");
+    if (InterlockedIncrement(&many_waits_signaled) == NUM_WAITS) SetEvent(p);
+}
+
+static void test_RegisterWaitForSingleObject_many(void)
+{
+    HANDLE *events, *wait_handles, complete_event;
+    DWORD threads_before, threads_after, start, i;
+    SIZE_T memory_before, memory_after;
+    DWORD ret;
+
+    if (!pRegisterWaitForSingleObject || !pUnregisterWait)
+    {
+        win_skip("RegisterWaitForSingleObject or UnregisterWait not implemented\n");
+        return;
+    }
+
+    events = HeapAlloc(GetProcessHeap(), 0, NUM_WAITS * sizeof(*events));
+    wait_handles = HeapAlloc(GetProcessHeap(), 0, NUM_WAITS * sizeof(*wait_handles));
+    complete_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    for (i = 0; i < NUM_WAITS; i++)
+        events[i] = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    threads_before = count_process_threads();
+    memory_before = get_process_memory();
+    start = GetTickCount();
+
+    for (i = 0; i < NUM_WAITS; i++)
+    {
+        ret = pRegisterWaitForSingleObject(&wait_handles[i], events[i], many_waits_function,
+                                           complete_event, INFINITE, WT_EXECUTEONLYONCE);
+        ok(ret, "RegisterWaitForSingleObject failed with error %d\n", GetLastError());
+        if (!ret) break;
+    }
+    if (i < NUM_WAITS)
+    {
+        while (i) pUnregisterWait(wait_handles[--i]);
+        goto done;
+    }
+
+    /* the waits are shared by threads waiting for up to MAXIMUM_WAIT_OBJECTS - 1 objects */
+    threads_after = count_process_threads();
+    memory_after = get_process_memory();
+    trace("%u registered waits: %u threads, %lu KiB committed, registered in %u ms\n", NUM_WAITS,
+          threads_after - threads_before, (unsigned long)(memory_after - memory_before) / 1024,
+          GetTickCount() - start);
+    ok(threads_after - threads_before < NUM_WAITS / 32,
+       "%u threads were created for %u waits\n", threads_after - threads_before, NUM_WAITS);
+
+    start = GetTickCount();
+    for (i = 0; i < NUM_WAITS; i++) SetEvent(events[i]);
+    ret = WaitForSingleObject(complete_event, 30000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ok(many_waits_signaled == NUM_WAITS, "expected %u callbacks, got %u\n", NUM_WAITS, many_waits_signaled);
+    trace("%u waits signaled in %u ms\n", NUM_WAITS, GetTickCount() - start);
+
+    for (i = 0; i < NUM_WAITS; i++)
+    {
+        ret = pUnregisterWait(wait_handles[i]);
+        ok(ret || GetLastError() == ERROR_IO_PENDING, "UnregisterWait failed with error %d\n", GetLastError());
+    }
+
+done:
+    for (i = 0; i < NUM_WAITS; i++) CloseHandle(events[i]);
+    CloseHandle(complete_event);
+    HeapFree(GetProcessHeap(), 0, wait_handles);
+    HeapFree(GetProcessHeap(), 0, events);
+}
+
 static DWORD TLS_main;
 static DWORD TLS_index0, TLS_index1;
 
@@ -1635,7 +1744,8 @@ static void test_threadpool(void)
     ok (workcalled == 1, "expected work to be called once, got %d\n", workcalled);
 
     pool = pCreateThreadpool(NULL);
-    todo_wine ok (pool != NULL, "CreateThreadpool failed\n");
+    ok (pool != NULL, "CreateThreadpool failed\n");
+    pCloseThreadpool(pool);
 }
 
 static void test_reserved_tls(void)
@@ -1690,6 +1800,7 @@ static void init_funcs(void)
     X(SetThreadPriorityBoost);
     X(RegisterWaitForSingleObject);
     X(UnregisterWait);
+    X(K32GetProcessMemoryInfo);
     X(IsWow64Process);
     X(SetThreadErrorMode);
     X(GetThreadErrorMode);
@@ -1700,6 +1811,7 @@ static void init_funcs(void)
     X(ReleaseActCtx);
 
     X(CreateThreadpool);
+    X(CloseThreadpool);
     X(CreateThreadpoolWork);
     X(SubmitThreadpoolWork);
     X(WaitForThreadpoolWorkCallbacks);
@@ -1764,6 +1876,7 @@ START_TEST(thread)
 #endif
    test_QueueUserWorkItem();
    test_RegisterWaitForSingleObject();
+   test_RegisterWaitForSingleObject_many();
    test_TLS();
    test_ThreadErrorMode();
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
@@ -68,7 +68,72 @@ static void test_timer(void)
     CloseHandle( handle );
 }
 
+static void test_many_timers(void)
+{
+    HANDLE (WINAPI *pCreateWaitableTimerA)( SECURITY_ATTRIBUTES*, BOOL, LPSTR );
+    BOOL (WINAPI *pSetWaitableTimer)(HANDLE, LARGE_INTEGER*, LONG, PTIMERAPCROUTINE, LPVOID, BOOL);
+    BOOL (WINAPI *pCancelWaitableTimer)(HANDLE);
+    HMODULE hker = GetModuleHandleA("kernel32.dll");
+    const unsigned int count = 100000;
+    HANDLE *handles, early;
+    LARGE_INTEGER due;
+    DWORD start, ret;
+    unsigned int i;
+
+    pCreateWaitableTimerA = (void*)GetProcAddress( hker, "CreateWaitableTimerA");
+    pSetWaitableTimer = (void*)GetProcAddress( hker, "SetWaitableTimer");
+    pCancelWaitableTimer = (void*)GetProcAddress( hker, "CancelWaitableTimer");
+    if( !pCreateWaitableTimerA || !pSetWaitableTimer || !pCancelWaitableTimer )
+    {
+        win_skip("waitable timers are not available\n");
+        return;
+    }
+
+    handles = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*handles) );
+    for (i = 0; i < count; i++)
+    {
+        handles[i] = pCreateWaitableTimerA( NULL, 0, NULL );
+        if (!handles[i]) break;
+    }
+    ok( i == count, "failed to create timer %u, error %u\n", i, GetLastError() );
+
+    /* arm them in scrambled order, all of them at least an hour away */
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        due.QuadPart = -((LONGLONG)3600 * 10000000 + (LONGLONG)((i * 7919) % count) * 10000);
+        ret = pSetWaitableTimer( handles[i], &due, 0, NULL, NULL, FALSE );
+        if (!ret) break;
+    }
+    ok( i == count, "failed to set timer %u\n", i );
+    trace( "arming %u timers: %u ms\n", count, GetTickCount() - start );
+
+    /* a timer armed after all of them must still expire first */
+    early = pCreateWaitableTimerA( NULL, 0, NULL );
+    due.QuadPart = -500000;
+    ok( pSetWaitableTimer( early, &due, 0, NULL, NULL, FALSE ), "failed to set timer\n" );
+    ret = WaitForSingleObject( early, 5000 );
+    ok( ret == WAIT_OBJECT_0, "wait returned %u\n", ret );
+    ret = WaitForSingleObject( handles[0], 0 );
+    ok( ret == WAIT_TIMEOUT, "wait returned %u\n", ret );
+    CloseHandle( early );
+
+    /* cancel every other timer, then the rest */
+    start = GetTickCount();
+    for (i = 0; i < count; i += 2)
+        if (!pCancelWaitableTimer( handles[i] )) break;
+    ok( i >= count, "failed to cancel timer %u\n", i );
+    for (i = 1; i < count; i += 2)
+        if (!pCancelWaitableTimer( handles[i] )) break;
+    ok( i >= count, "failed to cancel timer %u\n", i );
+    trace( "cancelling %u timers: %u ms\n", count, GetTickCount() - start );
+
+    for (i = 0; i < count; i++) CloseHandle( handles[i] );
+    HeapFree( GetProcessHeap(), 0, handles );
+}
+
 START_TEST(timer)
 {
     test_timer();
+    test_many_timers();
 }
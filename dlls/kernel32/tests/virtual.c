@@ -2489,6 +2489,55 @@ static void test_shared_memory(int is_child)
     CloseHandle(mapping);
 }
 
+static void test_many_views(void)
+{
+    /* don't exhaust a 32-bit address space, each view takes 64K */
+    const int max_views = sizeof(void *) > sizeof(int) ? 100000 : 20000;
+    MEMORY_BASIC_INFORMATION info;
+    DWORD start, alloc_time, query_time, free_time;
+    void **views;
+    int i, count;
+    SIZE_T ret;
+
+    views = HeapAlloc( GetProcessHeap(), 0, max_views * sizeof(*views) );
+
+    start = GetTickCount();
+    for (count = 0; count < max_views; count++)
+        if (!(views[count] = VirtualAlloc( NULL, 0x1000, MEM_RESERVE, PAGE_NOACCESS ))) break;
+    alloc_time = GetTickCount() - start;
+    ok( count >= 1000, "only got %d views\n", count );
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        ret = VirtualQuery( (char *)views[i] + 0x800, &info, sizeof(info) );
+        ok( ret == sizeof(info), "VirtualQuery failed\n" );
+        if (info.AllocationBase != views[i] || info.RegionSize != 0x1000 || info.State != MEM_RESERVE)
+        {
+            ok( 0, "view %d: wrong info %p/%p/%lx/%x\n", i, views[i], info.AllocationBase,
+                info.RegionSize, info.State );
+            break;
+        }
+    }
+    query_time = GetTickCount() - start;
+
+    /* free every other view, then fill the holes again */
+    for (i = 0; i < count; i += 2)
+        ok( VirtualFree( views[i], 0, MEM_RELEASE ), "VirtualFree failed %u\n", GetLastError() );
+    for (i = 0; i < count; i += 2)
+        if (!(views[i] = VirtualAlloc( NULL, 0x1000, MEM_RESERVE, PAGE_NOACCESS ))) break;
+    ok( i >= count, "failed to reallocate view %d, error %u\n", i, GetLastError() );
+    for ( ; i < count; i += 2) views[i] = NULL;
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+        if (views[i]) ok( VirtualFree( views[i], 0, MEM_RELEASE ), "VirtualFree failed %u\n", GetLastError() );
+    free_time = GetTickCount() - start;
+
+    trace( "%d views: alloc %u ms, query %u ms, free %u ms\n", count, alloc_time, query_time, free_time );
+    HeapFree( GetProcessHeap(), 0, views );
+}
+
 START_TEST(virtual)
 {
     int argc;
@@ -2547,4 +2596,5 @@ START_TEST(virtual)
     test_IsBadWritePtr();
     test_IsBadCodePtr();
     test_write_watch();
+    test_many_views();
 }
@@ -29,6 +29,7 @@
 # include <unistd.h>
 #endif
 
+#define NONAMELESSUNION
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "windef.h"
@@ -480,6 +481,178 @@ BOOL WINAPI QueueUserWorkItem( LPTHREAD_START_ROUTINE Function, PVOID Context, U
     return !status;
 }
 
+/***********************************************************************
+ *              CreateThreadpool  (KERNEL32.@)
+ */
+PTP_POOL WINAPI CreateThreadpool( PVOID reserved )
+{
+    TP_POOL *pool;
+    NTSTATUS status;
+
+    TRACE( "%p\n", reserved );
+
+    status = TpAllocPool( &pool, reserved );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    return pool;
+}
+
+/***********************************************************************
+ *              SetThreadpoolThreadMinimum  (KERNEL32.@)
+ */
+BOOL WINAPI SetThreadpoolThreadMinimum( PTP_POOL pool, DWORD minimum )
+{
+    NTSTATUS status;
+
+    TRACE( "%p %u\n", pool, minimum );
+
+    status = TpSetPoolMinThreads( pool, minimum );
+    if (status) SetLastError( RtlNtStatusToDosError(status) );
+    return !status;
+}
+
+/***********************************************************************
+ *              CreateThreadpoolCleanupGroup  (KERNEL32.@)
+ */
+PTP_CLEANUP_GROUP WINAPI CreateThreadpoolCleanupGroup( void )
+{
+    TP_CLEANUP_GROUP *group;
+    NTSTATUS status;
+
+    TRACE( "\n" );
+
+    status = TpAllocCleanupGroup( &group );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    return group;
+}
+
+/***********************************************************************
+ *              TrySubmitThreadpoolCallback  (KERNEL32.@)
+ */
+BOOL WINAPI TrySubmitThreadpoolCallback( PTP_SIMPLE_CALLBACK callback, PVOID userdata,
+                                         TP_CALLBACK_ENVIRON *environment )
+{
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    status = TpSimpleTryPost( callback, userdata, environment );
+    if (status) SetLastError( RtlNtStatusToDosError(status) );
+    return !status;
+}
+
+/***********************************************************************
+ *              CreateThreadpoolWork  (KERNEL32.@)
+ */
+PTP_WORK WINAPI CreateThreadpoolWork( PTP_WORK_CALLBACK callback, PVOID userdata,
+                                      TP_CALLBACK_ENVIRON *environment )
+{
+    TP_WORK *work;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    status = TpAllocWork( &work, callback, userdata, environment );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    return work;
+}
+
+/***********************************************************************
+ *              CreateThreadpoolTimer  (KERNEL32.@)
+ */
+PTP_TIMER WINAPI CreateThreadpoolTimer( PTP_TIMER_CALLBACK callback, PVOID userdata,
+                                        TP_CALLBACK_ENVIRON *environment )
+{
+    TP_TIMER *timer;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    status = TpAllocTimer( &timer, callback, userdata, environment );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    return timer;
+}
+
+/***********************************************************************
+ *              CreateThreadpoolWait  (KERNEL32.@)
+ */
+PTP_WAIT WINAPI CreateThreadpoolWait( PTP_WAIT_CALLBACK callback, PVOID userdata,
+                                      TP_CALLBACK_ENVIRON *environment )
+{
+    TP_WAIT *wait;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    status = TpAllocWait( &wait, callback, userdata, environment );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    return wait;
+}
+
+/* the Win32 callback of an I/O object is stored in its first field */
+static void CALLBACK tp_io_callback( TP_CALLBACK_INSTANCE *instance, void *userdata, void *cvalue,
+                                     IO_STATUS_BLOCK *iosb, TP_IO *io )
+{
+    PTP_WIN32_IO_CALLBACK callback = *(PTP_WIN32_IO_CALLBACK *)io;
+
+    callback( instance, userdata, cvalue, RtlNtStatusToDosError( iosb->u.Status ),
+              iosb->Information, io );
+}
+
+/***********************************************************************
+ *              CreateThreadpoolIo  (KERNEL32.@)
+ */
+PTP_IO WINAPI CreateThreadpoolIo( HANDLE handle, PTP_WIN32_IO_CALLBACK callback, PVOID userdata,
+                                  TP_CALLBACK_ENVIRON *environment )
+{
+    TP_IO *io;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", handle, callback, userdata, environment );
+
+    status = TpAllocIoCompletion( &io, handle, tp_io_callback, userdata, environment );
+    if (status)
+    {
+        SetLastError( RtlNtStatusToDosError(status) );
+        return NULL;
+    }
+    *(PTP_WIN32_IO_CALLBACK *)io = callback;
+    return io;
+}
+
+/***********************************************************************
+ *              CallbackMayRunLong  (KERNEL32.@)
+ */
+BOOL WINAPI CallbackMayRunLong( PTP_CALLBACK_INSTANCE instance )
+{
+    NTSTATUS status;
+
+    TRACE( "%p\n", instance );
+
+    status = TpCallbackMayRunLong( instance );
+    if (status) SetLastError( RtlNtStatusToDosError(status) );
+    return !status;
+}
+
 /**********************************************************************
  * GetThreadTimes [KERNEL32.@]  Obtains timing information.
  *
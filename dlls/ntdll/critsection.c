@@ -63,18 +63,31 @@ static inline void small_pause(void)
 
 static int wait_op = 128; /*FUTEX_WAIT|FUTEX_PRIVATE_FLAG*/
 static int wake_op = 129; /*FUTEX_WAKE|FUTEX_PRIVATE_FLAG*/
+static int wait_bitset_op = 137; /*FUTEX_WAIT_BITSET|FUTEX_PRIVATE_FLAG*/
+static int wake_bitset_op = 138; /*FUTEX_WAKE_BITSET|FUTEX_PRIVATE_FLAG*/
 
-static inline int futex_wait( int *addr, int val, struct timespec *timeout )
+int futex_wait( int *addr, int val, struct timespec *timeout )
 {
     return syscall( __NR_futex, addr, wait_op, val, timeout, 0, 0 );
 }
 
-static inline int futex_wake( int *addr, int val )
+int futex_wake( int *addr, int val )
 {
     return syscall( __NR_futex, addr, wake_op, val, NULL, 0, 0 );
 }
 
-static inline int use_futexes(void)
+/* note: unlike futex_wait, the timeout is absolute (CLOCK_MONOTONIC) */
+int futex_wait_bitset( int *addr, int val, struct timespec *timeout, int mask )
+{
+    return syscall( __NR_futex, addr, wait_bitset_op, val, timeout, 0, mask );
+}
+
+int futex_wake_bitset( int *addr, int val, int mask )
+{
+    return syscall( __NR_futex, addr, wake_bitset_op, val, NULL, 0, mask );
+}
+
+int use_futexes(void)
 {
     static int supported = -1;
 
@@ -85,6 +98,8 @@ static inline int use_futexes(void)
         {
             wait_op = 0; /*FUTEX_WAIT*/
             wake_op = 1; /*FUTEX_WAKE*/
+            wait_bitset_op = 9; /*FUTEX_WAIT_BITSET*/
+            wake_bitset_op = 10; /*FUTEX_WAKE_BITSET*/
             futex_wait( &supported, 10, NULL );
         }
         supported = (errno != ENOSYS);
@@ -177,6 +177,52 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 };
 static RTL_CRITICAL_SECTION dir_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
+/* cache of directory listings, for case-insensitive lookups */
+
+#define DIR_CACHE_MAX_DIRS     64        /* max. number of cached directories */
+#define DIR_CACHE_MAX_ENTRIES  0x40000   /* max. total number of cached entries */
+#define DIR_CACHE_END          (~0u)     /* end of a hash chain */
+
+struct dir_cache_entry
+{
+    unsigned int   next;            /* next entry with the same name hash */
+    unsigned int   next_short;      /* next entry with the same short name hash */
+    unsigned int   unix_name;       /* offset of the Unix name in unix_names */
+    unsigned int   name;            /* offset of the Unicode name in names */
+    unsigned short len;             /* length of the Unicode name */
+    unsigned short short_len;       /* length of the short name, 0 if it's a valid 8.3 name */
+    WCHAR          short_name[12];  /* hashed short name */
+};
+
+struct dir_cache
+{
+    struct list             entry;       /* entry in the LRU list */
+    BOOL                    cached;      /* whether it's in the LRU list */
+    dev_t                   dev;         /* identity of the directory */
+    ino_t                   ino;
+    time_t                  mtime;       /* modification time when the directory was read */
+    time_t                  ctime;       /* change time when the directory was read */
+    unsigned int            count;       /* number of entries */
+    unsigned int            hash_size;   /* size of the hash tables */
+    unsigned int           *hash;        /* hash table of the names */
+    unsigned int           *short_hash;  /* hash table of the short names, built on demand */
+    struct dir_cache_entry *entries;     /* entries in readdir order */
+    WCHAR                  *names;       /* Unicode names */
+    char                   *unix_names;  /* Unix names */
+};
+
+static struct list dir_cache_list = LIST_INIT( dir_cache_list );
+static unsigned int dir_cache_dirs, dir_cache_entries;
+
+static RTL_CRITICAL_SECTION dir_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG dir_cache_critsect_debug =
+{
+    0, 0, &dir_cache_section,
+    { &dir_cache_critsect_debug.ProcessLocksList, &dir_cache_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": dir_cache_section") }
+};
+static RTL_CRITICAL_SECTION dir_cache_section = { &dir_cache_critsect_debug, -1, 0, 0, 0, 0 };
+
 
 /* check if a given Unicode char is OK in a DOS short name */
 static inline BOOL is_invalid_dos_char( WCHAR ch )
@@ -1155,10 +1201,10 @@ static DWORD WINAPI init_options( RTL_RUN_ONCE *once, void *param, void **contex
     static const WCHAR WineW[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e',0};
     static const WCHAR ShowDotFilesW[] = {'S','h','o','w','D','o','t','F','i','l','e','s',0};
     char tmp[80];
-    HANDLE root, hkey;
-    DWORD dummy;
+    HANDLE root;
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING nameW;
+    struct key_value_query query;
 
     RtlOpenCurrentUser( KEY_ALL_ACCESS, &root );
     attr.Length = sizeof(attr);
@@ -1169,16 +1215,15 @@ static DWORD WINAPI init_options( RTL_RUN_ONCE *once, void *param, void **contex
     attr.SecurityQualityOfService = NULL;
     RtlInitUnicodeString( &nameW, WineW );
 
+    query.name   = ShowDotFilesW;
+    query.info   = (KEY_VALUE_PARTIAL_INFORMATION *)tmp;
+    query.length = sizeof(tmp);
+
     /* @@ Wine registry key: HKCU\Software\Wine */
-    if (!NtOpenKey( &hkey, KEY_ALL_ACCESS, &attr ))
+    if (!query_key_values( &attr, &query, 1 ) && !query.status)
     {
-        RtlInitUnicodeString( &nameW, ShowDotFilesW );
-        if (!NtQueryValueKey( hkey, &nameW, KeyValuePartialInformation, tmp, sizeof(tmp), &dummy ))
-        {
-            WCHAR *str = (WCHAR *)((KEY_VALUE_PARTIAL_INFORMATION *)tmp)->Data;
-            show_dot_files = IS_OPTION_TRUE( str[0] );
-        }
-        NtClose( hkey );
+        WCHAR *str = (WCHAR *)query.info->Data;
+        show_dot_files = IS_OPTION_TRUE( str[0] );
     }
     NtClose( root );
 
@@ -2058,6 +2103,280 @@ static void read_directory_readdir( int fd, IO_STATUS_BLOCK *io, void *buffer, U
     else io->u.Status = restart_scan ? STATUS_NO_SUCH_FILE : STATUS_NO_MORE_FILES;
 }
 
+/***********************************************************************
+ *           hash_dir_cache_name
+ */
+static inline unsigned int hash_dir_cache_name( const WCHAR *name, int len )
+{
+    unsigned int hash = 0x811c9dc5;
+    while (len--) hash = (hash ^ tolowerW( *name++ )) * 0x01000193;
+    return hash;
+}
+
+
+/***********************************************************************
+ *           free_dir_cache
+ */
+static void free_dir_cache( struct dir_cache *cache )
+{
+    RtlFreeHeap( GetProcessHeap(), 0, cache->hash );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->short_hash );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->entries );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache->unix_names );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+
+/***********************************************************************
+ *           release_dir_cache
+ *
+ * Release a directory listing that was used for a lookup.
+ * dir_cache_section must be held by caller.
+ */
+static void release_dir_cache( struct dir_cache *cache )
+{
+    if (!cache->cached) free_dir_cache( cache );
+}
+
+
+/***********************************************************************
+ *           read_dir_cache
+ *
+ * Read a whole directory and build the hash table of its entries.
+ */
+static struct dir_cache *read_dir_cache( const char *unix_name, const struct stat *st )
+{
+    struct dir_cache *cache;
+    struct dir_cache_entry *entry;
+    struct dirent *de;
+    DIR *dir;
+    unsigned int i, hash, max_entries = 64, names_size = 1024, unix_size = 1024, names_pos = 0, unix_pos = 0;
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    void *ptr;
+    int len, unix_len;
+
+    if (!(dir = opendir( unix_name ))) return NULL;
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) goto failed;
+    cache->dev   = st->st_dev;
+    cache->ino   = st->st_ino;
+    cache->mtime = st->st_mtime;
+    cache->ctime = st->st_ctime;
+    if (!(cache->entries = RtlAllocateHeap( GetProcessHeap(), 0, max_entries * sizeof(*cache->entries) )) ||
+        !(cache->names = RtlAllocateHeap( GetProcessHeap(), 0, names_size * sizeof(WCHAR) )) ||
+        !(cache->unix_names = RtlAllocateHeap( GetProcessHeap(), 0, unix_size )))
+        goto failed;
+
+    while ((de = readdir( dir )))
+    {
+        unix_len = strlen( de->d_name ) + 1;
+        len = ntdll_umbstowcs( 0, de->d_name, unix_len - 1, buffer, MAX_DIR_ENTRY_LEN );
+        if (len < 0) continue;  /* cannot be found by name anyway */
+
+        if (cache->count == max_entries)
+        {
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->entries,
+                                           2 * max_entries * sizeof(*cache->entries) ))) goto failed;
+            cache->entries = ptr;
+            max_entries *= 2;
+        }
+        if (names_pos + len > names_size)
+        {
+            names_size = max( 2 * names_size, names_pos + len );
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->names, names_size * sizeof(WCHAR) )))
+                goto failed;
+            cache->names = ptr;
+        }
+        if (unix_pos + unix_len > unix_size)
+        {
+            unix_size = max( 2 * unix_size, unix_pos + unix_len );
+            if (!(ptr = RtlReAllocateHeap( GetProcessHeap(), 0, cache->unix_names, unix_size )))
+                goto failed;
+            cache->unix_names = ptr;
+        }
+
+        entry = &cache->entries[cache->count++];
+        entry->name      = names_pos;
+        entry->len       = len;
+        entry->unix_name = unix_pos;
+        entry->short_len = 0;
+        memcpy( cache->names + names_pos, buffer, len * sizeof(WCHAR) );
+        memcpy( cache->unix_names + unix_pos, de->d_name, unix_len );
+        names_pos += len;
+        unix_pos += unix_len;
+    }
+    closedir( dir );
+    dir = NULL;
+
+    for (cache->hash_size = 16; cache->hash_size < cache->count; cache->hash_size *= 2) /* nothing */;
+    if (!(cache->hash = RtlAllocateHeap( GetProcessHeap(), 0, cache->hash_size * sizeof(*cache->hash) )))
+        goto failed;
+    memset( cache->hash, 0xff, cache->hash_size * sizeof(*cache->hash) );
+    for (i = 0; i < cache->count; i++)
+    {
+        entry = &cache->entries[i];
+        hash = hash_dir_cache_name( cache->names + entry->name, entry->len ) & (cache->hash_size - 1);
+        entry->next = cache->hash[hash];
+        cache->hash[hash] = i;
+    }
+    return cache;
+
+failed:
+    if (dir) closedir( dir );
+    if (cache) free_dir_cache( cache );
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           build_dir_cache_short_names
+ *
+ * Build the hash table of the short names the first time we need it.
+ */
+static BOOL build_dir_cache_short_names( struct dir_cache *cache )
+{
+    struct dir_cache_entry *entry;
+    UNICODE_STRING str;
+    BOOLEAN spaces;
+    unsigned int i, hash;
+
+    if (cache->short_hash) return TRUE;
+    if (!(cache->short_hash = RtlAllocateHeap( GetProcessHeap(), 0,
+                                               cache->hash_size * sizeof(*cache->short_hash) )))
+        return FALSE;
+    memset( cache->short_hash, 0xff, cache->hash_size * sizeof(*cache->short_hash) );
+
+    for (i = 0; i < cache->count; i++)
+    {
+        entry = &cache->entries[i];
+        str.Buffer = cache->names + entry->name;
+        str.Length = str.MaximumLength = entry->len * sizeof(WCHAR);
+        if (RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) && !spaces) continue;
+        entry->short_len = hash_short_file_name( &str, entry->short_name );
+        hash = hash_dir_cache_name( entry->short_name, entry->short_len ) & (cache->hash_size - 1);
+        entry->next_short = cache->short_hash[hash];
+        cache->short_hash[hash] = i;
+    }
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           get_dir_cache
+ *
+ * Retrieve the listing of a directory, reading it again if it has changed.
+ * The returned listing must be released with release_dir_cache.
+ * dir_cache_section must be held by caller.
+ */
+static struct dir_cache *get_dir_cache( const char *unix_name )
+{
+    struct dir_cache *cache;
+    struct stat st;
+
+    if (stat( unix_name, &st ) == -1) return NULL;
+
+    LIST_FOR_EACH_ENTRY( cache, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (cache->dev != st.st_dev || cache->ino != st.st_ino) continue;
+        list_remove( &cache->entry );
+        if (cache->mtime == st.st_mtime && cache->ctime == st.st_ctime)
+        {
+            list_add_head( &dir_cache_list, &cache->entry );
+            return cache;
+        }
+        /* the directory has changed, read it again */
+        dir_cache_dirs--;
+        dir_cache_entries -= cache->count;
+        free_dir_cache( cache );
+        break;
+    }
+
+    if (!(cache = read_dir_cache( unix_name, &st ))) return NULL;
+
+    /* changes within the same second as our read can't be detected, so don't keep it in that case */
+    if (st.st_mtime >= time( NULL ) - 1 || cache->count > DIR_CACHE_MAX_ENTRIES) return cache;
+
+    while (dir_cache_dirs >= DIR_CACHE_MAX_DIRS || dir_cache_entries + cache->count > DIR_CACHE_MAX_ENTRIES)
+    {
+        struct dir_cache *old = LIST_ENTRY( list_tail( &dir_cache_list ), struct dir_cache, entry );
+        list_remove( &old->entry );
+        dir_cache_dirs--;
+        dir_cache_entries -= old->count;
+        free_dir_cache( old );
+    }
+    list_add_head( &dir_cache_list, &cache->entry );
+    cache->cached = TRUE;
+    dir_cache_dirs++;
+    dir_cache_entries += cache->count;
+    return cache;
+}
+
+
+/***********************************************************************
+ *           find_dir_cache_entry
+ *
+ * Find the first entry of a directory that matches a name, case-insensitively,
+ * or through its short name. Returns the number of matches.
+ */
+static unsigned int find_dir_cache_entry( struct dir_cache *cache, const WCHAR *name, int length,
+                                          BOOLEAN check_short, unsigned int *index )
+{
+    unsigned int i, hash = hash_dir_cache_name( name, length ) & (cache->hash_size - 1);
+    unsigned int matches = 0;
+
+    *index = DIR_CACHE_END;
+    for (i = cache->hash[hash]; i != DIR_CACHE_END; i = cache->entries[i].next)
+    {
+        const struct dir_cache_entry *entry = &cache->entries[i];
+        if (entry->len != length || memicmpW( cache->names + entry->name, name, length )) continue;
+        matches++;
+        if (i < *index) *index = i;
+    }
+    if (!check_short || !build_dir_cache_short_names( cache )) return matches;
+
+    for (i = cache->short_hash[hash]; i != DIR_CACHE_END; i = cache->entries[i].next_short)
+    {
+        const struct dir_cache_entry *entry = &cache->entries[i];
+        if (entry->short_len != length || memicmpW( entry->short_name, name, length )) continue;
+        matches++;
+        if (i < *index) *index = i;
+    }
+    return matches;
+}
+
+
+/***********************************************************************
+ *           lookup_dir_cache
+ *
+ * Look for a file in the cached listing of a directory, and store its Unix name
+ * in the buffer, which must be at least MAX_DIR_ENTRY_LEN+1 chars long.
+ * If unique is set, only a file that is the only one matching the name is returned.
+ * Returns 1 if found, 0 if not found, and -1 if the listing is not available.
+ */
+static int lookup_dir_cache( const char *unix_name, const WCHAR *name, int length, BOOLEAN check_short,
+                             BOOLEAN unique, char *buffer )
+{
+    struct dir_cache *cache;
+    unsigned int index, matches;
+    int ret = -1;
+
+    RtlEnterCriticalSection( &dir_cache_section );
+    if ((cache = get_dir_cache( unix_name )))
+    {
+        matches = find_dir_cache_entry( cache, name, length, check_short, &index );
+        if (!matches) ret = 0;
+        else if (matches == 1 || !unique)
+        {
+            strcpy( buffer, cache->unix_names + cache->entries[index].unix_name );
+            ret = 1;
+        }
+        release_dir_cache( cache );
+    }
+    RtlLeaveCriticalSection( &dir_cache_section );
+    return ret;
+}
+
+
 /***********************************************************************
  *           read_directory_stat
  *
@@ -2107,6 +2426,34 @@ static int read_directory_stat( int fd, IO_STATUS_BLOCK *io, void *buffer, ULONG
             }
             else io->u.Status = STATUS_NO_MORE_FILES;
         }
+        else
+        {
+            /* the name may differ in case, look for it in the directory listing */
+            UNICODE_STRING str = *mask;
+            BOOLEAN spaces, is_name_8_dot_3 = RtlIsNameLegalDOS8Dot3( &str, NULL, &spaces ) && !spaces;
+            char name[MAX_DIR_ENTRY_LEN + 1];
+
+            switch (lookup_dir_cache( ".", mask->Buffer, mask->Length / sizeof(WCHAR),
+                                      is_name_8_dot_3, TRUE, name ))
+            {
+            case 1:
+            {
+                union file_directory_info *info = append_entry( buffer, io, length, name, NULL, mask, class );
+                if (info)
+                {
+                    info->next = 0;
+                    if (io->u.Status != STATUS_BUFFER_OVERFLOW) lseek( fd, 1, SEEK_CUR );
+                    ret = 0;
+                    break;
+                }
+                /* fall through */
+            }
+            case 0:
+                io->u.Status = restart_scan ? STATUS_NO_SUCH_FILE : STATUS_NO_MORE_FILES;
+                ret = 0;
+                break;
+            }
+        }
     }
     else ret = -1;
 
@@ -2312,6 +2659,15 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    switch (lookup_dir_cache( unix_name, name, length, is_name_8_dot_3, FALSE, unix_name + pos ))
+    {
+    case 1:
+        unix_name[pos - 1] = '/';
+        goto success;
+    case 0:
+        goto not_found;
+    }
+
     if (!(dir = opendir( unix_name )))
     {
         if (errno == ENOENT) return STATUS_OBJECT_PATH_NOT_FOUND;
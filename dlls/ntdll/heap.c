@@ -114,12 +114,21 @@ C_ASSERT( sizeof(ARENA_LARGE) % LARGE_ALIGNMENT == 0 );
 #define HEAP_TAIL_EXTRA_SIZE(flags) \
     ((flags & HEAP_TAIL_CHECKING_ENABLED) || RUNNING_ON_VALGRIND ? ALIGNMENT : 0)
 
-/* Max size of the blocks on the free lists */
+/* small blocks get one free list per ALIGNMENT step up to this size */
+#define HEAP_MAX_SMALL_FREE_LIST  0x100
+#define HEAP_NB_SMALL_FREE_LISTS  (HEAP_MAX_SMALL_FREE_LIST / ALIGNMENT)
+
+/* Max size of the blocks on the free lists above HEAP_MAX_SMALL_FREE_LIST */
 static const SIZE_T HEAP_freeListSizes[] =
 {
-    0x10, 0x20, 0x30, 0x40, 0x60, 0x80, 0x100, 0x200, 0x400, 0x1000, ~0UL
+    0x200, 0x400, 0x1000, ~0UL
 };
-#define HEAP_NB_FREE_LISTS  (sizeof(HEAP_freeListSizes)/sizeof(HEAP_freeListSizes[0]))
+#define HEAP_NB_FREE_LISTS  (HEAP_NB_SMALL_FREE_LISTS + sizeof(HEAP_freeListSizes)/sizeof(HEAP_freeListSizes[0]))
+
+/* low-fragmentation front end: lock-free lists of freed blocks, one per block size */
+#define HEAP_LFH_MAX_BLOCK_SIZE   0x400   /* largest block size handled by the front end */
+#define HEAP_LFH_NB_BINS          (HEAP_LFH_MAX_BLOCK_SIZE / ALIGNMENT)
+#define HEAP_LFH_MAX_DEPTH        64      /* max number of cached blocks per bin */
 
 typedef union
 {
@@ -159,6 +168,7 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    SLIST_HEADER    *lfh_bins;      /* Low-fragmentation front end bins, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -304,10 +314,25 @@ static inline unsigned int get_freelist_index( SIZE_T size )
     unsigned int i;
 
     size -= sizeof(ARENA_FREE);
-    for (i = 0; i < HEAP_NB_FREE_LISTS - 1; i++) if (size <= HEAP_freeListSizes[i]) break;
+    if (size <= HEAP_MAX_SMALL_FREE_LIST) return size ? (size - 1) / ALIGNMENT : 0;
+    for (i = HEAP_NB_SMALL_FREE_LISTS; i < HEAP_NB_FREE_LISTS - 1; i++)
+        if (size <= HEAP_freeListSizes[i - HEAP_NB_SMALL_FREE_LISTS]) break;
     return i;
 }
 
+/* get the max size of the blocks on a given free list */
+static inline SIZE_T get_freelist_size( unsigned int index )
+{
+    if (index < HEAP_NB_SMALL_FREE_LISTS) return (index + 1) * ALIGNMENT;
+    return HEAP_freeListSizes[index - HEAP_NB_SMALL_FREE_LISTS];
+}
+
+/* get the front end bin for a given block size; block sizes are all ARENA_OFFSET modulo ALIGNMENT */
+static inline SLIST_HEADER *get_lfh_bin( const HEAP *heap, SIZE_T size )
+{
+    return &heap->lfh_bins[size / ALIGNMENT];
+}
+
 /* get the memory protection type to use for a given heap */
 static inline ULONG get_protection_type( DWORD flags )
 {
@@ -338,7 +363,7 @@ static void HEAP_Dump( HEAP *heap )
     DPRINTF( "\nFree lists:\n Block   Stat   Size    Id\n" );
     for (i = 0; i < HEAP_NB_FREE_LISTS; i++)
         DPRINTF( "%p free %08lx prev=%p next=%p\n",
-                 &heap->freeList[i].arena, HEAP_freeListSizes[i],
+                 &heap->freeList[i].arena, get_freelist_size( i ),
                  LIST_ENTRY( heap->freeList[i].arena.entry.prev, ARENA_FREE, entry ),
                  LIST_ENTRY( heap->freeList[i].arena.entry.next, ARENA_FREE, entry ));
 
@@ -658,10 +683,12 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
     if ((char *)pFree + size < (char *)subheap->base + subheap->size)
         return;  /* Not the last block, so nothing more to do */
 
-    /* Free the whole sub-heap if it's empty and not the original one */
+    /* Free the whole sub-heap if it's empty and not the original one; sub-heaps
+     * are kept once the front end is enabled, since lfh_free_block looks them
+     * up without the heap lock */
 
     if (((char *)pFree == (char *)subheap->base + subheap->headerSize) &&
-        (subheap != &subheap->heap->subheap))
+        (subheap != &subheap->heap->subheap) && !subheap->heap->lfh_bins)
     {
         void *addr = subheap->base;
 
@@ -706,6 +733,123 @@ static void HEAP_ShrinkBlock(SUBHEAP *subheap, ARENA_INUSE *pArena, SIZE_T size)
 }
 
 
+/***********************************************************************
+ *           lfh_alloc_block
+ *
+ * Try to get a block of the specified size from the front end bins.
+ * Doesn't require the heap lock.
+ */
+static ARENA_INUSE *lfh_alloc_block( HEAP *heap, SIZE_T size )
+{
+    SLIST_ENTRY *entry;
+
+    if (size >= HEAP_LFH_MAX_BLOCK_SIZE) return NULL;
+    if (!(entry = RtlInterlockedPopEntrySList( get_lfh_bin( heap, size )))) return NULL;
+    return (ARENA_INUSE *)entry - 1;
+}
+
+
+/***********************************************************************
+ *           lfh_free_block
+ *
+ * Try to cache a freed block in the front end bins.
+ * Doesn't require the heap lock; anything that doesn't look like a valid
+ * in-use block is left to the normal path, which reports the error.
+ */
+static BOOL lfh_free_block( HEAP *heap, ARENA_INUSE *arena )
+{
+    const SUBHEAP *subheap;
+    ARENA_INUSE old_arena, new_arena;
+    SLIST_HEADER *bin;
+    SIZE_T size;
+
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+    /* sub-heaps are never released while the front end is enabled, so the list
+     * can be walked safely; this also rejects large blocks */
+    if (!(subheap = HEAP_FindSubHeap( heap, arena ))) return FALSE;
+    if ((const char *)arena < (const char *)subheap->base + subheap->headerSize) return FALSE;
+
+    old_arena = *arena;
+    if (old_arena.magic != ARENA_INUSE_MAGIC || (old_arena.size & ARENA_FLAG_FREE)) return FALSE;
+    size = old_arena.size & ARENA_SIZE_MASK;
+    if (size >= HEAP_LFH_MAX_BLOCK_SIZE) return FALSE;
+    if ((const char *)(arena + 1) + size > (const char *)subheap->base + subheap->size) return FALSE;
+    bin = get_lfh_bin( heap, size );
+    if (RtlQueryDepthSList( bin ) >= HEAP_LFH_MAX_DEPTH) return FALSE;
+
+    /* cached blocks look like pending free blocks to the rest of the heap code;
+     * switch the magic atomically so that concurrent double frees are caught */
+    new_arena = old_arena;
+    new_arena.magic = ARENA_PENDING_MAGIC;
+    if (interlocked_cmpxchg( (LONG *)arena + 1, ((LONG *)&new_arena)[1],
+                             ((LONG *)&old_arena)[1] ) != ((LONG *)&old_arena)[1])
+        return FALSE;
+
+    RtlInterlockedPushEntrySList( bin, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           lfh_flush_bins
+ *
+ * Return all the blocks cached in the front end to the free lists.
+ * The heap must be locked.
+ */
+static BOOL lfh_flush_bins( HEAP *heap )
+{
+    SLIST_ENTRY *entry, *next;
+    unsigned int i;
+    BOOL ret = FALSE;
+
+    for (i = 0; i < HEAP_LFH_NB_BINS; i++)
+    {
+        for (entry = RtlInterlockedFlushSList( &heap->lfh_bins[i] ); entry; entry = next)
+        {
+            ARENA_INUSE *arena = (ARENA_INUSE *)entry - 1;
+
+            next = entry->Next;
+            HEAP_MakeInUseBlockFree( HEAP_FindSubHeap( heap, arena ), arena );
+            ret = TRUE;
+        }
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           lfh_enable
+ *
+ * Enable the low-fragmentation front end for a heap.
+ */
+static NTSTATUS lfh_enable( HEAP *heap )
+{
+    void *ptr = NULL;
+    SIZE_T size = HEAP_LFH_NB_BINS * sizeof(SLIST_HEADER);
+    NTSTATUS status = STATUS_SUCCESS;
+    unsigned int i;
+
+    /* the front end bypasses both the heap lock and the debugging checks */
+    if (heap->flags & (HEAP_NO_SERIALIZE | HEAP_SHARED | HEAP_VALIDATE |
+                       HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED))
+        return STATUS_UNSUCCESSFUL;
+    if (heap->pending_free || RUNNING_ON_VALGRIND) return STATUS_UNSUCCESSFUL;
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lfh_bins)
+    {
+        if (!(status = NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &size,
+                                                MEM_COMMIT, PAGE_READWRITE )))
+        {
+            for (i = 0; i < HEAP_LFH_NB_BINS; i++) RtlInitializeSListHead( (SLIST_HEADER *)ptr + i );
+            heap->lfh_bins = ptr;
+        }
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+    return status;
+}
+
+
 /***********************************************************************
  *           allocate_large_block
  */
@@ -1016,6 +1160,8 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 
     if (!(heap->flags & HEAP_GROWABLE))
     {
+        /* give the cached blocks a chance to be coalesced */
+        if (heap->lfh_bins && lfh_flush_bins( heap )) return HEAP_FindFreeBlock( heap, size, ppSubHeap );
         WARN("Not enough space in heap %p for %08lx bytes\n", heap, size );
         return NULL;
     }
@@ -1279,6 +1425,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
         const DWORD *ptr = (const DWORD *)(pArena + 1);
         const DWORD *end = (const DWORD *)((const char *)ptr + size);
 
+        /* blocks cached by the front end are not filled */
+        if (!(flags & HEAP_FREE_CHECKING_ENABLED)) ptr = end;
         while (ptr < end)
         {
             if (*ptr != ARENA_FREE_FILLER)
@@ -1628,6 +1776,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = heapPtr->pending_free;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    if (heapPtr->lfh_bins)
+    {
+        size = 0;
+        addr = heapPtr->lfh_bins;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     size = 0;
     addr = heapPtr->subheap.base;
     NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
@@ -1673,6 +1827,16 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh_bins && (pInUse = lfh_alloc_block( heapPtr, rounded_size )))
+    {
+        pInUse->magic = ARENA_INUSE_MAGIC;
+        pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+        notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
+        initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
@@ -1756,13 +1920,20 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+
+    if (heapPtr->lfh_bins && lfh_free_block( heapPtr, pInUse ))
+    {
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
     if (!subheap)
@@ -2236,6 +2407,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2244,7 +2417,42 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->lfh_bins ? 2 /* low-fragmentation heap */ : 0 /* standard heap */;
+        return STATUS_SUCCESS;
+
+    default:
+        FIXME("Unknown heap information class %u\n", info_class);
+        return STATUS_INVALID_INFO_CLASS;
+    }
+}
+
+/***********************************************************************
+ *           RtlSetHeapInformation    (NTDLL.@)
+ */
+NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
+                                       PVOID info, SIZE_T size )
+{
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:  /* standard heap, the front end cannot be disabled once enabled */
+            return heapPtr->lfh_bins ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case 2:  /* low-fragmentation heap */
+            return lfh_enable( heapPtr );
+        default:  /* look-aside lists are not supported anymore since Vista */
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    case HeapEnableTerminationOnCorruption:
+        FIXME("HeapEnableTerminationOnCorruption not supported\n");
         return STATUS_SUCCESS;
 
     default:
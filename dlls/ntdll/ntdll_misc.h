@@ -93,10 +93,26 @@ extern unsigned int server_select( const select_op_t *select_op, data_size_t siz
                                    UINT flags, const LARGE_INTEGER *timeout ) DECLSPEC_HIDDEN;
 extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *call, apc_result_t *result ) DECLSPEC_HIDDEN;
 extern int server_remove_fd_from_cache( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void server_add_fd_cache_options( HANDLE handle, unsigned int options ) DECLSPEC_HIDDEN;
 extern int server_get_unix_fd( HANDLE handle, unsigned int access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options ) DECLSPEC_HIDDEN;
+extern struct fast_sync_slot *server_get_fast_sync( HANDLE handle, ACCESS_MASK access,
+                                                    enum fast_sync_type *type ) DECLSPEC_HIDDEN;
+extern struct completion_ring *server_get_completion_ring( HANDLE handle ) DECLSPEC_HIDDEN;
 extern int server_pipe( int fd[2] ) DECLSPEC_HIDDEN;
 
+/* registry */
+#define MAX_KEY_VALUE_QUERIES 8
+struct key_value_query
+{
+    const WCHAR                   *name;    /* value name */
+    KEY_VALUE_PARTIAL_INFORMATION *info;    /* buffer receiving the value */
+    DWORD                          length;  /* size of the buffer */
+    NTSTATUS                       status;  /* status of the query */
+};
+extern NTSTATUS query_key_values( const OBJECT_ATTRIBUTES *attr, struct key_value_query *queries,
+                                  unsigned int count ) DECLSPEC_HIDDEN;
+
 /* security descriptors */
 NTSTATUS NTDLL_create_struct_sd(PSECURITY_DESCRIPTOR nt_sd, struct security_descriptor **server_sd,
                                 data_size_t *server_sd_len) DECLSPEC_HIDDEN;
@@ -176,7 +192,7 @@ extern struct _KUSER_SHARED_DATA *user_shared_data DECLSPEC_HIDDEN;
 
 /* completion */
 extern NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                                     NTSTATUS CompletionStatus, ULONG Information ) DECLSPEC_HIDDEN;
+                                     NTSTATUS CompletionStatus, ULONG Information, BOOL async ) DECLSPEC_HIDDEN;
 
 /* code pages */
 extern int ntdll_umbstowcs(DWORD flags, const char* src, int srclen, WCHAR* dst, int dstlen) DECLSPEC_HIDDEN;
@@ -235,6 +251,7 @@ struct ntdll_thread_data
     WINE_VM86_TEB_INFO vm86;          /* 1fc vm86 private data */
     void              *exit_frame;    /* 204 exit frame pointer */
 #endif
+    struct threadpool_worker *threadpool_worker; /* 208/318 thread pool worker running on this thread */
 };
 
 static inline struct ntdll_thread_data *ntdll_get_thread_data(void)
@@ -245,6 +262,16 @@ static inline struct ntdll_thread_data *ntdll_get_thread_data(void)
 extern mode_t FILE_umask DECLSPEC_HIDDEN;
 extern HANDLE keyed_event DECLSPEC_HIDDEN;
 
+/* futex support */
+#ifdef __linux__
+struct timespec;
+extern int futex_wait( int *addr, int val, struct timespec *timeout ) DECLSPEC_HIDDEN;
+extern int futex_wake( int *addr, int val ) DECLSPEC_HIDDEN;
+extern int futex_wait_bitset( int *addr, int val, struct timespec *timeout, int mask ) DECLSPEC_HIDDEN;
+extern int futex_wake_bitset( int *addr, int val, int mask ) DECLSPEC_HIDDEN;
+extern int use_futexes(void) DECLSPEC_HIDDEN;
+#endif
+
 /* Register functions */
 
 #ifdef __i386__
@@ -535,6 +535,62 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
     return ret;
 }
 
+/******************************************************************************
+ *           query_key_values
+ *
+ * Open a key, retrieve the partial information of some of its values and
+ * close it again, all in a single server round trip. The returned status is
+ * that of opening the key; the status of each value is stored in its query.
+ */
+NTSTATUS query_key_values( const OBJECT_ATTRIBUTES *attr, struct key_value_query *queries,
+                           unsigned int count )
+{
+    struct __server_request_info reqs[MAX_KEY_VALUE_QUERIES + 2];
+    const unsigned int fixed_size = FIELD_OFFSET( KEY_VALUE_PARTIAL_INFORMATION, Data );
+    struct open_key_request *open_req;
+    struct close_handle_request *close_req;
+    unsigned int i;
+    NTSTATUS ret;
+
+    if (count > MAX_KEY_VALUE_QUERIES) return STATUS_INVALID_PARAMETER;
+    if (!attr || !attr->ObjectName) return STATUS_OBJECT_PATH_SYNTAX_BAD;
+    if (attr->ObjectName->Length > MAX_NAME_LENGTH) return STATUS_BUFFER_OVERFLOW;
+
+    open_req = wine_server_init_req( &reqs[0], REQ_open_key );
+    open_req->parent     = wine_server_obj_handle( attr->RootDirectory );
+    open_req->access     = KEY_QUERY_VALUE;
+    open_req->attributes = attr->Attributes;
+    wine_server_add_data( open_req, attr->ObjectName->Buffer, attr->ObjectName->Length );
+
+    for (i = 0; i < count; i++)
+    {
+        struct get_key_value_request *req = wine_server_init_req( &reqs[i + 1], REQ_get_key_value );
+
+        req->hkey = BATCH_LAST_HANDLE;
+        wine_server_add_data( req, queries[i].name, strlenW( queries[i].name ) * sizeof(WCHAR) );
+        if (queries[i].length > fixed_size)
+            wine_server_set_reply( req, queries[i].info->Data, queries[i].length - fixed_size );
+    }
+
+    close_req = wine_server_init_req( &reqs[count + 1], REQ_close_handle );
+    close_req->handle = BATCH_LAST_HANDLE;
+
+    wine_server_call_batch( reqs, count + 2 );
+    if ((ret = reqs[0].u.reply.reply_header.error)) return ret;
+
+    for (i = 0; i < count; i++)
+    {
+        const struct get_key_value_reply *reply = &reqs[i + 1].u.reply.get_key_value_reply;
+
+        if ((queries[i].status = reply->__header.error)) continue;
+        copy_key_value_info( KeyValuePartialInformation, queries[i].info, queries[i].length,
+                             reply->type, 0, reply->total );
+        if (queries[i].length < fixed_size) queries[i].status = STATUS_BUFFER_TOO_SMALL;
+        else if (queries[i].length < fixed_size + reply->total) queries[i].status = STATUS_BUFFER_OVERFLOW;
+    }
+    return STATUS_SUCCESS;
+}
+
 /******************************************************************************
  * RtlpNtQueryValueKey [NTDLL.@]
  *
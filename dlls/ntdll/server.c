@@ -89,6 +89,8 @@ WINE_DEFAULT_DEBUG_CHANNEL(server);
 #define MSG_CMSG_CLOEXEC 0
 #endif
 
+#define MAX_BATCH_REQUESTS 16      /* max. number of requests in a batch */
+
 #define SOCKETNAME "socket"        /* name of the socket file */
 #define LOCKNAME   "lock"          /* name of the lock file */
 
@@ -298,6 +300,100 @@ unsigned int wine_server_call( void *req_ptr )
 }
 
 
+/***********************************************************************
+ *           wine_server_call_batch (NTDLL.@)
+ *
+ * Perform several server calls in a single round trip.
+ *
+ * PARAMS
+ *     reqs  [I/O] Requests, initialized with wine_server_init_req
+ *     count [I]   Number of requests
+ *
+ * RETURNS
+ *     The status of the first request that failed. All the requests are
+ *     executed, and each one gets its own reply.
+ *
+ * NOTES
+ *     A request can refer to the first handle returned by an earlier
+ *     request of the same batch with BATCH_LAST_HANDLE, e.g. to open a
+ *     key, query one of its values and close it again.
+ */
+unsigned int wine_server_call_batch( struct __server_request_info *reqs, unsigned int count )
+{
+    static const char padding[8];
+    struct __server_request_info batch;
+    struct iovec vec[1 + MAX_BATCH_REQUESTS * (__SERVER_MAX_DATA + 2)];
+    data_size_t len, size = 0, reply_size = 0;
+    unsigned int i, j, n = 1, ret = STATUS_SUCCESS;
+    char pad[8];
+    sigset_t old_set;
+    int res;
+
+    if (count > MAX_BATCH_REQUESTS) return STATUS_INVALID_PARAMETER;
+
+    for (i = 0; i < count; i++)
+    {
+        len = reqs[i].u.req.request_header.request_size;
+        vec[n].iov_base = &reqs[i].u.req;
+        vec[n++].iov_len = sizeof(reqs[i].u.req);
+        for (j = 0; j < reqs[i].data_count; j++)
+        {
+            vec[n].iov_base = (void *)reqs[i].data[j].ptr;
+            vec[n++].iov_len = reqs[i].data[j].size;
+        }
+        if (BATCH_ALIGN( len ) != len)
+        {
+            vec[n].iov_base = (void *)padding;
+            vec[n++].iov_len = BATCH_ALIGN( len ) - len;
+        }
+        size += sizeof(reqs[i].u.req) + BATCH_ALIGN( len );
+        reply_size += sizeof(reqs[i].u.reply) + BATCH_ALIGN( reqs[i].u.req.request_header.reply_size );
+    }
+
+    memset( &batch.u.req, 0, sizeof(batch.u.req) );
+    batch.u.req.request_header.req = REQ_call_batch;
+    batch.u.req.request_header.request_size = size;
+    batch.u.req.request_header.reply_size = reply_size;
+    vec[0].iov_base = &batch.u.req;
+    vec[0].iov_len = sizeof(batch.u.req);
+
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &old_set );
+
+    if ((res = writev( ntdll_get_thread_data()->request_fd, vec, n )) != size + sizeof(batch.u.req))
+    {
+        if (res >= 0) server_protocol_error( "partial write %d\n", res );
+        if (errno == EPIPE) abort_thread(0);
+        if (errno != EFAULT) server_protocol_perror( "write" );
+        ret = STATUS_ACCESS_VIOLATION;
+    }
+    else
+    {
+        read_reply_data( &batch.u.reply, sizeof(batch.u.reply) );
+        ret = batch.u.reply.reply_header.error;
+    }
+
+    if (ret)  /* the batch itself failed */
+    {
+        for (i = 0; i < count; i++)
+        {
+            memset( &reqs[i].u.reply, 0, sizeof(reqs[i].u.reply) );
+            reqs[i].u.reply.reply_header.error = ret;
+        }
+    }
+    else for (i = 0; i < count; i++)
+    {
+        read_reply_data( &reqs[i].u.reply, sizeof(reqs[i].u.reply) );
+        len = reqs[i].u.reply.reply_header.reply_size;
+        if (len) read_reply_data( reqs[i].reply_data, len );
+        if (BATCH_ALIGN( len ) != len) read_reply_data( pad, BATCH_ALIGN( len ) - len );
+        if (!ret) ret = reqs[i].u.reply.reply_header.error;
+    }
+
+    pthread_sigmask( SIG_SETMASK, &old_set, NULL );
+    return ret;
+}
+
+
 /***********************************************************************
  *           server_enter_uninterrupted_section
  */
@@ -787,19 +883,43 @@ static int receive_fd( obj_handle_t *handle )
 /***********************************************************************/
 /* fd cache support */
 
-struct fd_cache_entry
+union fd_cache_entry
 {
-    int fd;
-    enum server_fd_type type : 5;
-    unsigned int        access : 3;
-    unsigned int        options : 24;
+    LONG64 data;
+    struct
+    {
+        int fd;  /* fd + 1, so that 0 can be used as the unset value */
+        enum server_fd_type type : 4;
+        unsigned int        access : 3;
+        unsigned int        options : 25;  /* includes FD_OPTION_SKIP_SYNC_COMPLETION */
+    } s;
 };
 
-#define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(struct fd_cache_entry))
-#define FD_CACHE_ENTRIES     128
+C_ASSERT( sizeof(union fd_cache_entry) == sizeof(LONG64) );
+C_ASSERT( FD_TYPE_NB_TYPES <= 16 );
+
+#define FD_CACHE_BLOCK_SIZE  (65536 / sizeof(union fd_cache_entry))
+
+/* The caches are looked up without locking. Blocks are never freed once
+ * allocated, and when a directory of blocks needs to grow it's replaced by a
+ * larger copy, leaving the old one around for the threads still using it. */
+struct fd_cache_dir
+{
+    unsigned int size;       /* number of blocks */
+    void        *blocks[1];  /* blocks of entries, allocated on demand */
+};
+
+static struct fd_cache_dir *fd_cache;
+static union fd_cache_entry fd_cache_initial_block[FD_CACHE_BLOCK_SIZE];
+static LONG fd_cache_epoch;  /* incremented every time a handle is removed from the cache */
+
+/* fast sync info of the handles, indexed like the fd cache */
+static struct fd_cache_dir *fast_sync_cache;
+static unsigned int fast_sync_cache_initial_block[FD_CACHE_BLOCK_SIZE];
 
-static struct fd_cache_entry *fd_cache[FD_CACHE_ENTRIES];
-static struct fd_cache_entry fd_cache_initial_block[FD_CACHE_BLOCK_SIZE];
+/* completion ring info of the handles, indexed like the fd cache */
+static struct fd_cache_dir *completion_ring_cache;
+static unsigned int completion_ring_cache_initial_block[FD_CACHE_BLOCK_SIZE];
 
 static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
 {
@@ -808,64 +928,138 @@ static inline unsigned int handle_to_index( HANDLE handle, unsigned int *entry )
     return idx % FD_CACHE_BLOCK_SIZE;
 }
 
+static inline void *get_cache_block( struct fd_cache_dir *dir, unsigned int entry )
+{
+    if (!dir || entry >= dir->size) return NULL;
+    return dir->blocks[entry];
+}
+
+/* read the whole entry at once, so that the fd and its attributes are consistent */
+static inline LONG64 read_fd_cache_entry( union fd_cache_entry *entry )
+{
+#ifdef _WIN64
+    return *(volatile LONG64 *)&entry->data;
+#else
+    return interlocked_cmpxchg64( &entry->data, 0, 0 );
+#endif
+}
+
+static inline LONG64 exchange_fd_cache_entry( union fd_cache_entry *entry, LONG64 data )
+{
+    LONG64 prev;
+
+    do prev = read_fd_cache_entry( entry );
+    while (interlocked_cmpxchg64( &entry->data, data, prev ) != prev);
+    return prev;
+}
+
 
 /***********************************************************************
- *           add_fd_to_cache
+ *           alloc_cache_block
  *
+ * Allocate a block of a cache, growing its directory if needed.
  * Caller must hold fd_cache_section.
  */
-static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
-                            unsigned int access, unsigned int options )
+static void *alloc_cache_block( struct fd_cache_dir **dir_ptr, unsigned int entry,
+                                size_t entry_size, void *initial_block )
 {
-    unsigned int entry, idx = handle_to_index( handle, &entry );
-    int prev_fd;
+    struct fd_cache_dir *dir = *dir_ptr, *new_dir;
+    unsigned int size;
+    void *block;
 
-    if (entry >= FD_CACHE_ENTRIES)
+    if (!dir || entry >= dir->size)
     {
-        FIXME( "too many allocated handles, not caching %p\n", handle );
-        return FALSE;
+        for (size = dir ? dir->size : 16; size <= entry; size *= 2) /* nothing */;
+        new_dir = wine_anon_mmap( NULL, FIELD_OFFSET( struct fd_cache_dir, blocks[size] ),
+                                  PROT_READ | PROT_WRITE, 0 );
+        if (new_dir == MAP_FAILED) return NULL;
+        new_dir->size = size;
+        if (dir) memcpy( new_dir->blocks, dir->blocks, dir->size * sizeof(dir->blocks[0]) );
+        interlocked_xchg_ptr( (void **)dir_ptr, new_dir );
+        dir = new_dir;
     }
-
-    if (!fd_cache[entry])  /* do we need to allocate a new block of entries? */
+    if (!(block = dir->blocks[entry]))
     {
-        if (!entry) fd_cache[0] = fd_cache_initial_block;
+        if (!entry) block = initial_block;
         else
         {
-            void *ptr = wine_anon_mmap( NULL, FD_CACHE_BLOCK_SIZE * sizeof(struct fd_cache_entry),
-                                        PROT_READ | PROT_WRITE, 0 );
-            if (ptr == MAP_FAILED) return FALSE;
-            fd_cache[entry] = ptr;
+            block = wine_anon_mmap( NULL, FD_CACHE_BLOCK_SIZE * entry_size, PROT_READ | PROT_WRITE, 0 );
+            if (block == MAP_FAILED) return NULL;
         }
+        interlocked_xchg_ptr( &dir->blocks[entry], block );
     }
-    /* store fd+1 so that 0 can be used as the unset value */
-    prev_fd = interlocked_xchg( &fd_cache[entry][idx].fd, fd + 1 ) - 1;
-    fd_cache[entry][idx].type = type;
-    fd_cache[entry][idx].access = access;
-    fd_cache[entry][idx].options = options;
-    if (prev_fd != -1) close( prev_fd );
-    return TRUE;
+    return block;
 }
 
 
 /***********************************************************************
- *           get_cached_fd
+ *           add_fd_to_cache
  *
  * Caller must hold fd_cache_section.
  */
+static BOOL add_fd_to_cache( HANDLE handle, int fd, enum server_fd_type type,
+                            unsigned int access, unsigned int options, LONG epoch )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry *block, cache, prev;
+
+    if (!(block = alloc_cache_block( &fd_cache, entry, sizeof(*block), fd_cache_initial_block )))
+        return FALSE;
+
+    cache.data = 0;
+    cache.s.fd = fd + 1;
+    cache.s.type = type;
+    cache.s.access = access;
+    cache.s.options = options;
+    prev.data = exchange_fd_cache_entry( &block[idx], cache.data );
+    if (prev.s.fd) close( prev.s.fd - 1 );
+
+    /* if a handle was closed while we were asking the server, it may have been
+     * this one, so take the fd back unless the closing thread already did */
+    if (fd_cache_epoch != epoch &&
+        interlocked_cmpxchg64( &block[idx].data, 0, cache.data ) == cache.data)
+        return FALSE;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           get_cached_fd
+ */
 static inline int get_cached_fd( HANDLE handle, enum server_fd_type *type,
                                  unsigned int *access, unsigned int *options )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
-    int fd = -1;
+    union fd_cache_entry *block, cache;
+
+    if (!(block = get_cache_block( fd_cache, entry ))) return -1;
 
-    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
+    cache.data = read_fd_cache_entry( &block[idx] );
+    if (type) *type = cache.s.type;
+    if (access) *access = cache.s.access;
+    if (options) *options = cache.s.options;
+    return cache.s.fd - 1;
+}
+
+
+/***********************************************************************
+ *           server_add_fd_cache_options
+ *
+ * Add options to the cached fd of a handle, if it's in the cache.
+ */
+void server_add_fd_cache_options( HANDLE handle, unsigned int options )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry *block, cache;
+    LONG64 prev;
+
+    if (!(block = get_cache_block( fd_cache, entry ))) return;
+    do
     {
-        fd = fd_cache[entry][idx].fd - 1;
-        if (type) *type = fd_cache[entry][idx].type;
-        if (access) *access = fd_cache[entry][idx].access;
-        if (options) *options = fd_cache[entry][idx].options;
-    }
-    return fd;
+        prev = cache.data = read_fd_cache_entry( &block[idx] );
+        if (!cache.s.fd) return;
+        cache.s.options |= options;
+    } while (interlocked_cmpxchg64( &block[idx].data, cache.data, prev ) != prev);
 }
 
 
@@ -875,15 +1069,281 @@ static inline int get_cached_fd( HANDLE handle, enum server_fd_type *type,
 int server_remove_fd_from_cache( HANDLE handle )
 {
     unsigned int entry, idx = handle_to_index( handle, &entry );
+    union fd_cache_entry *block, prev;
+    unsigned int *sync_block;
     int fd = -1;
 
-    if (entry < FD_CACHE_ENTRIES && fd_cache[entry])
-        fd = interlocked_xchg( &fd_cache[entry][idx].fd, 0 ) - 1;
+    interlocked_xchg_add( &fd_cache_epoch, 1 );
+
+    if ((block = get_cache_block( fd_cache, entry )))
+    {
+        prev.data = exchange_fd_cache_entry( &block[idx], 0 );
+        fd = prev.s.fd - 1;
+    }
+
+    /* the handle value may get reused for another object */
+    if ((sync_block = get_cache_block( fast_sync_cache, entry ))) sync_block[idx] = 0;
+    if ((sync_block = get_cache_block( completion_ring_cache, entry ))) sync_block[idx] = 0;
 
     return fd;
 }
 
 
+/***********************************************************************/
+/* fast synchronization objects support */
+
+/* a cache entry holds the slot index, the object type and the access bits
+ * we care about; 0 means the server hasn't been asked about the handle yet */
+#define FAST_SYNC_CACHED        0x80000000
+#define FAST_SYNC_SYNCHRONIZE   0x40000000
+#define FAST_SYNC_MODIFY_STATE  0x20000000
+#define FAST_SYNC_TYPE_SHIFT    16
+#define FAST_SYNC_TYPE_MASK     0x3
+#define FAST_SYNC_SLOT_MASK     0xffff
+
+static struct fast_sync_slot *fast_sync_region;
+static BOOL fast_sync_disabled;
+
+
+/***********************************************************************
+ *           map_fast_sync_region
+ *
+ * Caller must hold fd_cache_section.
+ */
+static BOOL map_fast_sync_region(void)
+{
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    int fd = -1;
+    void *ptr;
+
+    if (fast_sync_region) return TRUE;
+    if (fast_sync_disabled) return FALSE;
+
+    SERVER_START_REQ( get_fast_sync_region )
+    {
+        if (!wine_server_call( req ))
+        {
+            size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+
+    if (fd != -1)
+    {
+        if (size >= FAST_SYNC_MAX_SLOTS * sizeof(struct fast_sync_slot))
+        {
+            ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            if (ptr != MAP_FAILED) fast_sync_region = ptr;
+        }
+        close( fd );
+    }
+    if (!fast_sync_region)
+    {
+        WARN( "shared synchronization region not available, using server calls\n" );
+        fast_sync_disabled = TRUE;
+    }
+    return fast_sync_region != NULL;
+}
+
+
+/***********************************************************************
+ *           query_fast_sync
+ *
+ * Caller must hold fd_cache_section.
+ */
+static unsigned int query_fast_sync( HANDLE handle, unsigned int entry, unsigned int idx )
+{
+    unsigned int *block, info = 0;
+
+    if ((block = get_cache_block( fast_sync_cache, entry )) && (info = block[idx]))
+        return info;  /* another thread got it first */
+    if (!map_fast_sync_region()) return 0;
+
+    SERVER_START_REQ( get_fast_sync )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!wine_server_call( req ))
+        {
+            info = FAST_SYNC_CACHED;
+            if (reply->type != FAST_SYNC_NONE && reply->slot < FAST_SYNC_MAX_SLOTS)
+            {
+                info |= (reply->type << FAST_SYNC_TYPE_SHIFT) | reply->slot;
+                if (reply->access & SYNCHRONIZE) info |= FAST_SYNC_SYNCHRONIZE;
+                /* EVENT_MODIFY_STATE and SEMAPHORE_MODIFY_STATE are the same bit */
+                if (reply->access & EVENT_MODIFY_STATE) info |= FAST_SYNC_MODIFY_STATE;
+            }
+        }
+    }
+    SERVER_END_REQ;
+
+    /* only grow the cache for handles the server knows about */
+    if (!info) return 0;
+    if (!(block = alloc_cache_block( &fast_sync_cache, entry, sizeof(*block),
+                                     fast_sync_cache_initial_block )))
+        return 0;
+    block[idx] = info;
+    return info;
+}
+
+
+/***********************************************************************
+ *           server_get_fast_sync
+ *
+ * Return the shared state of an event or semaphore if the handle grants
+ * the requested access (SYNCHRONIZE or *_MODIFY_STATE), or NULL if the
+ * object has to be accessed through server calls.
+ */
+struct fast_sync_slot *server_get_fast_sync( HANDLE handle, ACCESS_MASK access,
+                                             enum fast_sync_type *type )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int *block, info = 0;
+    sigset_t sigset;
+
+    if (fast_sync_disabled || !handle || ((ULONG_PTR)handle & 3)) return NULL;
+
+    if ((block = get_cache_block( fast_sync_cache, entry ))) info = block[idx];
+    if (!info)
+    {
+        server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+        info = query_fast_sync( handle, entry, idx );
+        server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    }
+
+    *type = (info >> FAST_SYNC_TYPE_SHIFT) & FAST_SYNC_TYPE_MASK;
+    if (*type == FAST_SYNC_NONE) return NULL;
+    if ((access & SYNCHRONIZE) && !(info & FAST_SYNC_SYNCHRONIZE)) return NULL;
+    if ((access & EVENT_MODIFY_STATE) && !(info & FAST_SYNC_MODIFY_STATE)) return NULL;
+    return fast_sync_region + (info & FAST_SYNC_SLOT_MASK);
+}
+
+
+/***********************************************************************/
+/* completion port rings support */
+
+/* a cache entry holds the ring index and whether the handle can use it;
+ * 0 means the server hasn't been asked about the handle yet */
+#define COMPLETION_RING_CACHED        0x80000000
+#define COMPLETION_RING_MODIFY_STATE  0x40000000
+#define COMPLETION_RING_INDEX_MASK    0xffff
+
+static struct completion_ring *completion_ring_region;
+static BOOL completion_ring_disabled;
+
+
+/***********************************************************************
+ *           map_completion_ring_region
+ *
+ * Caller must hold fd_cache_section.
+ */
+static BOOL map_completion_ring_region(void)
+{
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    int fd = -1;
+    void *ptr;
+
+    if (completion_ring_region) return TRUE;
+    if (completion_ring_disabled) return FALSE;
+
+    SERVER_START_REQ( get_completion_ring_region )
+    {
+        if (!wine_server_call( req ))
+        {
+            size = reply->size;
+            fd = receive_fd( &fd_handle );
+        }
+    }
+    SERVER_END_REQ;
+
+    if (fd != -1)
+    {
+        if (size >= COMPLETION_MAX_RINGS * sizeof(struct completion_ring))
+        {
+            ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            if (ptr != MAP_FAILED) completion_ring_region = ptr;
+        }
+        close( fd );
+    }
+    if (!completion_ring_region)
+    {
+        WARN( "shared completion region not available, using server calls\n" );
+        completion_ring_disabled = TRUE;
+    }
+    return completion_ring_region != NULL;
+}
+
+
+/***********************************************************************
+ *           query_completion_ring
+ *
+ * Caller must hold fd_cache_section.
+ */
+static unsigned int query_completion_ring( HANDLE handle, unsigned int entry, unsigned int idx )
+{
+    unsigned int *block, info = 0;
+
+    if ((block = get_cache_block( completion_ring_cache, entry )) && (info = block[idx]))
+        return info;  /* another thread got it first */
+    if (!map_completion_ring_region()) return 0;
+
+    SERVER_START_REQ( get_completion_ring )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!wine_server_call( req ))
+        {
+            info = COMPLETION_RING_CACHED;
+            if (reply->index >= 0 && reply->index < COMPLETION_MAX_RINGS &&
+                (reply->access & IO_COMPLETION_MODIFY_STATE))
+                info |= COMPLETION_RING_MODIFY_STATE | reply->index;
+        }
+    }
+    SERVER_END_REQ;
+
+    /* only grow the cache for handles the server knows about */
+    if (!info) return 0;
+    if (!(block = alloc_cache_block( &completion_ring_cache, entry, sizeof(*block),
+                                     completion_ring_cache_initial_block )))
+        return 0;
+    block[idx] = info;
+    return info;
+}
+
+
+/***********************************************************************
+ *           server_get_completion_ring
+ *
+ * Return the shared packet ring of a completion port if the handle grants
+ * IO_COMPLETION_MODIFY_STATE, or NULL if the port has to be accessed
+ * through server calls.
+ */
+struct completion_ring *server_get_completion_ring( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+    unsigned int *block, info = 0;
+    struct completion_ring *ring;
+    sigset_t sigset;
+
+    if (completion_ring_disabled || !handle || ((ULONG_PTR)handle & 3)) return NULL;
+
+    if ((block = get_cache_block( completion_ring_cache, entry ))) info = block[idx];
+    if (!info)
+    {
+        server_enter_uninterrupted_section( &fd_cache_section, &sigset );
+        info = query_completion_ring( handle, entry, idx );
+        server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+    }
+
+    if (!(info & COMPLETION_RING_MODIFY_STATE)) return NULL;
+    ring = completion_ring_region + (info & COMPLETION_RING_INDEX_MASK);
+    /* the server stopped using it, the port's packets are in its queue now */
+    if (*(volatile int *)&ring->disabled) return NULL;
+    return ring;
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -896,15 +1356,22 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
     obj_handle_t fd_handle;
     int ret = 0, fd;
     unsigned int access = 0;
+    LONG epoch;
 
     *unix_fd = -1;
     *needs_close = 0;
     wanted_access &= FILE_READ_DATA | FILE_WRITE_DATA | FILE_APPEND_DATA;
 
+    fd = get_cached_fd( handle, type, &access, options );
+    if (fd != -1) goto done;
+
     server_enter_uninterrupted_section( &fd_cache_section, &sigset );
 
+    /* another thread may have added it in the meantime */
     fd = get_cached_fd( handle, type, &access, options );
-    if (fd != -1) goto done;
+    if (fd != -1) goto leave;
+
+    epoch = fd_cache_epoch;
 
     SERVER_START_REQ( get_handle_fd )
     {
@@ -919,15 +1386,16 @@ int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                 assert( wine_server_ptr_handle(fd_handle) == handle );
                 *needs_close = (!reply->cacheable ||
                                 !add_fd_to_cache( handle, fd, reply->type,
-                                                  reply->access, reply->options ));
+                                                  reply->access, reply->options, epoch ));
             }
             else ret = STATUS_TOO_MANY_OPENED_FILES;
         }
     }
     SERVER_END_REQ;
 
-done:
+leave:
     server_leave_uninterrupted_section( &fd_cache_section, &sigset );
+done:
     if (!ret && ((access & wanted_access) != wanted_access))
     {
         ret = STATUS_ACCESS_DENIED;
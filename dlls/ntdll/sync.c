@@ -46,6 +46,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <time.h>
 
 #define NONAMELESSUNION
@@ -57,6 +58,7 @@
 #include "winternl.h"
 #include "wine/server.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 #include "ntdll_misc.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(ntdll);
@@ -251,12 +253,59 @@ NTSTATUS WINAPI NtQuerySemaphore( HANDLE handle, SEMAPHORE_INFORMATION_CLASS cla
     return ret;
 }
 
+/* read the shared state of an object, waiting for the server to unlock it; it only locks
+ * it while acquiring the objects of a wait-all, so this is very short */
+static int get_fast_sync_state( struct fast_sync_slot *slot )
+{
+    unsigned int spins = 0;
+    int cur;
+
+    while ((cur = *(volatile int *)&slot->state) == FAST_SYNC_LOCKED)
+        if (++spins > 100) NtYieldExecution();
+    return cur;
+}
+
+/* wake up the waiters blocked in the server after changing the shared state of an object */
+static void wake_fast_sync_waiters( HANDLE handle, struct fast_sync_slot *slot )
+{
+    /* the state has been changed with an interlocked operation, so a thread
+     * that isn't counted yet will see the new state once it starts waiting */
+    if (!*(volatile int *)&slot->waiters) return;
+
+    SERVER_START_REQ( fast_sync_wake )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
 /******************************************************************************
  *  NtReleaseSemaphore (NTDLL.@)
  */
 NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, PULONG previous )
 {
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
     NTSTATUS ret;
+
+    if ((slot = server_get_fast_sync( handle, SEMAPHORE_MODIFY_STATE, &type )) &&
+        type == FAST_SYNC_SEMAPHORE)
+    {
+        ULONG cur;
+
+        do
+        {
+            cur = get_fast_sync_state( slot );
+            if (cur + count < cur || cur + count > slot->max) return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+        } while ((ULONG)interlocked_cmpxchg( &slot->state, cur + count, cur ) != cur);
+
+        if (previous) *previous = cur;
+        /* nobody can be blocked on a semaphore whose count was already positive */
+        if (!cur) wake_fast_sync_waiters( handle, slot );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -350,10 +399,24 @@ NTSTATUS WINAPI NtOpenEvent(
  */
 NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 {
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
     NTSTATUS ret;
 
     /* FIXME: set NumberOfThreadsReleased */
 
+    if ((slot = server_get_fast_sync( handle, EVENT_MODIFY_STATE, &type )) &&
+        type != FAST_SYNC_SEMAPHORE)
+    {
+        int cur;
+
+        do cur = get_fast_sync_state( slot );
+        while (interlocked_cmpxchg( &slot->state, 1, cur ) != cur);
+        /* nobody can be blocked on an event that was already signaled */
+        if (!cur) wake_fast_sync_waiters( handle, slot );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -369,11 +432,23 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
  */
 NTSTATUS WINAPI NtResetEvent( HANDLE handle, PULONG NumberOfThreadsReleased )
 {
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
     NTSTATUS ret;
 
     /* resetting an event can't release any thread... */
     if (NumberOfThreadsReleased) *NumberOfThreadsReleased = 0;
 
+    if ((slot = server_get_fast_sync( handle, EVENT_MODIFY_STATE, &type )) &&
+        type != FAST_SYNC_SEMAPHORE)
+    {
+        int cur;
+
+        do cur = get_fast_sync_state( slot );
+        while (interlocked_cmpxchg( &slot->state, 0, cur ) != cur);
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -845,6 +920,29 @@ NTSTATUS WINAPI NtSetTimerResolution(IN ULONG resolution,
 
 /* wait operations */
 
+/* try to satisfy a wait on an event or semaphore without a server call;
+ * returns STATUS_PENDING if the server needs to handle the wait */
+static NTSTATUS fast_sync_wait( HANDLE handle, const LARGE_INTEGER *timeout )
+{
+    struct fast_sync_slot *slot;
+    enum fast_sync_type type;
+    int cur;
+
+    if (!(slot = server_get_fast_sync( handle, SYNCHRONIZE, &type ))) return STATUS_PENDING;
+
+    if (type == FAST_SYNC_MANUAL_EVENT)
+    {
+        if (get_fast_sync_state( slot )) return STATUS_WAIT_0;
+    }
+    else
+    {
+        while ((cur = get_fast_sync_state( slot )) > 0)
+            if (interlocked_cmpxchg( &slot->state, cur - 1, cur ) == cur) return STATUS_WAIT_0;
+    }
+    if (timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
+    return STATUS_PENDING;
+}
+
 /******************************************************************
  *		NtWaitForMultipleObjects (NTDLL.@)
  */
@@ -857,6 +955,13 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles,
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    /* alertable waits need to check for user APCs first */
+    if (count == 1 && !alertable)
+    {
+        NTSTATUS ret = fast_sync_wait( handles[0], timeout );
+        if (ret != STATUS_PENDING) return ret;
+    }
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_all ? SELECT_WAIT_ALL : SELECT_WAIT;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -949,6 +1054,207 @@ NTSTATUS WINAPI NtDelayExecution( BOOLEAN alertable, const LARGE_INTEGER *timeou
 }
 
 
+/* wait for or release a keyed event through the server */
+static NTSTATUS server_keyed_event_op( HANDLE handle, const void *key, BOOL release,
+                                       BOOLEAN alertable, const LARGE_INTEGER *timeout )
+{
+    select_op_t select_op;
+    UINT flags = SELECT_INTERRUPTIBLE;
+
+    if (alertable) flags |= SELECT_ALERTABLE;
+    select_op.keyed_event.op     = release ? SELECT_KEYED_EVENT_RELEASE : SELECT_KEYED_EVENT_WAIT;
+    select_op.keyed_event.handle = wine_server_obj_handle( handle );
+    select_op.keyed_event.key    = wine_server_client_ptr( key );
+    return server_select( &select_op, sizeof(select_op.keyed_event), flags, timeout );
+}
+
+
+#ifdef __linux__
+
+/* convert an NT timeout to an absolute time, TIMEOUT_INFINITE if there is none */
+static LONGLONG get_absolute_timeout( const LARGE_INTEGER *timeout )
+{
+    LARGE_INTEGER now;
+
+    if (!timeout || timeout->QuadPart == TIMEOUT_INFINITE) return TIMEOUT_INFINITE;
+    if (timeout->QuadPart >= 0) return timeout->QuadPart;
+    NtQuerySystemTime( &now );
+    return now.QuadPart - timeout->QuadPart;
+}
+
+/* relative futex timeout until an absolute time, NULL for an infinite wait */
+static struct timespec *get_futex_timeout( struct timespec *timespec, LONGLONG end )
+{
+    LARGE_INTEGER now;
+    LONGLONG diff;
+
+    if (end == TIMEOUT_INFINITE) return NULL;
+    NtQuerySystemTime( &now );
+    diff = max( end - now.QuadPart, 0 );
+    timespec->tv_sec  = diff / 10000000;
+    timespec->tv_nsec = (diff % 10000000) * 100;
+    return timespec;
+}
+
+/* In-process implementation of the process keyed event
+ *
+ * The server never pairs threads of different processes on a keyed event,
+ * so when futexes are available the process keyed event (which is also
+ * what a NULL handle refers to) is implemented with a list of waiting and
+ * releasing threads, each one sleeping on its own futex until paired.
+ *
+ * Alertable operations need the server to be woken up by user APCs. When
+ * they don't find a partner right away they go to the server, and are kept
+ * in a second list while they are there, so that the matching operations
+ * on the same key follow them instead of waiting in process forever. */
+
+struct keyed_entry
+{
+    struct list  entry;
+    const void  *key;
+    BOOL         release;   /* is the thread releasing or waiting? */
+    int          paired;    /* futex, set once another thread took care of us */
+};
+
+static struct list keyed_entries = LIST_INIT( keyed_entries );
+static struct list keyed_server_entries = LIST_INIT( keyed_server_entries );
+
+static RTL_CRITICAL_SECTION keyed_section;
+static RTL_CRITICAL_SECTION_DEBUG keyed_section_debug =
+{
+    0, 0, &keyed_section,
+    { &keyed_section_debug.ProcessLocksList, &keyed_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": keyed_section") }
+};
+static RTL_CRITICAL_SECTION keyed_section = { &keyed_section_debug, -1, 0, 0, 0, 0 };
+
+static NTSTATUS fast_keyed_event_op( HANDLE handle, const void *key, BOOL release,
+                                     BOOLEAN alertable, const LARGE_INTEGER *timeout )
+{
+    struct keyed_entry self, *other;
+    struct timespec timespec;
+    LONGLONG end;
+    BOOL paired, use_server = alertable;
+    NTSTATUS ret;
+
+    if ((handle && handle != keyed_event) || !use_futexes())
+        return STATUS_NOT_IMPLEMENTED;
+
+    self.key     = key;
+    self.release = release;
+    self.paired  = 0;
+
+    RtlEnterCriticalSection( &keyed_section );
+    LIST_FOR_EACH_ENTRY( other, &keyed_entries, struct keyed_entry, entry )
+    {
+        if (other->key != key || other->release == release) continue;
+        list_remove( &other->entry );
+        other->paired = 1;
+        futex_wake( &other->paired, 1 );
+        RtlLeaveCriticalSection( &keyed_section );
+        return STATUS_SUCCESS;
+    }
+    LIST_FOR_EACH_ENTRY( other, &keyed_server_entries, struct keyed_entry, entry )
+    {
+        if (other->key != key || other->release == release) continue;
+        use_server = TRUE;  /* our partner is waiting in the server */
+        break;
+    }
+    if (use_server)
+    {
+        list_add_tail( &keyed_server_entries, &self.entry );
+        RtlLeaveCriticalSection( &keyed_section );
+
+        ret = server_keyed_event_op( keyed_event, key, release, alertable, timeout );
+
+        RtlEnterCriticalSection( &keyed_section );
+        list_remove( &self.entry );
+        RtlLeaveCriticalSection( &keyed_section );
+        return ret;
+    }
+    list_add_tail( &keyed_entries, &self.entry );
+    RtlLeaveCriticalSection( &keyed_section );
+
+    end = get_absolute_timeout( timeout );
+    while (!*(volatile int *)&self.paired)
+    {
+        if (futex_wait( &self.paired, 0, get_futex_timeout( &timespec, end ) ) == -1 && errno == ETIMEDOUT)
+        {
+            RtlEnterCriticalSection( &keyed_section );
+            if (!(paired = self.paired)) list_remove( &self.entry );
+            RtlLeaveCriticalSection( &keyed_section );
+            if (!paired) return STATUS_TIMEOUT;
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+/* RtlWaitOnAddress support: waiters sleep on a futex picked from a small
+ * hash table, which is bumped and woken up by the wake functions. Collisions
+ * only cause spurious wakeups, which callers have to expect anyway. */
+
+static int addr_futex_table[256];
+
+static inline int *hash_addr( const void *addr )
+{
+    ULONG_PTR val = (ULONG_PTR)addr;
+    return &addr_futex_table[(val >> 2) & 255];
+}
+
+static BOOL compare_addr( const void *addr, const void *cmp, SIZE_T size );
+
+static NTSTATUS fast_wait_addr( const void *addr, const void *cmp, SIZE_T size,
+                                const LARGE_INTEGER *timeout )
+{
+    struct timespec timespec;
+    int *futex, val;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    futex = hash_addr( addr );
+    /* read the futex before the address, so that a wake in between is noticed */
+    val = interlocked_cmpxchg( futex, 0, 0 );
+    if (!compare_addr( addr, cmp, size )) return STATUS_SUCCESS;
+
+    if (futex_wait( futex, val, get_futex_timeout( &timespec, get_absolute_timeout( timeout ) ) ) == -1 &&
+        errno == ETIMEDOUT)
+        return STATUS_TIMEOUT;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_wake_addr( const void *addr )
+{
+    int *futex;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    futex = hash_addr( addr );
+    interlocked_xchg_add( futex, 1 );
+    futex_wake( futex, INT_MAX );
+    return STATUS_SUCCESS;
+}
+
+#else  /* __linux__ */
+
+static NTSTATUS fast_keyed_event_op( HANDLE handle, const void *key, BOOL release,
+                                     BOOLEAN alertable, const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_wait_addr( const void *addr, const void *cmp, SIZE_T size,
+                                const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_wake_addr( const void *addr )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
 /******************************************************************************
  *              NtCreateKeyedEvent (NTDLL.@)
  */
@@ -1016,15 +1322,12 @@ NTSTATUS WINAPI NtOpenKeyedEvent( HANDLE *handle, ACCESS_MASK access, const OBJE
 NTSTATUS WINAPI NtWaitForKeyedEvent( HANDLE handle, const void *key,
                                      BOOLEAN alertable, const LARGE_INTEGER *timeout )
 {
-    select_op_t select_op;
-    UINT flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if ((ULONG_PTR)key & 1) return STATUS_INVALID_PARAMETER_1;
-    if (alertable) flags |= SELECT_ALERTABLE;
-    select_op.keyed_event.op     = SELECT_KEYED_EVENT_WAIT;
-    select_op.keyed_event.handle = wine_server_obj_handle( handle );
-    select_op.keyed_event.key    = wine_server_client_ptr( key );
-    return server_select( &select_op, sizeof(select_op.keyed_event), flags, timeout );
+    if ((ret = fast_keyed_event_op( handle, key, FALSE, alertable, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+    return server_keyed_event_op( handle, key, FALSE, alertable, timeout );
 }
 
 /******************************************************************************
@@ -1033,15 +1336,152 @@ NTSTATUS WINAPI NtWaitForKeyedEvent( HANDLE handle, const void *key,
 NTSTATUS WINAPI NtReleaseKeyedEvent( HANDLE handle, const void *key,
                                      BOOLEAN alertable, const LARGE_INTEGER *timeout )
 {
-    select_op_t select_op;
-    UINT flags = SELECT_INTERRUPTIBLE;
+    NTSTATUS ret;
 
     if ((ULONG_PTR)key & 1) return STATUS_INVALID_PARAMETER_1;
-    if (alertable) flags |= SELECT_ALERTABLE;
-    select_op.keyed_event.op     = SELECT_KEYED_EVENT_RELEASE;
-    select_op.keyed_event.handle = wine_server_obj_handle( handle );
-    select_op.keyed_event.key    = wine_server_client_ptr( key );
-    return server_select( &select_op, sizeof(select_op.keyed_event), flags, timeout );
+    if ((ret = fast_keyed_event_op( handle, key, TRUE, alertable, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+    return server_keyed_event_op( handle, key, TRUE, alertable, timeout );
+}
+
+/* completion ports with a shared ring of packets, see server/completion.c */
+
+/* how long to wait for a packet that is still being written before asking the server to check
+ * on its writer: first yield, then sleep a millisecond at a time */
+#define COMPLETION_RING_SPINS   100
+#define COMPLETION_RING_SLEEPS  50
+
+/* wake up a waiter blocked in the server, and let it refill the ring if packets overflowed */
+static void wake_completion_ring( HANDLE port, BOOL stalled )
+{
+    SERVER_START_REQ( completion_ring_wake )
+    {
+        req->handle  = wine_server_obj_handle( port );
+        req->stalled = stalled;
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+static BOOL completion_ring_push( struct completion_ring *ring, ULONG_PTR key, ULONG_PTR value,
+                                  NTSTATUS status, ULONG_PTR information )
+{
+    struct completion_ring_entry *entry;
+    unsigned int pos, retries;
+    int diff;
+
+    /* packets queued in the server must be removed first */
+    if (*(volatile int *)&ring->overflow || *(volatile int *)&ring->disabled) return FALSE;
+
+    for (retries = 0; ; retries++)
+    {
+        if (retries == COMPLETION_RING_SIZE) return FALSE;  /* let the server queue it */
+        pos = *(volatile unsigned int *)&ring->enqueue_pos;
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        diff = *(volatile unsigned int *)&entry->seq - pos;
+        if (diff < 0) return FALSE;  /* full */
+        if (!diff && (unsigned int)interlocked_cmpxchg( (int *)&ring->enqueue_pos, pos + 1, pos ) == pos)
+            break;
+    }
+    entry->ckey        = key;
+    entry->cvalue      = value;
+    entry->information = information;
+    entry->status      = status;
+    interlocked_xchg( (int *)&entry->seq, pos + 1 );
+
+    /* if the server stopped using the ring meanwhile, it may have missed the packet;
+     * take it back unless it's been removed already, and post it with a request */
+    if (*(volatile int *)&ring->disabled &&
+        (unsigned int)interlocked_cmpxchg( (int *)&entry->seq, pos - 1, pos + 1 ) == pos + 1)
+        return FALSE;
+    interlocked_xchg_add( &ring->count, 1 );
+    return TRUE;
+}
+
+/* remove up to max packets from the ring, without blocking for long */
+static ULONG completion_ring_pop( HANDLE port, struct completion_ring *ring,
+                                  FILE_IO_COMPLETION_INFORMATION *info, ULONG max )
+{
+    struct completion_ring_entry *entry;
+    LARGE_INTEGER one_ms;
+    unsigned int pos, spins;
+    int count, diff;
+    ULONG i, taken, retries, ret = 0;
+    BOOL stalled = FALSE;
+
+    one_ms.QuadPart = -10000;
+    for (retries = 0; ; retries++)
+    {
+        if (retries == COMPLETION_RING_SIZE || *(volatile int *)&ring->disabled) return 0;
+        if ((count = *(volatile int *)&ring->count) <= 0) return 0;
+        taken = min( (ULONG)count, max );
+        if (interlocked_cmpxchg( &ring->count, count - taken, count ) == count) break;
+    }
+
+    /* the packets are ours now, but the first ones may still be being written */
+    for (i = 0; i < taken; i++)
+    {
+        for (spins = 0; ; spins++)
+        {
+            pos = *(volatile unsigned int *)&ring->dequeue_pos;
+            entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+            diff = *(volatile unsigned int *)&entry->seq - (pos + 1);
+            if (!diff && (unsigned int)interlocked_cmpxchg( (int *)&ring->dequeue_pos, pos + 1, pos ) == pos)
+                break;
+            if (*(volatile int *)&ring->disabled) goto done;
+            if (spins == COMPLETION_RING_SPINS + COMPLETION_RING_SLEEPS)
+            {
+                stalled = TRUE;
+                goto done;
+            }
+            if (diff >= 0) continue;
+            if (spins < COMPLETION_RING_SPINS) NtYieldExecution();
+            else NtDelayExecution( FALSE, &one_ms );
+        }
+        info[ret].CompletionKey          = entry->ckey;
+        info[ret].CompletionValue        = entry->cvalue;
+        info[ret].IoStatusBlock.u.Status = entry->status;
+        info[ret].IoStatusBlock.Information = entry->information;
+        /* the server takes the packet itself if it stops using the ring meanwhile */
+        if ((unsigned int)interlocked_cmpxchg( (int *)&entry->seq, pos + COMPLETION_RING_SIZE,
+                                               pos + 1 ) == pos + 1)
+            ret++;
+    }
+
+done:
+    /* give back what we couldn't remove, and let the server check on a writer that never finished */
+    if (i < taken) interlocked_xchg_add( &ring->count, taken - i );
+    if (stalled) wake_completion_ring( port, TRUE );
+    /* we made room for the packets the server had to keep */
+    else if (*(volatile int *)&ring->overflow) wake_completion_ring( port, FALSE );
+    return ret;
+}
+
+/* returns STATUS_NOT_IMPLEMENTED if the server stopped using the ring, its packets are then
+ * in the server queue */
+static NTSTATUS remove_ring_completions( HANDLE port, struct completion_ring *ring,
+                                         FILE_IO_COMPLETION_INFORMATION *info, ULONG max,
+                                         ULONG *written, const LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    LARGE_INTEGER end;
+    NTSTATUS status;
+
+    /* other threads may take the packets we are woken up for, so keep the deadline across waits */
+    if (timeout && timeout->QuadPart < 0)
+    {
+        NtQuerySystemTime( &end );
+        end.QuadPart -= timeout->QuadPart;
+        timeout = &end;
+    }
+
+    for (;;)
+    {
+        if ((*written = completion_ring_pop( port, ring, info, max ))) return STATUS_SUCCESS;
+        if (*(volatile int *)&ring->disabled) return STATUS_NOT_IMPLEMENTED;
+        if (timeout && !timeout->QuadPart) return STATUS_TIMEOUT;
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != STATUS_WAIT_0) return status;
+    }
 }
 
 /******************************************************************
@@ -1101,11 +1541,21 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE CompletionPort, ULONG_PTR CompletionKe
                                    ULONG_PTR CompletionValue, NTSTATUS Status,
                                    SIZE_T NumberOfBytesTransferred )
 {
+    struct completion_ring *ring;
     NTSTATUS status;
 
     TRACE("(%p, %lx, %lx, %x, %lx)\n", CompletionPort, CompletionKey,
           CompletionValue, Status, NumberOfBytesTransferred);
 
+    if ((ring = server_get_completion_ring( CompletionPort )) &&
+        completion_ring_push( ring, CompletionKey, CompletionValue, Status, NumberOfBytesTransferred ))
+    {
+        /* the packet is counted with an interlocked operation, so a thread
+         * that isn't counted as a waiter yet will see it once it starts waiting */
+        if (*(volatile int *)&ring->waiters) wake_completion_ring( CompletionPort, FALSE );
+        return STATUS_SUCCESS;
+    }
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( CompletionPort );
@@ -1137,11 +1587,27 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
                                       PULONG_PTR CompletionValue, PIO_STATUS_BLOCK iosb,
                                       PLARGE_INTEGER WaitTime )
 {
+    struct completion_ring *ring;
+    FILE_IO_COMPLETION_INFORMATION info;
+    ULONG count;
     NTSTATUS status;
 
     TRACE("(%p, %p, %p, %p, %p)\n", CompletionPort, CompletionKey,
           CompletionValue, iosb, WaitTime);
 
+    if ((ring = server_get_completion_ring( CompletionPort )) &&
+        (status = remove_ring_completions( CompletionPort, ring, &info, 1, &count,
+                                           WaitTime, FALSE )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (status == STATUS_SUCCESS)
+        {
+            *CompletionKey   = info.CompletionKey;
+            *CompletionValue = info.CompletionValue;
+            *iosb            = info.IoStatusBlock;
+        }
+        return status;
+    }
+
     for(;;)
     {
         SERVER_START_REQ( remove_completion )
@@ -1164,6 +1630,66 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from completion object's queue
+ *
+ * PARAMS
+ *      CompletionPort  [I] HANDLE to I/O completion object
+ *      info            [O] array of completion messages
+ *      count           [I] size of the array
+ *      written         [O] number of messages retrieved
+ *      timeout         [I] optional wait time in NTDLL format
+ *      alertable       [I] whether the wait is alertable
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE CompletionPort, FILE_IO_COMPLETION_INFORMATION *info,
+                                        ULONG count, ULONG *written, LARGE_INTEGER *timeout,
+                                        BOOLEAN alertable )
+{
+    struct completion_ring *ring;
+    NTSTATUS status;
+    ULONG i = 0;
+
+    TRACE("(%p, %p, %u, %p, %p, %u)\n", CompletionPort, info, count, written, timeout, alertable);
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+
+    if ((ring = server_get_completion_ring( CompletionPort )) &&
+        (status = remove_ring_completions( CompletionPort, ring, info, count, written,
+                                           timeout, alertable )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
+    for (;;)
+    {
+        while (i < count)
+        {
+            SERVER_START_REQ( remove_completion )
+            {
+                req->handle = wine_server_obj_handle( CompletionPort );
+                if (!(status = wine_server_call( req )))
+                {
+                    info[i].CompletionKey             = reply->ckey;
+                    info[i].CompletionValue           = reply->cvalue;
+                    info[i].IoStatusBlock.Information = reply->information;
+                    info[i].IoStatusBlock.u.Status    = reply->status;
+                }
+            }
+            SERVER_END_REQ;
+            if (status) break;
+            i++;
+        }
+        if (i || status != STATUS_PENDING) break;
+
+        status = NtWaitForSingleObject( CompletionPort, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+    *written = i;
+    return i ? STATUS_SUCCESS : status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
@@ -1251,7 +1777,7 @@ NTSTATUS WINAPI NtQueryIoCompletion( HANDLE CompletionPort, IO_COMPLETION_INFORM
 }
 
 NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
-                              NTSTATUS CompletionStatus, ULONG Information )
+                              NTSTATUS CompletionStatus, ULONG Information, BOOL async )
 {
     NTSTATUS status;
 
@@ -1261,6 +1787,7 @@ NTSTATUS NTDLL_AddCompletion( HANDLE hFile, ULONG_PTR CompletionValue,
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         status = wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -1383,6 +1910,312 @@ DWORD WINAPI RtlRunOnceExecuteOnce( RTL_RUN_ONCE *once, PRTL_RUN_ONCE_INIT_FN fu
 }
 
 
+#ifdef __linux__
+
+/* Futex-based SRW locks
+ *
+ * When futexes are available the kernel takes care of queueing the waiters,
+ * so the lock doesn't need to count them precisely and can use a simpler
+ * layout than the keyed event implementation below:
+ *
+ *    31 - the lock is owned exclusively
+ * 30-16 - number of threads waiting for exclusive access
+ *    15 - there are threads waiting for shared access
+ *  14-0 - number of shared owners
+ *
+ * Exclusive and shared waiters sleep on the same futex with different
+ * bitsets, so that releasing the lock only wakes up the right kind. */
+
+#define SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT        0x80000000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK    0x7fff0000
+#define SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC     0x00010000
+#define SRWLOCK_FUTEX_SHARED_WAITERS_BIT        0x00008000
+#define SRWLOCK_FUTEX_SHARED_OWNERS_MASK        0x00007fff
+#define SRWLOCK_FUTEX_SHARED_OWNERS_INC         0x00000001
+
+#define SRWLOCK_FUTEX_BITSET_EXCLUSIVE  1
+#define SRWLOCK_FUTEX_BITSET_SHARED     2
+
+static NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (old = *(int *)&lock->Ptr;;)
+    {
+        if ((old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) || (old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+            return STATUS_TIMEOUT;
+        if (interlocked_cmpxchg( (int *)&lock->Ptr, old | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT, old ) == old)
+            return STATUS_SUCCESS;
+        old = *(volatile int *)&lock->Ptr;
+    }
+}
+
+static NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    /* uncontended case */
+    if (!interlocked_cmpxchg( (int *)&lock->Ptr, SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT, 0 ))
+        return STATUS_SUCCESS;
+
+    /* register as an exclusive waiter, this keeps new shared owners out */
+    do
+    {
+        old = *(volatile int *)&lock->Ptr;
+        new = old + SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+        if (!(new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+    } while (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) != old);
+
+    for (;;)
+    {
+        do
+        {
+            old = *(volatile int *)&lock->Ptr;
+            if ((old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) || (old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+                break;
+            new = (old | SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) - SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_INC;
+            if (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) == old) return STATUS_SUCCESS;
+        } while (1);
+
+        futex_wait_bitset( (int *)&lock->Ptr, old, NULL, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    }
+}
+
+static NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (old = *(int *)&lock->Ptr;;)
+    {
+        if ((old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) || (old & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+            return STATUS_TIMEOUT;
+        new = old + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+        if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        if (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) == old) return STATUS_SUCCESS;
+        old = *(volatile int *)&lock->Ptr;
+    }
+}
+
+static NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    for (;;)
+    {
+        old = *(volatile int *)&lock->Ptr;
+        if ((old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) || (old & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+        {
+            /* exclusive owners and waiters go first */
+            new = old | SRWLOCK_FUTEX_SHARED_WAITERS_BIT;
+            if (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) == old)
+                futex_wait_bitset( (int *)&lock->Ptr, new, NULL, SRWLOCK_FUTEX_BITSET_SHARED );
+            continue;
+        }
+        new = old + SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+        if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK)) RtlRaiseStatus( STATUS_RESOURCE_NOT_OWNED );
+        if (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) == old) return STATUS_SUCCESS;
+    }
+}
+
+static NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(volatile int *)&lock->Ptr;
+        if (!(old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT)) return STATUS_RESOURCE_NOT_OWNED;
+        new = old & ~SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT;
+        /* shared waiters are all woken up below if there is no exclusive waiter */
+        if (!(new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)) new &= ~SRWLOCK_FUTEX_SHARED_WAITERS_BIT;
+    } while (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) != old);
+
+    if (new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK)
+        futex_wake_bitset( (int *)&lock->Ptr, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    else if (old & SRWLOCK_FUTEX_SHARED_WAITERS_BIT)
+        futex_wake_bitset( (int *)&lock->Ptr, INT_MAX, SRWLOCK_FUTEX_BITSET_SHARED );
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    int old, new;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    do
+    {
+        old = *(volatile int *)&lock->Ptr;
+        if ((old & SRWLOCK_FUTEX_EXCLUSIVE_LOCK_BIT) || !(old & SRWLOCK_FUTEX_SHARED_OWNERS_MASK))
+            return STATUS_RESOURCE_NOT_OWNED;
+        new = old - SRWLOCK_FUTEX_SHARED_OWNERS_INC;
+    } while (interlocked_cmpxchg( (int *)&lock->Ptr, new, old ) != old);
+
+    /* the last shared owner lets an exclusive waiter in */
+    if (!(new & SRWLOCK_FUTEX_SHARED_OWNERS_MASK) && (new & SRWLOCK_FUTEX_EXCLUSIVE_WAITERS_MASK))
+        futex_wake_bitset( (int *)&lock->Ptr, 1, SRWLOCK_FUTEX_BITSET_EXCLUSIVE );
+    return STATUS_SUCCESS;
+}
+
+/* Futex-based condition variables
+ *
+ * The variable holds a sequence number that is bumped by every wake, so that
+ * a thread going to sleep after the lock was released still notices it. The
+ * low bit is set by sleeping threads, which lets the wake functions skip the
+ * system call when nobody is waiting. */
+
+#define CV_FUTEX_WAITERS_BIT  1
+#define CV_FUTEX_SEQ_INC      2
+
+static NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    int old, *futex = (int *)&variable->Ptr;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    if (!(*(volatile int *)futex & CV_FUTEX_WAITERS_BIT)) return STATUS_SUCCESS;
+
+    if (count == 1)
+    {
+        interlocked_xchg_add( futex, CV_FUTEX_SEQ_INC );
+        if (futex_wake( futex, 1 ) > 0) return STATUS_SUCCESS;
+        /* nobody was sleeping anymore, clear the waiters bit below */
+    }
+
+    /* clearing the bit can race with a thread going to sleep, so wake
+     * up everybody; the waiters that are still around will set it again */
+    do
+    {
+        old = *(volatile int *)futex;
+    } while (interlocked_cmpxchg( futex, (old + CV_FUTEX_SEQ_INC) & ~CV_FUTEX_WAITERS_BIT, old ) != old);
+    futex_wake( futex, INT_MAX );
+    return STATUS_SUCCESS;
+}
+
+/* mark the variable as having waiters, return the value to sleep on */
+static int fast_prepare_sleep_cv( RTL_CONDITION_VARIABLE *variable )
+{
+    int old, *futex = (int *)&variable->Ptr;
+
+    do
+    {
+        old = *(volatile int *)futex;
+        if (old & CV_FUTEX_WAITERS_BIT) return old;
+    } while (interlocked_cmpxchg( futex, old | CV_FUTEX_WAITERS_BIT, old ) != old);
+    return old | CV_FUTEX_WAITERS_BIT;
+}
+
+static NTSTATUS fast_sleep_cv( RTL_CONDITION_VARIABLE *variable, int val, const LARGE_INTEGER *timeout )
+{
+    struct timespec timespec;
+
+    if (futex_wait( (int *)&variable->Ptr, val,
+                    get_futex_timeout( &timespec, get_absolute_timeout( timeout ) ) ) == -1 &&
+        errno == ETIMEDOUT)
+        return STATUS_TIMEOUT;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fast_sleep_cs_cv( RTL_CONDITION_VARIABLE *variable, RTL_CRITICAL_SECTION *crit,
+                                  const LARGE_INTEGER *timeout )
+{
+    NTSTATUS status;
+    int val;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    val = fast_prepare_sleep_cv( variable );
+    RtlLeaveCriticalSection( crit );
+    status = fast_sleep_cv( variable, val, timeout );
+    RtlEnterCriticalSection( crit );
+    return status;
+}
+
+static NTSTATUS fast_sleep_srw_cv( RTL_CONDITION_VARIABLE *variable, RTL_SRWLOCK *lock,
+                                   const LARGE_INTEGER *timeout, ULONG flags )
+{
+    NTSTATUS status;
+    int val;
+
+    if (!use_futexes()) return STATUS_NOT_IMPLEMENTED;
+
+    val = fast_prepare_sleep_cv( variable );
+    if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
+    {
+        RtlReleaseSRWLockShared( lock );
+        status = fast_sleep_cv( variable, val, timeout );
+        RtlAcquireSRWLockShared( lock );
+    }
+    else
+    {
+        RtlReleaseSRWLockExclusive( lock );
+        status = fast_sleep_cv( variable, val, timeout );
+        RtlAcquireSRWLockExclusive( lock );
+    }
+    return status;
+}
+
+#else  /* __linux__ */
+
+static NTSTATUS fast_try_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_acquire_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_try_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_acquire_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_srw_exclusive( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_release_srw_shared( RTL_SRWLOCK *lock )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_wake_cv( RTL_CONDITION_VARIABLE *variable, int count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_sleep_cs_cv( RTL_CONDITION_VARIABLE *variable, RTL_CRITICAL_SECTION *crit,
+                                  const LARGE_INTEGER *timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS fast_sleep_srw_cv( RTL_CONDITION_VARIABLE *variable, RTL_SRWLOCK *lock,
+                                   const LARGE_INTEGER *timeout, ULONG flags )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
 /* SRW locks implementation
  *
  * The memory layout used by the lock is:
@@ -1510,7 +2343,8 @@ static inline void srwlock_leave_shared( RTL_SRWLOCK *lock, unsigned int val )
  * NOTES
  *  Please note that SRWLocks do not keep track of the owner of a lock.
  *  It doesn't make any difference which thread for example unlocks an
- *  SRWLock (see corresponding tests). This implementation uses two
+ *  SRWLock (see corresponding tests). When futexes are available the
+ *  waiters sleep on the lock itself, otherwise this implementation uses two
  *  keyed events (one for the exclusive waiters and one for the shared
  *  waiters) and is limited to 2^15-1 waiting threads.
  */
@@ -1529,6 +2363,9 @@ void WINAPI RtlInitializeSRWLock( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    if (fast_acquire_srw_exclusive( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (srwlock_lock_exclusive( (unsigned int *)&lock->Ptr, SRWLOCK_RES_EXCLUSIVE ))
         NtWaitForKeyedEvent( keyed_event, srwlock_key_exclusive(lock), FALSE, NULL );
 }
@@ -1543,6 +2380,10 @@ void WINAPI RtlAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+
+    if (fast_acquire_srw_shared( lock ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     /* Acquires a shared lock. If it's currently not possible to add elements to
      * the shared queue, then request exclusive access instead. */
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
@@ -1573,6 +2414,14 @@ void WINAPI RtlAcquireSRWLockShared( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    NTSTATUS status;
+
+    if ((status = fast_release_srw_exclusive( lock )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (status) RtlRaiseStatus( status );
+        return;
+    }
+
     srwlock_leave_exclusive( lock, srwlock_unlock_exclusive( (unsigned int *)&lock->Ptr,
                              - SRWLOCK_RES_EXCLUSIVE ) - SRWLOCK_RES_EXCLUSIVE );
 }
@@ -1582,6 +2431,14 @@ void WINAPI RtlReleaseSRWLockExclusive( RTL_SRWLOCK *lock )
  */
 void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
 {
+    NTSTATUS status;
+
+    if ((status = fast_release_srw_shared( lock )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (status) RtlRaiseStatus( status );
+        return;
+    }
+
     srwlock_leave_shared( lock, srwlock_lock_exclusive( (unsigned int *)&lock->Ptr,
                           - SRWLOCK_RES_SHARED ) - SRWLOCK_RES_SHARED );
 }
@@ -1595,6 +2452,11 @@ void WINAPI RtlReleaseSRWLockShared( RTL_SRWLOCK *lock )
  */
 BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 {
+    NTSTATUS status;
+
+    if ((status = fast_try_acquire_srw_exclusive( lock )) != STATUS_NOT_IMPLEMENTED)
+        return status == STATUS_SUCCESS;
+
     return interlocked_cmpxchg( (int *)&lock->Ptr, SRWLOCK_MASK_IN_EXCLUSIVE |
                                 SRWLOCK_RES_EXCLUSIVE, 0 ) == 0;
 }
@@ -1605,6 +2467,11 @@ BOOLEAN WINAPI RtlTryAcquireSRWLockExclusive( RTL_SRWLOCK *lock )
 BOOLEAN WINAPI RtlTryAcquireSRWLockShared( RTL_SRWLOCK *lock )
 {
     unsigned int val, tmp;
+    NTSTATUS status;
+
+    if ((status = fast_try_acquire_srw_shared( lock )) != STATUS_NOT_IMPLEMENTED)
+        return status == STATUS_SUCCESS;
+
     for (val = *(unsigned int *)&lock->Ptr;; val = tmp)
     {
         if (val & SRWLOCK_MASK_EXCLUSIVE_QUEUE)
@@ -1648,6 +2515,9 @@ void WINAPI RtlInitializeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
+    if (fast_wake_cv( variable, 1 ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
     if (interlocked_dec_if_nonzero( (int *)&variable->Ptr ))
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1659,7 +2529,12 @@ void WINAPI RtlWakeConditionVariable( RTL_CONDITION_VARIABLE *variable )
  */
 void WINAPI RtlWakeAllConditionVariable( RTL_CONDITION_VARIABLE *variable )
 {
-    int val = interlocked_xchg( (int *)&variable->Ptr, 0 );
+    int val;
+
+    if (fast_wake_cv( variable, INT_MAX ) != STATUS_NOT_IMPLEMENTED)
+        return;
+
+    val = interlocked_xchg( (int *)&variable->Ptr, 0 );
     while (val-- > 0)
         NtReleaseKeyedEvent( keyed_event, &variable->Ptr, FALSE, NULL );
 }
@@ -1683,6 +2558,10 @@ NTSTATUS WINAPI RtlSleepConditionVariableCS( RTL_CONDITION_VARIABLE *variable, R
                                              const LARGE_INTEGER *timeout )
 {
     NTSTATUS status;
+
+    if ((status = fast_sleep_cs_cv( variable, crit, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
     interlocked_xchg_add( (int *)&variable->Ptr, 1 );
     RtlLeaveCriticalSection( crit );
 
@@ -1720,6 +2599,10 @@ NTSTATUS WINAPI RtlSleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable,
                                               const LARGE_INTEGER *timeout, ULONG flags )
 {
     NTSTATUS status;
+
+    if ((status = fast_sleep_srw_cv( variable, lock, timeout, flags )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
     interlocked_xchg_add( (int *)&variable->Ptr, 1 );
 
     if (flags & RTL_CONDITION_VARIABLE_LOCKMODE_SHARED)
@@ -1740,3 +2623,127 @@ NTSTATUS WINAPI RtlSleepConditionVariableSRW( RTL_CONDITION_VARIABLE *variable,
         RtlAcquireSRWLockExclusive( lock );
     return status;
 }
+
+/* RtlWaitOnAddress fallback when futexes are not available: the waiters are
+ * kept in a list and sleep on the process keyed event, using the address of
+ * their list entry as key. */
+
+struct addr_wait_entry
+{
+    struct list  entry;
+    const void  *addr;  /* address waited on, NULL once woken up */
+};
+
+static struct list addr_waiters = LIST_INIT( addr_waiters );
+
+static RTL_CRITICAL_SECTION addr_section;
+static RTL_CRITICAL_SECTION_DEBUG addr_section_debug =
+{
+    0, 0, &addr_section,
+    { &addr_section_debug.ProcessLocksList, &addr_section_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": addr_section") }
+};
+static RTL_CRITICAL_SECTION addr_section = { &addr_section_debug, -1, 0, 0, 0, 0 };
+
+static BOOL compare_addr( const void *addr, const void *cmp, SIZE_T size )
+{
+    switch (size)
+    {
+    case 1: return (*(const volatile BYTE *)addr == *(const BYTE *)cmp);
+    case 2: return (*(const volatile WORD *)addr == *(const WORD *)cmp);
+    case 4: return (*(const volatile DWORD *)addr == *(const DWORD *)cmp);
+    case 8: return (*(const volatile DWORD64 *)addr == *(const DWORD64 *)cmp);
+    }
+    return FALSE;
+}
+
+static void wake_addr_waiters( const void *addr, int count )
+{
+    struct addr_wait_entry *entry, *next;
+    struct list woken = LIST_INIT( woken );
+
+    RtlEnterCriticalSection( &addr_section );
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &addr_waiters, struct addr_wait_entry, entry )
+    {
+        if (entry->addr != addr) continue;
+        entry->addr = NULL;
+        list_remove( &entry->entry );
+        list_add_tail( &woken, &entry->entry );
+        if (!--count) break;
+    }
+    RtlLeaveCriticalSection( &addr_section );
+
+    /* the entries stay valid until the corresponding thread is released */
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &woken, struct addr_wait_entry, entry )
+        NtReleaseKeyedEvent( keyed_event, entry, FALSE, NULL );
+}
+
+/***********************************************************************
+ *           RtlWaitOnAddress   (NTDLL.@)
+ *
+ * Waits until the value at an address differs from the compare value,
+ * or until one of the RtlWakeAddress functions is called for it.
+ *
+ * PARAMS
+ *  addr     [I] address to wait on
+ *  cmp      [I] value the address is compared to
+ *  size     [I] size of the value (1, 2, 4 or 8 bytes)
+ *  timeout  [I] timeout
+ *
+ * RETURNS
+ *  STATUS_SUCCESS when woken up or if the value differs, STATUS_TIMEOUT otherwise.
+ *
+ * NOTES
+ *  Spurious wakeups may happen, callers are expected to check the value again.
+ */
+NTSTATUS WINAPI RtlWaitOnAddress( const void *addr, const void *cmp, SIZE_T size,
+                                  const LARGE_INTEGER *timeout )
+{
+    struct addr_wait_entry self;
+    NTSTATUS status;
+    BOOL woken;
+
+    if (size != 1 && size != 2 && size != 4 && size != 8) return STATUS_INVALID_PARAMETER;
+
+    if ((status = fast_wait_addr( addr, cmp, size, timeout )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
+    RtlEnterCriticalSection( &addr_section );
+    if (!compare_addr( addr, cmp, size ))
+    {
+        RtlLeaveCriticalSection( &addr_section );
+        return STATUS_SUCCESS;
+    }
+    self.addr = addr;
+    list_add_tail( &addr_waiters, &self.entry );
+    RtlLeaveCriticalSection( &addr_section );
+
+    status = NtWaitForKeyedEvent( keyed_event, &self, FALSE, timeout );
+    if (status != STATUS_SUCCESS)
+    {
+        RtlEnterCriticalSection( &addr_section );
+        if (!(woken = !self.addr)) list_remove( &self.entry );
+        RtlLeaveCriticalSection( &addr_section );
+        /* somebody is about to release us, wait for it */
+        if (woken) status = NtWaitForKeyedEvent( keyed_event, &self, FALSE, NULL );
+    }
+    return status;
+}
+
+/***********************************************************************
+ *           RtlWakeAddressAll   (NTDLL.@)
+ */
+void WINAPI RtlWakeAddressAll( const void *addr )
+{
+    if (fast_wake_addr( addr ) != STATUS_NOT_IMPLEMENTED) return;
+    wake_addr_waiters( addr, -1 );
+}
+
+/***********************************************************************
+ *           RtlWakeAddressSingle   (NTDLL.@)
+ */
+void WINAPI RtlWakeAddressSingle( const void *addr )
+{
+    if (fast_wake_addr( addr ) != STATUS_NOT_IMPLEMENTED) return;
+    wake_addr_waiters( addr, 1 );
+}
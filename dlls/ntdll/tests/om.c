@@ -24,6 +24,7 @@
 #include "stdio.h"
 #include "winnt.h"
 #include "stdlib.h"
+#include "wine/server.h"
 
 static HANDLE   (WINAPI *pCreateWaitableTimerA)(SECURITY_ATTRIBUTES*, BOOL, LPCSTR);
 static BOOLEAN  (WINAPI *pRtlCreateUnicodeStringFromAsciiz)(PUNICODE_STRING, LPCSTR);
@@ -54,6 +55,8 @@ static NTSTATUS (WINAPI *pNtCreateKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJE
 static NTSTATUS (WINAPI *pNtOpenKeyedEvent)( HANDLE *, ACCESS_MASK, const OBJECT_ATTRIBUTES * );
 static NTSTATUS (WINAPI *pNtWaitForKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
 static NTSTATUS (WINAPI *pNtReleaseKeyedEvent)( HANDLE, const void *, BOOLEAN, const LARGE_INTEGER * );
+static unsigned int (CDECL *pwine_server_call)( void *req_ptr );
+static unsigned int (CDECL *pwine_server_call_batch)( struct __server_request_info *reqs, unsigned int count );
 
 #define KEYEDEVENT_WAIT       0x0001
 #define KEYEDEVENT_WAKE       0x0002
@@ -891,6 +894,82 @@ static DWORD WINAPI keyed_event_thread( void *arg )
     return 0;
 }
 
+struct null_keyed_event_params
+{
+    BOOL    release;
+    NTSTATUS status;
+};
+
+static DWORD WINAPI null_keyed_event_thread( void *arg )
+{
+    struct null_keyed_event_params *params = arg;
+    LARGE_INTEGER timeout;
+
+    timeout.QuadPart = -50000000;
+    if (params->release)
+        params->status = pNtReleaseKeyedEvent( NULL, (void *)0x1000, TRUE, &timeout );
+    else
+        params->status = pNtWaitForKeyedEvent( NULL, (void *)0x1000, TRUE, &timeout );
+    return 0;
+}
+
+static void CALLBACK null_keyed_event_apc( ULONG_PTR arg )
+{
+}
+
+/* alertable and non-alertable operations on the same key must find each other */
+static void test_null_keyed_event(void)
+{
+    struct null_keyed_event_params params;
+    LARGE_INTEGER timeout;
+    NTSTATUS status;
+    HANDLE thread;
+
+    timeout.QuadPart = -100000;
+    status = pNtReleaseKeyedEvent( NULL, (void *)0x1000, FALSE, &timeout );
+    if (status == STATUS_INVALID_HANDLE)
+    {
+        win_skip( "NULL keyed event handle not supported\n" );
+        return;
+    }
+    ok( status == STATUS_TIMEOUT, "NtReleaseKeyedEvent %x\n", status );
+
+    timeout.QuadPart = -50000000;
+    params.release = FALSE;
+    params.status = 0xdeadbeef;
+    thread = CreateThread( NULL, 0, null_keyed_event_thread, &params, 0, NULL );
+    Sleep( 100 );
+    status = pNtReleaseKeyedEvent( NULL, (void *)0x1000, FALSE, &timeout );
+    ok( status == STATUS_SUCCESS, "NtReleaseKeyedEvent %x\n", status );
+    ok( WaitForSingleObject( thread, 10000 ) == 0, "wait failed\n" );
+    ok( params.status == STATUS_SUCCESS, "NtWaitForKeyedEvent %x\n", params.status );
+    CloseHandle( thread );
+
+    params.release = TRUE;
+    params.status = 0xdeadbeef;
+    thread = CreateThread( NULL, 0, null_keyed_event_thread, &params, 0, NULL );
+    Sleep( 100 );
+    status = pNtWaitForKeyedEvent( NULL, (void *)0x1000, FALSE, &timeout );
+    ok( status == STATUS_SUCCESS, "NtWaitForKeyedEvent %x\n", status );
+    ok( WaitForSingleObject( thread, 10000 ) == 0, "wait failed\n" );
+    ok( params.status == STATUS_SUCCESS, "NtReleaseKeyedEvent %x\n", params.status );
+    CloseHandle( thread );
+
+    /* alertable waits can be interrupted by user APCs */
+    params.release = FALSE;
+    params.status = 0xdeadbeef;
+    thread = CreateThread( NULL, 0, null_keyed_event_thread, &params, 0, NULL );
+    Sleep( 100 );
+    ok( QueueUserAPC( null_keyed_event_apc, thread, 0 ), "QueueUserAPC failed %u\n", GetLastError() );
+    ok( WaitForSingleObject( thread, 10000 ) == 0, "wait failed\n" );
+    ok( params.status == STATUS_USER_APC, "NtWaitForKeyedEvent %x\n", params.status );
+    CloseHandle( thread );
+
+    timeout.QuadPart = -100000;
+    status = pNtReleaseKeyedEvent( NULL, (void *)0x1000, FALSE, &timeout );
+    ok( status == STATUS_TIMEOUT, "NtReleaseKeyedEvent %x\n", status );
+}
+
 static void test_keyed_events(void)
 {
     OBJECT_ATTRIBUTES attr;
@@ -1032,6 +1111,177 @@ static void test_keyed_events(void)
     NtClose( event );
 }
 
+static void test_many_names(void)
+{
+    static const int count = 100000;
+    DWORD start, create_time, open_time;
+    HANDLE *handles, handle;
+    char name[64];
+    int i;
+
+    handles = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*handles) );
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "wine_test_many_names_%u", i );
+        handles[i] = CreateEventA( NULL, FALSE, FALSE, name );
+        if (!handles[i]) break;
+    }
+    create_time = GetTickCount() - start;
+    ok( i == count, "failed to create event %u, error %u\n", i, GetLastError() );
+
+    start = GetTickCount();
+    for (i = 0; i < count; i++)
+    {
+        sprintf( name, "wine_test_many_names_%u", i );
+        handle = OpenEventA( EVENT_ALL_ACCESS, FALSE, name );
+        if (!handle)
+        {
+            ok( 0, "failed to open event %u, error %u\n", i, GetLastError() );
+            break;
+        }
+        CloseHandle( handle );
+    }
+    open_time = GetTickCount() - start;
+
+    /* kernel32 doesn't ask for case insensitive lookups */
+    SetLastError( 0xdeadbeef );
+    handle = OpenEventA( EVENT_ALL_ACCESS, FALSE, "WINE_TEST_MANY_NAMES_0" );
+    ok( !handle, "opened event with a different case\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+    if (handle) CloseHandle( handle );
+
+    for (i = 0; i < count && handles[i]; i++) CloseHandle( handles[i] );
+
+    SetLastError( 0xdeadbeef );
+    handle = OpenEventA( EVENT_ALL_ACCESS, FALSE, "wine_test_many_names_0" );
+    ok( !handle, "event still exists\n" );
+    ok( GetLastError() == ERROR_FILE_NOT_FOUND, "wrong error %u\n", GetLastError() );
+
+    trace( "%u named events: create %u ms, open %u ms\n", count, create_time, open_time );
+    HeapFree( GetProcessHeap(), 0, handles );
+}
+
+struct raw_batch
+{
+    const void  *data;
+    data_size_t  size;
+};
+
+/* sends a call_batch request with raw contents, the server kills the thread if they are invalid */
+static DWORD WINAPI raw_batch_thread( void *arg )
+{
+    const struct raw_batch *batch = arg;
+    struct __server_request_info info;
+    struct call_batch_request *req;
+    char replies[256];
+
+    req = wine_server_init_req( &info, REQ_call_batch );
+    wine_server_add_data( req, batch->data, batch->size );
+    wine_server_set_reply( req, replies, sizeof(replies) );
+    pwine_server_call( req );
+    return 0;
+}
+
+static void test_raw_batch( const void *data, data_size_t size, DWORD expect )
+{
+    struct raw_batch batch;
+    HANDLE thread;
+    DWORD code;
+
+    batch.data = data;
+    batch.size = size;
+    thread = CreateThread( NULL, 0, raw_batch_thread, &batch, 0, NULL );
+    ok( WaitForSingleObject( thread, 5000 ) == WAIT_OBJECT_0, "thread didn't exit\n" );
+    ok( GetExitCodeThread( thread, &code ), "GetExitCodeThread failed %u\n", GetLastError() );
+    ok( code == expect, "batch of %u bytes: thread exited with %u\n", size, code );
+    CloseHandle( thread );
+}
+
+static void test_server_batch(void)
+{
+    struct __server_request_info reqs[7];
+    struct object_attributes objattr;
+    struct create_event_request *create_req;
+    struct event_op_request *op_req;
+    struct query_event_request *query_req;
+    struct close_handle_request *close_req;
+    const struct query_event_reply *query_reply;
+    union generic_request batch[2];
+    EVENT_BASIC_INFORMATION info;
+    HANDLE event1, event2;
+    unsigned int i, ret;
+
+    if (!pwine_server_call_batch)
+    {
+        win_skip( "wine_server_call_batch is not available\n" );
+        return;
+    }
+
+    memset( &objattr, 0, sizeof(objattr) );
+    create_req = wine_server_init_req( &reqs[0], REQ_create_event );
+    create_req->access = EVENT_ALL_ACCESS;
+    create_req->manual_reset = TRUE;
+    wine_server_add_data( create_req, &objattr, sizeof(objattr) );
+    create_req = wine_server_init_req( &reqs[1], REQ_create_event );
+    create_req->access = EVENT_ALL_ACCESS;
+    create_req->manual_reset = TRUE;
+    create_req->initial_state = TRUE;
+    wine_server_add_data( create_req, &objattr, sizeof(objattr) );
+    /* these refer to the second event */
+    op_req = wine_server_init_req( &reqs[2], REQ_event_op );
+    op_req->handle = BATCH_LAST_HANDLE;
+    op_req->op = RESET_EVENT;
+    query_req = wine_server_init_req( &reqs[3], REQ_query_event );
+    query_req->handle = BATCH_LAST_HANDLE;
+    op_req = wine_server_init_req( &reqs[4], REQ_event_op );
+    op_req->handle = BATCH_LAST_HANDLE;
+    op_req->op = SET_EVENT;
+    close_req = wine_server_init_req( &reqs[5], REQ_close_handle );
+    close_req->handle = BATCH_LAST_HANDLE;
+    query_req = wine_server_init_req( &reqs[6], REQ_query_event );
+    query_req->handle = BATCH_LAST_HANDLE;
+
+    ret = pwine_server_call_batch( reqs, 7 );
+    ok( ret == STATUS_INVALID_HANDLE, "got %x\n", ret );
+    for (i = 0; i < 6; i++)
+        ok( !reqs[i].u.reply.reply_header.error, "%u: got %x\n", i, reqs[i].u.reply.reply_header.error );
+    ok( reqs[6].u.reply.reply_header.error == STATUS_INVALID_HANDLE,
+        "got %x\n", reqs[6].u.reply.reply_header.error );
+
+    /* the replies come back in the order of the requests */
+    event1 = wine_server_ptr_handle( reqs[0].u.reply.create_event_reply.handle );
+    event2 = wine_server_ptr_handle( reqs[1].u.reply.create_event_reply.handle );
+    ok( event1 != 0 && event2 != 0 && event1 != event2, "got %p and %p\n", event1, event2 );
+    query_reply = &reqs[3].u.reply.query_event_reply;
+    ok( query_reply->manual_reset == TRUE, "got manual_reset %d\n", query_reply->manual_reset );
+    ok( query_reply->state == FALSE, "got state %d\n", query_reply->state );
+
+    /* only the second event was set and closed */
+    ret = pNtQueryEvent( event1, EventBasicInformation, &info, sizeof(info), NULL );
+    ok( ret == STATUS_SUCCESS, "NtQueryEvent failed %x\n", ret );
+    ok( info.EventState == 0, "event was set\n" );
+    ret = pNtClose( event1 );
+    ok( ret == STATUS_SUCCESS, "NtClose failed %x\n", ret );
+    ret = pNtClose( event2 );
+    ok( ret == STATUS_INVALID_HANDLE, "second event wasn't closed: %x\n", ret );
+
+    /* malformed batches are fatal protocol errors */
+    memset( batch, 0, sizeof(batch) );
+    batch[0].request_header.req = REQ_query_event;
+    test_raw_batch( batch, sizeof(batch[0]), 0 );  /* invalid handle, but a valid batch */
+    test_raw_batch( batch, sizeof(batch[0]) / 2, 1 );  /* truncated request */
+
+    batch[0].request_header.request_size = sizeof(batch[1]);
+    test_raw_batch( batch, sizeof(batch[0]), 1 );  /* request data past the end of the batch */
+
+    batch[0].request_header.req = REQ_call_batch;
+    batch[0].request_header.request_size = sizeof(batch[1]);
+    batch[1].request_header.req = REQ_query_event;
+    test_raw_batch( batch, sizeof(batch), 1 );  /* nested batch */
+}
+
 START_TEST(om)
 {
     HMODULE hntdll = GetModuleHandleA("ntdll.dll");
@@ -1071,6 +1321,8 @@ START_TEST(om)
     pNtOpenKeyedEvent       =  (void *)GetProcAddress(hntdll, "NtOpenKeyedEvent");
     pNtWaitForKeyedEvent    =  (void *)GetProcAddress(hntdll, "NtWaitForKeyedEvent");
     pNtReleaseKeyedEvent    =  (void *)GetProcAddress(hntdll, "NtReleaseKeyedEvent");
+    pwine_server_call       =  (void *)GetProcAddress(hntdll, "wine_server_call");
+    pwine_server_call_batch =  (void *)GetProcAddress(hntdll, "wine_server_call_batch");
 
     test_case_sensitive();
     test_namespace_pipe();
@@ -1081,4 +1333,7 @@ START_TEST(om)
     test_type_mismatch();
     test_event();
     test_keyed_events();
+    test_null_keyed_event();
+    test_many_names();
+    test_server_batch();
 }
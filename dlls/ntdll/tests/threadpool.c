@@ -0,0 +1,569 @@
+/*
+ * Unit test suite for the thread pool functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntdll_test.h"
+
+static HMODULE hntdll = 0;
+static NTSTATUS (WINAPI *pTpAllocCleanupGroup)(TP_CLEANUP_GROUP **);
+static NTSTATUS (WINAPI *pTpAllocPool)(TP_POOL **,PVOID);
+static NTSTATUS (WINAPI *pTpAllocTimer)(TP_TIMER **,PTP_TIMER_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
+static NTSTATUS (WINAPI *pTpAllocWait)(TP_WAIT **,PTP_WAIT_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
+static NTSTATUS (WINAPI *pTpAllocWork)(TP_WORK **,PTP_WORK_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
+static NTSTATUS (WINAPI *pTpCallbackMayRunLong)(TP_CALLBACK_INSTANCE *);
+static VOID     (WINAPI *pTpCallbackReleaseSemaphoreOnCompletion)(TP_CALLBACK_INSTANCE *,HANDLE,DWORD);
+static VOID     (WINAPI *pTpDisassociateCallback)(TP_CALLBACK_INSTANCE *);
+static BOOL     (WINAPI *pTpIsTimerSet)(TP_TIMER *);
+static VOID     (WINAPI *pTpPostWork)(TP_WORK *);
+static VOID     (WINAPI *pTpReleaseCleanupGroup)(TP_CLEANUP_GROUP *);
+static VOID     (WINAPI *pTpReleaseCleanupGroupMembers)(TP_CLEANUP_GROUP *,BOOL,PVOID);
+static VOID     (WINAPI *pTpReleasePool)(TP_POOL *);
+static VOID     (WINAPI *pTpReleaseTimer)(TP_TIMER *);
+static VOID     (WINAPI *pTpReleaseWait)(TP_WAIT *);
+static VOID     (WINAPI *pTpReleaseWork)(TP_WORK *);
+static VOID     (WINAPI *pTpSetPoolMaxThreads)(TP_POOL *,DWORD);
+static NTSTATUS (WINAPI *pTpSetPoolMinThreads)(TP_POOL *,DWORD);
+static VOID     (WINAPI *pTpSetTimer)(TP_TIMER *,LARGE_INTEGER *,LONG,LONG);
+static VOID     (WINAPI *pTpSetWait)(TP_WAIT *,HANDLE,LARGE_INTEGER *);
+static NTSTATUS (WINAPI *pTpSimpleTryPost)(PTP_SIMPLE_CALLBACK,PVOID,TP_CALLBACK_ENVIRON *);
+static VOID     (WINAPI *pTpWaitForTimer)(TP_TIMER *,BOOL);
+static VOID     (WINAPI *pTpWaitForWait)(TP_WAIT *,BOOL);
+static VOID     (WINAPI *pTpWaitForWork)(TP_WORK *,BOOL);
+
+#define NTDLL_GET_PROC(func) \
+    do \
+    { \
+        p ## func = (void *)GetProcAddress(hntdll, #func); \
+        if (!p ## func) trace("Failed to get address for %s\n", #func); \
+    } \
+    while (0)
+
+static BOOL init_threadpool(void)
+{
+    hntdll = GetModuleHandleA("ntdll");
+    if (!hntdll)
+    {
+        win_skip("Could not load ntdll\n");
+        return FALSE;
+    }
+
+    NTDLL_GET_PROC(TpAllocCleanupGroup);
+    NTDLL_GET_PROC(TpAllocPool);
+    NTDLL_GET_PROC(TpAllocTimer);
+    NTDLL_GET_PROC(TpAllocWait);
+    NTDLL_GET_PROC(TpAllocWork);
+    NTDLL_GET_PROC(TpCallbackMayRunLong);
+    NTDLL_GET_PROC(TpCallbackReleaseSemaphoreOnCompletion);
+    NTDLL_GET_PROC(TpDisassociateCallback);
+    NTDLL_GET_PROC(TpIsTimerSet);
+    NTDLL_GET_PROC(TpPostWork);
+    NTDLL_GET_PROC(TpReleaseCleanupGroup);
+    NTDLL_GET_PROC(TpReleaseCleanupGroupMembers);
+    NTDLL_GET_PROC(TpReleasePool);
+    NTDLL_GET_PROC(TpReleaseTimer);
+    NTDLL_GET_PROC(TpReleaseWait);
+    NTDLL_GET_PROC(TpReleaseWork);
+    NTDLL_GET_PROC(TpSetPoolMaxThreads);
+    NTDLL_GET_PROC(TpSetPoolMinThreads);
+    NTDLL_GET_PROC(TpSetTimer);
+    NTDLL_GET_PROC(TpSetWait);
+    NTDLL_GET_PROC(TpSimpleTryPost);
+    NTDLL_GET_PROC(TpWaitForTimer);
+    NTDLL_GET_PROC(TpWaitForWait);
+    NTDLL_GET_PROC(TpWaitForWork);
+
+    if (!pTpAllocPool)
+    {
+        win_skip("Threadpool functions not supported, skipping tests\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+#undef NTDLL_GET_PROC
+
+static void init_environment( TP_CALLBACK_ENVIRON *environment, TP_POOL *pool, TP_CLEANUP_GROUP *group )
+{
+    memset( environment, 0, sizeof(*environment) );
+    environment->Version = 1;
+    environment->Pool = pool;
+    environment->CleanupGroup = group;
+}
+
+static void CALLBACK simple_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
+{
+    HANDLE semaphore = userdata;
+    ReleaseSemaphore(semaphore, 1, NULL);
+}
+
+static void CALLBACK simple2_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
+{
+    Sleep(50);
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void test_tp_simple(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    TP_CLEANUP_GROUP *group;
+    HANDLE semaphore;
+    NTSTATUS status;
+    TP_POOL *pool;
+    LONG userdata;
+    DWORD result;
+    int i;
+
+    semaphore = CreateSemaphoreA(NULL, 0, 1, NULL);
+    ok(semaphore != NULL, "CreateSemaphoreA failed %u\n", GetLastError());
+
+    /* post the callback using the default threadpool */
+    status = pTpSimpleTryPost(simple_cb, semaphore, NULL);
+    ok(!status, "TpSimpleTryPost failed with status %x\n", status);
+    result = WaitForSingleObject(semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+
+    /* allocate new threadpool */
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    /* post the callback using the new threadpool */
+    init_environment(&environment, pool, NULL);
+    status = pTpSimpleTryPost(simple_cb, semaphore, &environment);
+    ok(!status, "TpSimpleTryPost failed with status %x\n", status);
+    result = WaitForSingleObject(semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+
+    /* the members of a cleanup group are waited for when the group is released */
+    group = NULL;
+    status = pTpAllocCleanupGroup(&group);
+    ok(!status, "TpAllocCleanupGroup failed with status %x\n", status);
+    ok(group != NULL, "expected group != NULL\n");
+
+    userdata = 0;
+    init_environment(&environment, pool, group);
+    for (i = 0; i < 10; i++)
+    {
+        status = pTpSimpleTryPost(simple2_cb, &userdata, &environment);
+        ok(!status, "TpSimpleTryPost failed with status %x\n", status);
+    }
+    pTpReleaseCleanupGroupMembers(group, FALSE, NULL);
+    ok(userdata == 10, "expected userdata = 10, got %u\n", userdata);
+
+    pTpReleaseCleanupGroup(group);
+    pTpReleasePool(pool);
+    CloseHandle(semaphore);
+}
+
+static void CALLBACK work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    Sleep(50);
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void CALLBACK work_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    HANDLE semaphore = userdata;
+    pTpCallbackReleaseSemaphoreOnCompletion(instance, semaphore, 1);
+}
+
+static void test_tp_work(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    HANDLE semaphore;
+    TP_WORK *work;
+    TP_POOL *pool;
+    NTSTATUS status;
+    LONG userdata;
+    DWORD result;
+    int i;
+
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    pTpSetPoolMaxThreads(pool, 1);
+
+    /* all the callbacks run when the pending ones aren't cancelled */
+    userdata = 0;
+    init_environment(&environment, pool, NULL);
+    work = NULL;
+    status = pTpAllocWork(&work, work_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    ok(work != NULL, "expected work != NULL\n");
+
+    for (i = 0; i < 10; i++) pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    ok(userdata == 10, "expected userdata = 10, got %u\n", userdata);
+
+    /* with a single thread, cancelling leaves only the callback which already started */
+    userdata = 0;
+    for (i = 0; i < 10; i++) pTpPostWork(work);
+    Sleep(25);
+    pTpWaitForWork(work, TRUE);
+    ok(userdata == 1, "expected userdata = 1, got %u\n", userdata);
+    pTpReleaseWork(work);
+
+    /* the instance cleanup actions are performed after the callback returns */
+    semaphore = CreateSemaphoreA(NULL, 0, 1, NULL);
+    status = pTpAllocWork(&work, work_release_cb, semaphore, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    pTpPostWork(work);
+    result = WaitForSingleObject(semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    pTpWaitForWork(work, FALSE);
+    pTpReleaseWork(work);
+
+    CloseHandle(semaphore);
+    pTpReleasePool(pool);
+}
+
+static void CALLBACK group_cancel_cb(void *object, void *userdata)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void CALLBACK blocking_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    Sleep(100);
+}
+
+static void test_tp_group_cancel(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    TP_CLEANUP_GROUP *group;
+    LONG userdata, cancelled;
+    TP_WORK *work, *work2;
+    TP_POOL *pool;
+    NTSTATUS status;
+    int i;
+
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    pTpSetPoolMaxThreads(pool, 1);
+
+    status = pTpAllocCleanupGroup(&group);
+    ok(!status, "TpAllocCleanupGroup failed with status %x\n", status);
+
+    init_environment(&environment, pool, group);
+    environment.CleanupGroupCancelCallback = group_cancel_cb;
+    userdata = 0;
+    status = pTpAllocWork(&work2, work_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    status = pTpAllocWork(&work, blocking_work_cb, NULL, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+
+    /* block the only thread, the callbacks of the other object stay pending */
+    pTpPostWork(work);
+    Sleep(25);
+    for (i = 0; i < 5; i++) pTpPostWork(work2);
+
+    /* the cancel callback is only called for the object which had pending callbacks */
+    cancelled = 0;
+    pTpReleaseCleanupGroupMembers(group, TRUE, &cancelled);
+    ok(userdata == 0, "expected userdata = 0, got %u\n", userdata);
+    ok(cancelled == 1, "expected cancel callback to be called once, got %u\n", cancelled);
+
+    pTpReleaseCleanupGroup(group);
+    pTpReleasePool(pool);
+}
+
+static void CALLBACK disassociate_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    HANDLE event = userdata;
+    pTpDisassociateCallback(instance);
+    WaitForSingleObject(event, 1000);
+}
+
+static void CALLBACK long_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    NTSTATUS status = pTpCallbackMayRunLong(instance);
+    ok(!status, "TpCallbackMayRunLong failed with status %x\n", status);
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void test_tp_instance(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    TP_WORK *work;
+    TP_POOL *pool;
+    NTSTATUS status;
+    HANDLE event;
+    LONG userdata;
+    DWORD start;
+
+    event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    init_environment(&environment, pool, NULL);
+
+    /* waiting doesn't block on a callback disassociated from its object */
+    status = pTpAllocWork(&work, disassociate_cb, event, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    pTpPostWork(work);
+    start = GetTickCount();
+    Sleep(25);
+    pTpWaitForWork(work, FALSE);
+    ok(GetTickCount() - start < 500, "TpWaitForWork waited for the disassociated callback\n");
+    SetEvent(event);
+    pTpReleaseWork(work);
+
+    userdata = 0;
+    status = pTpAllocWork(&work, long_cb, &userdata, &environment);
+    ok(!status, "TpAllocWork failed with status %x\n", status);
+    pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    ok(userdata == 1, "expected userdata = 1, got %u\n", userdata);
+    pTpReleaseWork(work);
+
+    pTpReleasePool(pool);
+    CloseHandle(event);
+}
+
+static void CALLBACK timer_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_TIMER *timer)
+{
+    HANDLE semaphore = userdata;
+    ReleaseSemaphore(semaphore, 1, NULL);
+}
+
+static void test_tp_timer(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    LARGE_INTEGER when;
+    HANDLE semaphore;
+    TP_TIMER *timer;
+    TP_POOL *pool;
+    NTSTATUS status;
+    DWORD result, start, elapsed;
+    int i;
+
+    semaphore = CreateSemaphoreA(NULL, 0, 10, NULL);
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    init_environment(&environment, pool, NULL);
+
+    timer = NULL;
+    status = pTpAllocTimer(&timer, timer_cb, semaphore, &environment);
+    ok(!status, "TpAllocTimer failed with status %x\n", status);
+    ok(timer != NULL, "expected timer != NULL\n");
+    ok(!pTpIsTimerSet(timer), "expected the timer not to be set\n");
+
+    /* relative one-shot timer */
+    when.QuadPart = (ULONGLONG)200 * -10000;
+    start = GetTickCount();
+    pTpSetTimer(timer, &when, 0, 0);
+    ok(pTpIsTimerSet(timer), "expected the timer to be set\n");
+    result = WaitForSingleObject(semaphore, 1000);
+    elapsed = GetTickCount() - start;
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    ok(elapsed >= 150, "expected the timer to fire after about 200ms, got %u\n", elapsed);
+    result = WaitForSingleObject(semaphore, 100);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+
+    /* periodic timer */
+    when.QuadPart = 0;
+    pTpSetTimer(timer, &when, 50, 0);
+    for (i = 0; i < 3; i++)
+    {
+        result = WaitForSingleObject(semaphore, 1000);
+        ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    }
+
+    /* unset the timer, no callback runs after the wait */
+    pTpSetTimer(timer, NULL, 0, 0);
+    ok(!pTpIsTimerSet(timer), "expected the timer not to be set\n");
+    pTpWaitForTimer(timer, TRUE);
+    while (!WaitForSingleObject(semaphore, 0));
+    result = WaitForSingleObject(semaphore, 200);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+
+    pTpReleaseTimer(timer);
+    pTpReleasePool(pool);
+    CloseHandle(semaphore);
+}
+
+struct wait_info
+{
+    HANDLE semaphore;
+    LONG   result;
+};
+
+static void CALLBACK wait_cb(TP_CALLBACK_INSTANCE *instance, void *userdata,
+                             TP_WAIT *wait, TP_WAIT_RESULT result)
+{
+    struct wait_info *info = userdata;
+    info->result = result;
+    ReleaseSemaphore(info->semaphore, 1, NULL);
+}
+
+static void test_tp_wait(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    struct wait_info info, info2;
+    LARGE_INTEGER timeout;
+    HANDLE event, event2, no_sync;
+    TP_WAIT *wait, *wait2;
+    TP_POOL *pool;
+    NTSTATUS status;
+    DWORD result;
+
+    info.semaphore = CreateSemaphoreA(NULL, 0, 1, NULL);
+    event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %x\n", status);
+    init_environment(&environment, pool, NULL);
+
+    wait = NULL;
+    status = pTpAllocWait(&wait, wait_cb, &info, &environment);
+    ok(!status, "TpAllocWait failed with status %x\n", status);
+    ok(wait != NULL, "expected wait != NULL\n");
+
+    /* the callback runs when the object is signaled */
+    info.result = -1;
+    pTpSetWait(wait, event, NULL);
+    result = WaitForSingleObject(info.semaphore, 100);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+    SetEvent(event);
+    result = WaitForSingleObject(info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    ok(info.result == WAIT_OBJECT_0, "expected WAIT_OBJECT_0, got %u\n", info.result);
+
+    /* the wait only fires once */
+    SetEvent(event);
+    result = WaitForSingleObject(info.semaphore, 100);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+    ResetEvent(event);
+
+    /* or when the timeout expires */
+    info.result = -1;
+    timeout.QuadPart = (ULONGLONG)100 * -10000;
+    pTpSetWait(wait, event, &timeout);
+    result = WaitForSingleObject(info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    ok(info.result == WAIT_TIMEOUT, "expected WAIT_TIMEOUT, got %u\n", info.result);
+
+    /* unregistering the wait prevents the callback */
+    pTpSetWait(wait, event, NULL);
+    pTpSetWait(wait, NULL, NULL);
+    SetEvent(event);
+    result = WaitForSingleObject(info.semaphore, 100);
+    ok(result == WAIT_TIMEOUT, "WaitForSingleObject returned %u\n", result);
+
+    /* a handle which can't be waited for doesn't prevent the other waits from firing */
+    info2.semaphore = CreateSemaphoreA(NULL, 0, 1, NULL);
+    event2 = CreateEventA(NULL, FALSE, FALSE, NULL);
+    ok(DuplicateHandle(GetCurrentProcess(), event2, GetCurrentProcess(), &no_sync,
+                       EVENT_MODIFY_STATE, FALSE, 0), "DuplicateHandle failed %u\n", GetLastError());
+    wait2 = NULL;
+    status = pTpAllocWait(&wait2, wait_cb, &info2, &environment);
+    ok(!status, "TpAllocWait failed with status %x\n", status);
+    pTpSetWait(wait2, no_sync, NULL);
+    ResetEvent(event);
+    info.result = -1;
+    pTpSetWait(wait, event, NULL);
+    SetEvent(event);
+    result = WaitForSingleObject(info.semaphore, 1000);
+    ok(result == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", result);
+    ok(info.result == WAIT_OBJECT_0, "expected WAIT_OBJECT_0, got %u\n", info.result);
+    pTpSetWait(wait2, NULL, NULL);
+    pTpWaitForWait(wait2, TRUE);
+    pTpReleaseWait(wait2);
+    CloseHandle(no_sync);
+    CloseHandle(event2);
+    CloseHandle(info2.semaphore);
+
+    pTpWaitForWait(wait, TRUE);
+    pTpReleaseWait(wait);
+    pTpReleasePool(pool);
+    CloseHandle(event);
+    CloseHandle(info.semaphore);
+}
+
+static void CALLBACK tiny_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    InterlockedIncrement((LONG *)userdata);
+}
+
+static void CALLBACK fanout_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    TP_WORK *tiny = userdata;
+    int i;
+
+    /* callbacks submitted from a worker go to its own queue, idle workers steal them */
+    for (i = 0; i < 1000; i++) pTpPostWork(tiny);
+}
+
+static void test_tp_throughput(void)
+{
+    static const DWORD threads[] = { 1, 2, 4, 8 };
+    TP_CALLBACK_ENVIRON environment;
+    TP_WORK *tiny, *fanout;
+    TP_POOL *pool;
+    NTSTATUS status;
+    LONG userdata;
+    DWORD start, i, j;
+
+    for (i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+    {
+        status = pTpAllocPool(&pool, NULL);
+        ok(!status, "TpAllocPool failed with status %x\n", status);
+        pTpSetPoolMaxThreads(pool, threads[i]);
+        status = pTpSetPoolMinThreads(pool, threads[i]);
+        ok(!status, "TpSetPoolMinThreads failed with status %x\n", status);
+        init_environment(&environment, pool, NULL);
+
+        userdata = 0;
+        status = pTpAllocWork(&tiny, tiny_work_cb, &userdata, &environment);
+        ok(!status, "TpAllocWork failed with status %x\n", status);
+        status = pTpAllocWork(&fanout, fanout_work_cb, tiny, &environment);
+        ok(!status, "TpAllocWork failed with status %x\n", status);
+
+        start = GetTickCount();
+        for (j = 0; j < 100000; j++) pTpPostWork(tiny);
+        pTpWaitForWork(tiny, FALSE);
+        ok(userdata == 100000, "expected userdata = 100000, got %u\n", userdata);
+        trace("%u threads: 100000 callbacks posted from outside the pool in %u ms\n",
+              threads[i], GetTickCount() - start);
+
+        userdata = 0;
+        start = GetTickCount();
+        for (j = 0; j < 100; j++) pTpPostWork(fanout);
+        pTpWaitForWork(fanout, FALSE);
+        pTpWaitForWork(tiny, FALSE);
+        ok(userdata == 100000, "expected userdata = 100000, got %u\n", userdata);
+        trace("%u threads: 100000 callbacks posted from the workers in %u ms\n",
+              threads[i], GetTickCount() - start);
+
+        pTpReleaseWork(fanout);
+        pTpReleaseWork(tiny);
+        pTpReleasePool(pool);
+    }
+}
+
+START_TEST(threadpool)
+{
+    if (!init_threadpool())
+        return;
+
+    test_tp_simple();
+    test_tp_work();
+    test_tp_group_cancel();
+    test_tp_instance();
+    test_tp_timer();
+    test_tp_wait();
+    test_tp_throughput();
+}
@@ -39,22 +39,14 @@ WINE_DEFAULT_DEBUG_CHANNEL(threadpool);
 
 #define WORKER_TIMEOUT 30000 /* 30 seconds */
 
-/* threadpool_cs must be held while modifying the following elements */
-static struct list work_item_list = LIST_INIT(work_item_list);
-static LONG num_workers;
-static LONG num_busy_workers;
-static LONG num_items_processed;
-
-static RTL_CONDITION_VARIABLE threadpool_cond = RTL_CONDITION_VARIABLE_INIT;
-
-static RTL_CRITICAL_SECTION threadpool_cs;
-static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
-{
-    0, 0, &threadpool_cs,
-    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
-    0, 0, { (DWORD_PTR)(__FILE__ ": threadpool_cs") }
-};
-static RTL_CRITICAL_SECTION threadpool_cs = { &critsect_debug, -1, 0, 0, 0, 0 };
+/* maximum number of workers with a queue that the other workers can steal from */
+#define THREADPOOL_MAX_QUEUES       64
+/* maximum number of callbacks moved at once to the queue of a worker */
+#define THREADPOOL_BATCH_SIZE       16
+/* interval in ms at which a pool whose workers are all blocked is given a new one */
+#define THREADPOOL_MONITOR_INTERVAL 50
+/* maximum number of unused simple callback objects kept around */
+#define THREADPOOL_MAX_CACHED       256
 
 static HANDLE compl_port = NULL;
 static RTL_CRITICAL_SECTION threadpool_compl_cs;
@@ -66,13 +58,201 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_compl_debug =
 };
 static RTL_CRITICAL_SECTION threadpool_compl_cs = { &critsect_compl_debug, -1, 0, 0, 0, 0 };
 
-struct work_item
+/* serializes the changes to the timer and wait registrations of the thread pool objects */
+static RTL_CRITICAL_SECTION threadpool_objects_cs;
+static RTL_CRITICAL_SECTION_DEBUG critsect_objects_debug =
 {
-    struct list entry;
-    PRTL_WORK_ITEM_ROUTINE function;
-    PVOID context;
+    0, 0, &threadpool_objects_cs,
+    { &critsect_objects_debug.ProcessLocksList, &critsect_objects_debug.ProcessLocksList },
+    0, 0, { (DWORD_PTR)(__FILE__ ": threadpool_objects_cs") }
+};
+static RTL_CRITICAL_SECTION threadpool_objects_cs = { &critsect_objects_debug, -1, 0, 0, 0, 0 };
+
+struct threadpool_object;
+
+/* a callback to execute, each one holds a reference to its object */
+struct threadpool_entry
+{
+    struct threadpool_object *object;
+    ULONG_PTR                 arg;
+};
+
+/* callbacks waiting to be executed, stored in a ring buffer that grows as needed */
+struct threadpool_queue
+{
+    RTL_CRITICAL_SECTION     cs;
+    struct threadpool_entry *entries;
+    unsigned int             head;
+    unsigned int             count;
+    unsigned int             size;   /* always a power of two */
+};
+
+struct threadpool_worker
+{
+    struct threadpool       *pool;
+    struct threadpool_queue  queue;      /* callbacks submitted by this worker */
+    int                      slot;       /* index in the pool slots, -1 if the queue can't be stolen from */
+    BOOL                     running;    /* a thread is using this worker */
+    LONG                     completed;  /* number of callbacks executed */
+};
+
+struct threadpool
+{
+    LONG                      refcount;
+    BOOL                      shutdown;
+    RTL_CRITICAL_SECTION      cs;             /* protects the workers and the events */
+    RTL_CONDITION_VARIABLE    update_event;   /* callbacks were submitted or the pool is shut down */
+    RTL_CONDITION_VARIABLE    finished_event; /* an object has no more pending or running callbacks */
+    struct threadpool_queue   queue;          /* callbacks submitted from outside the pool */
+    struct threadpool_worker *slots[THREADPOOL_MAX_QUEUES];
+    LONG                      num_slots;
+    int                       max_workers;
+    int                       min_workers;
+    int                       num_workers;
+    LONG                      num_idle;
+    LONG                      num_long;       /* workers running a callback that may run long */
+    HANDLE                    monitor;        /* timer used to check that the workers make progress */
+    LONG                      monitor_completed;
+};
+
+enum threadpool_objtype
+{
+    TP_OBJECT_TYPE_SIMPLE,
+    TP_OBJECT_TYPE_WORK,
+    TP_OBJECT_TYPE_TIMER,
+    TP_OBJECT_TYPE_WAIT,
+    TP_OBJECT_TYPE_IO
+};
+
+struct threadpool_object
+{
+    void                             *win32_callback; /* used by kernel32 for I/O objects */
+    SLIST_ENTRY                       cache_entry;
+    LONG                              refcount;
+    LONG                              released;       /* the reference of the creator was released */
+    enum threadpool_objtype           type;
+    struct threadpool                *pool;
+    struct threadpool_group          *group;
+    struct list                       group_entry;
+    BOOL                              is_group_member;
+    PVOID                             userdata;
+    PTP_CLEANUP_GROUP_CANCEL_CALLBACK group_cancel_callback;
+    PTP_SIMPLE_CALLBACK               finalization_callback;
+    BOOL                              may_run_long;
+    LONG                              num_pending;    /* submitted callbacks not yet started */
+    LONG                              num_running;    /* callbacks being executed */
+    LONG                              num_waiters;    /* threads waiting for the callbacks to finish */
+    union
+    {
+        struct
+        {
+            PTP_SIMPLE_CALLBACK    callback;
+            PRTL_WORK_ITEM_ROUTINE function;  /* for RtlQueueWorkItem */
+        } simple;
+        struct
+        {
+            PTP_WORK_CALLBACK callback;
+        } work;
+        struct
+        {
+            PTP_TIMER_CALLBACK callback;
+            HANDLE             timer;
+            LONG               period;
+            BOOL               set;
+        } timer;
+        struct
+        {
+            PTP_WAIT_CALLBACK callback;
+            HANDLE            wait;
+        } wait;
+        struct
+        {
+            PTP_IO_CALLBACK callback;
+            LONG            pending;  /* started asynchronous operations */
+            BOOL            shutdown;
+        } io;
+    } u;
+};
+
+struct threadpool_instance
+{
+    struct threadpool_object *object;
+    DWORD                     threadid;
+    BOOL                      associated;
+    BOOL                      may_run_long;
+    struct
+    {
+        RTL_CRITICAL_SECTION *critical_section;
+        HANDLE                mutex;
+        HANDLE                semaphore;
+        LONG                  semaphore_count;
+        HANDLE                event;
+        HMODULE               library;
+    } cleanup;
+};
+
+struct threadpool_group
+{
+    LONG                 refcount;
+    RTL_CRITICAL_SECTION cs;
+    struct list          members;
+};
+
+/* an I/O completion received for an I/O object */
+struct threadpool_completion
+{
+    ULONG_PTR       cvalue;
+    IO_STATUS_BLOCK iosb;
 };
 
+static struct threadpool *default_threadpool;
+static HANDLE threadpool_io_port;
+static SLIST_HEADER simple_cache;
+static LONG num_simple_cached;
+
+static inline struct threadpool *impl_from_TP_POOL( TP_POOL *pool )
+{
+    return (struct threadpool *)pool;
+}
+
+static inline struct threadpool_object *impl_from_TP_WORK( TP_WORK *work )
+{
+    struct threadpool_object *object = (struct threadpool_object *)work;
+    assert( object->type == TP_OBJECT_TYPE_WORK );
+    return object;
+}
+
+static inline struct threadpool_object *impl_from_TP_TIMER( TP_TIMER *timer )
+{
+    struct threadpool_object *object = (struct threadpool_object *)timer;
+    assert( object->type == TP_OBJECT_TYPE_TIMER );
+    return object;
+}
+
+static inline struct threadpool_object *impl_from_TP_WAIT( TP_WAIT *wait )
+{
+    struct threadpool_object *object = (struct threadpool_object *)wait;
+    assert( object->type == TP_OBJECT_TYPE_WAIT );
+    return object;
+}
+
+static inline struct threadpool_object *impl_from_TP_IO( TP_IO *io )
+{
+    struct threadpool_object *object = (struct threadpool_object *)io;
+    assert( object->type == TP_OBJECT_TYPE_IO );
+    return object;
+}
+
+static inline struct threadpool_group *impl_from_TP_CLEANUP_GROUP( TP_CLEANUP_GROUP *group )
+{
+    return (struct threadpool_group *)group;
+}
+
+static inline struct threadpool_instance *impl_from_TP_CALLBACK_INSTANCE( TP_CALLBACK_INSTANCE *instance )
+{
+    return (struct threadpool_instance *)instance;
+}
+
 static inline LONG interlocked_inc( PLONG dest )
 {
     return interlocked_xchg_add( dest, 1 ) + 1;
@@ -83,944 +263,2483 @@ static inline LONG interlocked_dec( PLONG dest )
     return interlocked_xchg_add( dest, -1 ) - 1;
 }
 
-static void WINAPI worker_thread_proc(void * param)
+static void tp_queue_init( struct threadpool_queue *queue )
 {
-    struct list *item;
-    struct work_item *work_item_ptr, work_item;
-    LARGE_INTEGER timeout;
-    timeout.QuadPart = -(WORKER_TIMEOUT * (ULONGLONG)10000);
+    RtlInitializeCriticalSection( &queue->cs );
+    queue->entries = NULL;
+    queue->head = queue->count = queue->size = 0;
+}
+
+static void tp_queue_destroy( struct threadpool_queue *queue )
+{
+    RtlDeleteCriticalSection( &queue->cs );
+    RtlFreeHeap( GetProcessHeap(), 0, queue->entries );
+}
 
-    RtlEnterCriticalSection( &threadpool_cs );
-    num_workers++;
+static BOOL tp_queue_push( struct threadpool_queue *queue, const struct threadpool_entry *entries,
+                           unsigned int count )
+{
+    struct threadpool_entry *new_entries;
+    unsigned int i, size;
 
-    for (;;)
+    RtlEnterCriticalSection( &queue->cs );
+    if (queue->count + count > queue->size)
     {
-        if ((item = list_head( &work_item_list )))
+        for (size = max( queue->size, 64 ); size < queue->count + count; size *= 2) ;
+        if (!(new_entries = RtlAllocateHeap( GetProcessHeap(), 0, size * sizeof(*new_entries) )))
         {
-            work_item_ptr = LIST_ENTRY( item, struct work_item, entry );
-            list_remove( &work_item_ptr->entry );
-            num_busy_workers++;
-            num_items_processed++;
-            RtlLeaveCriticalSection( &threadpool_cs );
-
-            /* copy item to stack and do the work */
-            work_item = *work_item_ptr;
-            RtlFreeHeap( GetProcessHeap(), 0, work_item_ptr );
-            TRACE("executing %p(%p)\n", work_item.function, work_item.context);
-            work_item.function( work_item.context );
-
-            RtlEnterCriticalSection( &threadpool_cs );
-            num_busy_workers--;
+            RtlLeaveCriticalSection( &queue->cs );
+            return FALSE;
         }
-        else if (RtlSleepConditionVariableCS( &threadpool_cond, &threadpool_cs, &timeout ) != STATUS_SUCCESS)
-            break;
+        for (i = 0; i < queue->count; i++)
+            new_entries[i] = queue->entries[(queue->head + i) & (queue->size - 1)];
+        RtlFreeHeap( GetProcessHeap(), 0, queue->entries );
+        queue->entries = new_entries;
+        queue->head = 0;
+        queue->size = size;
     }
+    for (i = 0; i < count; i++)
+        queue->entries[(queue->head + queue->count + i) & (queue->size - 1)] = entries[i];
+    queue->count += count;
+    RtlLeaveCriticalSection( &queue->cs );
+    return TRUE;
+}
 
-    num_workers--;
-    RtlLeaveCriticalSection( &threadpool_cs );
-    RtlExitUserThread( 0 );
+/* remove up to max entries, or half of them, from the front of the queue */
+static unsigned int tp_queue_take( struct threadpool_queue *queue, struct threadpool_entry *entries,
+                                   unsigned int max, BOOL half )
+{
+    unsigned int i, count;
 
-    /* never reached */
+    if (!*(volatile unsigned int *)&queue->count) return 0;
+
+    RtlEnterCriticalSection( &queue->cs );
+    count = half ? (queue->count + 1) / 2 : queue->count;
+    count = min( count, max );
+    for (i = 0; i < count; i++)
+        entries[i] = queue->entries[(queue->head + i) & (queue->size - 1)];
+    if (count)
+    {
+        queue->head = (queue->head + count) & (queue->size - 1);
+        queue->count -= count;
+    }
+    RtlLeaveCriticalSection( &queue->cs );
+    return count;
 }
 
-/***********************************************************************
- *              RtlQueueWorkItem   (NTDLL.@)
- *
- * Queues a work item into a thread in the thread pool.
- *
- * PARAMS
- *  Function [I] Work function to execute.
- *  Context  [I] Context to pass to the work function when it is executed.
- *  Flags    [I] Flags. See notes.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- *
- * NOTES
- *  Flags can be one or more of the following:
- *|WT_EXECUTEDEFAULT - Executes the work item in a non-I/O worker thread.
- *|WT_EXECUTEINIOTHREAD - Executes the work item in an I/O worker thread.
- *|WT_EXECUTEINPERSISTENTTHREAD - Executes the work item in a thread that is persistent.
- *|WT_EXECUTELONGFUNCTION - Hints that the execution can take a long time.
- *|WT_TRANSFER_IMPERSONATION - Executes the function with the current access token.
- */
-NTSTATUS WINAPI RtlQueueWorkItem(PRTL_WORK_ITEM_ROUTINE Function, PVOID Context, ULONG Flags)
+/* check if any queue of the pool has callbacks, racy but only used to decide whether to wait */
+static BOOL tp_pool_has_work( struct threadpool *pool )
 {
-    HANDLE thread;
-    NTSTATUS status;
-    LONG items_processed;
-    struct work_item *work_item = RtlAllocateHeap(GetProcessHeap(), 0, sizeof(struct work_item));
+    LONG i, num_slots = *(volatile LONG *)&pool->num_slots;
 
-    if (!work_item)
-        return STATUS_NO_MEMORY;
+    if (*(volatile unsigned int *)&pool->queue.count) return TRUE;
+    for (i = 0; i < num_slots; i++)
+        if (*(volatile unsigned int *)&pool->slots[i]->queue.count) return TRUE;
+    return FALSE;
+}
 
-    work_item->function = Function;
-    work_item->context = Context;
+static LONG tp_pool_completed( struct threadpool *pool )
+{
+    LONG i, num_slots = *(volatile LONG *)&pool->num_slots, completed = 0;
 
-    if (Flags & ~WT_EXECUTELONGFUNCTION)
-        FIXME("Flags 0x%x not supported\n", Flags);
+    for (i = 0; i < num_slots; i++) completed += *(volatile LONG *)&pool->slots[i]->completed;
+    return completed;
+}
 
-    RtlEnterCriticalSection( &threadpool_cs );
-    list_add_tail( &work_item_list, &work_item->entry );
-    status = (num_workers > num_busy_workers) ? STATUS_SUCCESS : STATUS_UNSUCCESSFUL;
-    items_processed = num_items_processed;
-    RtlLeaveCriticalSection( &threadpool_cs );
+static void tp_pool_destroy( struct threadpool *pool )
+{
+    LONG i;
 
-    /* FIXME: tune this algorithm to not be as aggressive with creating threads
-     * if WT_EXECUTELONGFUNCTION isn't specified */
-    if (status == STATUS_SUCCESS)
-        RtlWakeConditionVariable( &threadpool_cond );
-    else
+    TRACE( "destroying pool %p\n", pool );
+
+    for (i = 0; i < pool->num_slots; i++)
     {
-        status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
-                                      worker_thread_proc, NULL, &thread, NULL );
+        tp_queue_destroy( &pool->slots[i]->queue );
+        RtlFreeHeap( GetProcessHeap(), 0, pool->slots[i] );
+    }
+    tp_queue_destroy( &pool->queue );
+    pool->cs.DebugInfo->Spare[0] = 0;
+    RtlDeleteCriticalSection( &pool->cs );
+    RtlFreeHeap( GetProcessHeap(), 0, pool );
+}
 
-        /* NOTE: we don't care if we couldn't create the thread if there is at
-         * least one other available to process the request */
-        if (status == STATUS_SUCCESS)
-            NtClose( thread );
-        else
-        {
-            RtlEnterCriticalSection( &threadpool_cs );
-            if (num_workers > 0 || num_items_processed != items_processed)
-                status = STATUS_SUCCESS;
-            else
-                list_remove( &work_item->entry );
-            RtlLeaveCriticalSection( &threadpool_cs );
+static void tp_pool_release( struct threadpool *pool )
+{
+    BOOL destroy;
 
-            if (status != STATUS_SUCCESS)
-                RtlFreeHeap( GetProcessHeap(), 0, work_item );
-        }
-    }
+    if (interlocked_dec( &pool->refcount )) return;
 
-    return status;
+    /* the remaining workers destroy the pool once they are all gone */
+    RtlEnterCriticalSection( &pool->cs );
+    pool->shutdown = TRUE;
+    destroy = !pool->num_workers;
+    RtlWakeAllConditionVariable( &pool->update_event );
+    RtlLeaveCriticalSection( &pool->cs );
+
+    if (destroy) tp_pool_destroy( pool );
 }
 
-/***********************************************************************
- * iocp_poller - get completion events and run callbacks
- */
-static DWORD CALLBACK iocp_poller(LPVOID Arg)
+static NTSTATUS tp_pool_alloc( struct threadpool **out )
 {
-    HANDLE cport = Arg;
+    struct threadpool *pool;
 
-    while( TRUE )
-    {
-        PRTL_OVERLAPPED_COMPLETION_ROUTINE callback;
-        LPVOID overlapped;
-        IO_STATUS_BLOCK iosb;
-        NTSTATUS res = NtRemoveIoCompletion( cport, (PULONG_PTR)&callback, (PULONG_PTR)&overlapped, &iosb, NULL );
-        if (res)
-        {
-            ERR("NtRemoveIoCompletion failed: 0x%x\n", res);
-        }
-        else
-        {
-            DWORD transferred = 0;
-            DWORD err = 0;
+    if (!(pool = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*pool) )))
+        return STATUS_NO_MEMORY;
 
-            if (iosb.u.Status == STATUS_SUCCESS)
-                transferred = iosb.Information;
-            else
-                err = RtlNtStatusToDosError(iosb.u.Status);
+    pool->refcount = 1;
+    RtlInitializeCriticalSection( &pool->cs );
+    pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool.cs");
+    RtlInitializeConditionVariable( &pool->update_event );
+    RtlInitializeConditionVariable( &pool->finished_event );
+    tp_queue_init( &pool->queue );
+    pool->max_workers = 500;
+    pool->min_workers = 0;
+
+    TRACE( "allocated pool %p\n", pool );
+    *out = pool;
+    return STATUS_SUCCESS;
+}
 
-            callback( err, transferred, overlapped );
-        }
+static struct threadpool *get_default_threadpool(void)
+{
+    struct threadpool *pool;
+
+    if (!default_threadpool && !tp_pool_alloc( &pool ))
+    {
+        if (interlocked_cmpxchg_ptr( (void **)&default_threadpool, pool, NULL ))
+            tp_pool_release( pool );  /* someone else was faster */
     }
-    return 0;
+    return default_threadpool;
 }
 
-/***********************************************************************
- *              RtlSetIoCompletionCallback  (NTDLL.@)
- *
- * Binds a handle to a thread pool's completion port, and possibly
- * starts a non-I/O thread to monitor this port and call functions back.
- *
- * PARAMS
- *  FileHandle [I] Handle to bind to a completion port.
- *  Function   [I] Callback function to call on I/O completions.
- *  Flags      [I] Not used.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- *
- */
-NTSTATUS WINAPI RtlSetIoCompletionCallback(HANDLE FileHandle, PRTL_OVERLAPPED_COMPLETION_ROUTINE Function, ULONG Flags)
+static void CALLBACK tp_worker_proc( void *param );
+
+/* start a new worker thread, the pool lock must be held */
+static NTSTATUS tp_pool_add_worker( struct threadpool *pool )
 {
-    IO_STATUS_BLOCK iosb;
-    FILE_COMPLETION_INFORMATION info;
+    struct threadpool_worker *worker = NULL;
+    NTSTATUS status;
+    HANDLE thread;
+    LONG i;
 
-    if (Flags) FIXME("Unknown value Flags=0x%x\n", Flags);
+    if (pool->shutdown) return STATUS_UNSUCCESSFUL;
 
-    if (!compl_port)
-    {
-        NTSTATUS res = STATUS_SUCCESS;
+    /* reuse the queue of a worker which exited, its queue is empty */
+    for (i = 0; i < pool->num_slots; i++)
+        if (!pool->slots[i]->running) worker = pool->slots[i];
 
-        RtlEnterCriticalSection(&threadpool_compl_cs);
-        if (!compl_port)
+    if (!worker)
+    {
+        if (!(worker = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*worker) ))) return STATUS_NO_MEMORY;
+        worker->pool = pool;
+        worker->running = FALSE;
+        worker->completed = 0;
+        worker->slot = -1;
+        tp_queue_init( &worker->queue );
+        if (pool->num_slots < THREADPOOL_MAX_QUEUES)
         {
-            HANDLE cport;
-
-            res = NtCreateIoCompletion( &cport, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
-            if (!res)
-            {
-                /* FIXME native can start additional threads in case of e.g. hung callback function. */
-                res = RtlQueueWorkItem( iocp_poller, cport, WT_EXECUTEDEFAULT );
-                if (!res)
-                    compl_port = cport;
-                else
-                    NtClose( cport );
-            }
+            worker->slot = pool->num_slots;
+            pool->slots[worker->slot] = worker;
+            interlocked_inc( &pool->num_slots );
         }
-        RtlLeaveCriticalSection(&threadpool_compl_cs);
-        if (res) return res;
     }
 
-    info.CompletionPort = compl_port;
-    info.CompletionKey = (ULONG_PTR)Function;
+    worker->running = TRUE;
+    status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                  tp_worker_proc, worker, &thread, NULL );
+    if (status)
+    {
+        worker->running = FALSE;
+        if (worker->slot == -1)
+        {
+            tp_queue_destroy( &worker->queue );
+            RtlFreeHeap( GetProcessHeap(), 0, worker );
+        }
+        return status;
+    }
 
-    return NtSetInformationFile( FileHandle, &iosb, &info, sizeof(info), FileCompletionInformation );
+    NtClose( thread );
+    pool->num_workers++;
+    return STATUS_SUCCESS;
 }
 
-static inline PLARGE_INTEGER get_nt_timeout( PLARGE_INTEGER pTime, ULONG timeout )
-{
-    if (timeout == INFINITE) return NULL;
-    pTime->QuadPart = (ULONGLONG)timeout * -10000;
-    return pTime;
-}
+static void tp_pool_arm_monitor( struct threadpool *pool );
 
-struct wait_work_item
+/* called periodically while all the workers are busy and callbacks are waiting, to add
+ * a worker when none of them completed a callback, since they are likely blocked */
+static void CALLBACK tp_pool_monitor_proc( void *param, BOOLEAN fired )
 {
-    HANDLE Object;
-    HANDLE CancelEvent;
-    WAITORTIMERCALLBACK Callback;
-    PVOID Context;
-    ULONG Milliseconds;
-    ULONG Flags;
-    HANDLE CompletionEvent;
-    LONG DeleteCount;
-    BOOLEAN CallbackInProgress;
-};
+    struct threadpool *pool = param;
+    LONG completed = tp_pool_completed( pool );
+    HANDLE timer;
+
+    RtlEnterCriticalSection( &pool->cs );
+    timer = pool->monitor;
+    pool->monitor = NULL;
+    if (!pool->num_idle && tp_pool_has_work( pool ))
+    {
+        if (completed == pool->monitor_completed && pool->num_workers < pool->max_workers)
+        {
+            TRACE( "no progress in pool %p, adding a worker\n", pool );
+            tp_pool_add_worker( pool );
+        }
+        tp_pool_arm_monitor( pool );
+    }
+    RtlLeaveCriticalSection( &pool->cs );
 
-static void delete_wait_work_item(struct wait_work_item *wait_work_item)
-{
-    NtClose( wait_work_item->CancelEvent );
-    RtlFreeHeap( GetProcessHeap(), 0, wait_work_item );
+    RtlDeleteTimer( NULL, timer, NULL );
+    tp_pool_release( pool );
 }
 
-static DWORD CALLBACK wait_thread_proc(LPVOID Arg)
+/* the pool lock must be held */
+static void tp_pool_arm_monitor( struct threadpool *pool )
 {
-    struct wait_work_item *wait_work_item = Arg;
-    NTSTATUS status;
-    BOOLEAN alertable = (wait_work_item->Flags & WT_EXECUTEINIOTHREAD) != 0;
-    HANDLE handles[2] = { wait_work_item->Object, wait_work_item->CancelEvent };
-    LARGE_INTEGER timeout;
-    HANDLE completion_event;
+    if (pool->monitor || pool->shutdown) return;
 
-    TRACE("\n");
+    pool->monitor_completed = tp_pool_completed( pool );
+    interlocked_inc( &pool->refcount );
+    if (RtlCreateTimer( &pool->monitor, NULL, tp_pool_monitor_proc, pool,
+                        THREADPOOL_MONITOR_INTERVAL, 0, WT_EXECUTEINTIMERTHREAD ))
+    {
+        pool->monitor = NULL;
+        interlocked_dec( &pool->refcount );
+    }
+}
 
-    while (TRUE)
+/* make sure that someone will execute the callbacks that were just submitted */
+static void tp_pool_wake( struct threadpool *pool )
+{
+    if (interlocked_cmpxchg( &pool->num_idle, 0, 0 ))
     {
-        status = NtWaitForMultipleObjects( 2, handles, FALSE, alertable,
-                                           get_nt_timeout( &timeout, wait_work_item->Milliseconds ) );
-        if (status == STATUS_WAIT_0 || status == STATUS_TIMEOUT)
-        {
-            BOOLEAN TimerOrWaitFired;
+        RtlEnterCriticalSection( &pool->cs );
+        RtlWakeConditionVariable( &pool->update_event );
+        RtlLeaveCriticalSection( &pool->cs );
+        return;
+    }
 
-            if (status == STATUS_WAIT_0)
-            {
-                TRACE( "object %p signaled, calling callback %p with context %p\n",
-                    wait_work_item->Object, wait_work_item->Callback,
-                    wait_work_item->Context );
-                TimerOrWaitFired = FALSE;
-            }
-            else
-            {
-                TRACE( "wait for object %p timed out, calling callback %p with context %p\n",
-                    wait_work_item->Object, wait_work_item->Callback,
-                    wait_work_item->Context );
-                TimerOrWaitFired = TRUE;
-            }
-            wait_work_item->CallbackInProgress = TRUE;
-            wait_work_item->Callback( wait_work_item->Context, TimerOrWaitFired );
-            wait_work_item->CallbackInProgress = FALSE;
+    /* all the workers are busy, start a new one as long as there are less workers
+     * running short callbacks than processors, otherwise let the monitor decide */
+    if (pool->monitor && (pool->num_workers >= pool->max_workers ||
+                          pool->num_workers - pool->num_long >= NtCurrentTeb()->Peb->NumberOfProcessors))
+        return;
 
-            if (wait_work_item->Flags & WT_EXECUTEONLYONCE)
-                break;
-        }
+    RtlEnterCriticalSection( &pool->cs );
+    if (!pool->num_idle)
+    {
+        if (pool->num_workers < pool->max_workers &&
+            (pool->num_workers - pool->num_long < NtCurrentTeb()->Peb->NumberOfProcessors ||
+             pool->num_workers < pool->min_workers))
+            tp_pool_add_worker( pool );
         else
-            break;
+            tp_pool_arm_monitor( pool );
     }
+    RtlLeaveCriticalSection( &pool->cs );
+}
 
-    completion_event = wait_work_item->CompletionEvent;
-    if (completion_event) NtSetEvent( completion_event, NULL );
+static void tp_group_release( struct threadpool_group *group )
+{
+    if (interlocked_dec( &group->refcount )) return;
 
-    if (interlocked_inc( &wait_work_item->DeleteCount ) == 2 )
-        delete_wait_work_item( wait_work_item );
+    TRACE( "destroying group %p\n", group );
 
-    return 0;
+    assert( list_empty( &group->members ) );
+    group->cs.DebugInfo->Spare[0] = 0;
+    RtlDeleteCriticalSection( &group->cs );
+    RtlFreeHeap( GetProcessHeap(), 0, group );
 }
 
-/***********************************************************************
- *              RtlRegisterWait   (NTDLL.@)
- *
- * Registers a wait for a handle to become signaled.
- *
- * PARAMS
- *  NewWaitObject [I] Handle to the new wait object. Use RtlDeregisterWait() to free it.
- *  Object   [I] Object to wait to become signaled.
- *  Callback [I] Callback function to execute when the wait times out or the handle is signaled.
- *  Context  [I] Context to pass to the callback function when it is executed.
- *  Milliseconds [I] Number of milliseconds to wait before timing out.
- *  Flags    [I] Flags. See notes.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- *
- * NOTES
- *  Flags can be one or more of the following:
- *|WT_EXECUTEDEFAULT - Executes the work item in a non-I/O worker thread.
- *|WT_EXECUTEINIOTHREAD - Executes the work item in an I/O worker thread.
- *|WT_EXECUTEINPERSISTENTTHREAD - Executes the work item in a thread that is persistent.
- *|WT_EXECUTELONGFUNCTION - Hints that the execution can take a long time.
- *|WT_TRANSFER_IMPERSONATION - Executes the function with the current access token.
- */
-NTSTATUS WINAPI RtlRegisterWait(PHANDLE NewWaitObject, HANDLE Object,
-                                RTL_WAITORTIMERCALLBACKFUNC Callback,
-                                PVOID Context, ULONG Milliseconds, ULONG Flags)
+static struct threadpool_object *tp_object_alloc( enum threadpool_objtype type )
 {
-    struct wait_work_item *wait_work_item;
-    NTSTATUS status;
-
-    TRACE( "(%p, %p, %p, %p, %d, 0x%x)\n", NewWaitObject, Object, Callback, Context, Milliseconds, Flags );
-
-    wait_work_item = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*wait_work_item) );
-    if (!wait_work_item)
-        return STATUS_NO_MEMORY;
-
-    wait_work_item->Object = Object;
-    wait_work_item->Callback = Callback;
-    wait_work_item->Context = Context;
-    wait_work_item->Milliseconds = Milliseconds;
-    wait_work_item->Flags = Flags;
-    wait_work_item->CallbackInProgress = FALSE;
-    wait_work_item->DeleteCount = 0;
-    wait_work_item->CompletionEvent = NULL;
+    struct threadpool_object *object = NULL;
 
-    status = NtCreateEvent( &wait_work_item->CancelEvent, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
-    if (status != STATUS_SUCCESS)
+    if (type == TP_OBJECT_TYPE_SIMPLE)
     {
-        RtlFreeHeap( GetProcessHeap(), 0, wait_work_item );
-        return status;
+        SLIST_ENTRY *entry = RtlInterlockedPopEntrySList( &simple_cache );
+        if (entry)
+        {
+            interlocked_dec( &num_simple_cached );
+            object = CONTAINING_RECORD( entry, struct threadpool_object, cache_entry );
+        }
     }
+    if (!object && !(object = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*object) ))) return NULL;
 
-    Flags = Flags & (WT_EXECUTEINIOTHREAD | WT_EXECUTEINPERSISTENTTHREAD |
-                     WT_EXECUTELONGFUNCTION | WT_TRANSFER_IMPERSONATION);
-    status = RtlQueueWorkItem( wait_thread_proc, wait_work_item, Flags );
-    if (status != STATUS_SUCCESS)
+    memset( object, 0, sizeof(*object) );
+    object->type = type;
+    return object;
+}
+
+static void tp_object_free( struct threadpool_object *object )
+{
+    if (object->type == TP_OBJECT_TYPE_SIMPLE &&
+        interlocked_inc( &num_simple_cached ) <= THREADPOOL_MAX_CACHED)
     {
-        delete_wait_work_item( wait_work_item );
-        return status;
+        RtlInterlockedPushEntrySList( &simple_cache, &object->cache_entry );
+        return;
     }
-
-    *NewWaitObject = wait_work_item;
-    return status;
+    if (object->type == TP_OBJECT_TYPE_SIMPLE) interlocked_dec( &num_simple_cached );
+    RtlFreeHeap( GetProcessHeap(), 0, object );
 }
 
-/***********************************************************************
- *              RtlDeregisterWaitEx   (NTDLL.@)
- *
- * Cancels a wait operation and frees the resources associated with calling
- * RtlRegisterWait().
- *
- * PARAMS
- *  WaitObject [I] Handle to the wait object to free.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- */
-NTSTATUS WINAPI RtlDeregisterWaitEx(HANDLE WaitHandle, HANDLE CompletionEvent)
+/* initialize the common part of an object and take the reference of its creator */
+static NTSTATUS tp_object_initialize( struct threadpool_object *object, PVOID userdata,
+                                      TP_CALLBACK_ENVIRON *environment )
 {
-    struct wait_work_item *wait_work_item = WaitHandle;
-    NTSTATUS status = STATUS_SUCCESS;
-
-    TRACE( "(%p)\n", WaitHandle );
+    object->refcount = 1;
+    object->userdata = userdata;
+    object->pool = NULL;
 
-    NtSetEvent( wait_work_item->CancelEvent, NULL );
-    if (wait_work_item->CallbackInProgress)
+    if (environment)
     {
-        if (CompletionEvent != NULL)
-        {
-            if (CompletionEvent == INVALID_HANDLE_VALUE)
-            {
-                status = NtCreateEvent( &CompletionEvent, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
-                if (status != STATUS_SUCCESS)
-                    return status;
-                interlocked_xchg_ptr( &wait_work_item->CompletionEvent, CompletionEvent );
-                if (wait_work_item->CallbackInProgress)
-                    NtWaitForSingleObject( CompletionEvent, FALSE, NULL );
-                NtClose( CompletionEvent );
-            }
-            else
-            {
-                interlocked_xchg_ptr( &wait_work_item->CompletionEvent, CompletionEvent );
-                if (wait_work_item->CallbackInProgress)
-                    status = STATUS_PENDING;
-            }
-        }
-        else
-            status = STATUS_PENDING;
+        if (environment->Version != 1 && environment->Version != 3)
+            FIXME( "unsupported environment version %u\n", environment->Version );
+
+        object->pool = impl_from_TP_POOL( environment->Pool );
+        object->group = impl_from_TP_CLEANUP_GROUP( environment->CleanupGroup );
+        object->group_cancel_callback = environment->CleanupGroupCancelCallback;
+        object->finalization_callback = environment->FinalizationCallback;
+        object->may_run_long = environment->u.s.LongFunction != 0;
+
+        if (environment->RaceDll)
+            FIXME( "unsupported race dll %p\n", environment->RaceDll );
+        if (environment->ActivationContext)
+            FIXME( "unsupported activation context %p\n", environment->ActivationContext );
+        if (environment->u.s.Persistent)
+            FIXME( "persistent threads are not supported\n" );
     }
 
-    if (interlocked_inc( &wait_work_item->DeleteCount ) == 2 )
+    if (!object->pool && !(object->pool = get_default_threadpool())) return STATUS_NO_MEMORY;
+    interlocked_inc( &object->pool->refcount );
+
+    if (object->group)
     {
-        status = STATUS_SUCCESS;
-        delete_wait_work_item( wait_work_item );
+        struct threadpool_group *group = object->group;
+
+        interlocked_inc( &group->refcount );
+        RtlEnterCriticalSection( &group->cs );
+        list_add_tail( &group->members, &object->group_entry );
+        object->is_group_member = TRUE;
+        RtlLeaveCriticalSection( &group->cs );
     }
 
-    return status;
+    TRACE( "allocated object %p of type %u in pool %p\n", object, object->type, object->pool );
+    return STATUS_SUCCESS;
 }
 
-/***********************************************************************
- *              RtlDeregisterWait   (NTDLL.@)
- *
- * Cancels a wait operation and frees the resources associated with calling
- * RtlRegisterWait().
- *
- * PARAMS
- *  WaitObject [I] Handle to the wait object to free.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- */
-NTSTATUS WINAPI RtlDeregisterWait(HANDLE WaitHandle)
+static void tp_instance_init( struct threadpool_instance *instance, struct threadpool_object *object )
 {
-    return RtlDeregisterWaitEx(WaitHandle, NULL);
+    memset( instance, 0, sizeof(*instance) );
+    instance->object = object;
+    instance->threadid = GetCurrentThreadId();
+    instance->associated = TRUE;
 }
 
+/* perform the actions requested by the callback after it returns */
+static void tp_instance_cleanup( struct threadpool_instance *instance )
+{
+    NTSTATUS status;
 
-/************************** Timer Queue Impl **************************/
+    if (instance->cleanup.critical_section)
+        RtlLeaveCriticalSection( instance->cleanup.critical_section );
+    if (instance->cleanup.mutex && (status = NtReleaseMutant( instance->cleanup.mutex, NULL )))
+        ERR( "failed to release mutex %p: %08x\n", instance->cleanup.mutex, status );
+    if (instance->cleanup.semaphore &&
+        (status = NtReleaseSemaphore( instance->cleanup.semaphore, instance->cleanup.semaphore_count, NULL )))
+        ERR( "failed to release semaphore %p: %08x\n", instance->cleanup.semaphore, status );
+    if (instance->cleanup.event && (status = NtSetEvent( instance->cleanup.event, NULL )))
+        ERR( "failed to set event %p: %08x\n", instance->cleanup.event, status );
+    if (instance->cleanup.library)
+        LdrUnloadDll( instance->cleanup.library );
+}
 
-struct timer_queue;
-struct queue_timer
+static void tp_object_release( struct threadpool_object *object )
 {
-    struct timer_queue *q;
-    struct list entry;
-    ULONG runcount;             /* number of callbacks pending execution */
-    RTL_WAITORTIMERCALLBACKFUNC callback;
-    PVOID param;
-    DWORD period;
-    ULONG flags;
-    ULONGLONG expire;
-    BOOL destroy;      /* timer should be deleted; once set, never unset */
-    HANDLE event;      /* removal event */
-};
+    struct threadpool *pool = object->pool;
 
-struct timer_queue
-{
-    DWORD magic;
-    RTL_CRITICAL_SECTION cs;
-    struct list timers;          /* sorted by expiration time */
-    BOOL quit;         /* queue should be deleted; once set, never unset */
-    HANDLE event;
-    HANDLE thread;
-};
+    if (interlocked_dec( &object->refcount )) return;
 
-#define EXPIRE_NEVER (~(ULONGLONG) 0)
-#define TIMER_QUEUE_MAGIC 0x516d6954  /* TimQ */
+    TRACE( "destroying object %p of type %u\n", object, object->type );
 
-static void queue_remove_timer(struct queue_timer *t)
-{
-    /* We MUST hold the queue cs while calling this function.  This ensures
-       that we cannot queue another callback for this timer.  The runcount
-       being zero makes sure we don't have any already queued.  */
-    struct timer_queue *q = t->q;
+    assert( !object->num_pending && !object->num_running );
 
-    assert(t->runcount == 0);
-    assert(t->destroy);
+    if (object->finalization_callback)
+    {
+        struct threadpool_instance instance;
 
-    list_remove(&t->entry);
-    if (t->event)
-        NtSetEvent(t->event, NULL);
-    RtlFreeHeap(GetProcessHeap(), 0, t);
+        tp_instance_init( &instance, object );
+        object->finalization_callback( (TP_CALLBACK_INSTANCE *)&instance, object->userdata );
+        tp_instance_cleanup( &instance );
+    }
 
-    if (q->quit && list_empty(&q->timers))
-        NtSetEvent(q->event, NULL);
+    tp_object_free( object );
+    tp_pool_release( pool );
 }
 
-static void timer_cleanup_callback(struct queue_timer *t)
+/* release the reference of the creator, either explicitly or through the cleanup group */
+static BOOL tp_object_close( struct threadpool_object *object )
 {
-    struct timer_queue *q = t->q;
-    RtlEnterCriticalSection(&q->cs);
+    struct threadpool_group *group = object->group;
+    BOOL member = FALSE;
 
-    assert(0 < t->runcount);
-    --t->runcount;
+    if (interlocked_xchg( &object->released, TRUE )) return FALSE;
 
-    if (t->destroy && t->runcount == 0)
-        queue_remove_timer(t);
+    if (group)
+    {
+        RtlEnterCriticalSection( &group->cs );
+        if ((member = object->is_group_member))
+        {
+            list_remove( &object->group_entry );
+            object->is_group_member = FALSE;
+        }
+        RtlLeaveCriticalSection( &group->cs );
+        if (member) tp_group_release( group );
+    }
 
-    RtlLeaveCriticalSection(&q->cs);
+    tp_object_release( object );
+    return TRUE;
 }
 
-static DWORD WINAPI timer_callback_wrapper(LPVOID p)
+/* take one of the pending callbacks */
+static BOOL tp_object_claim( struct threadpool_object *object )
 {
-    struct queue_timer *t = p;
-    t->callback(t->param, TRUE);
-    timer_cleanup_callback(t);
-    return 0;
-}
+    LONG pending;
 
-static inline ULONGLONG queue_current_time(void)
-{
-    LARGE_INTEGER now, freq;
-    NtQueryPerformanceCounter(&now, &freq);
-    return now.QuadPart * 1000 / freq.QuadPart;
+    while ((pending = *(volatile LONG *)&object->num_pending))
+        if (interlocked_cmpxchg( &object->num_pending, pending - 1, pending ) == pending) return TRUE;
+    return FALSE;
 }
 
-static void queue_add_timer(struct queue_timer *t, ULONGLONG time,
-                            BOOL set_event)
+static void tp_object_finished( struct threadpool_object *object )
 {
-    /* We MUST hold the queue cs while calling this function.  */
-    struct timer_queue *q = t->q;
-    struct list *ptr = &q->timers;
+    struct threadpool *pool = object->pool;
 
-    assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
+    if (interlocked_dec( &object->num_running )) return;
+    if (!interlocked_cmpxchg( &object->num_waiters, 0, 0 )) return;
 
-    if (time != EXPIRE_NEVER)
-        LIST_FOR_EACH(ptr, &q->timers)
-        {
-            struct queue_timer *cur = LIST_ENTRY(ptr, struct queue_timer, entry);
-            if (time < cur->expire)
-                break;
-        }
-    list_add_before(ptr, &t->entry);
+    RtlEnterCriticalSection( &pool->cs );
+    RtlWakeAllConditionVariable( &pool->finished_event );
+    RtlLeaveCriticalSection( &pool->cs );
+}
 
-    t->expire = time;
+static NTSTATUS tp_object_submit( struct threadpool_object *object, ULONG_PTR arg )
+{
+    struct threadpool *pool = object->pool;
+    struct threadpool_worker *worker = ntdll_get_thread_data()->threadpool_worker;
+    struct threadpool_queue *queue = &pool->queue;
+    struct threadpool_entry entry;
+
+    /* callbacks submitted from a worker go to its own queue, where they are likely still in cache */
+    if (worker && worker->pool == pool && worker->slot != -1) queue = &worker->queue;
+
+    entry.object = object;
+    entry.arg    = arg;
+    interlocked_inc( &object->refcount );
+    interlocked_inc( &object->num_pending );
+    if (!tp_queue_push( queue, &entry, 1 ))
+    {
+        tp_object_claim( object );
+        tp_object_release( object );
+        return STATUS_NO_MEMORY;
+    }
 
-    /* If we insert at the head of the list, we need to expire sooner
-       than expected.  */
-    if (set_event && &t->entry == list_head(&q->timers))
-        NtSetEvent(q->event, NULL);
+    tp_pool_wake( pool );
+    return STATUS_SUCCESS;
 }
 
-static inline void queue_move_timer(struct queue_timer *t, ULONGLONG time,
-                                    BOOL set_event)
+/* discard the callbacks that didn't start yet, the entries still in the queues are skipped */
+static LONG tp_object_cancel( struct threadpool_object *object )
 {
-    /* We MUST hold the queue cs while calling this function.  */
-    list_remove(&t->entry);
-    queue_add_timer(t, time, set_event);
+    return interlocked_xchg( &object->num_pending, 0 );
 }
 
-static void queue_timer_expire(struct timer_queue *q)
+static void tp_object_wait( struct threadpool_object *object )
 {
-    struct queue_timer *t = NULL;
+    struct threadpool *pool = object->pool;
+
+    RtlEnterCriticalSection( &pool->cs );
+    interlocked_inc( &object->num_waiters );
+    while (*(volatile LONG *)&object->num_pending || *(volatile LONG *)&object->num_running)
+        RtlSleepConditionVariableCS( &pool->finished_event, &pool->cs, NULL );
+    interlocked_dec( &object->num_waiters );
+    RtlLeaveCriticalSection( &pool->cs );
+}
 
-    RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+/* remove the timer or registered wait of an object, and wait until its callback has returned.
+ * threadpool_objects_cs must be held; it is released while waiting, since the callbacks
+ * may need it. */
+static void tp_object_remove_trigger( struct threadpool_object *object )
+{
+    HANDLE handle;
+
+    for (;;)
     {
-        ULONGLONG now, next;
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        if (!t->destroy && t->expire <= ((now = queue_current_time())))
+        if (object->type == TP_OBJECT_TYPE_TIMER)
         {
-            ++t->runcount;
-            if (t->period)
-            {
-                next = t->expire + t->period;
-                /* avoid trigger cascade if overloaded / hibernated */
-                if (next < now)
-                    next = now + t->period;
-            }
-            else
-                next = EXPIRE_NEVER;
-            queue_move_timer(t, next, FALSE);
+            if (!(handle = object->u.timer.timer)) break;
+            object->u.timer.timer = NULL;
         }
         else
-            t = NULL;
+        {
+            if (!(handle = object->u.wait.wait)) break;
+            object->u.wait.wait = NULL;
+        }
+
+        RtlLeaveCriticalSection( &threadpool_objects_cs );
+        if (object->type == TP_OBJECT_TYPE_TIMER) RtlDeleteTimer( NULL, handle, INVALID_HANDLE_VALUE );
+        else RtlDeregisterWaitEx( handle, INVALID_HANDLE_VALUE );
+        /* another thread may have set the object again in the meantime */
+        RtlEnterCriticalSection( &threadpool_objects_cs );
     }
-    RtlLeaveCriticalSection(&q->cs);
+}
 
-    if (t)
+/* stop the timer, wait or I/O associated with an object before closing it */
+static void tp_object_shutdown( struct threadpool_object *object )
+{
+    switch (object->type)
     {
-        if (t->flags & WT_EXECUTEINTIMERTHREAD)
-            timer_callback_wrapper(t);
-        else
-        {
-            ULONG flags
-                = (t->flags
-                   & (WT_EXECUTEINIOTHREAD | WT_EXECUTEINPERSISTENTTHREAD
-                      | WT_EXECUTELONGFUNCTION | WT_TRANSFER_IMPERSONATION));
-            NTSTATUS status = RtlQueueWorkItem(timer_callback_wrapper, t, flags);
-            if (status != STATUS_SUCCESS)
-                timer_cleanup_callback(t);
-        }
+    case TP_OBJECT_TYPE_TIMER:
+        RtlEnterCriticalSection( &threadpool_objects_cs );
+        tp_object_remove_trigger( object );
+        object->u.timer.set = FALSE;
+        RtlLeaveCriticalSection( &threadpool_objects_cs );
+        break;
+    case TP_OBJECT_TYPE_WAIT:
+        RtlEnterCriticalSection( &threadpool_objects_cs );
+        tp_object_remove_trigger( object );
+        RtlLeaveCriticalSection( &threadpool_objects_cs );
+        break;
+    case TP_OBJECT_TYPE_IO:
+        object->u.io.shutdown = TRUE;
+        break;
+    default:
+        break;
     }
 }
 
-static ULONG queue_get_timeout(struct timer_queue *q)
+static void tp_worker_execute( struct threadpool_worker *worker, const struct threadpool_entry *entry )
 {
-    struct queue_timer *t;
-    ULONG timeout = INFINITE;
+    struct threadpool_object *object = entry->object;
+    struct threadpool *pool = worker->pool;
+    struct threadpool_completion *completion = (struct threadpool_completion *)entry->arg;
+    struct threadpool_instance instance;
+    TP_CALLBACK_INSTANCE *callback_instance = (TP_CALLBACK_INSTANCE *)&instance;
+    BOOL executed = FALSE;
 
-    RtlEnterCriticalSection(&q->cs);
-    if (list_head(&q->timers))
+    interlocked_inc( &object->num_running );
+    tp_instance_init( &instance, object );
+
+    if (tp_object_claim( object ))
     {
-        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
-        assert(!t->destroy || t->expire == EXPIRE_NEVER);
+        if (object->may_run_long) TpCallbackMayRunLong( callback_instance );
 
-        if (t->expire != EXPIRE_NEVER)
+        switch (object->type)
         {
-            ULONGLONG time = queue_current_time();
-            timeout = t->expire < time ? 0 : t->expire - time;
+        case TP_OBJECT_TYPE_SIMPLE:
+            TRACE( "executing simple callback %p(%p, %p)\n",
+                   object->u.simple.callback, callback_instance, object->userdata );
+            if (object->u.simple.function) object->u.simple.function( object->userdata );
+            else object->u.simple.callback( callback_instance, object->userdata );
+            break;
+        case TP_OBJECT_TYPE_WORK:
+            TRACE( "executing work callback %p(%p, %p, %p)\n",
+                   object->u.work.callback, callback_instance, object->userdata, object );
+            object->u.work.callback( callback_instance, object->userdata, (TP_WORK *)object );
+            break;
+        case TP_OBJECT_TYPE_TIMER:
+            TRACE( "executing timer callback %p(%p, %p, %p)\n",
+                   object->u.timer.callback, callback_instance, object->userdata, object );
+            object->u.timer.callback( callback_instance, object->userdata, (TP_TIMER *)object );
+            break;
+        case TP_OBJECT_TYPE_WAIT:
+            TRACE( "executing wait callback %p(%p, %p, %p, %lu)\n",
+                   object->u.wait.callback, callback_instance, object->userdata, object, entry->arg );
+            object->u.wait.callback( callback_instance, object->userdata, (TP_WAIT *)object, entry->arg );
+            break;
+        case TP_OBJECT_TYPE_IO:
+            TRACE( "executing I/O callback %p(%p, %p, %#lx, %p, %p)\n", object->u.io.callback,
+                   callback_instance, object->userdata, completion->cvalue, &completion->iosb, object );
+            object->u.io.callback( callback_instance, object->userdata, (void *)completion->cvalue,
+                                   &completion->iosb, (TP_IO *)object );
+            break;
         }
+
+        tp_instance_cleanup( &instance );
+        if (instance.may_run_long) interlocked_dec( &pool->num_long );
+        worker->completed++;
+        executed = TRUE;
     }
-    RtlLeaveCriticalSection(&q->cs);
 
-    return timeout;
+    if (instance.associated) tp_object_finished( object );
+    if (object->type == TP_OBJECT_TYPE_IO) RtlFreeHeap( GetProcessHeap(), 0, completion );
+    if (object->type == TP_OBJECT_TYPE_SIMPLE && executed) tp_object_close( object );
+    tp_object_release( object );
 }
 
-static void WINAPI timer_queue_thread_proc(LPVOID p)
+/* find the next callback to execute, from the worker queue, the pool queue or another worker */
+static BOOL tp_worker_next( struct threadpool_worker *worker, struct threadpool_entry *entry )
 {
-    struct timer_queue *q = p;
-    ULONG timeout_ms;
+    struct threadpool *pool = worker->pool;
+    struct threadpool_entry batch[THREADPOOL_BATCH_SIZE];
+    unsigned int i, count, max = THREADPOOL_BATCH_SIZE;
+    LONG num_slots;
 
-    timeout_ms = INFINITE;
-    for (;;)
-    {
-        LARGE_INTEGER timeout;
-        NTSTATUS status;
-        BOOL done = FALSE;
+    if (tp_queue_take( &worker->queue, entry, 1, FALSE )) return TRUE;
 
-        status = NtWaitForSingleObject(
-            q->event, FALSE, get_nt_timeout(&timeout, timeout_ms));
+    /* the queue of a worker without a slot is invisible to the others, don't fill it */
+    if (worker->slot == -1) max = 1;
 
-        if (status == STATUS_WAIT_0)
+    count = tp_queue_take( &pool->queue, batch, max, TRUE );
+    if (!count)
+    {
+        num_slots = *(volatile LONG *)&pool->num_slots;
+        for (i = 1; i <= num_slots && !count; i++)
         {
-            /* There are two possible ways to trigger the event.  Either
-               we are quitting and the last timer got removed, or a new
-               timer got put at the head of the list so we need to adjust
-               our timeout.  */
-            RtlEnterCriticalSection(&q->cs);
-            if (q->quit && list_empty(&q->timers))
-                done = TRUE;
-            RtlLeaveCriticalSection(&q->cs);
+            struct threadpool_worker *victim = pool->slots[(worker->slot + i) % num_slots];
+            if (victim == worker) continue;
+            count = tp_queue_take( &victim->queue, batch, max, TRUE );
         }
-        else if (status == STATUS_TIMEOUT)
-            queue_timer_expire(q);
-
-        if (done)
-            break;
-
-        timeout_ms = queue_get_timeout(q);
+        if (!count) return FALSE;
+        TRACE( "worker %p stole %u callbacks\n", worker, count );
     }
 
-    NtClose(q->event);
-    RtlDeleteCriticalSection(&q->cs);
-    q->magic = 0;
-    RtlFreeHeap(GetProcessHeap(), 0, q);
-}
-
-static void queue_destroy_timer(struct queue_timer *t)
-{
-    /* We MUST hold the queue cs while calling this function.  */
-    t->destroy = TRUE;
-    if (t->runcount == 0)
-        /* Ensure a timer is promptly removed.  If callbacks are pending,
-           it will be removed after the last one finishes by the callback
-           cleanup wrapper.  */
-        queue_remove_timer(t);
-    else
-        /* Make sure no destroyed timer masks an active timer at the head
-           of the sorted list.  */
-        queue_move_timer(t, EXPIRE_NEVER, FALSE);
+    *entry = batch[0];
+    if (count > 1 && !tp_queue_push( &worker->queue, batch + 1, count - 1 ))
+    {
+        for (i = 1; i < count; i++) tp_worker_execute( worker, &batch[i] );
+    }
+    return TRUE;
 }
 
-/***********************************************************************
- *              RtlCreateTimerQueue   (NTDLL.@)
- *
- * Creates a timer queue object and returns a handle to it.
- *
- * PARAMS
- *  NewTimerQueue [O] The newly created queue.
- *
- * RETURNS
- *  Success: STATUS_SUCCESS.
- *  Failure: Any NTSTATUS code.
- */
-NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
+static void CALLBACK tp_worker_proc( void *param )
 {
+    struct threadpool_worker *worker = param;
+    struct threadpool *pool = worker->pool;
+    struct threadpool_entry entry;
+    LARGE_INTEGER timeout;
     NTSTATUS status;
-    struct timer_queue *q = RtlAllocateHeap(GetProcessHeap(), 0, sizeof *q);
-    if (!q)
-        return STATUS_NO_MEMORY;
+    BOOL destroy, unslotted;
 
-    RtlInitializeCriticalSection(&q->cs);
-    list_init(&q->timers);
-    q->quit = FALSE;
-    q->magic = TIMER_QUEUE_MAGIC;
-    status = NtCreateEvent(&q->event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
-    if (status != STATUS_SUCCESS)
+    TRACE( "starting worker %p in pool %p\n", worker, pool );
+
+    ntdll_get_thread_data()->threadpool_worker = worker;
+    timeout.QuadPart = -(WORKER_TIMEOUT * (ULONGLONG)10000);
+
+    for (;;)
     {
-        RtlFreeHeap(GetProcessHeap(), 0, q);
-        return status;
+        while (tp_worker_next( worker, &entry )) tp_worker_execute( worker, &entry );
+
+        RtlEnterCriticalSection( &pool->cs );
+        interlocked_inc( &pool->num_idle );
+        status = STATUS_SUCCESS;
+        while (!pool->shutdown && status != STATUS_TIMEOUT && !tp_pool_has_work( pool ))
+            status = RtlSleepConditionVariableCS( &pool->update_event, &pool->cs, &timeout );
+        interlocked_dec( &pool->num_idle );
+
+        if (!tp_pool_has_work( pool ) &&
+            (pool->shutdown || (status == STATUS_TIMEOUT && pool->num_workers > pool->min_workers)))
+            break;
+        RtlLeaveCriticalSection( &pool->cs );
     }
-    status = RtlCreateUserThread(GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
-                                 timer_queue_thread_proc, q, &q->thread, NULL);
-    if (status != STATUS_SUCCESS)
+
+    TRACE( "exiting worker %p in pool %p\n", worker, pool );
+
+    pool->num_workers--;
+    worker->running = FALSE;
+    destroy = pool->shutdown && !pool->num_workers;
+    /* once the lock is released, a slotted worker may be freed by tp_pool_destroy */
+    unslotted = worker->slot == -1;
+    RtlLeaveCriticalSection( &pool->cs );
+
+    ntdll_get_thread_data()->threadpool_worker = NULL;
+    if (unslotted)
     {
-        NtClose(q->event);
-        RtlFreeHeap(GetProcessHeap(), 0, q);
-        return status;
+        tp_queue_destroy( &worker->queue );
+        RtlFreeHeap( GetProcessHeap(), 0, worker );
     }
-
-    *NewTimerQueue = q;
-    return STATUS_SUCCESS;
+    if (destroy) tp_pool_destroy( pool );
+    RtlExitUserThread( 0 );
 }
 
 /***********************************************************************
- *              RtlDeleteTimerQueueEx   (NTDLL.@)
+ *              RtlQueueWorkItem   (NTDLL.@)
  *
- * Deletes a timer queue object.
+ * Queues a work item into a thread in the thread pool.
  *
  * PARAMS
- *  TimerQueue      [I] The timer queue to destroy.
- *  CompletionEvent [I] If NULL, return immediately.  If INVALID_HANDLE_VALUE,
- *                      wait until all timers are finished firing before
- *                      returning.  Otherwise, return immediately and set the
- *                      event when all timers are done.
+ *  Function [I] Work function to execute.
+ *  Context  [I] Context to pass to the work function when it is executed.
+ *  Flags    [I] Flags. See notes.
  *
  * RETURNS
- *  Success: STATUS_SUCCESS if synchronous, STATUS_PENDING if not.
+ *  Success: STATUS_SUCCESS.
  *  Failure: Any NTSTATUS code.
+ *
+ * NOTES
+ *  Flags can be one or more of the following:
+ *|WT_EXECUTEDEFAULT - Executes the work item in a non-I/O worker thread.
+ *|WT_EXECUTEINIOTHREAD - Executes the work item in an I/O worker thread.
+ *|WT_EXECUTEINPERSISTENTTHREAD - Executes the work item in a thread that is persistent.
+ *|WT_EXECUTELONGFUNCTION - Hints that the execution can take a long time.
+ *|WT_TRANSFER_IMPERSONATION - Executes the function with the current access token.
  */
-NTSTATUS WINAPI RtlDeleteTimerQueueEx(HANDLE TimerQueue, HANDLE CompletionEvent)
+NTSTATUS WINAPI RtlQueueWorkItem(PRTL_WORK_ITEM_ROUTINE Function, PVOID Context, ULONG Flags)
 {
-    struct timer_queue *q = TimerQueue;
-    struct queue_timer *t, *temp;
-    HANDLE thread;
+    struct threadpool_object *object;
     NTSTATUS status;
 
-    if (!q || q->magic != TIMER_QUEUE_MAGIC)
-        return STATUS_INVALID_HANDLE;
-
-    thread = q->thread;
+    TRACE( "%p %p %x\n", Function, Context, Flags );
 
-    RtlEnterCriticalSection(&q->cs);
-    q->quit = TRUE;
-    if (list_head(&q->timers))
-        /* When the last timer is removed, it will signal the timer thread to
-           exit...  */
-        LIST_FOR_EACH_ENTRY_SAFE(t, temp, &q->timers, struct queue_timer, entry)
-            queue_destroy_timer(t);
-    else
-        /* However if we have none, we must do it ourselves.  */
-        NtSetEvent(q->event, NULL);
-    RtlLeaveCriticalSection(&q->cs);
+    if (Flags & ~WT_EXECUTELONGFUNCTION)
+        FIXME("Flags 0x%x not supported\n", Flags);
 
-    if (CompletionEvent == INVALID_HANDLE_VALUE)
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_SIMPLE ))) return STATUS_NO_MEMORY;
+    object->u.simple.function = Function;
+    if ((status = tp_object_initialize( object, Context, NULL )))
     {
-        NtWaitForSingleObject(thread, FALSE, NULL);
-        status = STATUS_SUCCESS;
-    }
-    else
-    {
-        if (CompletionEvent)
-        {
-            FIXME("asynchronous return on completion event unimplemented\n");
-            NtWaitForSingleObject(thread, FALSE, NULL);
-            NtSetEvent(CompletionEvent, NULL);
-        }
-        status = STATUS_PENDING;
+        tp_object_free( object );
+        return status;
     }
+    object->may_run_long = (Flags & WT_EXECUTELONGFUNCTION) != 0;
 
-    NtClose(thread);
+    if ((status = tp_object_submit( object, 0 ))) tp_object_close( object );
     return status;
 }
 
-static struct timer_queue *default_timer_queue;
-
-static struct timer_queue *get_timer_queue(HANDLE TimerQueue)
+/***********************************************************************
+ * iocp_poller - get completion events and run callbacks
+ */
+static DWORD CALLBACK iocp_poller(LPVOID Arg)
 {
-    if (TimerQueue)
-        return TimerQueue;
-    else
+    HANDLE cport = Arg;
+
+    while( TRUE )
     {
-        if (!default_timer_queue)
+        PRTL_OVERLAPPED_COMPLETION_ROUTINE callback;
+        LPVOID overlapped;
+        IO_STATUS_BLOCK iosb;
+        NTSTATUS res = NtRemoveIoCompletion( cport, (PULONG_PTR)&callback, (PULONG_PTR)&overlapped, &iosb, NULL );
+        if (res)
         {
-            HANDLE q;
-            NTSTATUS status = RtlCreateTimerQueue(&q);
-            if (status == STATUS_SUCCESS)
-            {
-                PVOID p = interlocked_cmpxchg_ptr(
-                    (void **) &default_timer_queue, q, NULL);
-                if (p)
-                    /* Got beat to the punch.  */
-                    RtlDeleteTimerQueueEx(q, NULL);
-            }
+            ERR("NtRemoveIoCompletion failed: 0x%x\n", res);
+        }
+        else
+        {
+            DWORD transferred = 0;
+            DWORD err = 0;
+
+            if (iosb.u.Status == STATUS_SUCCESS)
+                transferred = iosb.Information;
+            else
+                err = RtlNtStatusToDosError(iosb.u.Status);
+
+            callback( err, transferred, overlapped );
         }
-        return default_timer_queue;
     }
+    return 0;
 }
 
 /***********************************************************************
- *              RtlCreateTimer   (NTDLL.@)
+ *              RtlSetIoCompletionCallback  (NTDLL.@)
  *
- * Creates a new timer associated with the given queue.
+ * Binds a handle to a thread pool's completion port, and possibly
+ * starts a non-I/O thread to monitor this port and call functions back.
  *
  * PARAMS
- *  NewTimer   [O] The newly created timer.
- *  TimerQueue [I] The queue to hold the timer.
- *  Callback   [I] The callback to fire.
- *  Parameter  [I] The argument for the callback.
- *  DueTime    [I] The delay, in milliseconds, before first firing the
- *                 timer.
- *  Period     [I] The period, in milliseconds, at which to fire the timer
- *                 after the first callback.  If zero, the timer will only
- *                 fire once.  It still needs to be deleted with
- *                 RtlDeleteTimer.
- * Flags       [I] Flags controlling the execution of the callback.  In
- *                 addition to the WT_* thread pool flags (see
- *                 RtlQueueWorkItem), WT_EXECUTEINTIMERTHREAD and
- *                 WT_EXECUTEONLYONCE are supported.
+ *  FileHandle [I] Handle to bind to a completion port.
+ *  Function   [I] Callback function to call on I/O completions.
+ *  Flags      [I] Not used.
  *
  * RETURNS
  *  Success: STATUS_SUCCESS.
  *  Failure: Any NTSTATUS code.
+ *
  */
-NTSTATUS WINAPI RtlCreateTimer(PHANDLE NewTimer, HANDLE TimerQueue,
-                               RTL_WAITORTIMERCALLBACKFUNC Callback,
-                               PVOID Parameter, DWORD DueTime, DWORD Period,
-                               ULONG Flags)
+NTSTATUS WINAPI RtlSetIoCompletionCallback(HANDLE FileHandle, PRTL_OVERLAPPED_COMPLETION_ROUTINE Function, ULONG Flags)
 {
-    NTSTATUS status;
-    struct queue_timer *t;
-    struct timer_queue *q = get_timer_queue(TimerQueue);
-
-    if (!q) return STATUS_NO_MEMORY;
-    if (q->magic != TIMER_QUEUE_MAGIC) return STATUS_INVALID_HANDLE;
+    IO_STATUS_BLOCK iosb;
+    FILE_COMPLETION_INFORMATION info;
 
-    t = RtlAllocateHeap(GetProcessHeap(), 0, sizeof *t);
-    if (!t)
-        return STATUS_NO_MEMORY;
+    if (Flags) FIXME("Unknown value Flags=0x%x\n", Flags);
 
-    t->q = q;
-    t->runcount = 0;
-    t->callback = Callback;
-    t->param = Parameter;
-    t->period = Period;
-    t->flags = Flags;
-    t->destroy = FALSE;
-    t->event = NULL;
+    if (!compl_port)
+    {
+        NTSTATUS res = STATUS_SUCCESS;
 
-    status = STATUS_SUCCESS;
-    RtlEnterCriticalSection(&q->cs);
-    if (q->quit)
-        status = STATUS_INVALID_HANDLE;
-    else
-        queue_add_timer(t, queue_current_time() + DueTime, TRUE);
-    RtlLeaveCriticalSection(&q->cs);
+        RtlEnterCriticalSection(&threadpool_compl_cs);
+        if (!compl_port)
+        {
+            HANDLE cport;
 
-    if (status == STATUS_SUCCESS)
-        *NewTimer = t;
+            res = NtCreateIoCompletion( &cport, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+            if (!res)
+            {
+                /* FIXME native can start additional threads in case of e.g. hung callback function. */
+                res = RtlQueueWorkItem( iocp_poller, cport, WT_EXECUTELONGFUNCTION );
+                if (!res)
+                    compl_port = cport;
+                else
+                    NtClose( cport );
+            }
+        }
+        RtlLeaveCriticalSection(&threadpool_compl_cs);
+        if (res) return res;
+    }
+
+    info.CompletionPort = compl_port;
+    info.CompletionKey = (ULONG_PTR)Function;
+
+    return NtSetInformationFile( FileHandle, &iosb, &info, sizeof(info), FileCompletionInformation );
+}
+
+static inline PLARGE_INTEGER get_nt_timeout( PLARGE_INTEGER pTime, ULONG timeout )
+{
+    if (timeout == INFINITE) return NULL;
+    pTime->QuadPart = (ULONGLONG)timeout * -10000;
+    return pTime;
+}
+
+static inline ULONGLONG queue_current_time(void)
+{
+    LARGE_INTEGER now, freq;
+    NtQueryPerformanceCounter(&now, &freq);
+    return now.QuadPart * 1000 / freq.QuadPart;
+}
+
+#define EXPIRE_NEVER (~(ULONGLONG) 0)
+
+/* a thread waiting for up to MAXIMUM_WAIT_OBJECTS - 1 registered waits, the first
+ * handle of its wait is an event signaled when the set of waits changes */
+struct wait_bucket
+{
+    struct list entry;          /* entry in the waitqueue list */
+    struct list waits;          /* registered waits handled by this thread */
+    LONG        num_waits;
+    HANDLE      update_event;
+};
+
+struct wait_work_item
+{
+    struct list         entry;  /* entry in the bucket list */
+    struct wait_bucket *bucket; /* NULL once removed from the bucket */
+    LONG                refcount;
+    HANDLE              Object;
+    WAITORTIMERCALLBACK Callback;
+    PVOID               Context;
+    ULONG               Milliseconds;
+    ULONG               Flags;
+    ULONGLONG           Timeout;     /* time at which the wait times out */
+    HANDLE              CompletionEvent;
+    BOOL                Active;      /* still waited for by the bucket thread */
+    BOOL                Deregistered;
+    BOOL                CallbackInProgress;
+    BOOLEAN             TimerOrWaitFired;
+};
+
+static RTL_CRITICAL_SECTION waitqueue_cs;
+static RTL_CRITICAL_SECTION_DEBUG critsect_waitqueue_debug =
+{
+    0, 0, &waitqueue_cs,
+    { &critsect_waitqueue_debug.ProcessLocksList, &critsect_waitqueue_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": waitqueue_cs") }
+};
+static RTL_CRITICAL_SECTION waitqueue_cs = { &critsect_waitqueue_debug, -1, 0, 0, 0, 0 };
+
+static struct list wait_buckets = LIST_INIT( wait_buckets );
+
+static void release_wait_work_item( struct wait_work_item *wait_work_item )
+{
+    if (interlocked_dec( &wait_work_item->refcount )) return;
+    RtlFreeHeap( GetProcessHeap(), 0, wait_work_item );
+}
+
+/* the waitqueue lock must be held */
+static void wait_work_item_rearm( struct wait_work_item *wait_work_item )
+{
+    if (wait_work_item->Milliseconds == INFINITE)
+        wait_work_item->Timeout = EXPIRE_NEVER;
     else
-        RtlFreeHeap(GetProcessHeap(), 0, t);
+        wait_work_item->Timeout = queue_current_time() + wait_work_item->Milliseconds;
+}
 
-    return status;
+/* the callback returned, wait for the object again unless the wait is gone */
+static void wait_work_item_done( struct wait_work_item *wait_work_item )
+{
+    HANDLE completion_event = NULL;
+
+    RtlEnterCriticalSection( &waitqueue_cs );
+    wait_work_item->CallbackInProgress = FALSE;
+    if (wait_work_item->Deregistered)
+    {
+        completion_event = wait_work_item->CompletionEvent;
+        wait_work_item->CompletionEvent = NULL;
+    }
+    else if (wait_work_item->Active)
+    {
+        wait_work_item_rearm( wait_work_item );
+        NtSetEvent( wait_work_item->bucket->update_event, NULL );
+    }
+    RtlLeaveCriticalSection( &waitqueue_cs );
+
+    if (completion_event) NtSetEvent( completion_event, NULL );
+    release_wait_work_item( wait_work_item );
+}
+
+static void run_wait_callback( struct wait_work_item *wait_work_item )
+{
+    TRACE( "%s for object %p, calling callback %p with context %p\n",
+           wait_work_item->TimerOrWaitFired ? "wait timed out" : "object signaled",
+           wait_work_item->Object, wait_work_item->Callback, wait_work_item->Context );
+
+    wait_work_item->Callback( wait_work_item->Context, wait_work_item->TimerOrWaitFired );
+    wait_work_item_done( wait_work_item );
+}
+
+static DWORD CALLBACK wait_callback_proc( LPVOID Arg )
+{
+    run_wait_callback( Arg );
+    return 0;
+}
+
+/* start the callback of a wait, the waitqueue lock must be held; returns TRUE if
+ * it must be called from the wait thread once the lock is released */
+static BOOL fire_wait_work_item( struct wait_work_item *wait_work_item, BOOLEAN timed_out )
+{
+    struct wait_bucket *bucket = wait_work_item->bucket;
+
+    wait_work_item->TimerOrWaitFired = timed_out;
+    wait_work_item->CallbackInProgress = TRUE;
+    if (wait_work_item->Flags & WT_EXECUTEONLYONCE) wait_work_item->Active = FALSE;
+    interlocked_inc( &wait_work_item->refcount );
+
+    /* move it after the other waits, so that an object which is always signaled
+     * doesn't prevent the following ones from being noticed */
+    list_remove( &wait_work_item->entry );
+    list_add_tail( &bucket->waits, &wait_work_item->entry );
+
+    if (wait_work_item->Flags & WT_EXECUTEINWAITTHREAD) return TRUE;
+    if (RtlQueueWorkItem( wait_callback_proc, wait_work_item,
+                          wait_work_item->Flags & WT_EXECUTELONGFUNCTION ))
+        return TRUE;
+    return FALSE;
+}
+
+/* get the index of the wait which was signaled, or 0 */
+static inline ULONG get_signaled_index( NTSTATUS status, ULONG count )
+{
+    if (status > STATUS_WAIT_0 && status < STATUS_WAIT_0 + count)
+        return status - STATUS_WAIT_0;
+    if (status > STATUS_ABANDONED_WAIT_0 && status < STATUS_ABANDONED_WAIT_0 + count)
+        return status - STATUS_ABANDONED_WAIT_0;
+    return 0;
+}
+
+static void CALLBACK wait_thread_proc( void *param )
+{
+    struct wait_bucket *bucket = param;
+    struct wait_work_item *objects[MAXIMUM_WAIT_OBJECTS], *fired[MAXIMUM_WAIT_OBJECTS];
+    struct wait_work_item *wait_work_item, *next;
+    HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+    LARGE_INTEGER timeout, zero;
+    ULONGLONG now, expire;
+    ULONG count = 1, num_fired = 0, i;
+    NTSTATUS status = STATUS_WAIT_0;
+    BOOL idle = FALSE;
+
+    TRACE( "starting wait thread for bucket %p\n", bucket );
+
+    zero.QuadPart = 0;
+    handles[0] = bucket->update_event;
+
+    RtlEnterCriticalSection( &waitqueue_cs );
+    for (;;)
+    {
+        /* the waits in the objects array are still in the bucket, only this thread removes them */
+        if ((i = get_signaled_index( status, count )))
+        {
+            wait_work_item = objects[i];
+            if (wait_work_item->Active && fire_wait_work_item( wait_work_item, FALSE ))
+                fired[num_fired++] = wait_work_item;
+        }
+        else if (status != STATUS_WAIT_0 && status != STATUS_TIMEOUT && status != STATUS_USER_APC)
+        {
+            /* one of the handles was closed or can't be waited for, stop waiting for it */
+            for (i = 1; i < count; i++)
+            {
+                NTSTATUS res = NtWaitForSingleObject( handles[i], FALSE, &zero );
+
+                if (res == STATUS_TIMEOUT) continue;
+                if (res == STATUS_WAIT_0 || res == STATUS_ABANDONED_WAIT_0)
+                {
+                    /* the probe consumed the signal, don't lose it */
+                    if (objects[i]->Active && fire_wait_work_item( objects[i], FALSE ))
+                        fired[num_fired++] = objects[i];
+                    continue;
+                }
+                WARN( "can't wait for handle %p of wait %p: %08x\n", handles[i], objects[i], res );
+                objects[i]->Active = FALSE;
+            }
+        }
+
+        /* run the callbacks which must be called from this thread */
+        if (num_fired)
+        {
+            RtlLeaveCriticalSection( &waitqueue_cs );
+            for (i = 0; i < num_fired; i++) run_wait_callback( fired[i] );
+            RtlEnterCriticalSection( &waitqueue_cs );
+            num_fired = 0;
+        }
+
+        /* build the array of handles, dropping the waits that are gone and firing the timeouts */
+        now = queue_current_time();
+        expire = EXPIRE_NEVER;
+        count = 1;
+        LIST_FOR_EACH_ENTRY_SAFE( wait_work_item, next, &bucket->waits, struct wait_work_item, entry )
+        {
+            if (!wait_work_item->Active)
+            {
+                list_remove( &wait_work_item->entry );
+                wait_work_item->bucket = NULL;
+                bucket->num_waits--;
+                release_wait_work_item( wait_work_item );
+            }
+            else if (wait_work_item->CallbackInProgress)
+                continue;  /* waited for again once the callback returns */
+            else if (wait_work_item->Timeout <= now)
+            {
+                if (fire_wait_work_item( wait_work_item, TRUE )) fired[num_fired++] = wait_work_item;
+            }
+            else
+            {
+                expire = min( expire, wait_work_item->Timeout );
+                objects[count] = wait_work_item;
+                handles[count++] = wait_work_item->Object;
+            }
+        }
+        if (num_fired)
+        {
+            status = STATUS_WAIT_0;
+            continue;
+        }
+
+        /* exit when no wait was registered for a while */
+        if (!bucket->num_waits)
+        {
+            if (idle) break;
+            expire = now + WORKER_TIMEOUT;
+        }
+
+        RtlLeaveCriticalSection( &waitqueue_cs );
+        status = NtWaitForMultipleObjects( count, handles, FALSE, TRUE,
+                                           get_nt_timeout( &timeout, expire == EXPIRE_NEVER ?
+                                                           INFINITE : expire - now ) );
+        RtlEnterCriticalSection( &waitqueue_cs );
+        idle = status == STATUS_TIMEOUT && !bucket->num_waits;
+    }
+
+    TRACE( "exiting wait thread for bucket %p\n", bucket );
+
+    list_remove( &bucket->entry );
+    RtlLeaveCriticalSection( &waitqueue_cs );
+
+    NtClose( bucket->update_event );
+    RtlFreeHeap( GetProcessHeap(), 0, bucket );
+    RtlExitUserThread( 0 );
+}
+
+/* find a thread which can wait for one more object, the waitqueue lock must be held */
+static NTSTATUS get_wait_bucket( struct wait_bucket **ret )
+{
+    struct wait_bucket *bucket;
+    NTSTATUS status;
+    HANDLE thread;
+
+    LIST_FOR_EACH_ENTRY( bucket, &wait_buckets, struct wait_bucket, entry )
+    {
+        if (bucket->num_waits < MAXIMUM_WAIT_OBJECTS - 1)
+        {
+            *ret = bucket;
+            return STATUS_SUCCESS;
+        }
+    }
+
+    if (!(bucket = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*bucket) ))) return STATUS_NO_MEMORY;
+    list_init( &bucket->waits );
+    bucket->num_waits = 0;
+
+    status = NtCreateEvent( &bucket->update_event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE );
+    if (status)
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, bucket );
+        return status;
+    }
+    status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                  wait_thread_proc, bucket, &thread, NULL );
+    if (status)
+    {
+        NtClose( bucket->update_event );
+        RtlFreeHeap( GetProcessHeap(), 0, bucket );
+        return status;
+    }
+    NtClose( thread );
+
+    list_add_tail( &wait_buckets, &bucket->entry );
+    *ret = bucket;
+    return STATUS_SUCCESS;
 }
 
 /***********************************************************************
- *              RtlUpdateTimer   (NTDLL.@)
+ *              RtlRegisterWait   (NTDLL.@)
  *
- * Changes the time at which a timer expires.
+ * Registers a wait for a handle to become signaled.
  *
  * PARAMS
- *  TimerQueue [I] The queue that holds the timer.
- *  Timer      [I] The timer to update.
- *  DueTime    [I] The delay, in milliseconds, before next firing the timer.
- *  Period     [I] The period, in milliseconds, at which to fire the timer
- *                 after the first callback.  If zero, the timer will not
- *                 refire once.  It still needs to be deleted with
- *                 RtlDeleteTimer.
+ *  NewWaitObject [I] Handle to the new wait object. Use RtlDeregisterWait() to free it.
+ *  Object   [I] Object to wait to become signaled.
+ *  Callback [I] Callback function to execute when the wait times out or the handle is signaled.
+ *  Context  [I] Context to pass to the callback function when it is executed.
+ *  Milliseconds [I] Number of milliseconds to wait before timing out.
+ *  Flags    [I] Flags. See notes.
  *
  * RETURNS
  *  Success: STATUS_SUCCESS.
  *  Failure: Any NTSTATUS code.
+ *
+ * NOTES
+ *  Flags can be one or more of the following:
+ *|WT_EXECUTEDEFAULT - Executes the work item in a non-I/O worker thread.
+ *|WT_EXECUTEINIOTHREAD - Executes the work item in an I/O worker thread.
+ *|WT_EXECUTEINPERSISTENTTHREAD - Executes the work item in a thread that is persistent.
+ *|WT_EXECUTELONGFUNCTION - Hints that the execution can take a long time.
+ *|WT_TRANSFER_IMPERSONATION - Executes the function with the current access token.
+ *
+ *  Up to MAXIMUM_WAIT_OBJECTS - 1 objects are waited for by the same thread, the
+ *  callbacks are executed by the thread pool unless WT_EXECUTEINWAITTHREAD is set.
  */
-NTSTATUS WINAPI RtlUpdateTimer(HANDLE TimerQueue, HANDLE Timer,
-                               DWORD DueTime, DWORD Period)
+NTSTATUS WINAPI RtlRegisterWait(PHANDLE NewWaitObject, HANDLE Object,
+                                RTL_WAITORTIMERCALLBACKFUNC Callback,
+                                PVOID Context, ULONG Milliseconds, ULONG Flags)
 {
-    struct queue_timer *t = Timer;
-    struct timer_queue *q = t->q;
+    struct wait_work_item *wait_work_item;
+    struct wait_bucket *bucket;
+    NTSTATUS status;
 
-    RtlEnterCriticalSection(&q->cs);
-    /* Can't change a timer if it was once-only or destroyed.  */
-    if (t->expire != EXPIRE_NEVER)
+    TRACE( "(%p, %p, %p, %p, %d, 0x%x)\n", NewWaitObject, Object, Callback, Context, Milliseconds, Flags );
+
+    wait_work_item = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*wait_work_item) );
+    if (!wait_work_item)
+        return STATUS_NO_MEMORY;
+
+    wait_work_item->refcount = 2;  /* one for the caller and one for the bucket */
+    wait_work_item->Object = Object;
+    wait_work_item->Callback = Callback;
+    wait_work_item->Context = Context;
+    wait_work_item->Milliseconds = Milliseconds;
+    wait_work_item->Flags = Flags;
+    wait_work_item->CompletionEvent = NULL;
+    wait_work_item->Active = TRUE;
+    wait_work_item->Deregistered = FALSE;
+    wait_work_item->CallbackInProgress = FALSE;
+
+    RtlEnterCriticalSection( &waitqueue_cs );
+    if ((status = get_wait_bucket( &bucket )))
     {
-        t->period = Period;
-        queue_move_timer(t, queue_current_time() + DueTime, TRUE);
+        RtlLeaveCriticalSection( &waitqueue_cs );
+        RtlFreeHeap( GetProcessHeap(), 0, wait_work_item );
+        return status;
     }
-    RtlLeaveCriticalSection(&q->cs);
+    wait_work_item_rearm( wait_work_item );
+    wait_work_item->bucket = bucket;
+    list_add_tail( &bucket->waits, &wait_work_item->entry );
+    bucket->num_waits++;
+    NtSetEvent( bucket->update_event, NULL );
+    RtlLeaveCriticalSection( &waitqueue_cs );
 
-    return STATUS_SUCCESS;
+    *NewWaitObject = wait_work_item;
+    return status;
 }
 
 /***********************************************************************
- *              RtlDeleteTimer   (NTDLL.@)
+ *              RtlDeregisterWaitEx   (NTDLL.@)
  *
- * Cancels a timer-queue timer.
+ * Cancels a wait operation and frees the resources associated with calling
+ * RtlRegisterWait().
  *
  * PARAMS
- *  TimerQueue      [I] The queue that holds the timer.
- *  Timer           [I] The timer to update.
- *  CompletionEvent [I] If NULL, return immediately.  If INVALID_HANDLE_VALUE,
- *                      wait until the timer is finished firing all pending
- *                      callbacks before returning.  Otherwise, return
- *                      immediately and set the timer is done.
+ *  WaitObject [I] Handle to the wait object to free.
  *
  * RETURNS
- *  Success: STATUS_SUCCESS if the timer is done, STATUS_PENDING if not,
-             or if the completion event is NULL.
+ *  Success: STATUS_SUCCESS.
  *  Failure: Any NTSTATUS code.
  */
-NTSTATUS WINAPI RtlDeleteTimer(HANDLE TimerQueue, HANDLE Timer,
-                               HANDLE CompletionEvent)
+NTSTATUS WINAPI RtlDeregisterWaitEx(HANDLE WaitHandle, HANDLE CompletionEvent)
 {
-    struct queue_timer *t = Timer;
-    struct timer_queue *q;
-    NTSTATUS status = STATUS_PENDING;
+    struct wait_work_item *wait_work_item = WaitHandle;
+    NTSTATUS status = STATUS_SUCCESS;
     HANDLE event = NULL;
 
-    if (!Timer)
-        return STATUS_INVALID_PARAMETER_1;
-    q = t->q;
+    TRACE( "(%p)\n", WaitHandle );
+
     if (CompletionEvent == INVALID_HANDLE_VALUE)
     {
-        status = NtCreateEvent(&event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
-        if (status == STATUS_SUCCESS)
-            status = STATUS_PENDING;
+        status = NtCreateEvent( &event, EVENT_ALL_ACCESS, NULL, NotificationEvent, FALSE );
+        if (status != STATUS_SUCCESS)
+            return status;
     }
-    else if (CompletionEvent)
-        event = CompletionEvent;
 
-    RtlEnterCriticalSection(&q->cs);
-    t->event = event;
-    if (t->runcount == 0 && event)
-        status = STATUS_SUCCESS;
-    queue_destroy_timer(t);
-    RtlLeaveCriticalSection(&q->cs);
+    RtlEnterCriticalSection( &waitqueue_cs );
+    wait_work_item->Active = FALSE;
+    wait_work_item->Deregistered = TRUE;
+    if (wait_work_item->bucket) NtSetEvent( wait_work_item->bucket->update_event, NULL );
 
-    if (CompletionEvent == INVALID_HANDLE_VALUE && event)
+    if (wait_work_item->CallbackInProgress)
     {
-        if (status == STATUS_PENDING)
+        if (event) wait_work_item->CompletionEvent = event;
+        else
         {
-            NtWaitForSingleObject(event, FALSE, NULL);
-            status = STATUS_SUCCESS;
+            wait_work_item->CompletionEvent = CompletionEvent;
+            status = STATUS_PENDING;
         }
-        NtClose(event);
+    }
+    else
+    {
+        if (event)
+        {
+            NtClose( event );
+            event = NULL;
+        }
+        else if (CompletionEvent) NtSetEvent( CompletionEvent, NULL );
+    }
+    RtlLeaveCriticalSection( &waitqueue_cs );
+
+    if (event)
+    {
+        NtWaitForSingleObject( event, FALSE, NULL );
+        NtClose( event );
     }
 
+    release_wait_work_item( wait_work_item );
     return status;
 }
+
+/***********************************************************************
+ *              RtlDeregisterWait   (NTDLL.@)
+ *
+ * Cancels a wait operation and frees the resources associated with calling
+ * RtlRegisterWait().
+ *
+ * PARAMS
+ *  WaitObject [I] Handle to the wait object to free.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlDeregisterWait(HANDLE WaitHandle)
+{
+    return RtlDeregisterWaitEx(WaitHandle, NULL);
+}
+
+
+/************************** Timer Queue Impl **************************/
+
+struct timer_queue;
+struct queue_timer
+{
+    struct timer_queue *q;
+    struct list entry;
+    ULONG runcount;             /* number of callbacks pending execution */
+    RTL_WAITORTIMERCALLBACKFUNC callback;
+    PVOID param;
+    DWORD period;
+    ULONG flags;
+    ULONGLONG expire;
+    BOOL destroy;      /* timer should be deleted; once set, never unset */
+    HANDLE event;      /* removal event */
+};
+
+struct timer_queue
+{
+    DWORD magic;
+    RTL_CRITICAL_SECTION cs;
+    struct list timers;          /* sorted by expiration time */
+    BOOL quit;         /* queue should be deleted; once set, never unset */
+    HANDLE event;
+    HANDLE thread;
+};
+
+#define TIMER_QUEUE_MAGIC 0x516d6954  /* TimQ */
+
+static void queue_remove_timer(struct queue_timer *t)
+{
+    /* We MUST hold the queue cs while calling this function.  This ensures
+       that we cannot queue another callback for this timer.  The runcount
+       being zero makes sure we don't have any already queued.  */
+    struct timer_queue *q = t->q;
+
+    assert(t->runcount == 0);
+    assert(t->destroy);
+
+    list_remove(&t->entry);
+    if (t->event)
+        NtSetEvent(t->event, NULL);
+    RtlFreeHeap(GetProcessHeap(), 0, t);
+
+    if (q->quit && list_empty(&q->timers))
+        NtSetEvent(q->event, NULL);
+}
+
+static void timer_cleanup_callback(struct queue_timer *t)
+{
+    struct timer_queue *q = t->q;
+    RtlEnterCriticalSection(&q->cs);
+
+    assert(0 < t->runcount);
+    --t->runcount;
+
+    if (t->destroy && t->runcount == 0)
+        queue_remove_timer(t);
+
+    RtlLeaveCriticalSection(&q->cs);
+}
+
+static DWORD WINAPI timer_callback_wrapper(LPVOID p)
+{
+    struct queue_timer *t = p;
+    t->callback(t->param, TRUE);
+    timer_cleanup_callback(t);
+    return 0;
+}
+
+static void queue_add_timer(struct queue_timer *t, ULONGLONG time,
+                            BOOL set_event)
+{
+    /* We MUST hold the queue cs while calling this function.  */
+    struct timer_queue *q = t->q;
+    struct list *ptr = &q->timers;
+
+    assert(!q->quit || (t->destroy && time == EXPIRE_NEVER));
+
+    if (time != EXPIRE_NEVER)
+        LIST_FOR_EACH(ptr, &q->timers)
+        {
+            struct queue_timer *cur = LIST_ENTRY(ptr, struct queue_timer, entry);
+            if (time < cur->expire)
+                break;
+        }
+    list_add_before(ptr, &t->entry);
+
+    t->expire = time;
+
+    /* If we insert at the head of the list, we need to expire sooner
+       than expected.  */
+    if (set_event && &t->entry == list_head(&q->timers))
+        NtSetEvent(q->event, NULL);
+}
+
+static inline void queue_move_timer(struct queue_timer *t, ULONGLONG time,
+                                    BOOL set_event)
+{
+    /* We MUST hold the queue cs while calling this function.  */
+    list_remove(&t->entry);
+    queue_add_timer(t, time, set_event);
+}
+
+static void queue_timer_expire(struct timer_queue *q)
+{
+    struct queue_timer *t = NULL;
+
+    RtlEnterCriticalSection(&q->cs);
+    if (list_head(&q->timers))
+    {
+        ULONGLONG now, next;
+        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
+        if (!t->destroy && t->expire <= ((now = queue_current_time())))
+        {
+            ++t->runcount;
+            if (t->period)
+            {
+                next = t->expire + t->period;
+                /* avoid trigger cascade if overloaded / hibernated */
+                if (next < now)
+                    next = now + t->period;
+            }
+            else
+                next = EXPIRE_NEVER;
+            queue_move_timer(t, next, FALSE);
+        }
+        else
+            t = NULL;
+    }
+    RtlLeaveCriticalSection(&q->cs);
+
+    if (t)
+    {
+        if (t->flags & WT_EXECUTEINTIMERTHREAD)
+            timer_callback_wrapper(t);
+        else
+        {
+            ULONG flags
+                = (t->flags
+                   & (WT_EXECUTEINIOTHREAD | WT_EXECUTEINPERSISTENTTHREAD
+                      | WT_EXECUTELONGFUNCTION | WT_TRANSFER_IMPERSONATION));
+            NTSTATUS status = RtlQueueWorkItem(timer_callback_wrapper, t, flags);
+            if (status != STATUS_SUCCESS)
+                timer_cleanup_callback(t);
+        }
+    }
+}
+
+static ULONG queue_get_timeout(struct timer_queue *q)
+{
+    struct queue_timer *t;
+    ULONG timeout = INFINITE;
+
+    RtlEnterCriticalSection(&q->cs);
+    if (list_head(&q->timers))
+    {
+        t = LIST_ENTRY(list_head(&q->timers), struct queue_timer, entry);
+        assert(!t->destroy || t->expire == EXPIRE_NEVER);
+
+        if (t->expire != EXPIRE_NEVER)
+        {
+            ULONGLONG time = queue_current_time();
+            timeout = t->expire < time ? 0 : t->expire - time;
+        }
+    }
+    RtlLeaveCriticalSection(&q->cs);
+
+    return timeout;
+}
+
+static void WINAPI timer_queue_thread_proc(LPVOID p)
+{
+    struct timer_queue *q = p;
+    ULONG timeout_ms;
+
+    timeout_ms = INFINITE;
+    for (;;)
+    {
+        LARGE_INTEGER timeout;
+        NTSTATUS status;
+        BOOL done = FALSE;
+
+        status = NtWaitForSingleObject(
+            q->event, FALSE, get_nt_timeout(&timeout, timeout_ms));
+
+        if (status == STATUS_WAIT_0)
+        {
+            /* There are two possible ways to trigger the event.  Either
+               we are quitting and the last timer got removed, or a new
+               timer got put at the head of the list so we need to adjust
+               our timeout.  */
+            RtlEnterCriticalSection(&q->cs);
+            if (q->quit && list_empty(&q->timers))
+                done = TRUE;
+            RtlLeaveCriticalSection(&q->cs);
+        }
+        else if (status == STATUS_TIMEOUT)
+            queue_timer_expire(q);
+
+        if (done)
+            break;
+
+        timeout_ms = queue_get_timeout(q);
+    }
+
+    NtClose(q->event);
+    RtlDeleteCriticalSection(&q->cs);
+    q->magic = 0;
+    RtlFreeHeap(GetProcessHeap(), 0, q);
+}
+
+static void queue_destroy_timer(struct queue_timer *t)
+{
+    /* We MUST hold the queue cs while calling this function.  */
+    t->destroy = TRUE;
+    if (t->runcount == 0)
+        /* Ensure a timer is promptly removed.  If callbacks are pending,
+           it will be removed after the last one finishes by the callback
+           cleanup wrapper.  */
+        queue_remove_timer(t);
+    else
+        /* Make sure no destroyed timer masks an active timer at the head
+           of the sorted list.  */
+        queue_move_timer(t, EXPIRE_NEVER, FALSE);
+}
+
+/***********************************************************************
+ *              RtlCreateTimerQueue   (NTDLL.@)
+ *
+ * Creates a timer queue object and returns a handle to it.
+ *
+ * PARAMS
+ *  NewTimerQueue [O] The newly created queue.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlCreateTimerQueue(PHANDLE NewTimerQueue)
+{
+    NTSTATUS status;
+    struct timer_queue *q = RtlAllocateHeap(GetProcessHeap(), 0, sizeof *q);
+    if (!q)
+        return STATUS_NO_MEMORY;
+
+    RtlInitializeCriticalSection(&q->cs);
+    list_init(&q->timers);
+    q->quit = FALSE;
+    q->magic = TIMER_QUEUE_MAGIC;
+    status = NtCreateEvent(&q->event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
+    if (status != STATUS_SUCCESS)
+    {
+        RtlFreeHeap(GetProcessHeap(), 0, q);
+        return status;
+    }
+    status = RtlCreateUserThread(GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                 timer_queue_thread_proc, q, &q->thread, NULL);
+    if (status != STATUS_SUCCESS)
+    {
+        NtClose(q->event);
+        RtlFreeHeap(GetProcessHeap(), 0, q);
+        return status;
+    }
+
+    *NewTimerQueue = q;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *              RtlDeleteTimerQueueEx   (NTDLL.@)
+ *
+ * Deletes a timer queue object.
+ *
+ * PARAMS
+ *  TimerQueue      [I] The timer queue to destroy.
+ *  CompletionEvent [I] If NULL, return immediately.  If INVALID_HANDLE_VALUE,
+ *                      wait until all timers are finished firing before
+ *                      returning.  Otherwise, return immediately and set the
+ *                      event when all timers are done.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS if synchronous, STATUS_PENDING if not.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlDeleteTimerQueueEx(HANDLE TimerQueue, HANDLE CompletionEvent)
+{
+    struct timer_queue *q = TimerQueue;
+    struct queue_timer *t, *temp;
+    HANDLE thread;
+    NTSTATUS status;
+
+    if (!q || q->magic != TIMER_QUEUE_MAGIC)
+        return STATUS_INVALID_HANDLE;
+
+    thread = q->thread;
+
+    RtlEnterCriticalSection(&q->cs);
+    q->quit = TRUE;
+    if (list_head(&q->timers))
+        /* When the last timer is removed, it will signal the timer thread to
+           exit...  */
+        LIST_FOR_EACH_ENTRY_SAFE(t, temp, &q->timers, struct queue_timer, entry)
+            queue_destroy_timer(t);
+    else
+        /* However if we have none, we must do it ourselves.  */
+        NtSetEvent(q->event, NULL);
+    RtlLeaveCriticalSection(&q->cs);
+
+    if (CompletionEvent == INVALID_HANDLE_VALUE)
+    {
+        NtWaitForSingleObject(thread, FALSE, NULL);
+        status = STATUS_SUCCESS;
+    }
+    else
+    {
+        if (CompletionEvent)
+        {
+            FIXME("asynchronous return on completion event unimplemented\n");
+            NtWaitForSingleObject(thread, FALSE, NULL);
+            NtSetEvent(CompletionEvent, NULL);
+        }
+        status = STATUS_PENDING;
+    }
+
+    NtClose(thread);
+    return status;
+}
+
+static struct timer_queue *default_timer_queue;
+
+static struct timer_queue *get_timer_queue(HANDLE TimerQueue)
+{
+    if (TimerQueue)
+        return TimerQueue;
+    else
+    {
+        if (!default_timer_queue)
+        {
+            HANDLE q;
+            NTSTATUS status = RtlCreateTimerQueue(&q);
+            if (status == STATUS_SUCCESS)
+            {
+                PVOID p = interlocked_cmpxchg_ptr(
+                    (void **) &default_timer_queue, q, NULL);
+                if (p)
+                    /* Got beat to the punch.  */
+                    RtlDeleteTimerQueueEx(q, NULL);
+            }
+        }
+        return default_timer_queue;
+    }
+}
+
+/***********************************************************************
+ *              RtlCreateTimer   (NTDLL.@)
+ *
+ * Creates a new timer associated with the given queue.
+ *
+ * PARAMS
+ *  NewTimer   [O] The newly created timer.
+ *  TimerQueue [I] The queue to hold the timer.
+ *  Callback   [I] The callback to fire.
+ *  Parameter  [I] The argument for the callback.
+ *  DueTime    [I] The delay, in milliseconds, before first firing the
+ *                 timer.
+ *  Period     [I] The period, in milliseconds, at which to fire the timer
+ *                 after the first callback.  If zero, the timer will only
+ *                 fire once.  It still needs to be deleted with
+ *                 RtlDeleteTimer.
+ * Flags       [I] Flags controlling the execution of the callback.  In
+ *                 addition to the WT_* thread pool flags (see
+ *                 RtlQueueWorkItem), WT_EXECUTEINTIMERTHREAD and
+ *                 WT_EXECUTEONLYONCE are supported.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlCreateTimer(PHANDLE NewTimer, HANDLE TimerQueue,
+                               RTL_WAITORTIMERCALLBACKFUNC Callback,
+                               PVOID Parameter, DWORD DueTime, DWORD Period,
+                               ULONG Flags)
+{
+    NTSTATUS status;
+    struct queue_timer *t;
+    struct timer_queue *q = get_timer_queue(TimerQueue);
+
+    if (!q) return STATUS_NO_MEMORY;
+    if (q->magic != TIMER_QUEUE_MAGIC) return STATUS_INVALID_HANDLE;
+
+    t = RtlAllocateHeap(GetProcessHeap(), 0, sizeof *t);
+    if (!t)
+        return STATUS_NO_MEMORY;
+
+    t->q = q;
+    t->runcount = 0;
+    t->callback = Callback;
+    t->param = Parameter;
+    t->period = Period;
+    t->flags = Flags;
+    t->destroy = FALSE;
+    t->event = NULL;
+
+    status = STATUS_SUCCESS;
+    RtlEnterCriticalSection(&q->cs);
+    if (q->quit)
+        status = STATUS_INVALID_HANDLE;
+    else
+        queue_add_timer(t, queue_current_time() + DueTime, TRUE);
+    RtlLeaveCriticalSection(&q->cs);
+
+    if (status == STATUS_SUCCESS)
+        *NewTimer = t;
+    else
+        RtlFreeHeap(GetProcessHeap(), 0, t);
+
+    return status;
+}
+
+/***********************************************************************
+ *              RtlUpdateTimer   (NTDLL.@)
+ *
+ * Changes the time at which a timer expires.
+ *
+ * PARAMS
+ *  TimerQueue [I] The queue that holds the timer.
+ *  Timer      [I] The timer to update.
+ *  DueTime    [I] The delay, in milliseconds, before next firing the timer.
+ *  Period     [I] The period, in milliseconds, at which to fire the timer
+ *                 after the first callback.  If zero, the timer will not
+ *                 refire once.  It still needs to be deleted with
+ *                 RtlDeleteTimer.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlUpdateTimer(HANDLE TimerQueue, HANDLE Timer,
+                               DWORD DueTime, DWORD Period)
+{
+    struct queue_timer *t = Timer;
+    struct timer_queue *q = t->q;
+
+    RtlEnterCriticalSection(&q->cs);
+    /* Can't change a timer if it was once-only or destroyed.  */
+    if (t->expire != EXPIRE_NEVER)
+    {
+        t->period = Period;
+        queue_move_timer(t, queue_current_time() + DueTime, TRUE);
+    }
+    RtlLeaveCriticalSection(&q->cs);
+
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *              RtlDeleteTimer   (NTDLL.@)
+ *
+ * Cancels a timer-queue timer.
+ *
+ * PARAMS
+ *  TimerQueue      [I] The queue that holds the timer.
+ *  Timer           [I] The timer to update.
+ *  CompletionEvent [I] If NULL, return immediately.  If INVALID_HANDLE_VALUE,
+ *                      wait until the timer is finished firing all pending
+ *                      callbacks before returning.  Otherwise, return
+ *                      immediately and set the timer is done.
+ *
+ * RETURNS
+ *  Success: STATUS_SUCCESS if the timer is done, STATUS_PENDING if not,
+             or if the completion event is NULL.
+ *  Failure: Any NTSTATUS code.
+ */
+NTSTATUS WINAPI RtlDeleteTimer(HANDLE TimerQueue, HANDLE Timer,
+                               HANDLE CompletionEvent)
+{
+    struct queue_timer *t = Timer;
+    struct timer_queue *q;
+    NTSTATUS status = STATUS_PENDING;
+    HANDLE event = NULL;
+
+    if (!Timer)
+        return STATUS_INVALID_PARAMETER_1;
+    q = t->q;
+    if (CompletionEvent == INVALID_HANDLE_VALUE)
+    {
+        status = NtCreateEvent(&event, EVENT_ALL_ACCESS, NULL, SynchronizationEvent, FALSE);
+        if (status == STATUS_SUCCESS)
+            status = STATUS_PENDING;
+    }
+    else if (CompletionEvent)
+        event = CompletionEvent;
+
+    RtlEnterCriticalSection(&q->cs);
+    t->event = event;
+    if (t->runcount == 0 && event)
+        status = STATUS_SUCCESS;
+    queue_destroy_timer(t);
+    RtlLeaveCriticalSection(&q->cs);
+
+    if (CompletionEvent == INVALID_HANDLE_VALUE && event)
+    {
+        if (status == STATUS_PENDING)
+        {
+            NtWaitForSingleObject(event, FALSE, NULL);
+            status = STATUS_SUCCESS;
+        }
+        NtClose(event);
+    }
+
+    return status;
+}
+
+
+/************************** Vista thread pool API **************************/
+
+/***********************************************************************
+ *           TpAllocPool    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocPool( TP_POOL **out, PVOID reserved )
+{
+    TRACE( "%p %p\n", out, reserved );
+
+    if (reserved) FIXME( "reserved argument is nonzero (%p)\n", reserved );
+
+    return tp_pool_alloc( (struct threadpool **)out );
+}
+
+/***********************************************************************
+ *           TpReleasePool    (NTDLL.@)
+ */
+VOID WINAPI TpReleasePool( TP_POOL *pool )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+
+    TRACE( "%p\n", pool );
+
+    tp_pool_release( this );
+}
+
+/***********************************************************************
+ *           TpSetPoolMaxThreads    (NTDLL.@)
+ */
+VOID WINAPI TpSetPoolMaxThreads( TP_POOL *pool, DWORD maximum )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+
+    TRACE( "%p %u\n", pool, maximum );
+
+    RtlEnterCriticalSection( &this->cs );
+    this->max_workers = max( maximum, 1 );
+    this->min_workers = min( this->min_workers, this->max_workers );
+    RtlLeaveCriticalSection( &this->cs );
+}
+
+/***********************************************************************
+ *           TpSetPoolMinThreads    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpSetPoolMinThreads( TP_POOL *pool, DWORD minimum )
+{
+    struct threadpool *this = impl_from_TP_POOL( pool );
+    NTSTATUS status = STATUS_SUCCESS;
+
+    TRACE( "%p %u\n", pool, minimum );
+
+    RtlEnterCriticalSection( &this->cs );
+    while (this->num_workers < minimum && !status)
+        status = tp_pool_add_worker( this );
+    if (!status)
+    {
+        this->min_workers = minimum;
+        this->max_workers = max( this->min_workers, this->max_workers );
+    }
+    RtlLeaveCriticalSection( &this->cs );
+    return status;
+}
+
+/***********************************************************************
+ *           TpAllocCleanupGroup    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocCleanupGroup( TP_CLEANUP_GROUP **out )
+{
+    struct threadpool_group *group;
+
+    TRACE( "%p\n", out );
+
+    if (!out) return STATUS_ACCESS_VIOLATION;
+    if (!(group = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*group) ))) return STATUS_NO_MEMORY;
+
+    group->refcount = 1;
+    RtlInitializeCriticalSection( &group->cs );
+    group->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": threadpool_group.cs");
+    list_init( &group->members );
+
+    *out = (TP_CLEANUP_GROUP *)group;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpReleaseCleanupGroupMembers    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseCleanupGroupMembers( TP_CLEANUP_GROUP *group, BOOL cancel_pending, PVOID userdata )
+{
+    struct threadpool_group *this = impl_from_TP_CLEANUP_GROUP( group );
+    struct threadpool_object *object, *next;
+    struct list members = LIST_INIT( members );
+
+    TRACE( "%p %u %p\n", group, cancel_pending, userdata );
+
+    /* take over the members that weren't already closed by their creator */
+    RtlEnterCriticalSection( &this->cs );
+    LIST_FOR_EACH_ENTRY_SAFE( object, next, &this->members, struct threadpool_object, group_entry )
+    {
+        list_remove( &object->group_entry );
+        object->is_group_member = FALSE;
+        interlocked_dec( &this->refcount );
+        if (!interlocked_xchg( &object->released, TRUE ))
+            list_add_tail( &members, &object->group_entry );
+    }
+    RtlLeaveCriticalSection( &this->cs );
+
+    LIST_FOR_EACH_ENTRY_SAFE( object, next, &members, struct threadpool_object, group_entry )
+    {
+        LONG cancelled = 0;
+
+        tp_object_shutdown( object );
+        if (cancel_pending) cancelled = tp_object_cancel( object );
+        tp_object_wait( object );
+        if (cancelled && object->group_cancel_callback)
+        {
+            TRACE( "executing group cancel callback %p(%p, %p)\n",
+                   object->group_cancel_callback, object->userdata, userdata );
+            object->group_cancel_callback( object->userdata, userdata );
+        }
+        tp_object_release( object );
+    }
+}
+
+/***********************************************************************
+ *           TpReleaseCleanupGroup    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseCleanupGroup( TP_CLEANUP_GROUP *group )
+{
+    struct threadpool_group *this = impl_from_TP_CLEANUP_GROUP( group );
+
+    TRACE( "%p\n", group );
+
+    tp_group_release( this );
+}
+
+/***********************************************************************
+ *           TpSimpleTryPost    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpSimpleTryPost( PTP_SIMPLE_CALLBACK callback, PVOID userdata,
+                                 TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", callback, userdata, environment );
+
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_SIMPLE ))) return STATUS_NO_MEMORY;
+    object->u.simple.callback = callback;
+    if ((status = tp_object_initialize( object, userdata, environment )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    if ((status = tp_object_submit( object, 0 ))) tp_object_close( object );
+    return status;
+}
+
+/***********************************************************************
+ *           TpAllocWork    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocWork( TP_WORK **out, PTP_WORK_CALLBACK callback, PVOID userdata,
+                             TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_WORK ))) return STATUS_NO_MEMORY;
+    object->u.work.callback = callback;
+    if ((status = tp_object_initialize( object, userdata, environment )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    *out = (TP_WORK *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpPostWork    (NTDLL.@)
+ */
+VOID WINAPI TpPostWork( TP_WORK *work )
+{
+    struct threadpool_object *this = impl_from_TP_WORK( work );
+    NTSTATUS status;
+
+    TRACE( "%p\n", work );
+
+    if ((status = tp_object_submit( this, 0 ))) ERR( "failed to submit %p: %08x\n", work, status );
+}
+
+/***********************************************************************
+ *           TpWaitForWork    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForWork( TP_WORK *work, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_WORK( work );
+
+    TRACE( "%p %u\n", work, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseWork    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseWork( TP_WORK *work )
+{
+    struct threadpool_object *this = impl_from_TP_WORK( work );
+
+    TRACE( "%p\n", work );
+
+    tp_object_close( this );
+}
+
+/* convert a thread pool timeout to a relative timeout in milliseconds */
+static DWORD get_relative_timeout( const LARGE_INTEGER *timeout )
+{
+    LARGE_INTEGER now;
+    LONGLONG diff = -timeout->QuadPart;
+
+    if (timeout->QuadPart > 0)
+    {
+        NtQuerySystemTime( &now );
+        diff = timeout->QuadPart - now.QuadPart;
+    }
+    if (diff <= 0) return 0;
+    diff = (diff + 9999) / 10000;
+    return diff >= INFINITE ? INFINITE - 1 : diff;
+}
+
+static void CALLBACK tp_timer_expired( void *param, BOOLEAN fired )
+{
+    struct threadpool_object *object = param;
+    NTSTATUS status;
+
+    if (!object->u.timer.period) object->u.timer.set = FALSE;
+    if ((status = tp_object_submit( object, 0 ))) ERR( "failed to submit %p: %08x\n", object, status );
+}
+
+/***********************************************************************
+ *           TpAllocTimer    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocTimer( TP_TIMER **out, PTP_TIMER_CALLBACK callback, PVOID userdata,
+                              TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_TIMER ))) return STATUS_NO_MEMORY;
+    object->u.timer.callback = callback;
+    if ((status = tp_object_initialize( object, userdata, environment )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    *out = (TP_TIMER *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpSetTimer    (NTDLL.@)
+ */
+VOID WINAPI TpSetTimer( TP_TIMER *timer, LARGE_INTEGER *timeout, LONG period, LONG window_length )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+    NTSTATUS status;
+
+    TRACE( "%p %p %u %u\n", timer, timeout, period, window_length );
+
+    RtlEnterCriticalSection( &threadpool_objects_cs );
+
+    tp_object_remove_trigger( this );
+
+    /* the window length only allows to coalesce timers, ignore it */
+    this->u.timer.period = period;
+    this->u.timer.set = timeout != NULL;
+    if (timeout && (status = RtlCreateTimer( &this->u.timer.timer, NULL, tp_timer_expired, this,
+                                             get_relative_timeout( timeout ), period,
+                                             WT_EXECUTEINTIMERTHREAD )))
+    {
+        ERR( "failed to set timer %p: %08x\n", timer, status );
+        this->u.timer.timer = NULL;
+        this->u.timer.set = FALSE;
+    }
+
+    RtlLeaveCriticalSection( &threadpool_objects_cs );
+}
+
+/***********************************************************************
+ *           TpIsTimerSet    (NTDLL.@)
+ */
+BOOL WINAPI TpIsTimerSet( TP_TIMER *timer )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p\n", timer );
+
+    return this->u.timer.set;
+}
+
+/***********************************************************************
+ *           TpWaitForTimer    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForTimer( TP_TIMER *timer, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p %u\n", timer, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseTimer    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseTimer( TP_TIMER *timer )
+{
+    struct threadpool_object *this = impl_from_TP_TIMER( timer );
+
+    TRACE( "%p\n", timer );
+
+    tp_object_shutdown( this );
+    tp_object_close( this );
+}
+
+static void CALLBACK tp_wait_signaled( void *param, BOOLEAN timed_out )
+{
+    struct threadpool_object *object = param;
+    NTSTATUS status;
+
+    if ((status = tp_object_submit( object, timed_out ? WAIT_TIMEOUT : WAIT_OBJECT_0 )))
+        ERR( "failed to submit %p: %08x\n", object, status );
+}
+
+/***********************************************************************
+ *           TpAllocWait    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocWait( TP_WAIT **out, PTP_WAIT_CALLBACK callback, PVOID userdata,
+                             TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    NTSTATUS status;
+
+    TRACE( "%p %p %p %p\n", out, callback, userdata, environment );
+
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_WAIT ))) return STATUS_NO_MEMORY;
+    object->u.wait.callback = callback;
+    if ((status = tp_object_initialize( object, userdata, environment )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    *out = (TP_WAIT *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpSetWait    (NTDLL.@)
+ */
+VOID WINAPI TpSetWait( TP_WAIT *wait, HANDLE handle, LARGE_INTEGER *timeout )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+    NTSTATUS status;
+
+    TRACE( "%p %p %p\n", wait, handle, timeout );
+
+    RtlEnterCriticalSection( &threadpool_objects_cs );
+
+    tp_object_remove_trigger( this );
+
+    if (handle && (status = RtlRegisterWait( &this->u.wait.wait, handle, tp_wait_signaled, this,
+                                             timeout ? get_relative_timeout( timeout ) : INFINITE,
+                                             WT_EXECUTEONLYONCE | WT_EXECUTEINWAITTHREAD )))
+    {
+        ERR( "failed to register wait %p: %08x\n", wait, status );
+        this->u.wait.wait = NULL;
+    }
+
+    RtlLeaveCriticalSection( &threadpool_objects_cs );
+}
+
+/***********************************************************************
+ *           TpWaitForWait    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForWait( TP_WAIT *wait, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+
+    TRACE( "%p %u\n", wait, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseWait    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseWait( TP_WAIT *wait )
+{
+    struct threadpool_object *this = impl_from_TP_WAIT( wait );
+
+    TRACE( "%p\n", wait );
+
+    tp_object_shutdown( this );
+    tp_object_close( this );
+}
+
+static DWORD CALLBACK tp_io_poller( void *param )
+{
+    struct threadpool_completion *completion;
+    struct threadpool_object *object;
+    IO_STATUS_BLOCK iosb;
+    ULONG_PTR key, cvalue;
+    NTSTATUS status;
+
+    for (;;)
+    {
+        if ((status = NtRemoveIoCompletion( threadpool_io_port, &key, &cvalue, &iosb, NULL )))
+        {
+            ERR( "NtRemoveIoCompletion failed: %08x\n", status );
+            continue;
+        }
+
+        /* each started operation holds a reference, released once its completion is queued */
+        object = (struct threadpool_object *)key;
+        if (interlocked_dec( &object->u.io.pending ) < 0)
+        {
+            ERR( "unexpected completion for %p, StartThreadpoolIo wasn't called\n", object );
+            interlocked_inc( &object->u.io.pending );
+            continue;
+        }
+        if (object->u.io.shutdown)
+            WARN( "ignoring completion for closed I/O object %p\n", object );
+        else if (!(completion = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*completion) )))
+            ERR( "out of memory, completion for %p lost\n", object );
+        else
+        {
+            completion->cvalue = cvalue;
+            completion->iosb = iosb;
+            if (tp_object_submit( object, (ULONG_PTR)completion ))
+                RtlFreeHeap( GetProcessHeap(), 0, completion );
+        }
+        tp_object_release( object );
+    }
+    return 0;
+}
+
+/***********************************************************************
+ *           TpAllocIoCompletion    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpAllocIoCompletion( TP_IO **out, HANDLE file, PTP_IO_CALLBACK callback, PVOID userdata,
+                                     TP_CALLBACK_ENVIRON *environment )
+{
+    struct threadpool_object *object;
+    FILE_COMPLETION_INFORMATION info;
+    IO_STATUS_BLOCK iosb;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    TRACE( "%p %p %p %p %p\n", out, file, callback, userdata, environment );
+
+    if (!threadpool_io_port)
+    {
+        RtlEnterCriticalSection( &threadpool_compl_cs );
+        if (!threadpool_io_port)
+        {
+            HANDLE port, thread;
+
+            if (!(status = NtCreateIoCompletion( &port, IO_COMPLETION_ALL_ACCESS, NULL, 0 )))
+            {
+                status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, NULL, 0, 0,
+                                              (PRTL_THREAD_START_ROUTINE)tp_io_poller, NULL, &thread, NULL );
+                if (!status)
+                {
+                    NtClose( thread );
+                    threadpool_io_port = port;
+                }
+                else NtClose( port );
+            }
+        }
+        RtlLeaveCriticalSection( &threadpool_compl_cs );
+        if (status) return status;
+    }
+
+    if (!(object = tp_object_alloc( TP_OBJECT_TYPE_IO ))) return STATUS_NO_MEMORY;
+    object->u.io.callback = callback;
+
+    info.CompletionPort = threadpool_io_port;
+    info.CompletionKey = (ULONG_PTR)object;
+    if ((status = NtSetInformationFile( file, &iosb, &info, sizeof(info), FileCompletionInformation )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    if ((status = tp_object_initialize( object, userdata, environment )))
+    {
+        tp_object_free( object );
+        return status;
+    }
+
+    *out = (TP_IO *)object;
+    return STATUS_SUCCESS;
+}
+
+/***********************************************************************
+ *           TpStartAsyncIoOperation    (NTDLL.@)
+ */
+VOID WINAPI TpStartAsyncIoOperation( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    interlocked_inc( &this->refcount );
+    interlocked_inc( &this->u.io.pending );
+}
+
+/***********************************************************************
+ *           TpCancelAsyncIoOperation    (NTDLL.@)
+ */
+VOID WINAPI TpCancelAsyncIoOperation( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    if (interlocked_dec( &this->u.io.pending ) < 0)
+    {
+        interlocked_inc( &this->u.io.pending );
+        return;
+    }
+    tp_object_release( this );
+}
+
+/***********************************************************************
+ *           TpWaitForIoCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpWaitForIoCompletion( TP_IO *io, BOOL cancel_pending )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p %u\n", io, cancel_pending );
+
+    if (cancel_pending) tp_object_cancel( this );
+    tp_object_wait( this );
+}
+
+/***********************************************************************
+ *           TpReleaseIoCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpReleaseIoCompletion( TP_IO *io )
+{
+    struct threadpool_object *this = impl_from_TP_IO( io );
+
+    TRACE( "%p\n", io );
+
+    if (this->u.io.pending) WARN( "%p still has %d pending operations\n", io, this->u.io.pending );
+    tp_object_shutdown( this );
+    tp_object_close( this );
+}
+
+/***********************************************************************
+ *           TpCallbackMayRunLong    (NTDLL.@)
+ */
+NTSTATUS WINAPI TpCallbackMayRunLong( TP_CALLBACK_INSTANCE *instance )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+    struct threadpool *pool = this->object->pool;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    TRACE( "%p\n", instance );
+
+    if (this->threadid != GetCurrentThreadId())
+    {
+        ERR( "called from wrong thread, ignoring\n" );
+        return STATUS_UNSUCCESSFUL;
+    }
+    if (this->may_run_long) return STATUS_SUCCESS;
+
+    /* this worker no longer counts as running short callbacks, replace it if needed */
+    this->may_run_long = TRUE;
+    interlocked_inc( &pool->num_long );
+
+    RtlEnterCriticalSection( &pool->cs );
+    if (!pool->num_idle && tp_pool_has_work( pool ))
+    {
+        if (pool->num_workers < pool->max_workers) status = tp_pool_add_worker( pool );
+        else status = STATUS_TOO_MANY_THREADS;
+    }
+    RtlLeaveCriticalSection( &pool->cs );
+    return status;
+}
+
+/***********************************************************************
+ *           TpDisassociateCallback    (NTDLL.@)
+ */
+VOID WINAPI TpDisassociateCallback( TP_CALLBACK_INSTANCE *instance )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p\n", instance );
+
+    if (this->threadid != GetCurrentThreadId())
+    {
+        ERR( "called from wrong thread, ignoring\n" );
+        return;
+    }
+    if (!this->associated) return;
+
+    this->associated = FALSE;
+    tp_object_finished( this->object );
+}
+
+/***********************************************************************
+ *           TpCallbackSetEventOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackSetEventOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE event )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, event );
+
+    if (!this->cleanup.event) this->cleanup.event = event;
+}
+
+/***********************************************************************
+ *           TpCallbackReleaseSemaphoreOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackReleaseSemaphoreOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE semaphore,
+                                                    DWORD count )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p %u\n", instance, semaphore, count );
+
+    if (!this->cleanup.semaphore)
+    {
+        this->cleanup.semaphore = semaphore;
+        this->cleanup.semaphore_count = count;
+    }
+}
+
+/***********************************************************************
+ *           TpCallbackReleaseMutexOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackReleaseMutexOnCompletion( TP_CALLBACK_INSTANCE *instance, HANDLE mutex )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, mutex );
+
+    if (!this->cleanup.mutex) this->cleanup.mutex = mutex;
+}
+
+/***********************************************************************
+ *           TpCallbackLeaveCriticalSectionOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackLeaveCriticalSectionOnCompletion( TP_CALLBACK_INSTANCE *instance,
+                                                        RTL_CRITICAL_SECTION *crit )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, crit );
+
+    if (!this->cleanup.critical_section) this->cleanup.critical_section = crit;
+}
+
+/***********************************************************************
+ *           TpCallbackUnloadDllOnCompletion    (NTDLL.@)
+ */
+VOID WINAPI TpCallbackUnloadDllOnCompletion( TP_CALLBACK_INSTANCE *instance, HMODULE module )
+{
+    struct threadpool_instance *this = impl_from_TP_CALLBACK_INSTANCE( instance );
+
+    TRACE( "%p %p\n", instance, module );
+
+    if (!this->cleanup.library) this->cleanup.library = module;
+}
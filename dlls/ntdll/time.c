@@ -569,24 +569,13 @@ static BOOL match_tz_info(const RTL_TIME_ZONE_INFORMATION *tzi, const RTL_TIME_Z
     return FALSE;
 }
 
-static BOOL reg_query_value(HKEY hkey, LPCWSTR name, DWORD type, void *data, DWORD count)
+static BOOL get_query_value(const struct key_value_query *query, DWORD type, void *data, DWORD count)
 {
-    UNICODE_STRING nameW;
-    char buf[256];
-    KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)buf;
-
-    if (count > sizeof(buf) - sizeof(KEY_VALUE_PARTIAL_INFORMATION))
-        return FALSE;
-
-    RtlInitUnicodeString(&nameW, name);
-
-    if (NtQueryValueKey(hkey, &nameW, KeyValuePartialInformation,
-                        buf, sizeof(buf), &count))
-        return FALSE;
-
-    if (info->Type != type) return FALSE;
+    if (query->status) return FALSE;
+    if (query->info->Type != type) return FALSE;
+    if (query->info->DataLength > count) return FALSE;
 
-    memcpy(data, info->Data, info->DataLength);
+    memcpy(data, query->info->Data, query->info->DataLength);
     return TRUE;
 }
 
@@ -628,7 +617,9 @@ static void find_reg_tz_info(RTL_TIME_ZONE_INFORMATION *tzi)
         static const WCHAR dltW[] = { 'D','l','t',0 };
         static const WCHAR tziW[] = { 'T','Z','I',0 };
         RTL_TIME_ZONE_INFORMATION reg_tzi;
-        HANDLE hSubkey;
+        struct key_value_query queries[3];
+        char value_buf[3][256];
+        unsigned int i;
         struct tz_reg_data
         {
             LONG bias;
@@ -644,23 +635,33 @@ static void find_reg_tz_info(RTL_TIME_ZONE_INFORMATION *tzi)
         attr.Attributes = 0;
         attr.SecurityDescriptor = NULL;
         attr.SecurityQualityOfService = NULL;
-        if (NtOpenKey(&hSubkey, KEY_READ, &attr))
+
+        queries[0].name = stdW;
+        queries[1].name = dltW;
+        queries[2].name = tziW;
+        for (i = 0; i < 3; i++)
+        {
+            queries[i].info = (KEY_VALUE_PARTIAL_INFORMATION *)value_buf[i];
+            queries[i].length = sizeof(value_buf[i]);
+        }
+
+        /* open the subkey, read its values and close it in a single server call */
+        if (query_key_values(&attr, queries, 3))
         {
             WARN("Unable to open subkey %s\n", debugstr_wn(nameW.Buffer, nameW.Length/sizeof(WCHAR)));
             continue;
         }
 
-#define get_value(hkey, name, type, data, len) \
-    if (!reg_query_value(hkey, name, type, data, len)) \
+#define get_value(query, type, data, len) \
+    if (!get_query_value(query, type, data, len)) \
     { \
-        WARN("can't read data from %s\n", debugstr_w(name)); \
-        NtClose(hkey); \
+        WARN("can't read data from %s\n", debugstr_w((query)->name)); \
         continue; \
     }
 
-        get_value(hSubkey, stdW, REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName));
-        get_value(hSubkey, dltW, REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName));
-        get_value(hSubkey, tziW, REG_BINARY, &tz_data, sizeof(tz_data));
+        get_value(&queries[0], REG_SZ, reg_tzi.StandardName, sizeof(reg_tzi.StandardName));
+        get_value(&queries[1], REG_SZ, reg_tzi.DaylightName, sizeof(reg_tzi.DaylightName));
+        get_value(&queries[2], REG_BINARY, &tz_data, sizeof(tz_data));
 
 #undef get_value
 
@@ -684,8 +685,6 @@ static void find_reg_tz_info(RTL_TIME_ZONE_INFORMATION *tzi)
             reg_tzi.DaylightDate.wSecond, reg_tzi.DaylightDate.wMilliseconds,
             reg_tzi.DaylightBias);
 
-        NtClose(hSubkey);
-
         if (match_tz_info(tzi, &reg_tzi))
         {
             *tzi = reg_tzi;
@@ -238,11 +238,12 @@ static BOOL get_nt_registry_version( RTL_OSVERSIONINFOEXW *version )
 
     OBJECT_ATTRIBUTES attr;
     UNICODE_STRING nameW, valueW;
-    HANDLE hkey, hkey2;
+    HANDLE hkey;
     char tmp[64];
     DWORD count;
     BOOL ret = FALSE;
     KEY_VALUE_PARTIAL_INFORMATION *info = (KEY_VALUE_PARTIAL_INFORMATION *)tmp;
+    struct key_value_query query;
 
     attr.Length = sizeof(attr);
     attr.RootDirectory = 0;
@@ -298,36 +299,32 @@ static BOOL get_nt_registry_version( RTL_OSVERSIONINFOEXW *version )
         /* get service pack version */
 
         RtlInitUnicodeString( &nameW, service_pack_keyW );
-        if (!NtOpenKey( &hkey2, KEY_ALL_ACCESS, &attr ))
+        query.name   = CSDVersionW;
+        query.info   = info;
+        query.length = sizeof(tmp);
+        if (!query_key_values( &attr, &query, 1 ) && !query.status)
         {
-            RtlInitUnicodeString( &valueW, CSDVersionW );
-            if (!NtQueryValueKey( hkey2, &valueW, KeyValuePartialInformation, tmp, sizeof(tmp), &count ))
+            if (info->DataLength >= sizeof(DWORD))
             {
-                if (info->DataLength >= sizeof(DWORD))
-                {
-                    DWORD dw = *(DWORD *)info->Data;
-                    version->wServicePackMajor = LOWORD(dw) >> 8;
-                    version->wServicePackMinor = LOWORD(dw) & 0xff;
-                }
+                DWORD dw = *(DWORD *)info->Data;
+                version->wServicePackMajor = LOWORD(dw) >> 8;
+                version->wServicePackMinor = LOWORD(dw) & 0xff;
             }
-            NtClose( hkey2 );
         }
 
         /* get product type */
 
         RtlInitUnicodeString( &nameW, product_keyW );
-        if (!NtOpenKey( &hkey2, KEY_ALL_ACCESS, &attr ))
+        query.name   = ProductTypeW;
+        query.info   = info;
+        query.length = sizeof(tmp) - 1;
+        if (!query_key_values( &attr, &query, 1 ) && !query.status)
         {
-            RtlInitUnicodeString( &valueW, ProductTypeW );
-            if (!NtQueryValueKey( hkey2, &valueW, KeyValuePartialInformation, tmp, sizeof(tmp)-1, &count ))
-            {
-                WCHAR *str = (WCHAR *)info->Data;
-                str[info->DataLength / sizeof(WCHAR)] = 0;
-                if (!strcmpiW( str, WinNTW )) version->wProductType = VER_NT_WORKSTATION;
-                else if (!strcmpiW( str, LanmanNTW )) version->wProductType = VER_NT_DOMAIN_CONTROLLER;
-                else if (!strcmpiW( str, ServerNTW )) version->wProductType = VER_NT_SERVER;
-            }
-            NtClose( hkey2 );
+            WCHAR *str = (WCHAR *)info->Data;
+            str[info->DataLength / sizeof(WCHAR)] = 0;
+            if (!strcmpiW( str, WinNTW )) version->wProductType = VER_NT_WORKSTATION;
+            else if (!strcmpiW( str, LanmanNTW )) version->wProductType = VER_NT_DOMAIN_CONTROLLER;
+            else if (!strcmpiW( str, ServerNTW )) version->wProductType = VER_NT_SERVER;
         }
 
         /* FIXME: get wSuiteMask */
@@ -52,6 +52,7 @@
 #include "wine/server.h"
 #include "wine/exception.h"
 #include "wine/list.h"
+#include "wine/rbtree.h"
 #include "wine/debug.h"
 #include "ntdll_misc.h"
 
@@ -66,8 +67,12 @@ WINE_DECLARE_DEBUG_CHANNEL(module);
 struct file_view
 {
     struct list   entry;       /* Entry in global view list */
+    struct wine_rb_entry tree_entry; /* Entry in global view tree */
+    struct list   free_entry;  /* Entry in free space list */
+    struct wine_rb_entry free_tree_entry; /* Entry in free space tree */
     void         *base;        /* Base address */
     size_t        size;        /* Size in bytes */
+    size_t        gap;         /* Free space between the previous view and this one */
     HANDLE        mapping;     /* Handle to the file mapping */
     unsigned int  map_protect; /* Mapping protection */
     unsigned int  protect;     /* Protection for all pages at allocation time */
@@ -98,6 +103,64 @@ static const BYTE VIRTUAL_Win32Flags[16] =
 
 static struct list views_list = LIST_INIT(views_list);
 
+/* views that have some free space before them, to skip densely packed areas */
+static struct list free_list = LIST_INIT(free_list);
+
+/* the view trees are needed before the heap exists, and their stack never grows
+ * beyond a few entries; it is only used while modifying a tree, so it can be shared */
+static struct wine_rb_entry **view_tree_stack[128];
+
+static void *view_tree_alloc( size_t size )
+{
+    return size <= sizeof(view_tree_stack) ? view_tree_stack : NULL;
+}
+
+static void *view_tree_realloc( void *ptr, size_t size )
+{
+    return size <= sizeof(view_tree_stack) ? view_tree_stack : NULL;
+}
+
+static void view_tree_free( void *ptr )
+{
+}
+
+static int compare_view( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct file_view *view = WINE_RB_ENTRY_VALUE( entry, const struct file_view, tree_entry );
+
+    if (addr < view->base) return -1;
+    if (addr > view->base) return 1;
+    return 0;
+}
+
+static int compare_free_view( const void *addr, const struct wine_rb_entry *entry )
+{
+    const struct file_view *view = WINE_RB_ENTRY_VALUE( entry, const struct file_view, free_tree_entry );
+
+    if (addr < view->base) return -1;
+    if (addr > view->base) return 1;
+    return 0;
+}
+
+static const struct wine_rb_functions view_tree_functions =
+{
+    view_tree_alloc,
+    view_tree_realloc,
+    view_tree_free,
+    compare_view
+};
+
+static const struct wine_rb_functions free_tree_functions =
+{
+    view_tree_alloc,
+    view_tree_realloc,
+    view_tree_free,
+    compare_free_view
+};
+
+static struct wine_rb_tree views_tree;
+static struct wine_rb_tree free_tree;
+
 static RTL_CRITICAL_SECTION csVirtual;
 static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 {
@@ -222,6 +285,103 @@ static void VIRTUAL_DumpView( struct file_view *view )
 }
 
 
+/***********************************************************************
+ *           find_view_below
+ *
+ * Find the last view starting at or below a given address.
+ * The csVirtual section must be held by caller.
+ */
+static struct file_view *find_view_below( const void *addr )
+{
+    struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view, *ret = NULL;
+
+    while (ptr)
+    {
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, tree_entry );
+        if (view->base > addr) ptr = ptr->left;
+        else
+        {
+            ret = view;
+            ptr = ptr->right;
+        }
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           next_view
+ *
+ * Return the view following a given one, or the first view if NULL.
+ */
+static inline struct file_view *next_view( struct file_view *view )
+{
+    struct list *ptr = view ? list_next( &views_list, &view->entry ) : list_head( &views_list );
+    return ptr ? LIST_ENTRY( ptr, struct file_view, entry ) : NULL;
+}
+
+
+/***********************************************************************
+ *           find_free_view_above
+ *
+ * Find the first view with free space before it starting above a given address.
+ */
+static struct file_view *find_free_view_above( const void *addr )
+{
+    struct wine_rb_entry *ptr = free_tree.root;
+    struct file_view *view, *ret = NULL;
+
+    while (ptr)
+    {
+        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, free_tree_entry );
+        if (view->base <= addr) ptr = ptr->right;
+        else
+        {
+            ret = view;
+            ptr = ptr->left;
+        }
+    }
+    return ret;
+}
+
+
+/***********************************************************************
+ *           update_view_gap
+ *
+ * Update the free space before a view after its neighbours changed.
+ */
+static void update_view_gap( struct file_view *view )
+{
+    struct list *ptr = list_prev( &views_list, &view->entry );
+    struct file_view *next;
+    char *prev_end = NULL;
+    size_t gap;
+
+    if (ptr)
+    {
+        struct file_view *prev = LIST_ENTRY( ptr, struct file_view, entry );
+        prev_end = (char *)prev->base + prev->size;
+    }
+    gap = (char *)view->base > prev_end ? (char *)view->base - prev_end : 0;
+
+    if (gap && !view->gap)
+    {
+        if ((next = find_free_view_above( view->base )))
+            list_add_before( &next->free_entry, &view->free_entry );
+        else
+            list_add_tail( &free_list, &view->free_entry );
+        wine_rb_put( &free_tree, view->base, &view->free_tree_entry );
+    }
+    else if (!gap && view->gap)
+    {
+        wine_rb_remove( &free_tree, view->base );
+        list_remove( &view->free_entry );
+    }
+    view->gap = gap;
+}
+
+
 /***********************************************************************
  *           VIRTUAL_Dump
  */
@@ -256,17 +416,13 @@ static void VIRTUAL_Dump(void)
  */
 static struct file_view *VIRTUAL_FindView( const void *addr, size_t size )
 {
-    struct file_view *view;
+    struct file_view *view = find_view_below( addr );
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if (view->base > addr) break;  /* no matching view */
-        if ((const char *)view->base + view->size <= (const char *)addr) continue;
-        if ((const char *)view->base + view->size < (const char *)addr + size) break;  /* size too large */
-        if ((const char *)addr + size < (const char *)addr) break; /* overflow */
-        return view;
-    }
-    return NULL;
+    if (!view) return NULL;  /* no matching view */
+    if ((const char *)view->base + view->size <= (const char *)addr) return NULL;
+    if ((const char *)view->base + view->size < (const char *)addr + size) return NULL;  /* size too large */
+    if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
+    return view;
 }
 
 
@@ -289,14 +445,12 @@ static inline UINT_PTR get_mask( ULONG zero_bits )
  */
 static struct file_view *find_view_range( const void *addr, size_t size )
 {
-    struct file_view *view;
+    struct file_view *view = find_view_below( addr );
 
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
-    {
-        if ((const char *)view->base >= (const char *)addr + size) break;
-        if ((const char *)view->base + view->size > (const char *)addr) return view;
-    }
-    return NULL;
+    if (view && (const char *)view->base + view->size > (const char *)addr) return view;
+    if (!(view = next_view( view ))) return NULL;
+    if ((const char *)view->base >= (const char *)addr + size) return NULL;
+    return view;
 }
 
 
@@ -308,7 +462,9 @@ static struct file_view *find_view_range( const void *addr, size_t size )
  */
 static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
 {
-    struct list *ptr;
+    struct list *ptr = list_tail( &views_list );
+    struct file_view *view, *last = ptr ? LIST_ENTRY( ptr, struct file_view, entry ) : NULL;
+    char *gap_start, *gap_end;
     void *start;
 
     if (top_down)
@@ -316,29 +472,52 @@ static void *find_free_area( void *base, void *end, size_t size, size_t mask, in
         start = ROUND_ADDR( (char *)end - size, mask );
         if (start >= end || start < base) return NULL;
 
-        for (ptr = views_list.prev; ptr != &views_list; ptr = ptr->prev)
-        {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
+        /* check the space above the last view first */
+        if (!last || (char *)last->base + last->size <= (char *)start) return start;
 
-            if ((char *)view->base + view->size <= (char *)start) break;
-            if ((char *)view->base >= (char *)start + size) continue;
-            start = ROUND_ADDR( (char *)view->base - size, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || start < base) return NULL;
+        /* then the free space before each view, going down */
+        view = find_free_view_above( end );
+        ptr = view ? list_prev( &free_list, &view->free_entry ) : list_tail( &free_list );
+        if (view && (char *)view->base - view->gap < (char *)end) ptr = &view->free_entry;
+        for ( ; ptr; ptr = list_prev( &free_list, ptr ))
+        {
+            view = LIST_ENTRY( ptr, struct file_view, free_entry );
+            gap_start = (char *)view->base - view->gap;
+            if (gap_start < (char *)base) gap_start = base;
+            gap_end = (char *)view->base < (char *)end ? view->base : end;
+            if (gap_end > gap_start && (size_t)(gap_end - gap_start) >= size)
+            {
+                start = ROUND_ADDR( gap_end - size, mask );
+                if (start >= (void *)gap_start) return start;
+            }
+            /* stop if the remaining views are below the range */
+            if ((char *)view->base - view->gap <= (char *)base) break;
         }
+        return NULL;
     }
     else
     {
         start = ROUND_ADDR( (char *)base + mask, mask );
         if (start >= end || (char *)end - (char *)start < size) return NULL;
 
-        for (ptr = views_list.next; ptr != &views_list; ptr = ptr->next)
+        /* check the free space before each view, going up */
+        view = find_free_view_above( start );
+        for (ptr = view ? &view->free_entry : NULL; ptr; ptr = list_next( &free_list, ptr ))
         {
-            struct file_view *view = LIST_ENTRY( ptr, struct file_view, entry );
+            view = LIST_ENTRY( ptr, struct file_view, free_entry );
+            gap_start = (char *)view->base - view->gap;
+            if (gap_start < (char *)start) gap_start = start;
+            gap_start = ROUND_ADDR( gap_start + mask, mask );
+            gap_end = (char *)view->base < (char *)end ? view->base : end;
+            if (gap_start && gap_start < gap_end && (size_t)(gap_end - gap_start) >= size) return gap_start;
+            /* stop if the remaining views are above the range */
+            if (view->base >= end) return NULL;
+        }
 
-            if ((char *)view->base >= (char *)start + size) break;
-            if ((char *)view->base + view->size <= (char *)start) continue;
-            start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
+        /* then the space above the last view */
+        if (last && (char *)last->base + last->size > (char *)start)
+        {
+            start = ROUND_ADDR( (char *)last->base + last->size + mask, mask );
             /* stop if remaining space is not large enough */
             if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
         }
@@ -385,7 +564,8 @@ static void remove_reserved_area( void *addr, size_t size )
     wine_mmap_remove_reserved_area( addr, size, 0 );
 
     /* unmap areas not covered by an existing view */
-    LIST_FOR_EACH_ENTRY( view, &views_list, struct file_view, entry )
+    if (!(view = find_view_below( addr ))) view = next_view( NULL );
+    for ( ; view; view = next_view( view ))
     {
         if ((char *)view->base >= (char *)addr + size)
         {
@@ -436,8 +616,17 @@ static inline void unmap_area( void *addr, size_t size )
  */
 static void delete_view( struct file_view *view ) /* [in] View */
 {
+    struct file_view *next = next_view( view );
+
     if (!(view->protect & VPROT_SYSTEM)) unmap_area( view->base, view->size );
+    if (view->gap)
+    {
+        wine_rb_remove( &free_tree, view->base );
+        list_remove( &view->free_entry );
+    }
+    wine_rb_remove( &views_tree, view->base );
     list_remove( &view->entry );
+    if (next) update_view_gap( next );
     if (view->mapping) close_handle( view->mapping );
     RtlFreeHeap( virtual_heap, 0, view );
 }
@@ -450,8 +639,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
  */
 static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t size, unsigned int vprot )
 {
-    struct file_view *view;
-    struct list *ptr;
+    struct file_view *view, *prev, *next;
     int unix_prot = VIRTUAL_GetUnixProt( vprot );
 
     assert( !((UINT_PTR)base & page_mask) );
@@ -467,49 +655,43 @@ static NTSTATUS create_view( struct file_view **view_ret, void *base, size_t siz
 
     view->base    = base;
     view->size    = size;
+    view->gap     = 0;
     view->mapping = 0;
     view->map_protect = 0;
     view->protect = vprot;
     memset( view->prot, vprot, size >> page_shift );
 
-    /* Insert it in the linked list */
-
-    LIST_FOR_EACH( ptr, &views_list )
-    {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if (next->base > base) break;
-    }
-    list_add_before( ptr, &view->entry );
-
     /* Check for overlapping views. This can happen if the previous view
      * was a system view that got unmapped behind our back. In that case
      * we recover by simply deleting it. */
 
-    if ((ptr = list_prev( &views_list, &view->entry )) != NULL)
+    if ((prev = find_view_below( base )) && (char *)prev->base + prev->size > (char *)base)
     {
-        struct file_view *prev = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)prev->base + prev->size > (char *)base)
-        {
-            TRACE( "overlapping prev view %p-%p for %p-%p\n",
-                   prev->base, (char *)prev->base + prev->size,
-                   base, (char *)base + view->size );
-            assert( prev->protect & VPROT_SYSTEM );
-            delete_view( prev );
-        }
+        TRACE( "overlapping prev view %p-%p for %p-%p\n",
+               prev->base, (char *)prev->base + prev->size,
+               base, (char *)base + view->size );
+        assert( prev->protect & VPROT_SYSTEM );
+        delete_view( prev );
+        prev = find_view_below( base );
     }
-    if ((ptr = list_next( &views_list, &view->entry )) != NULL)
+    if ((next = next_view( prev )) && (char *)base + view->size > (char *)next->base)
     {
-        struct file_view *next = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)base + view->size > (char *)next->base)
-        {
-            TRACE( "overlapping next view %p-%p for %p-%p\n",
-                   next->base, (char *)next->base + next->size,
-                   base, (char *)base + view->size );
-            assert( next->protect & VPROT_SYSTEM );
-            delete_view( next );
-        }
+        TRACE( "overlapping next view %p-%p for %p-%p\n",
+               next->base, (char *)next->base + next->size,
+               base, (char *)base + view->size );
+        assert( next->protect & VPROT_SYSTEM );
+        delete_view( next );
+        next = next_view( prev );
     }
 
+    /* Insert it in the linked list and the tree */
+
+    if (prev) list_add_after( &prev->entry, &view->entry );
+    else list_add_head( &views_list, &view->entry );
+    wine_rb_put( &views_tree, view->base, &view->tree_entry );
+    update_view_gap( view );
+    if (next) update_view_gap( next );
+
     *view_ret = view;
     VIRTUAL_DEBUG_DUMP_VIEW( view );
 
@@ -1369,6 +1551,8 @@ void virtual_init(void)
         heap_base = wine_anon_mmap( NULL, VIRTUAL_HEAP_SIZE, PROT_READ|PROT_WRITE, 0 );
 
     assert( heap_base != (void *)-1 );
+    wine_rb_init( &views_tree, &view_tree_functions );
+    wine_rb_init( &free_tree, &free_tree_functions );
     virtual_heap = RtlCreateHeap( HEAP_NO_SERIALIZE, heap_base, VIRTUAL_HEAP_SIZE,
                                   VIRTUAL_HEAP_SIZE, NULL, NULL );
     create_view( &heap_view, heap_base, VIRTUAL_HEAP_SIZE, VPROT_COMMITTED | VPROT_READ | VPROT_WRITE );
@@ -2179,7 +2363,6 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
 {
     struct file_view *view;
     char *base, *alloc_base = 0;
-    struct list *ptr;
     SIZE_T size = 0;
     MEMORY_BASIC_INFORMATION *info = buffer;
     sigset_t sigset;
@@ -2235,30 +2418,17 @@ NTSTATUS WINAPI NtQueryVirtualMemory( HANDLE process, LPCVOID addr,
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &csVirtual, &sigset );
-    ptr = list_head( &views_list );
-    for (;;)
+    if ((view = find_view_below( base )) && (char *)view->base + view->size > base)
     {
-        if (!ptr)
-        {
-            size = (char *)working_set_limit - alloc_base;
-            view = NULL;
-            break;
-        }
-        view = LIST_ENTRY( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
-        {
-            size = (char *)view->base - alloc_base;
-            view = NULL;
-            break;
-        }
-        if ((char *)view->base + view->size > base)
-        {
-            alloc_base = view->base;
-            size = view->size;
-            break;
-        }
-        alloc_base = (char *)view->base + view->size;
-        ptr = list_next( &views_list, ptr );
+        alloc_base = view->base;
+        size = view->size;
+    }
+    else
+    {
+        if (view) alloc_base = (char *)view->base + view->size;
+        if ((view = next_view( view ))) size = (char *)view->base - alloc_base;
+        else size = (char *)working_set_limit - alloc_base;
+        view = NULL;
     }
 
     /* Fill the info structure */
@@ -711,7 +711,11 @@ static HRESULT WINAPI ClientRpcChannelBuffer_GetBuffer(LPRPCCHANNELBUFFER iface,
         }
     }
     if (apt) apartment_release(apt);
-    message_state->params.handle = ClientRpcChannelBuffer_GetEventHandle(This);
+    /* calls from multi-threaded apartments that go through the RPC runtime
+     * are made synchronously by ClientRpcChannelBuffer_SendReceive and so
+     * don't need an event */
+    if (message_state->params.bypass_rpcrt || !COM_CurrentApt() || !COM_CurrentApt()->multi_threaded)
+        message_state->params.handle = ClientRpcChannelBuffer_GetEventHandle(This);
     /* Note: message_state->params.msg is initialised in
      * ClientRpcChannelBuffer_SendReceive */
 
@@ -822,6 +826,8 @@ static inline HRESULT ClientRpcChannelBuffer_IsCorrectApartment(ClientRpcChannel
 static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER iface, RPCOLEMESSAGE *olemsg, ULONG *pstatus)
 {
     ClientRpcChannelBuffer *This = (ClientRpcChannelBuffer *)iface;
+    APARTMENT *apt = COM_CurrentApt();
+    BOOL completed = FALSE;
     HRESULT hr;
     RPC_MESSAGE *msg = (RPC_MESSAGE *)olemsg;
     RPC_STATUS status;
@@ -834,7 +840,7 @@ static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER ifac
 
     TRACE("(%p) iMethod=%d\n", olemsg, olemsg->iMethod);
 
-    hr = ClientRpcChannelBuffer_IsCorrectApartment(This, COM_CurrentApt());
+    hr = ClientRpcChannelBuffer_IsCorrectApartment(This, apt);
     if (hr != S_OK)
     {
         ERR("called from wrong apartment, should have been 0x%s\n",
@@ -846,7 +852,7 @@ static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER ifac
      * Note: doing a COM call during the processing of a sent message is
      * only disallowed if a client call is already being waited for
      * completion */
-    if (!COM_CurrentApt()->multi_threaded &&
+    if (!apt->multi_threaded &&
         COM_CurrentInfo()->pending_call_count_client &&
         InSendMessage())
     {
@@ -885,6 +891,17 @@ static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER ifac
             hr = HRESULT_FROM_WIN32(GetLastError());
         }
     }
+    else if (apt->multi_threaded)
+    {
+        /* multi-threaded apartments don't pump messages while waiting for a
+         * call to complete and can't be re-entered through this thread, so
+         * there is nothing to gain from a separate thread: make the call
+         * synchronously */
+        message_state->params.status = I_RpcSendReceive(msg);
+        TRACE("completed with status 0x%x\n", message_state->params.status);
+        completed = TRUE;
+        hr = S_OK;
+    }
     else
     {
         /* we use a separate thread here because we need to be able to
@@ -902,7 +919,7 @@ static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER ifac
             hr = S_OK;
     }
 
-    if (hr == S_OK)
+    if (hr == S_OK && !completed)
     {
         if (WaitForSingleObject(message_state->params.handle, 0))
         {
@@ -911,7 +928,8 @@ static HRESULT WINAPI ClientRpcChannelBuffer_SendReceive(LPRPCCHANNELBUFFER ifac
             COM_CurrentInfo()->pending_call_count_client--;
         }
     }
-    ClientRpcChannelBuffer_ReleaseEventHandle(This, message_state->params.handle);
+    if (message_state->params.handle)
+        ClientRpcChannelBuffer_ReleaseEventHandle(This, message_state->params.handle);
 
     /* for WM shortcut, faults are returned in params->hr */
     if (hr == S_OK)
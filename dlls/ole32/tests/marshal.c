@@ -2976,6 +2976,48 @@ static HANDLE create_target_process(const char *arg)
     return pi.hProcess;
 }
 
+static void time_remote_calls(IClassFactory *cf, const char *apartment)
+{
+    static const int count = 1000;
+    LARGE_INTEGER freq, start, end;
+    IUnknown *unk;
+    HRESULT hr = S_OK;
+    int i;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++)
+    {
+        hr = IClassFactory_CreateInstance(cf, NULL, &IID_IWineTest, (void **)&unk);
+        if (hr != CLASS_E_CLASSNOTAVAILABLE) break;
+    }
+    QueryPerformanceCounter(&end);
+    ok(hr == CLASS_E_CLASSNOTAVAILABLE, "CreateInstance returned 0x%08x\n", hr);
+
+    trace("%s client: %.0f calls/s to a local server\n", apartment,
+          (double)count * freq.QuadPart / (end.QuadPart - start.QuadPart));
+}
+
+static DWORD CALLBACK time_remote_calls_mta_proc(void *p)
+{
+    IStream *stream = p;
+    IClassFactory *cf;
+    HRESULT hr;
+
+    pCoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    hr = CoGetInterfaceAndReleaseStream(stream, &IID_IClassFactory, (void **)&cf);
+    ok_ole_success(hr, CoGetInterfaceAndReleaseStream);
+    if (hr == S_OK)
+    {
+        time_remote_calls(cf, "MTA");
+        IClassFactory_Release(cf);
+    }
+
+    CoUninitialize();
+    return 0;
+}
+
 /* tests functions commonly used by out of process COM servers */
 static void test_local_server(void)
 {
@@ -2986,6 +3028,8 @@ static void test_local_server(void)
     HANDLE process;
     HANDLE quit_event;
     HANDLE ready_event;
+    HANDLE thread;
+    IStream *stream;
 
     heventShutdown = CreateEventA(NULL, TRUE, FALSE, NULL);
 
@@ -3057,6 +3101,17 @@ static void test_local_server(void)
     hr = CoCreateInstance(&CLSID_WineOOPTest, NULL, CLSCTX_LOCAL_SERVER, &IID_IClassFactory, (void **)&cf);
     ok_ole_success(hr, CoCreateInstance);
 
+    /* compare the cost of calls made from both kinds of apartments */
+    time_remote_calls(cf, "STA");
+    hr = CoMarshalInterThreadInterfaceInStream(&IID_IClassFactory, (IUnknown *)cf, &stream);
+    ok_ole_success(hr, CoMarshalInterThreadInterfaceInStream);
+    if (hr == S_OK)
+    {
+        thread = CreateThread(NULL, 0, time_remote_calls_mta_proc, stream, 0, NULL);
+        ok( !WaitForSingleObject(thread, 30000), "wait timed out\n" );
+        CloseHandle(thread);
+    }
+
     IClassFactory_Release(cf);
 
     hr = CoCreateInstance(&CLSID_WineOOPTest, NULL, CLSCTX_LOCAL_SERVER, &IID_IClassFactory, (void **)&cf);
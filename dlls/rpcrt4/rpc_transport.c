@@ -109,12 +109,16 @@ static RPC_STATUS RPCRT4_SpawnConnection(RpcConnection** Connection, RpcConnecti
 
 /**** ncacn_np support ****/
 
+struct lrpc_shm;
+
 typedef struct _RpcConnection_np
 {
   RpcConnection common;
   HANDLE pipe;
   HANDLE listen_thread;
   BOOL listening;
+  struct lrpc_shm *shm;  /* ncalrpc only: shared memory transport, if negotiated */
+  BOOL shm_checked;      /* ncalrpc server only: first packet was checked for an offer */
 } RpcConnection_np;
 
 static RpcConnection *rpcrt4_conn_np_alloc(void)
@@ -246,12 +250,455 @@ static RPC_STATUS rpcrt4_conn_open_pipe(RpcConnection *Connection, LPCSTR pname,
   return RPC_S_OK;
 }
 
+/**** ncalrpc shared memory transport ****/
+
+/* Right after connecting the pipe, an ncalrpc client offers to use shared
+ * memory. A server which accepts creates a section with one ring buffer per
+ * direction and the events to wait on, duplicates them into the client and
+ * sends it the handle values; the client confirms that it could use them, and
+ * only needs to open the server process to notice it going away. PDUs are copied through the rings from
+ * then on and the pipe is only kept for impersonation. The objects have no
+ * name, so only the two ends of the connection can get to them. A side only
+ * signals the other side's event when that side is actually sleeping, so busy
+ * connections run without any wineserver round trips. Servers that don't know
+ * about the offer reject it as a protocol error, in which case the client
+ * reconnects and sticks to plain named pipes. */
+
+#define LRPC_SHM_MAGIC      0x4d4853ff  /* "\xffSHM", never a valid rpc_ver */
+#define LRPC_SHM_RING_SIZE  0x10000     /* must be a power of two */
+#define LRPC_SHM_SPIN_COUNT 4000
+
+struct lrpc_shm_ring
+{
+    /* updated by the reader */
+    volatile LONG head;
+    volatile LONG reader_waiting;
+    char pad1[56];
+    /* updated by the writer */
+    volatile LONG tail;
+    volatile LONG writer_waiting;
+    char pad2[56];
+    char data[LRPC_SHM_RING_SIZE];
+};
+
+struct lrpc_shm_section
+{
+    volatile LONG closed;
+    char pad[60];
+    struct lrpc_shm_ring ring[2];  /* client to server, server to client */
+};
+
+struct lrpc_shm_offer
+{
+    DWORD magic;
+    DWORD size;
+    DWORD client_pid;   /* the process the handles are duplicated into */
+    DWORD reserved[5];  /* not shorter than the PDU header the server reads first */
+};
+
+struct lrpc_shm_reply
+{
+    DWORD magic;
+    DWORD status;
+    DWORD server_pid;   /* only used to notice the server going away */
+    DWORD mapping;      /* handles in the client process */
+    DWORD events[4];    /* client data, client space, server data, server space */
+};
+
+struct lrpc_shm
+{
+    HANDLE mapping;
+    struct lrpc_shm_section *section;
+    struct lrpc_shm_ring *in;
+    struct lrpc_shm_ring *out;
+    HANDLE in_data;     /* we wait on it when the in ring is empty */
+    HANDLE in_space;    /* we signal it when we free space in the in ring */
+    HANDLE out_data;    /* we signal it when we put data in the out ring */
+    HANDLE out_space;   /* we wait on it when the out ring is full */
+    HANDLE peer_process;
+    CRITICAL_SECTION write_cs;
+};
+
+/* set once a server rejected the offer by dropping the connection */
+static volatile LONG lrpc_shm_disabled;
+
+static inline void lrpc_shm_pause(void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#endif
+}
+
+static void lrpc_shm_destroy(struct lrpc_shm *shm)
+{
+    if (shm->section)
+    {
+        /* wake up the other side, it could be waiting on either ring */
+        shm->section->closed = TRUE;
+        if (shm->out_data) SetEvent(shm->out_data);
+        if (shm->in_space) SetEvent(shm->in_space);
+        UnmapViewOfFile(shm->section);
+    }
+    if (shm->mapping) CloseHandle(shm->mapping);
+    if (shm->in_data) CloseHandle(shm->in_data);
+    if (shm->in_space) CloseHandle(shm->in_space);
+    if (shm->out_data) CloseHandle(shm->out_data);
+    if (shm->out_space) CloseHandle(shm->out_space);
+    if (shm->peer_process) CloseHandle(shm->peer_process);
+    shm->write_cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&shm->write_cs);
+    HeapFree(GetProcessHeap(), 0, shm);
+}
+
+static struct lrpc_shm *lrpc_shm_alloc(void)
+{
+    struct lrpc_shm *shm;
+
+    if (!(shm = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*shm))))
+        return NULL;
+    InitializeCriticalSection(&shm->write_cs);
+    shm->write_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": lrpc_shm.write_cs");
+    return shm;
+}
+
+/* Maps the section and assigns the rings and events of our side of the
+ * connection, in the order of lrpc_shm_reply.events. */
+static BOOL lrpc_shm_map(struct lrpc_shm *shm, HANDLE events[4], BOOL server)
+{
+    if (server)
+    {
+        shm->in_data   = events[0];
+        shm->in_space  = events[1];
+        shm->out_data  = events[2];
+        shm->out_space = events[3];
+    }
+    else
+    {
+        shm->in_data   = events[2];
+        shm->in_space  = events[3];
+        shm->out_data  = events[0];
+        shm->out_space = events[1];
+    }
+
+    if (!shm->mapping || !shm->in_data || !shm->in_space || !shm->out_data || !shm->out_space ||
+        !(shm->section = MapViewOfFile(shm->mapping, FILE_MAP_READ | FILE_MAP_WRITE,
+                                       0, 0, sizeof(*shm->section))))
+        return FALSE;
+
+    shm->in  = &shm->section->ring[server ? 0 : 1];
+    shm->out = &shm->section->ring[server ? 1 : 0];
+    return TRUE;
+}
+
+/* Creates the section and events of a connection on the server side. */
+static struct lrpc_shm *lrpc_shm_create(void)
+{
+    HANDLE events[4];
+    struct lrpc_shm *shm;
+    unsigned int i;
+
+    if (!(shm = lrpc_shm_alloc()))
+        return NULL;
+
+    shm->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                      0, sizeof(*shm->section), NULL);
+    for (i = 0; i < ARRAYSIZE(events); i++)
+        events[i] = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!lrpc_shm_map(shm, events, TRUE))
+    {
+        WARN("couldn't create shared memory section, error %d\n", GetLastError());
+        lrpc_shm_destroy(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+/* Takes over the section and events the server duplicated into our process;
+ * they are closed again if they can't be used. */
+static struct lrpc_shm *lrpc_shm_open(const struct lrpc_shm_reply *reply)
+{
+    HANDLE events[4];
+    struct lrpc_shm *shm;
+    unsigned int i;
+
+    if (!(shm = lrpc_shm_alloc()))
+    {
+        CloseHandle(ULongToHandle(reply->mapping));
+        for (i = 0; i < ARRAYSIZE(events); i++)
+            CloseHandle(ULongToHandle(reply->events[i]));
+        return NULL;
+    }
+
+    shm->mapping = ULongToHandle(reply->mapping);
+    for (i = 0; i < ARRAYSIZE(events); i++)
+        events[i] = ULongToHandle(reply->events[i]);
+    if (!lrpc_shm_map(shm, events, FALSE))
+    {
+        WARN("couldn't map shared memory section of process %04x, error %d\n",
+             reply->server_pid, GetLastError());
+        lrpc_shm_destroy(shm);
+        return NULL;
+    }
+
+    /* a wrong pid can only keep this connection from noticing that its server died */
+    shm->peer_process = OpenProcess(SYNCHRONIZE, FALSE, reply->server_pid);
+    return shm;
+}
+
+/* Waits until *pos changes from old. Returns FALSE if the connection was
+ * closed before that happened. */
+static BOOL lrpc_shm_wait(struct lrpc_shm *shm, HANDLE event, volatile LONG *waiting,
+                          volatile LONG *pos, LONG old)
+{
+    HANDLE handles[2];
+    DWORD count = 0;
+    unsigned int i;
+
+    if (NtCurrentTeb()->Peb->NumberOfProcessors > 1)
+    {
+        for (i = 0; i < LRPC_SHM_SPIN_COUNT; i++)
+        {
+            if (*pos != old || shm->section->closed) break;
+            lrpc_shm_pause();
+        }
+    }
+
+    handles[count++] = event;
+    if (shm->peer_process) handles[count++] = shm->peer_process;
+
+    InterlockedExchange(waiting, TRUE);
+    while (*pos == old && !shm->section->closed)
+    {
+        if (WaitForMultipleObjects(count, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            WARN("peer process went away\n");
+            shm->section->closed = TRUE;
+        }
+    }
+    InterlockedExchange(waiting, FALSE);
+
+    return *pos != old;
+}
+
+static int lrpc_shm_read(struct lrpc_shm *shm, void *buffer, unsigned int count)
+{
+    struct lrpc_shm_ring *ring = shm->in;
+    unsigned int bytes_left = count;
+    char *buf = buffer;
+
+    while (bytes_left)
+    {
+        LONG head = ring->head, tail = ring->tail;
+        unsigned int offset = head & (LRPC_SHM_RING_SIZE - 1);
+        unsigned int len = (ULONG)tail - (ULONG)head;
+
+        if (!len)
+        {
+            if (!lrpc_shm_wait(shm, shm->in_data, &ring->reader_waiting, &ring->tail, tail))
+                return -1;
+            continue;
+        }
+
+        len = min(len, bytes_left);
+        len = min(len, LRPC_SHM_RING_SIZE - offset);
+        memcpy(buf, ring->data + offset, len);
+        /* the interlocked operation orders the copy before releasing the space */
+        InterlockedExchange(&ring->head, head + len);
+        if (ring->writer_waiting) SetEvent(shm->in_space);
+
+        buf += len;
+        bytes_left -= len;
+    }
+    return count;
+}
+
+static int lrpc_shm_write(struct lrpc_shm *shm, const void *buffer, unsigned int count)
+{
+    struct lrpc_shm_ring *ring = shm->out;
+    unsigned int bytes_left = count;
+    const char *buf = buffer;
+
+    /* fragments must not be interleaved if several threads send on the connection */
+    EnterCriticalSection(&shm->write_cs);
+    while (bytes_left)
+    {
+        LONG head = ring->head, tail = ring->tail;
+        unsigned int offset = tail & (LRPC_SHM_RING_SIZE - 1);
+        unsigned int len = LRPC_SHM_RING_SIZE - ((ULONG)tail - (ULONG)head);
+
+        if (shm->section->closed)
+            break;
+        if (!len)
+        {
+            if (!lrpc_shm_wait(shm, shm->out_space, &ring->writer_waiting, &ring->head, head))
+                break;
+            continue;
+        }
+
+        len = min(len, bytes_left);
+        len = min(len, LRPC_SHM_RING_SIZE - offset);
+        memcpy(ring->data + offset, buf, len);
+        /* the interlocked operation orders the copy before publishing the data */
+        InterlockedExchange(&ring->tail, tail + len);
+        if (ring->reader_waiting) SetEvent(shm->out_data);
+
+        buf += len;
+        bytes_left -= len;
+    }
+    LeaveCriticalSection(&shm->write_cs);
+    return bytes_left ? -1 : count;
+}
+
+/* Offers shared memory to the server at the other end of the pipe. Returns
+ * FALSE if the connection can't be used anymore; *rejected is then set if the
+ * server dropped it because it doesn't understand the offer. */
+static BOOL rpcrt4_ncalrpc_offer_shm(RpcConnection_np *npc, BOOL *rejected)
+{
+    struct lrpc_shm_offer offer;
+    struct lrpc_shm_reply reply;
+    struct lrpc_shm *shm;
+    DWORD count, status;
+
+    *rejected = FALSE;
+    memset(&offer, 0, sizeof(offer));
+    offer.magic = LRPC_SHM_MAGIC;
+    offer.size = sizeof(struct lrpc_shm_section);
+    offer.client_pid = GetCurrentProcessId();
+
+    if (!WriteFile(npc->pipe, &offer, sizeof(offer), &count, NULL) || count != sizeof(offer))
+    {
+        WARN("couldn't send shared memory offer, error %d\n", GetLastError());
+        return FALSE;
+    }
+
+    if (!ReadFile(npc->pipe, &reply, sizeof(reply), &count, NULL))
+    {
+        status = GetLastError();
+        WARN("no reply to shared memory offer, error %d\n", status);
+        *rejected = status == ERROR_BROKEN_PIPE || status == ERROR_PIPE_NOT_CONNECTED;
+        return FALSE;
+    }
+    if (count != sizeof(reply) || reply.magic != LRPC_SHM_MAGIC)
+    {
+        WARN("server doesn't support shared memory\n");
+        *rejected = TRUE;
+        return FALSE;
+    }
+
+    if (reply.status != RPC_S_OK)
+    {
+        TRACE("server declined shared memory, status %d\n", reply.status);
+        return TRUE;
+    }
+
+    /* the server waits for us to confirm that we could use the section */
+    shm = lrpc_shm_open(&reply);
+    status = shm ? RPC_S_OK : RPC_S_OUT_OF_RESOURCES;
+    if (!WriteFile(npc->pipe, &status, sizeof(status), &count, NULL) || count != sizeof(status))
+    {
+        WARN("couldn't confirm shared memory, error %d\n", GetLastError());
+        if (shm) lrpc_shm_destroy(shm);
+        return FALSE;
+    }
+
+    if (shm)
+    {
+        npc->shm = shm;
+        TRACE("using shared memory section %p\n", shm->section);
+    }
+    return TRUE;
+}
+
+/* Duplicates the section and events of a connection into the client process,
+ * storing the new handle values in the reply. */
+static BOOL lrpc_shm_send_handles(struct lrpc_shm *shm, HANDLE client, struct lrpc_shm_reply *reply)
+{
+    HANDLE handles[5], dups[5];
+    unsigned int i;
+
+    handles[0] = shm->mapping;
+    handles[1] = shm->in_data;
+    handles[2] = shm->in_space;
+    handles[3] = shm->out_data;
+    handles[4] = shm->out_space;
+
+    for (i = 0; i < ARRAYSIZE(handles); i++)
+    {
+        if (!DuplicateHandle(GetCurrentProcess(), handles[i], client, &dups[i], 0, FALSE, DUPLICATE_SAME_ACCESS))
+        {
+            WARN("couldn't duplicate handle into the client, error %d\n", GetLastError());
+            while (i--) DuplicateHandle(client, dups[i], NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+            return FALSE;
+        }
+    }
+
+    reply->mapping = HandleToULong(dups[0]);
+    for (i = 0; i < ARRAYSIZE(reply->events); i++)
+        reply->events[i] = HandleToULong(dups[i + 1]);
+    return TRUE;
+}
+
+/* Handles the offer sent by rpcrt4_ncalrpc_offer_shm on the server side. */
+static void rpcrt4_ncalrpc_accept_shm(RpcConnection_np *npc, const struct lrpc_shm_offer *offer)
+{
+    struct lrpc_shm_reply reply;
+    struct lrpc_shm *shm = NULL;
+    HANDLE client = NULL;
+    DWORD count, status;
+    unsigned int i;
+
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = LRPC_SHM_MAGIC;
+    reply.server_pid = GetCurrentProcessId();
+    reply.status = RPC_S_OK;
+
+    /* the client process is only opened for duplicating, and closed right after */
+    if (offer->size != sizeof(struct lrpc_shm_section) ||
+        !(client = OpenProcess(PROCESS_DUP_HANDLE, FALSE, offer->client_pid)) ||
+        !(shm = lrpc_shm_create()) || !lrpc_shm_send_handles(shm, client, &reply))
+    {
+        reply.status = RPC_S_OUT_OF_RESOURCES;
+        if (shm) lrpc_shm_destroy(shm);
+        shm = NULL;
+    }
+
+    if (!WriteFile(npc->pipe, &reply, sizeof(reply), &count, NULL) || count != sizeof(reply))
+    {
+        /* the client never saw the handles, so they are ours to close */
+        if (shm)
+        {
+            DuplicateHandle(client, ULongToHandle(reply.mapping), NULL, NULL, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+            for (i = 0; i < ARRAYSIZE(reply.events); i++)
+                DuplicateHandle(client, ULongToHandle(reply.events[i]), NULL, NULL, 0, FALSE,
+                                DUPLICATE_CLOSE_SOURCE);
+            lrpc_shm_destroy(shm);
+        }
+        if (client) CloseHandle(client);
+        return;
+    }
+    if (client) CloseHandle(client);
+
+    /* from here on the client closes its handles itself if it can't use them */
+    if (!shm || !ReadFile(npc->pipe, &status, sizeof(status), &count, NULL) || count != sizeof(status) ||
+        status != RPC_S_OK)
+    {
+        if (shm) lrpc_shm_destroy(shm);
+        return;
+    }
+
+    /* a wrong pid can only keep this connection from noticing that its client died */
+    shm->peer_process = OpenProcess(SYNCHRONIZE, FALSE, offer->client_pid);
+    npc->shm = shm;
+    TRACE("using shared memory section %p\n", shm->section);
+}
+
 static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
 {
   RpcConnection_np *npc = (RpcConnection_np *) Connection;
   static const char prefix[] = "\\\\.\\pipe\\lrpc\\";
   RPC_STATUS r;
   LPSTR pname;
+  BOOL rejected;
 
   /* already connected? */
   if (npc->pipe)
@@ -262,6 +709,14 @@ static RPC_STATUS rpcrt4_ncalrpc_open(RpcConnection* Connection)
   pname = I_RpcAllocate(strlen(prefix) + strlen(Connection->Endpoint) + 1);
   strcat(strcpy(pname, prefix), Connection->Endpoint);
   r = rpcrt4_conn_open_pipe(Connection, pname, TRUE);
+  if (r == RPC_S_OK && !lrpc_shm_disabled && !rpcrt4_ncalrpc_offer_shm(npc, &rejected))
+  {
+    /* retry with plain named pipes, and don't offer anymore if the server didn't understand */
+    if (rejected) InterlockedExchange(&lrpc_shm_disabled, TRUE);
+    CloseHandle(npc->pipe);
+    npc->pipe = 0;
+    r = rpcrt4_conn_open_pipe(Connection, pname, TRUE);
+  }
   I_RpcFree(pname);
 
   return r;
@@ -476,6 +931,59 @@ static int rpcrt4_conn_np_wait_for_incoming_data(RpcConnection *Connection)
     return -1;
 }
 
+static int rpcrt4_conn_lrpc_read(RpcConnection *Connection,
+                        void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+  struct lrpc_shm_offer offer;
+  int ret;
+
+  if (npc->shm)
+    return lrpc_shm_read(npc->shm, buffer, count);
+
+  if (!Connection->server || npc->shm_checked)
+    return rpcrt4_conn_np_read(Connection, buffer, count);
+
+  /* the first thing a client sends is either a PDU or a shared memory offer */
+  npc->shm_checked = TRUE;
+  ret = rpcrt4_conn_np_read(Connection, buffer, count);
+  if (ret < 0 || count < sizeof(offer.magic) || count > sizeof(offer))
+    return ret;
+  memcpy(&offer, buffer, count);
+  if (offer.magic != LRPC_SHM_MAGIC)
+    return ret;
+
+  if (rpcrt4_conn_np_read(Connection, (char *)&offer + count, sizeof(offer) - count) < 0)
+    return -1;
+  rpcrt4_ncalrpc_accept_shm(npc, &offer);
+
+  if (npc->shm)
+    return lrpc_shm_read(npc->shm, buffer, count);
+  return rpcrt4_conn_np_read(Connection, buffer, count);
+}
+
+static int rpcrt4_conn_lrpc_write(RpcConnection *Connection,
+                             const void *buffer, unsigned int count)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  if (npc->shm)
+    return lrpc_shm_write(npc->shm, buffer, count);
+  return rpcrt4_conn_np_write(Connection, buffer, count);
+}
+
+static int rpcrt4_conn_lrpc_close(RpcConnection *Connection)
+{
+  RpcConnection_np *npc = (RpcConnection_np *) Connection;
+
+  if (npc->shm)
+  {
+    lrpc_shm_destroy(npc->shm);
+    npc->shm = NULL;
+  }
+  return rpcrt4_conn_np_close(Connection);
+}
+
 static size_t rpcrt4_ncacn_np_get_top_of_tower(unsigned char *tower_data,
                                                const char *networkaddr,
                                                const char *endpoint)
@@ -3303,9 +3811,9 @@ static const struct connection_ops conn_protseq_list[] = {
     rpcrt4_conn_np_alloc,
     rpcrt4_ncalrpc_open,
     rpcrt4_ncalrpc_handoff,
-    rpcrt4_conn_np_read,
-    rpcrt4_conn_np_write,
-    rpcrt4_conn_np_close,
+    rpcrt4_conn_lrpc_read,
+    rpcrt4_conn_lrpc_write,
+    rpcrt4_conn_lrpc_close,
     rpcrt4_conn_np_cancel_call,
     rpcrt4_conn_np_wait_for_incoming_data,
     rpcrt4_ncalrpc_get_top_of_tower,
@@ -1513,6 +1513,140 @@ run_tests(void)
   context_handle_test();
 }
 
+static void
+perf_tests(const char *protseq)
+{
+  static const int count = 2000, array_len = 0x4000, array_count = 200;
+  LARGE_INTEGER freq, start, end;
+  int i, *array, sum = 0;
+
+  QueryPerformanceFrequency(&freq);
+
+  QueryPerformanceCounter(&start);
+  for (i = 0; i < count; i++)
+    sum += square(2) == 4;
+  QueryPerformanceCounter(&end);
+  ok(sum == count, "got %d successful calls\n", sum);
+  trace("%s: %.2f us per call\n", protseq,
+        (double)(end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart / count);
+
+  array = HeapAlloc(GetProcessHeap(), 0, array_len * sizeof(*array));
+  for (i = 0; i < array_len; i++)
+    array[i] = i & 1;
+
+  QueryPerformanceCounter(&start);
+  for (i = 0; i < array_count; i++)
+  {
+    sum = sum_conf_array(array, array_len);
+    if (sum != array_len / 2) break;
+  }
+  QueryPerformanceCounter(&end);
+  ok(sum == array_len / 2, "got %d\n", sum);
+  trace("%s: %.1f MB/s\n", protseq,
+        (double)array_len * sizeof(*array) * array_count / (1024 * 1024) *
+        freq.QuadPart / (end.QuadPart - start.QuadPart));
+
+  HeapFree(GetProcessHeap(), 0, array);
+}
+
+/* ncalrpc connections of Wine map a shared memory section, count them */
+static unsigned int
+count_mapped_views(void)
+{
+  MEMORY_BASIC_INFORMATION info;
+  const char *addr = NULL;
+  unsigned int count = 0;
+
+  while (VirtualQuery(addr, &info, sizeof(info)))
+  {
+    if (info.Type == MEM_MAPPED && info.BaseAddress == info.AllocationBase) count++;
+    addr = (const char *)info.BaseAddress + info.RegionSize;
+  }
+  return count;
+}
+
+#define LRPC_PIPE "\\\\.\\pipe\\lrpc\\"
+
+/* Behaves like an ncalrpc server which doesn't know about the shared memory
+ * offer: connections not starting with an rpc_ver 5 PDU are dropped, the
+ * others are forwarded to the real server. */
+static LONG proxy_rejected;
+
+struct proxy_pipes
+{
+  HANDLE from;
+  HANDLE to;
+};
+
+static DWORD WINAPI
+proxy_forward_thread(void *arg)
+{
+  struct proxy_pipes *pipes = arg;
+  char buffer[4096];
+  DWORD size, written;
+
+  for (;;)
+  {
+    if (!ReadFile(pipes->from, buffer, sizeof(buffer), &size, NULL) && GetLastError() != ERROR_MORE_DATA)
+      break;
+    if (!WriteFile(pipes->to, buffer, size, &written, NULL))
+      break;
+  }
+  HeapFree(GetProcessHeap(), 0, pipes);
+  return 0;
+}
+
+static void
+proxy_forward(HANDLE from, HANDLE to)
+{
+  struct proxy_pipes *pipes = HeapAlloc(GetProcessHeap(), 0, sizeof(*pipes));
+
+  pipes->from = from;
+  pipes->to = to;
+  CloseHandle(CreateThread(NULL, 0, proxy_forward_thread, pipes, 0, NULL));
+}
+
+static DWORD WINAPI
+proxy_thread(void *arg)
+{
+  static const char server_name[] = LRPC_PIPE "00000000-4114-0704-2301-000000000000";
+  const char *name = arg;
+  HANDLE pipe, next, server;
+  char buffer[4096];
+  DWORD size, written, mode;
+
+  pipe = CreateNamedPipeA(name, PIPE_ACCESS_DUPLEX, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE,
+                          PIPE_UNLIMITED_INSTANCES, sizeof(buffer), sizeof(buffer), 0, NULL);
+  while (pipe != INVALID_HANDLE_VALUE)
+  {
+    if (!ConnectNamedPipe(pipe, NULL) && GetLastError() != ERROR_PIPE_CONNECTED)
+      break;
+    /* keep an instance listening for the client to come back */
+    next = CreateNamedPipeA(name, PIPE_ACCESS_DUPLEX, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE,
+                            PIPE_UNLIMITED_INSTANCES, sizeof(buffer), sizeof(buffer), 0, NULL);
+
+    if ((!ReadFile(pipe, buffer, sizeof(buffer), &size, NULL) && GetLastError() != ERROR_MORE_DATA) ||
+        !size || buffer[0] != 5)
+    {
+      InterlockedIncrement(&proxy_rejected);
+      CloseHandle(pipe);
+    }
+    else if ((server = CreateFileA(server_name, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                   OPEN_EXISTING, 0, 0)) != INVALID_HANDLE_VALUE)
+    {
+      mode = PIPE_READMODE_MESSAGE;
+      SetNamedPipeHandleState(server, &mode, NULL, NULL);
+      WriteFile(server, buffer, size, &written, NULL);
+      proxy_forward(pipe, server);
+      proxy_forward(server, pipe);
+    }
+    else
+      CloseHandle(pipe);
+    pipe = next;
+  }
+  return 0;
+}
+
 static void
 set_auth_info(RPC_BINDING_HANDLE handle)
 {
@@ -1545,6 +1679,7 @@ client(const char *test)
   static unsigned char guid[] = "00000000-4114-0704-2301-000000000000";
 
   unsigned char *binding;
+  unsigned int views;
 
   if (strcmp(test, "tcp_basic") == 0)
   {
@@ -1552,6 +1687,7 @@ client(const char *test)
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests();
+    perf_tests("ncacn_ip_tcp");
     authinfo_test(RPC_PROTSEQ_TCP, 0);
 
     ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
@@ -1573,7 +1709,11 @@ client(const char *test)
     ok(RPC_S_OK == RpcStringBindingComposeA(NULL, ncalrpc, NULL, guid, NULL, &binding), "RpcStringBindingCompose\n");
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
+    views = count_mapped_views();
     run_tests(); /* can cause RPC_X_BAD_STUB_DATA exception */
+    perf_tests("ncalrpc");
+    views = count_mapped_views() - views;
+    ok(views == 1 || broken(!views) /* no shared memory */, "ncalrpc mapped %u views\n", views);
     authinfo_test(RPC_PROTSEQ_LRPC, 0);
 
     ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
@@ -1590,12 +1730,39 @@ client(const char *test)
     ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
     ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
   }
+  else if (strcmp(test, "ncalrpc_fallback") == 0)
+  {
+    static const char proxy_name[] = LRPC_PIPE "00000000-4114-0704-2301-000000000001";
+    static unsigned char proxy_guid[] = "00000000-4114-0704-2301-000000000001";
+
+    if (!WaitNamedPipeA(LRPC_PIPE "00000000-4114-0704-2301-000000000000", NMPWAIT_USE_DEFAULT_WAIT) &&
+        GetLastError() == ERROR_FILE_NOT_FOUND)
+    {
+      skip("ncalrpc doesn't use named pipes\n");
+      return;
+    }
+    CloseHandle(CreateThread(NULL, 0, proxy_thread, (void *)proxy_name, 0, NULL));
+
+    ok(RPC_S_OK == RpcStringBindingComposeA(NULL, ncalrpc, NULL, proxy_guid, NULL, &binding), "RpcStringBindingCompose\n");
+    ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
+
+    /* the client has to reconnect without offering shared memory */
+    views = count_mapped_views();
+    perf_tests("ncalrpc without shared memory");
+    views = count_mapped_views() - views;
+    ok(proxy_rejected == 1, "got %d rejected connections\n", proxy_rejected);
+    ok(!views, "ncalrpc mapped %u views\n", views);
+
+    ok(RPC_S_OK == RpcStringFreeA(&binding), "RpcStringFree\n");
+    ok(RPC_S_OK == RpcBindingFree(&IServer_IfHandle), "RpcBindingFree\n");
+  }
   else if (strcmp(test, "np_basic") == 0)
   {
     ok(RPC_S_OK == RpcStringBindingComposeA(NULL, np, address_np, pipe, NULL, &binding), "RpcStringBindingCompose\n");
     ok(RPC_S_OK == RpcBindingFromStringBindingA(binding, &IServer_IfHandle), "RpcBindingFromStringBinding\n");
 
     run_tests();
+    perf_tests("ncacn_np");
     authinfo_test(RPC_PROTSEQ_NMP, 0);
     stop();
 
@@ -1651,6 +1818,7 @@ server(void)
   if (ncalrpc_status == RPC_S_OK)
   {
     run_client("ncalrpc_basic");
+    run_client("ncalrpc_fallback");
     if (pGetUserNameExA)
     {
       /* we don't need to register RPC_C_AUTHN_WINNT for ncalrpc */
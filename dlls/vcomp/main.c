@@ -20,104 +20,1497 @@
  */
 
 #include "config.h"
+#include "wine/port.h"
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <assert.h>
 
 #include "windef.h"
 #include "winbase.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(vcomp);
 
+typedef CRITICAL_SECTION *omp_lock_t;
+typedef CRITICAL_SECTION *omp_nest_lock_t;
+
+static struct list vcomp_idle_threads = LIST_INIT(vcomp_idle_threads);
+static DWORD   vcomp_context_tls = TLS_OUT_OF_INDEXES;
+static HMODULE vcomp_module;
+static int     vcomp_max_threads;
+static int     vcomp_num_threads;
+static BOOL    vcomp_nested_fork = FALSE;
+static BOOL    vcomp_dynamic_threads = FALSE;
+
+/* idle worker threads exit after this many milliseconds */
+#define VCOMP_IDLE_TIMEOUT 5000
+
+static CRITICAL_SECTION vcomp_section;
+static CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &vcomp_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": vcomp_section") }
+};
+static CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+#define VCOMP_DYNAMIC_FLAGS_STATIC      0x01
+#define VCOMP_DYNAMIC_FLAGS_CHUNKED     0x02
+#define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
+#define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
+
+struct vcomp_thread_data
+{
+    struct vcomp_team_data  *team;
+    struct vcomp_task_data  *task;
+    int                     thread_num;
+    BOOL                    parallel;
+    int                     fork_threads;
+
+    /* only used for worker threads */
+    struct list             entry;
+    CONDITION_VARIABLE      cond;
+
+    /* single */
+    unsigned int            single;
+
+    /* section */
+    unsigned int            section;
+
+    /* dynamic */
+    unsigned int            dynamic;
+    unsigned int            dynamic_type;
+    ULONG64                 dynamic_begin;
+    ULONG64                 dynamic_end;
+};
+
+struct vcomp_team_data
+{
+    CONDITION_VARIABLE      cond;
+    int                     num_threads;
+    int                     finished_threads;
+
+    /* callback arguments */
+    int                     nargs;
+    void                    *wrapper;
+    __ms_va_list            valist;
+
+    /* barrier */
+    unsigned int            barrier;
+    int                     barrier_count;
+};
+
+struct vcomp_task_data
+{
+    /* single */
+    unsigned int            single;
+
+    /* section */
+    unsigned int            section;
+    int                     num_sections;
+    int                     section_index;
+
+    /* dynamic */
+    unsigned int            dynamic;
+    ULONG64                 dynamic_first;
+    ULONG64                 dynamic_last;
+    ULONG64                 dynamic_iterations;
+    LONG64                  dynamic_step;
+    ULONG64                 dynamic_chunksize;
+};
+
+#if defined(__i386__)
+
+extern void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, __ms_va_list args);
+__ASM_GLOBAL_FUNC( _vcomp_fork_call_wrapper,
+                   "pushl %ebp\n\t"
+                   __ASM_CFI(".cfi_adjust_cfa_offset 4\n\t")
+                   __ASM_CFI(".cfi_rel_offset %ebp,0\n\t")
+                   "movl %esp,%ebp\n\t"
+                   __ASM_CFI(".cfi_def_cfa_register %ebp\n\t")
+                   "pushl %esi\n\t"
+                   __ASM_CFI(".cfi_rel_offset %esi,-4\n\t")
+                   "pushl %edi\n\t"
+                   __ASM_CFI(".cfi_rel_offset %edi,-8\n\t")
+                   "movl 12(%ebp),%edx\n\t"
+                   "movl %esp,%edi\n\t"
+                   "shll $2,%edx\n\t"
+                   "jz 1f\n\t"
+                   "subl %edx,%edi\n\t"
+                   "andl $~15,%edi\n\t"
+                   "movl %edi,%esp\n\t"
+                   "movl 12(%ebp),%ecx\n\t"
+                   "movl 16(%ebp),%esi\n\t"
+                   "cld\n\t"
+                   "rep; movsl\n"
+                   "1:\tcall *8(%ebp)\n\t"
+                   "leal -8(%ebp),%esp\n\t"
+                   "popl %edi\n\t"
+                   __ASM_CFI(".cfi_same_value %edi\n\t")
+                   "popl %esi\n\t"
+                   __ASM_CFI(".cfi_same_value %esi\n\t")
+                   "popl %ebp\n\t"
+                   __ASM_CFI(".cfi_def_cfa %esp,4\n\t")
+                   __ASM_CFI(".cfi_same_value %ebp\n\t")
+                   "ret" )
+
+#elif defined(__x86_64__)
+
+extern void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, __ms_va_list args);
+__ASM_GLOBAL_FUNC( _vcomp_fork_call_wrapper,
+                   "pushq %rbp\n\t"
+                   __ASM_CFI(".cfi_adjust_cfa_offset 8\n\t")
+                   __ASM_CFI(".cfi_rel_offset %rbp,0\n\t")
+                   "movq %rsp,%rbp\n\t"
+                   __ASM_CFI(".cfi_def_cfa_register %rbp\n\t")
+                   "pushq %rsi\n\t"
+                   __ASM_CFI(".cfi_rel_offset %rsi,-8\n\t")
+                   "pushq %rdi\n\t"
+                   __ASM_CFI(".cfi_rel_offset %rdi,-16\n\t")
+                   "movq %rcx,%rax\n\t"
+                   "movslq %edx,%rdx\n\t"
+                   "movq $4,%rcx\n\t"
+                   "cmp %rcx,%rdx\n\t"
+                   "cmovgq %rdx,%rcx\n\t"
+                   "leaq 0(,%rcx,8),%rdx\n\t"
+                   "subq %rdx,%rsp\n\t"
+                   "andq $~15,%rsp\n\t"
+                   "movq %rsp,%rdi\n\t"
+                   "movq %r8,%rsi\n\t"
+                   "rep; movsq\n\t"
+                   "movq 0(%rsp),%rcx\n\t"
+                   "movq 8(%rsp),%rdx\n\t"
+                   "movq 16(%rsp),%r8\n\t"
+                   "movq 24(%rsp),%r9\n\t"
+                   "callq *%rax\n\t"
+                   "leaq -16(%rbp),%rsp\n\t"
+                   "popq %rdi\n\t"
+                   __ASM_CFI(".cfi_same_value %rdi\n\t")
+                   "popq %rsi\n\t"
+                   __ASM_CFI(".cfi_same_value %rsi\n\t")
+                   __ASM_CFI(".cfi_def_cfa_register %rsp\n\t")
+                   "popq %rbp\n\t"
+                   __ASM_CFI(".cfi_adjust_cfa_offset -8\n\t")
+                   __ASM_CFI(".cfi_same_value %rbp\n\t")
+                   "ret")
+
+#else
+
+/* Generic version: the compiler only ever passes pointers to the outlined
+ * parallel region, so forwarding them as a fixed number of pointer-sized
+ * arguments is enough. */
+static void CDECL _vcomp_fork_call_wrapper(void *wrapper, int nargs, __ms_va_list args)
+{
+    void (CDECL *func)(void *, void *, void *, void *, void *, void *, void *, void *,
+                       void *, void *, void *, void *, void *, void *, void *, void *) = wrapper;
+    void *ptr[16];
+    int i;
+
+    if (nargs > 16)
+    {
+        FIXME("too many arguments %d\n", nargs);
+        nargs = 16;
+    }
+    for (i = 0; i < nargs; i++) ptr[i] = va_arg(args, void *);
+    for (; i < 16; i++) ptr[i] = NULL;
+
+    func(ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], ptr[5], ptr[6], ptr[7],
+         ptr[8], ptr[9], ptr[10], ptr[11], ptr[12], ptr[13], ptr[14], ptr[15]);
+}
+
+#endif
+
+static inline struct vcomp_thread_data *vcomp_get_thread_data(void)
+{
+    return (struct vcomp_thread_data *)TlsGetValue(vcomp_context_tls);
+}
+
+static inline void vcomp_set_thread_data(struct vcomp_thread_data *thread_data)
+{
+    TlsSetValue(vcomp_context_tls, thread_data);
+}
+
+static struct vcomp_thread_data *vcomp_init_thread_data(void)
+{
+    struct vcomp_thread_data *thread_data = vcomp_get_thread_data();
+    struct
+    {
+        struct vcomp_thread_data thread;
+        struct vcomp_task_data   task;
+    } *data;
+
+    if (thread_data) return thread_data;
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, sizeof(*data))))
+    {
+        ERR("could not create thread data\n");
+        ExitProcess(1);
+    }
+
+    data->task.single  = 0;
+    data->task.section = 0;
+    data->task.dynamic = 0;
+
+    thread_data = &data->thread;
+    thread_data->team           = NULL;
+    thread_data->task           = &data->task;
+    thread_data->thread_num     = 0;
+    thread_data->parallel       = FALSE;
+    thread_data->fork_threads   = 0;
+    thread_data->single         = 1;
+    thread_data->section        = 1;
+    thread_data->dynamic        = 1;
+    thread_data->dynamic_type   = 0;
+
+    vcomp_set_thread_data(thread_data);
+    return thread_data;
+}
+
+static void vcomp_free_thread_data(void)
+{
+    struct vcomp_thread_data *thread_data = vcomp_get_thread_data();
+    if (!thread_data) return;
+
+    HeapFree(GetProcessHeap(), 0, thread_data);
+    vcomp_set_thread_data(NULL);
+}
+
+static CRITICAL_SECTION *alloc_critsect(void)
+{
+    CRITICAL_SECTION *critsect;
+    if (!(critsect = HeapAlloc(GetProcessHeap(), 0, sizeof(*critsect))))
+    {
+        ERR("could not allocate critical section\n");
+        ExitProcess(1);
+    }
+
+    InitializeCriticalSection(critsect);
+    critsect->DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": critsect");
+    return critsect;
+}
+
+static void destroy_critsect(CRITICAL_SECTION *critsect)
+{
+    if (!critsect) return;
+    critsect->DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(critsect);
+    HeapFree(GetProcessHeap(), 0, critsect);
+}
+
+static inline BOOL critsect_owned_by_current_thread(CRITICAL_SECTION *critsect)
+{
+    return critsect->OwningThread == ULongToHandle(GetCurrentThreadId());
+}
+
+/* Atomic operations. 8 and 16 bit values are updated through a compare and
+ * exchange on the aligned 32 bit word containing them. */
+
+#define DEFINE_ATOMIC_SMALL(name, type, expr) \
+    void CDECL _vcomp_atomic_##name(type *dest, type val) \
+    { \
+        int *word = (int *)((ULONG_PTR)dest & ~(ULONG_PTR)3); \
+        unsigned int shift = ((ULONG_PTR)dest & 3) * 8; \
+        unsigned int mask = ((1u << (sizeof(type) * 8)) - 1) << shift; \
+        int old, new; \
+        type cur; \
+        do \
+        { \
+            old = *word; \
+            cur = (type)((unsigned int)old >> shift); \
+            new = (old & ~mask) | (((unsigned int)(type)(expr) << shift) & mask); \
+        } while (interlocked_cmpxchg(word, new, old) != old); \
+    }
+
+#define DEFINE_ATOMIC_I4(name, type, expr) \
+    void CDECL _vcomp_atomic_##name(type *dest, type val) \
+    { \
+        type cur; \
+        do cur = *dest; \
+        while ((type)interlocked_cmpxchg((int *)dest, (int)(expr), (int)cur) != cur); \
+    }
+
+#define DEFINE_ATOMIC_I8(name, type, expr) \
+    void CDECL _vcomp_atomic_##name(type *dest, type val) \
+    { \
+        type cur; \
+        do cur = *dest; \
+        while ((type)interlocked_cmpxchg64((__int64 *)dest, (__int64)(expr), (__int64)cur) != cur); \
+    }
+
+/* the shift count of the 64-bit shifts is still a 32-bit value */
+#define DEFINE_ATOMIC_SHIFT_I8(name, type, expr) \
+    void CDECL _vcomp_atomic_##name(type *dest, unsigned int val) \
+    { \
+        type cur; \
+        do cur = *dest; \
+        while ((type)interlocked_cmpxchg64((__int64 *)dest, (__int64)(expr), (__int64)cur) != cur); \
+    }
+
+#define DEFINE_ATOMIC_R4(name, expr) \
+    void CDECL _vcomp_atomic_##name(float *dest, float val) \
+    { \
+        union { float f; int i; } cur, new; \
+        do \
+        { \
+            cur.i = *(int *)dest; \
+            new.f = (expr); \
+        } while (interlocked_cmpxchg((int *)dest, new.i, cur.i) != cur.i); \
+    }
+
+#define DEFINE_ATOMIC_R8(name, expr) \
+    void CDECL _vcomp_atomic_##name(double *dest, double val) \
+    { \
+        union { double f; __int64 i; } cur, new; \
+        do \
+        { \
+            cur.i = *(__int64 *)dest; \
+            new.f = (expr); \
+        } while (interlocked_cmpxchg64((__int64 *)dest, new.i, cur.i) != cur.i); \
+    }
+
+DEFINE_ATOMIC_SMALL(add_i1,     char,           cur + val)
+DEFINE_ATOMIC_SMALL(and_i1,     char,           cur & val)
+DEFINE_ATOMIC_SMALL(div_i1,     char,           cur / val)
+DEFINE_ATOMIC_SMALL(div_ui1,    unsigned char,  cur / val)
+DEFINE_ATOMIC_SMALL(mul_i1,     char,           cur * val)
+DEFINE_ATOMIC_SMALL(or_i1,      char,           cur | val)
+DEFINE_ATOMIC_SMALL(shl_i1,     char,           cur << val)
+DEFINE_ATOMIC_SMALL(shr_i1,     char,           cur >> val)
+DEFINE_ATOMIC_SMALL(shr_ui1,    unsigned char,  cur >> val)
+DEFINE_ATOMIC_SMALL(sub_i1,     char,           cur - val)
+DEFINE_ATOMIC_SMALL(xor_i1,     char,           cur ^ val)
+static DEFINE_ATOMIC_SMALL(bool_and_i1, char,   cur && val)
+static DEFINE_ATOMIC_SMALL(bool_or_i1,  char,   cur || val)
+
+DEFINE_ATOMIC_SMALL(add_i2,     short,          cur + val)
+DEFINE_ATOMIC_SMALL(and_i2,     short,          cur & val)
+DEFINE_ATOMIC_SMALL(div_i2,     short,          cur / val)
+DEFINE_ATOMIC_SMALL(div_ui2,    unsigned short, cur / val)
+DEFINE_ATOMIC_SMALL(mul_i2,     short,          cur * val)
+DEFINE_ATOMIC_SMALL(or_i2,      short,          cur | val)
+DEFINE_ATOMIC_SMALL(shl_i2,     short,          cur << val)
+DEFINE_ATOMIC_SMALL(shr_i2,     short,          cur >> val)
+DEFINE_ATOMIC_SMALL(shr_ui2,    unsigned short, cur >> val)
+DEFINE_ATOMIC_SMALL(sub_i2,     short,          cur - val)
+DEFINE_ATOMIC_SMALL(xor_i2,     short,          cur ^ val)
+static DEFINE_ATOMIC_SMALL(bool_and_i2, short,  cur && val)
+static DEFINE_ATOMIC_SMALL(bool_or_i2,  short,  cur || val)
+
+void CDECL _vcomp_atomic_add_i4(int *dest, int val)
+{
+    interlocked_xchg_add(dest, val);
+}
+
+void CDECL _vcomp_atomic_sub_i4(int *dest, int val)
+{
+    interlocked_xchg_add(dest, -val);
+}
+
+DEFINE_ATOMIC_I4(and_i4,        int,            cur & val)
+DEFINE_ATOMIC_I4(div_i4,        int,            cur / val)
+DEFINE_ATOMIC_I4(div_ui4,       unsigned int,   cur / val)
+DEFINE_ATOMIC_I4(mul_i4,        int,            cur * val)
+DEFINE_ATOMIC_I4(or_i4,         int,            cur | val)
+DEFINE_ATOMIC_I4(shl_i4,        int,            cur << val)
+DEFINE_ATOMIC_I4(shr_i4,        int,            cur >> val)
+DEFINE_ATOMIC_I4(shr_ui4,       unsigned int,   cur >> val)
+DEFINE_ATOMIC_I4(xor_i4,        int,            cur ^ val)
+static DEFINE_ATOMIC_I4(bool_and_i4, int,       cur && val)
+static DEFINE_ATOMIC_I4(bool_or_i4,  int,       cur || val)
+
+DEFINE_ATOMIC_I8(add_i8,        LONG64,         cur + val)
+DEFINE_ATOMIC_I8(and_i8,        LONG64,         cur & val)
+DEFINE_ATOMIC_I8(div_i8,        LONG64,         cur / val)
+DEFINE_ATOMIC_I8(div_ui8,       ULONG64,        cur / val)
+DEFINE_ATOMIC_I8(mul_i8,        LONG64,         cur * val)
+DEFINE_ATOMIC_I8(or_i8,         LONG64,         cur | val)
+DEFINE_ATOMIC_SHIFT_I8(shl_i8,  LONG64,         cur << val)
+DEFINE_ATOMIC_SHIFT_I8(shr_i8,  LONG64,         cur >> val)
+DEFINE_ATOMIC_SHIFT_I8(shr_ui8, ULONG64,        cur >> val)
+DEFINE_ATOMIC_I8(sub_i8,        LONG64,         cur - val)
+DEFINE_ATOMIC_I8(xor_i8,        LONG64,         cur ^ val)
+static DEFINE_ATOMIC_I8(bool_and_i8, LONG64,    cur && val)
+static DEFINE_ATOMIC_I8(bool_or_i8,  LONG64,    cur || val)
+
+DEFINE_ATOMIC_R4(add_r4,        cur.f + val)
+DEFINE_ATOMIC_R4(div_r4,        cur.f / val)
+DEFINE_ATOMIC_R4(mul_r4,        cur.f * val)
+DEFINE_ATOMIC_R4(sub_r4,        cur.f - val)
+static DEFINE_ATOMIC_R4(bool_and_r4, (cur.f != 0.0f) && (val != 0.0f))
+static DEFINE_ATOMIC_R4(bool_or_r4,  (cur.f != 0.0f) || (val != 0.0f))
+
+DEFINE_ATOMIC_R8(add_r8,        cur.f + val)
+DEFINE_ATOMIC_R8(div_r8,        cur.f / val)
+DEFINE_ATOMIC_R8(mul_r8,        cur.f * val)
+DEFINE_ATOMIC_R8(sub_r8,        cur.f - val)
+static DEFINE_ATOMIC_R8(bool_and_r8, (cur.f != 0.0) && (val != 0.0))
+static DEFINE_ATOMIC_R8(bool_or_r8,  (cur.f != 0.0) || (val != 0.0))
+
+/* The reduction operator is stored in bits 8-11 of the flags: 1 = add
+ * (also used for subtraction), 2 = mul, 3 = and, 4 = or, 5 = xor,
+ * 6 = logical and, 7 = logical or. */
+#define REDUCTION_OP(flags, count) min(((flags) >> 8) & 0xf, (count) - 1)
+
+void CDECL _vcomp_reduction_i1(unsigned int flags, char *dest, char val)
+{
+    static void (CDECL * const funcs[])(char *, char) =
+    {
+        _vcomp_atomic_add_i1,
+        _vcomp_atomic_add_i1,
+        _vcomp_atomic_mul_i1,
+        _vcomp_atomic_and_i1,
+        _vcomp_atomic_or_i1,
+        _vcomp_atomic_xor_i1,
+        _vcomp_atomic_bool_and_i1,
+        _vcomp_atomic_bool_or_i1,
+    };
+    TRACE("(%x, %p, %d)\n", flags, dest, val);
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_i2(unsigned int flags, short *dest, short val)
+{
+    static void (CDECL * const funcs[])(short *, short) =
+    {
+        _vcomp_atomic_add_i2,
+        _vcomp_atomic_add_i2,
+        _vcomp_atomic_mul_i2,
+        _vcomp_atomic_and_i2,
+        _vcomp_atomic_or_i2,
+        _vcomp_atomic_xor_i2,
+        _vcomp_atomic_bool_and_i2,
+        _vcomp_atomic_bool_or_i2,
+    };
+    TRACE("(%x, %p, %d)\n", flags, dest, val);
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_i4(unsigned int flags, int *dest, int val)
+{
+    static void (CDECL * const funcs[])(int *, int) =
+    {
+        _vcomp_atomic_add_i4,
+        _vcomp_atomic_add_i4,
+        _vcomp_atomic_mul_i4,
+        _vcomp_atomic_and_i4,
+        _vcomp_atomic_or_i4,
+        _vcomp_atomic_xor_i4,
+        _vcomp_atomic_bool_and_i4,
+        _vcomp_atomic_bool_or_i4,
+    };
+    TRACE("(%x, %p, %d)\n", flags, dest, val);
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_i8(unsigned int flags, LONG64 *dest, LONG64 val)
+{
+    static void (CDECL * const funcs[])(LONG64 *, LONG64) =
+    {
+        _vcomp_atomic_add_i8,
+        _vcomp_atomic_add_i8,
+        _vcomp_atomic_mul_i8,
+        _vcomp_atomic_and_i8,
+        _vcomp_atomic_or_i8,
+        _vcomp_atomic_xor_i8,
+        _vcomp_atomic_bool_and_i8,
+        _vcomp_atomic_bool_or_i8,
+    };
+    TRACE("(%x, %p, %s)\n", flags, dest, wine_dbgstr_longlong(val));
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_r4(unsigned int flags, float *dest, float val)
+{
+    /* bitwise operators are not valid on floating point values */
+    static void (CDECL * const funcs[])(float *, float) =
+    {
+        _vcomp_atomic_add_r4,
+        _vcomp_atomic_add_r4,
+        _vcomp_atomic_mul_r4,
+        _vcomp_atomic_bool_or_r4,
+        _vcomp_atomic_bool_or_r4,
+        _vcomp_atomic_bool_or_r4,
+        _vcomp_atomic_bool_and_r4,
+        _vcomp_atomic_bool_or_r4,
+    };
+    TRACE("(%x, %p, %f)\n", flags, dest, val);
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_r8(unsigned int flags, double *dest, double val)
+{
+    static void (CDECL * const funcs[])(double *, double) =
+    {
+        _vcomp_atomic_add_r8,
+        _vcomp_atomic_add_r8,
+        _vcomp_atomic_mul_r8,
+        _vcomp_atomic_bool_or_r8,
+        _vcomp_atomic_bool_or_r8,
+        _vcomp_atomic_bool_or_r8,
+        _vcomp_atomic_bool_and_r8,
+        _vcomp_atomic_bool_or_r8,
+    };
+    TRACE("(%x, %p, %f)\n", flags, dest, val);
+    funcs[REDUCTION_OP(flags, sizeof(funcs) / sizeof(funcs[0]))](dest, val);
+}
+
+void CDECL _vcomp_reduction_u1(unsigned int flags, unsigned char *dest, unsigned char val)
+{
+    _vcomp_reduction_i1(flags, (char *)dest, val);
+}
+
+void CDECL _vcomp_reduction_u2(unsigned int flags, unsigned short *dest, unsigned short val)
+{
+    _vcomp_reduction_i2(flags, (short *)dest, val);
+}
+
+void CDECL _vcomp_reduction_u4(unsigned int flags, unsigned int *dest, unsigned int val)
+{
+    _vcomp_reduction_i4(flags, (int *)dest, val);
+}
+
+void CDECL _vcomp_reduction_u8(unsigned int flags, ULONG64 *dest, ULONG64 val)
+{
+    _vcomp_reduction_i8(flags, (LONG64 *)dest, val);
+}
+
 int CDECL omp_get_dynamic(void)
 {
-    TRACE("stub\n");
-    return 0;
+    TRACE("()\n");
+    return vcomp_dynamic_threads;
 }
 
 int CDECL omp_get_max_threads(void)
 {
-    TRACE("stub\n");
-    return 1;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    TRACE("()\n");
+    return thread_data->fork_threads ? thread_data->fork_threads : vcomp_num_threads;
 }
 
 int CDECL omp_get_nested(void)
 {
-    TRACE("stub\n");
-    return 0;
+    TRACE("()\n");
+    return vcomp_nested_fork;
 }
 
 int CDECL omp_get_num_procs(void)
 {
-    TRACE("stub\n");
-    return 1;
+    TRACE("()\n");
+    return vcomp_max_threads;
 }
 
 int CDECL omp_get_num_threads(void)
 {
-    TRACE("stub\n");
-    return 1;
+    struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    TRACE("()\n");
+    return team_data ? team_data->num_threads : 1;
 }
 
 int CDECL omp_get_thread_num(void)
 {
-    TRACE("stub\n");
-    return 0;
+    TRACE("()\n");
+    return vcomp_init_thread_data()->thread_num;
+}
+
+int CDECL _vcomp_get_thread_num(void)
+{
+    TRACE("()\n");
+    return vcomp_init_thread_data()->thread_num;
 }
 
 /* Time in seconds since "some time in the past" */
 double CDECL omp_get_wtime(void)
 {
-    return GetTickCount() / 1000.0;
+    LARGE_INTEGER frequency, counter;
+
+    if (!QueryPerformanceFrequency(&frequency) || !QueryPerformanceCounter(&counter))
+        return GetTickCount() / 1000.0;
+    return (double)counter.QuadPart / frequency.QuadPart;
+}
+
+double CDECL omp_get_wtick(void)
+{
+    LARGE_INTEGER frequency;
+
+    if (!QueryPerformanceFrequency(&frequency))
+        return 0.001;
+    return 1.0 / frequency.QuadPart;
+}
+
+int CDECL omp_in_parallel(void)
+{
+    TRACE("()\n");
+    return vcomp_init_thread_data()->parallel;
 }
 
 void CDECL omp_set_dynamic(int val)
 {
-    TRACE("(%d): stub\n", val);
+    TRACE("(%d)\n", val);
+    vcomp_dynamic_threads = val ? TRUE : FALSE;
 }
 
 void CDECL omp_set_nested(int nested)
 {
-    TRACE("(%d): stub\n", nested);
+    TRACE("(%d)\n", nested);
+    vcomp_nested_fork = nested ? TRUE : FALSE;
 }
 
 void CDECL omp_set_num_threads(int num_threads)
 {
-    TRACE("(%d): stub\n", num_threads);
+    TRACE("(%d)\n", num_threads);
+    if (num_threads >= 1)
+        vcomp_num_threads = num_threads;
+}
+
+void CDECL _vcomp_flush(void)
+{
+    static LONG dummy;
+    TRACE("()\n");
+    /* a locked instruction acts as a full memory barrier */
+    InterlockedExchange(&dummy, 0);
 }
 
 void CDECL _vcomp_barrier(void)
 {
-    TRACE("stub\n");
+    struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+
+    TRACE("()\n");
+
+    if (!team_data)
+        return;
+
+    EnterCriticalSection(&vcomp_section);
+    if (++team_data->barrier_count >= team_data->num_threads)
+    {
+        team_data->barrier++;
+        team_data->barrier_count = 0;
+        WakeAllConditionVariable(&team_data->cond);
+    }
+    else
+    {
+        unsigned int barrier = team_data->barrier;
+        while (team_data->barrier == barrier)
+            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+    }
+    LeaveCriticalSection(&vcomp_section);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
 {
-    TRACE("(%d): stub\n", num_threads);
+    TRACE("(%d)\n", num_threads);
+    if (num_threads >= 1)
+        vcomp_init_thread_data()->fork_threads = num_threads;
+}
+
+int CDECL _vcomp_master_begin(void)
+{
+    TRACE("()\n");
+    return !vcomp_init_thread_data()->thread_num;
+}
+
+void CDECL _vcomp_master_end(void)
+{
+    TRACE("()\n");
+    /* nothing to do here */
 }
 
 int CDECL _vcomp_single_begin(int flags)
 {
-    TRACE("(%x): stub\n", flags);
-    return TRUE;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_task_data *task_data = thread_data->task;
+    int ret = FALSE;
+
+    TRACE("(%x)\n", flags);
+
+    EnterCriticalSection(&vcomp_section);
+    thread_data->single++;
+    if ((int)(thread_data->single - task_data->single) > 0)
+    {
+        task_data->single = thread_data->single;
+        ret = TRUE;
+    }
+    LeaveCriticalSection(&vcomp_section);
+
+    return ret;
 }
 
 void CDECL _vcomp_single_end(void)
 {
-    TRACE("stub\n");
+    TRACE("()\n");
+    /* nothing to do here */
+}
+
+void CDECL _vcomp_enter_critsect(CRITICAL_SECTION **critsect)
+{
+    TRACE("(%p)\n", critsect);
+
+    if (!*critsect)
+    {
+        CRITICAL_SECTION *new_critsect = alloc_critsect();
+        if (interlocked_cmpxchg_ptr((void **)critsect, new_critsect, NULL) != NULL)
+            destroy_critsect(new_critsect);  /* someone beat us to it */
+    }
+
+    EnterCriticalSection(*critsect);
+}
+
+void CDECL _vcomp_leave_critsect(CRITICAL_SECTION *critsect)
+{
+    TRACE("(%p)\n", critsect);
+    LeaveCriticalSection(critsect);
+}
+
+void CDECL omp_init_lock(omp_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    *lock = alloc_critsect();
+}
+
+void CDECL omp_destroy_lock(omp_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    destroy_critsect(*lock);
+}
+
+void CDECL omp_set_lock(omp_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+
+    if (critsect_owned_by_current_thread(*lock))
+    {
+        ERR("omp_set_lock called while holding lock %p\n", *lock);
+        ExitProcess(1);
+    }
+
+    EnterCriticalSection(*lock);
+}
+
+void CDECL omp_unset_lock(omp_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    LeaveCriticalSection(*lock);
+}
+
+int CDECL omp_test_lock(omp_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+
+    if (critsect_owned_by_current_thread(*lock))
+        return 0;
+
+    return TryEnterCriticalSection(*lock);
+}
+
+void CDECL omp_init_nest_lock(omp_nest_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    *lock = alloc_critsect();
+}
+
+void CDECL omp_destroy_nest_lock(omp_nest_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    destroy_critsect(*lock);
+}
+
+void CDECL omp_set_nest_lock(omp_nest_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    EnterCriticalSection(*lock);
+}
+
+void CDECL omp_unset_nest_lock(omp_nest_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    LeaveCriticalSection(*lock);
+}
+
+int CDECL omp_test_nest_lock(omp_nest_lock_t *lock)
+{
+    TRACE("(%p)\n", lock);
+    return TryEnterCriticalSection(*lock) ? (*lock)->RecursionCount : 0;
+}
+
+void CDECL _vcomp_for_static_simple_init(unsigned int first, unsigned int last, int step,
+                                         BOOL increment, unsigned int *begin, unsigned int *end)
+{
+    unsigned int iterations, per_thread, remaining;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    int thread_num = thread_data->thread_num;
+
+    TRACE("(%u, %u, %d, %u, %p, %p)\n", first, last, step, increment, begin, end);
+
+    if (num_threads == 1)
+    {
+        *begin = first;
+        *end   = last;
+        return;
+    }
+
+    if (step <= 0)
+    {
+        *begin = 0;
+        *end   = increment ? -1 : 1;
+        return;
+    }
+
+    if (increment)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    per_thread = iterations / num_threads;
+    remaining  = iterations - per_thread * num_threads;
+
+    if (thread_num < remaining)
+        per_thread++;
+    else if (per_thread)
+        first += remaining * step;
+    else
+    {
+        *begin = first;
+        *end   = first - step;
+        return;
+    }
+
+    *begin = first + per_thread * thread_num * step;
+    *end   = *begin + (per_thread - 1) * step;
+}
+
+void CDECL _vcomp_for_static_simple_init_i8(ULONG64 first, ULONG64 last, LONG64 step,
+                                            BOOL increment, ULONG64 *begin, ULONG64 *end)
+{
+    ULONG64 iterations, per_thread, remaining;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    int thread_num = thread_data->thread_num;
+
+    TRACE("(%s, %s, %s, %x, %p, %p)\n", wine_dbgstr_longlong(first), wine_dbgstr_longlong(last),
+          wine_dbgstr_longlong(step), increment, begin, end);
+
+    if (num_threads == 1)
+    {
+        *begin = first;
+        *end   = last;
+        return;
+    }
+
+    if (step <= 0)
+    {
+        *begin = 0;
+        *end   = increment ? -1 : 1;
+        return;
+    }
+
+    if (increment)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    per_thread = iterations / num_threads;
+    remaining  = iterations - per_thread * num_threads;
+
+    if (thread_num < remaining)
+        per_thread++;
+    else if (per_thread)
+        first += remaining * step;
+    else
+    {
+        *begin = first;
+        *end   = first - step;
+        return;
+    }
+
+    *begin = first + per_thread * thread_num * step;
+    *end   = *begin + (per_thread - 1) * step;
+}
+
+void CDECL _vcomp_for_static_init(int first, int last, int step, int chunksize, unsigned int *loops,
+                                  int *begin, int *end, int *next, int *lastchunk)
+{
+    unsigned int iterations, num_chunks, per_thread, remaining;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    int thread_num = thread_data->thread_num;
+    int no_begin, no_lastchunk;
+
+    TRACE("(%d, %d, %d, %d, %p, %p, %p, %p, %p)\n",
+          first, last, step, chunksize, loops, begin, end, next, lastchunk);
+
+    if (!begin)
+    {
+        begin = &no_begin;
+        lastchunk = &no_lastchunk;
+    }
+
+    if (num_threads == 1 && chunksize != 1)
+    {
+        *loops      = 1;
+        *begin      = first;
+        *end        = last;
+        *next       = 0;
+        *lastchunk  = first;
+        return;
+    }
+
+    if (first == last)
+    {
+        *loops = !thread_num;
+        if (!thread_num)
+        {
+            *begin      = first;
+            *end        = last;
+            *next       = 0;
+            *lastchunk  = first;
+        }
+        return;
+    }
+
+    if (step <= 0)
+    {
+        *loops = 0;
+        return;
+    }
+
+    if (first < last)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    if (chunksize < 1)
+        chunksize = 1;
+
+    num_chunks  = ((DWORD64)iterations + chunksize - 1) / chunksize;
+    per_thread  = num_chunks / num_threads;
+    remaining   = num_chunks - per_thread * num_threads;
+
+    *loops      = per_thread + (thread_num < remaining);
+    *begin      = first + thread_num * chunksize * step;
+    *end        = *begin + (chunksize - 1) * step;
+    *next       = chunksize * num_threads * step;
+    *lastchunk  = first + (num_chunks - 1) * chunksize * step;
+}
+
+void CDECL _vcomp_for_static_init_i8(LONG64 first, LONG64 last, LONG64 step, LONG64 chunksize, ULONG64 *loops,
+                                     LONG64 *begin, LONG64 *end, LONG64 *next, LONG64 *lastchunk)
+{
+    ULONG64 iterations, num_chunks, per_thread, remaining;
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    int thread_num = thread_data->thread_num;
+    LONG64 no_begin, no_lastchunk;
+
+    TRACE("(%s, %s, %s, %s, %p, %p, %p, %p, %p)\n",
+          wine_dbgstr_longlong(first), wine_dbgstr_longlong(last),
+          wine_dbgstr_longlong(step), wine_dbgstr_longlong(chunksize),
+          loops, begin, end, next, lastchunk);
+
+    if (!begin)
+    {
+        begin = &no_begin;
+        lastchunk = &no_lastchunk;
+    }
+
+    if (num_threads == 1 && chunksize != 1)
+    {
+        *loops      = 1;
+        *begin      = first;
+        *end        = last;
+        *next       = 0;
+        *lastchunk  = first;
+        return;
+    }
+
+    if (first == last)
+    {
+        *loops = !thread_num;
+        if (!thread_num)
+        {
+            *begin      = first;
+            *end        = last;
+            *next       = 0;
+            *lastchunk  = first;
+        }
+        return;
+    }
+
+    if (step <= 0)
+    {
+        *loops = 0;
+        return;
+    }
+
+    if (first < last)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    if (chunksize < 1)
+        chunksize = 1;
+
+    num_chunks  = iterations / chunksize;
+    if (iterations % chunksize) num_chunks++;
+    per_thread  = num_chunks / num_threads;
+    remaining   = num_chunks - per_thread * num_threads;
+
+    *loops      = per_thread + (thread_num < remaining);
+    *begin      = first + thread_num * chunksize * step;
+    *end        = *begin + (chunksize - 1) * step;
+    *next       = chunksize * num_threads * step;
+    *lastchunk  = first + (num_chunks - 1) * chunksize * step;
+}
+
+void CDECL _vcomp_for_static_end(void)
+{
+    TRACE("()\n");
+    /* nothing to do here */
+}
+
+/* Shared part of _vcomp_for_dynamic_init and _vcomp_for_dynamic_init_i8. The
+ * iteration count has already been computed with the width of the loop
+ * variable, everything else works modulo the width of the caller. */
+static void vcomp_for_dynamic_init(unsigned int flags, ULONG64 first, ULONG64 last,
+                                   LONG64 step, ULONG64 chunksize, ULONG64 iterations)
+{
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_team_data *team_data = thread_data->team;
+    struct vcomp_task_data *task_data = thread_data->task;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    int thread_num = thread_data->thread_num;
+    unsigned int type = flags & ~VCOMP_DYNAMIC_FLAGS_INCREMENT;
+    ULONG64 per_thread, remaining;
+
+    if (type == VCOMP_DYNAMIC_FLAGS_STATIC)
+    {
+        per_thread = iterations / num_threads;
+        remaining  = iterations - per_thread * num_threads;
+
+        if (thread_num < remaining)
+            per_thread++;
+        else if (per_thread)
+            first += remaining * step;
+        else
+        {
+            thread_data->dynamic_type = 0;
+            return;
+        }
+
+        thread_data->dynamic_type   = VCOMP_DYNAMIC_FLAGS_STATIC;
+        thread_data->dynamic_begin  = first + per_thread * thread_num * step;
+        thread_data->dynamic_end    = thread_data->dynamic_begin + (per_thread - 1) * step;
+        return;
+    }
+
+    if (type != VCOMP_DYNAMIC_FLAGS_CHUNKED &&
+        type != VCOMP_DYNAMIC_FLAGS_GUIDED)
+    {
+        FIXME("unsupported flags %u\n", flags);
+        type = VCOMP_DYNAMIC_FLAGS_GUIDED;
+    }
+
+    if (!chunksize)
+        chunksize = 1;
+
+    EnterCriticalSection(&vcomp_section);
+    thread_data->dynamic++;
+    thread_data->dynamic_type = type;
+    if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
+    {
+        task_data->dynamic              = thread_data->dynamic;
+        task_data->dynamic_first        = first;
+        task_data->dynamic_last         = last;
+        task_data->dynamic_iterations   = iterations;
+        task_data->dynamic_step         = step;
+        task_data->dynamic_chunksize    = chunksize;
+    }
+    LeaveCriticalSection(&vcomp_section);
 }
 
-BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
+static BOOL vcomp_for_dynamic_next(ULONG64 *begin, ULONG64 *end)
 {
-    TRACE("(0x%p, %d, %p)\n", hinstDLL, fdwReason, lpvReserved);
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_task_data *task_data = thread_data->task;
+    struct vcomp_team_data *team_data = thread_data->team;
+    int num_threads = team_data ? team_data->num_threads : 1;
+    ULONG64 iterations = 0;
 
-    switch (fdwReason)
+    if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_STATIC)
+    {
+        *begin = thread_data->dynamic_begin;
+        *end   = thread_data->dynamic_end;
+        thread_data->dynamic_type = 0;
+        return TRUE;
+    }
+
+    if (thread_data->dynamic_type != VCOMP_DYNAMIC_FLAGS_CHUNKED &&
+        thread_data->dynamic_type != VCOMP_DYNAMIC_FLAGS_GUIDED)
+        return FALSE;
+
+    EnterCriticalSection(&vcomp_section);
+    if (thread_data->dynamic == task_data->dynamic &&
+        task_data->dynamic_iterations != 0)
+    {
+        iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+        if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
+            task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+        {
+            iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+        }
+        *begin = task_data->dynamic_first;
+        *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
+        task_data->dynamic_iterations -= iterations;
+        task_data->dynamic_first      += iterations * task_data->dynamic_step;
+        if (!task_data->dynamic_iterations)
+            *end = task_data->dynamic_last;
+    }
+    LeaveCriticalSection(&vcomp_section);
+
+    return iterations != 0;
+}
+
+void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsigned int last,
+                                   int step, unsigned int chunksize)
+{
+    unsigned int iterations;
+
+    TRACE("(%u, %u, %u, %d, %u)\n", flags, first, last, step, chunksize);
+
+    if (step <= 0)
+    {
+        vcomp_init_thread_data()->dynamic_type = 0;
+        return;
+    }
+
+    if (flags & VCOMP_DYNAMIC_FLAGS_INCREMENT)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    vcomp_for_dynamic_init(flags, first, last, step, chunksize, iterations);
+}
+
+void CDECL _vcomp_for_dynamic_init_i8(unsigned int flags, ULONG64 first, ULONG64 last,
+                                      LONG64 step, ULONG64 chunksize)
+{
+    ULONG64 iterations;
+
+    TRACE("(%u, %s, %s, %s, %s)\n", flags, wine_dbgstr_longlong(first),
+          wine_dbgstr_longlong(last), wine_dbgstr_longlong(step),
+          wine_dbgstr_longlong(chunksize));
+
+    if (step <= 0)
+    {
+        vcomp_init_thread_data()->dynamic_type = 0;
+        return;
+    }
+
+    if (flags & VCOMP_DYNAMIC_FLAGS_INCREMENT)
+        iterations = 1 + (last - first) / step;
+    else
+    {
+        iterations = 1 + (first - last) / step;
+        step *= -1;
+    }
+
+    vcomp_for_dynamic_init(flags, first, last, step, chunksize, iterations);
+}
+
+int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
+{
+    ULONG64 begin64, end64;
+
+    TRACE("(%p, %p)\n", begin, end);
+
+    if (!vcomp_for_dynamic_next(&begin64, &end64))
+        return 0;
+
+    *begin = begin64;
+    *end   = end64;
+    return 1;
+}
+
+int CDECL _vcomp_for_dynamic_next_i8(ULONG64 *begin, ULONG64 *end)
+{
+    TRACE("(%p, %p)\n", begin, end);
+    return vcomp_for_dynamic_next(begin, end);
+}
+
+void CDECL _vcomp_sections_init(int n)
+{
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_task_data *task_data = thread_data->task;
+
+    TRACE("(%d)\n", n);
+
+    EnterCriticalSection(&vcomp_section);
+    thread_data->section++;
+    if ((int)(thread_data->section - task_data->section) > 0)
+    {
+        task_data->section       = thread_data->section;
+        task_data->num_sections  = n;
+        task_data->section_index = 0;
+    }
+    LeaveCriticalSection(&vcomp_section);
+}
+
+int CDECL _vcomp_sections_next(void)
+{
+    struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
+    struct vcomp_task_data *task_data = thread_data->task;
+    int i = -1;
+
+    TRACE("()\n");
+
+    EnterCriticalSection(&vcomp_section);
+    if (thread_data->section == task_data->section &&
+        task_data->section_index != task_data->num_sections)
+    {
+        i = task_data->section_index++;
+    }
+    LeaveCriticalSection(&vcomp_section);
+    return i;
+}
+
+static DWORD WINAPI _vcomp_fork_worker(void *param)
+{
+    struct vcomp_thread_data *thread_data = param;
+    vcomp_set_thread_data(thread_data);
+
+    TRACE("starting worker thread for %p\n", thread_data);
+
+    EnterCriticalSection(&vcomp_section);
+    for (;;)
+    {
+        struct vcomp_team_data *team = thread_data->team;
+        if (team != NULL)
+        {
+            LeaveCriticalSection(&vcomp_section);
+            _vcomp_fork_call_wrapper(team->wrapper, team->nargs, team->valist);
+            EnterCriticalSection(&vcomp_section);
+
+            thread_data->team = NULL;
+            list_remove(&thread_data->entry);
+            list_add_tail(&vcomp_idle_threads, &thread_data->entry);
+            if (++team->finished_threads >= team->num_threads)
+                WakeAllConditionVariable(&team->cond);
+        }
+
+        if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, VCOMP_IDLE_TIMEOUT) &&
+            GetLastError() == ERROR_TIMEOUT && !thread_data->team)
+        {
+            break;
+        }
+    }
+    list_remove(&thread_data->entry);
+    LeaveCriticalSection(&vcomp_section);
+
+    TRACE("terminating worker thread for %p\n", thread_data);
+
+    /* the thread data is released on DLL_THREAD_DETACH */
+    FreeLibraryAndExitThread(vcomp_module, 0);
+    return 0;
+}
+
+void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
+{
+    struct vcomp_thread_data *prev_thread_data = vcomp_init_thread_data();
+    struct vcomp_thread_data thread_data;
+    struct vcomp_team_data team_data;
+    struct vcomp_task_data task_data;
+    int num_threads;
+
+    TRACE("(%d, %d, %p, ...)\n", ifval, nargs, wrapper);
+
+    if (!ifval)
+        num_threads = 1;
+    else if (prev_thread_data->parallel && !vcomp_nested_fork)
+        num_threads = 1;
+    else if (prev_thread_data->fork_threads)
+        num_threads = prev_thread_data->fork_threads;
+    else
+        num_threads = vcomp_num_threads;
+
+    InitializeConditionVariable(&team_data.cond);
+    team_data.num_threads       = 1;
+    team_data.finished_threads  = 0;
+    team_data.nargs             = nargs;
+    team_data.wrapper           = wrapper;
+    __ms_va_start(team_data.valist, wrapper);
+    team_data.barrier           = 0;
+    team_data.barrier_count     = 0;
+
+    task_data.single            = 0;
+    task_data.section           = 0;
+    task_data.dynamic           = 0;
+
+    thread_data.team            = &team_data;
+    thread_data.task            = &task_data;
+    thread_data.thread_num      = 0;
+    thread_data.parallel        = ifval || prev_thread_data->parallel;
+    thread_data.fork_threads    = 0;
+    thread_data.single          = 1;
+    thread_data.section         = 1;
+    thread_data.dynamic         = 1;
+    thread_data.dynamic_type    = 0;
+    list_init(&thread_data.entry);
+    InitializeConditionVariable(&thread_data.cond);
+
+    if (num_threads > 1)
+    {
+        struct list *ptr;
+        EnterCriticalSection(&vcomp_section);
+
+        /* reuse existing threads (if any) */
+        while (team_data.num_threads < num_threads && (ptr = list_head(&vcomp_idle_threads)))
+        {
+            struct vcomp_thread_data *data = LIST_ENTRY(ptr, struct vcomp_thread_data, entry);
+            data->team          = &team_data;
+            data->task          = &task_data;
+            data->thread_num    = team_data.num_threads++;
+            data->parallel      = thread_data.parallel;
+            data->fork_threads  = 0;
+            data->single        = 1;
+            data->section       = 1;
+            data->dynamic       = 1;
+            data->dynamic_type  = 0;
+            list_remove(&data->entry);
+            list_add_tail(&thread_data.entry, &data->entry);
+            WakeAllConditionVariable(&data->cond);
+        }
+
+        /* spawn additional threads */
+        while (team_data.num_threads < num_threads)
+        {
+            struct vcomp_thread_data *data;
+            HMODULE module;
+            HANDLE thread;
+
+            if (!(data = HeapAlloc(GetProcessHeap(), 0, sizeof(*data))))
+                break;
+
+            data->team          = &team_data;
+            data->task          = &task_data;
+            data->thread_num    = team_data.num_threads;
+            data->parallel      = thread_data.parallel;
+            data->fork_threads  = 0;
+            data->single        = 1;
+            data->section       = 1;
+            data->dynamic       = 1;
+            data->dynamic_type  = 0;
+            InitializeConditionVariable(&data->cond);
+
+            /* each worker holds a reference on the module until it exits */
+            if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                                    (const WCHAR *)vcomp_module, &module))
+            {
+                HeapFree(GetProcessHeap(), 0, data);
+                break;
+            }
+
+            if (!(thread = CreateThread(NULL, 0, _vcomp_fork_worker, data, 0, NULL)))
+            {
+                FreeLibrary(module);
+                HeapFree(GetProcessHeap(), 0, data);
+                break;
+            }
+
+            team_data.num_threads++;
+            list_add_tail(&thread_data.entry, &data->entry);
+            CloseHandle(thread);
+        }
+
+        LeaveCriticalSection(&vcomp_section);
+    }
+
+    vcomp_set_thread_data(&thread_data);
+    _vcomp_fork_call_wrapper(team_data.wrapper, team_data.nargs, team_data.valist);
+    vcomp_set_thread_data(prev_thread_data);
+    prev_thread_data->fork_threads = 0;
+
+    if (team_data.num_threads > 1)
+    {
+        EnterCriticalSection(&vcomp_section);
+
+        team_data.finished_threads++;
+        while (team_data.finished_threads < team_data.num_threads)
+            SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
+
+        LeaveCriticalSection(&vcomp_section);
+        assert(list_empty(&thread_data.entry));
+    }
+
+    __ms_va_end(team_data.valist);
+}
+
+BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
+{
+    TRACE("(%p, %d, %p)\n", instance, reason, reserved);
+
+    switch (reason)
     {
         case DLL_WINE_PREATTACH:
             return FALSE;    /* prefer native version */
+
         case DLL_PROCESS_ATTACH:
-            DisableThreadLibraryCalls(hinstDLL);
+        {
+            SYSTEM_INFO sysinfo;
+            char buffer[16];
+            int num_threads;
+
+            if ((vcomp_context_tls = TlsAlloc()) == TLS_OUT_OF_INDEXES)
+            {
+                ERR("Failed to allocate TLS index\n");
+                return FALSE;
+            }
+
+            GetSystemInfo(&sysinfo);
+            vcomp_module      = instance;
+            vcomp_max_threads = sysinfo.dwNumberOfProcessors;
+            vcomp_num_threads = sysinfo.dwNumberOfProcessors;
+
+            if (GetEnvironmentVariableA("OMP_NUM_THREADS", buffer, sizeof(buffer)) &&
+                (num_threads = atoi(buffer)) >= 1)
+                vcomp_num_threads = num_threads;
+            break;
+        }
+
+        case DLL_PROCESS_DETACH:
+        {
+            if (reserved) break;
+            if (vcomp_context_tls != TLS_OUT_OF_INDEXES)
+            {
+                vcomp_free_thread_data();
+                TlsFree(vcomp_context_tls);
+            }
+            break;
+        }
+
+        case DLL_THREAD_DETACH:
+        {
+            vcomp_free_thread_data();
             break;
+        }
     }
 
     return TRUE;
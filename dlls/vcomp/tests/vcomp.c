@@ -0,0 +1,737 @@
+/*
+ * Unit tests for vcomp (OpenMP runtime)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "wine/test.h"
+
+#define VCOMP_DYNAMIC_FLAGS_STATIC      0x01
+#define VCOMP_DYNAMIC_FLAGS_CHUNKED     0x02
+#define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
+#define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
+
+#define VCOMP_REDUCTION_FLAGS_ADD       0x100
+#define VCOMP_REDUCTION_FLAGS_MUL       0x200
+#define VCOMP_REDUCTION_FLAGS_AND       0x300
+#define VCOMP_REDUCTION_FLAGS_OR        0x400
+#define VCOMP_REDUCTION_FLAGS_XOR       0x500
+#define VCOMP_REDUCTION_FLAGS_BOOL_AND  0x600
+#define VCOMP_REDUCTION_FLAGS_BOOL_OR   0x700
+
+typedef CRITICAL_SECTION *omp_lock_t;
+typedef CRITICAL_SECTION *omp_nest_lock_t;
+
+static void  (CDECL   *p_vcomp_atomic_add_i1)(char *dest, char val);
+static void  (CDECL   *p_vcomp_atomic_add_i2)(short *dest, short val);
+static void  (CDECL   *p_vcomp_atomic_add_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_atomic_add_i8)(LONG64 *dest, LONG64 val);
+static void  (CDECL   *p_vcomp_atomic_add_r8)(double *dest, double val);
+static void  (CDECL   *p_vcomp_atomic_div_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_atomic_div_r4)(float *dest, float val);
+static void  (CDECL   *p_vcomp_atomic_div_ui4)(unsigned int *dest, unsigned int val);
+static void  (CDECL   *p_vcomp_atomic_mul_i2)(short *dest, short val);
+static void  (CDECL   *p_vcomp_atomic_mul_i8)(LONG64 *dest, LONG64 val);
+static void  (CDECL   *p_vcomp_atomic_shl_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_atomic_shl_i8)(LONG64 *dest, unsigned int val);
+static void  (CDECL   *p_vcomp_atomic_shr_i1)(char *dest, char val);
+static void  (CDECL   *p_vcomp_atomic_shr_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_atomic_shr_ui4)(unsigned int *dest, unsigned int val);
+static void  (CDECL   *p_vcomp_atomic_shr_ui8)(ULONG64 *dest, unsigned int val);
+static void  (CDECL   *p_vcomp_atomic_sub_i1)(char *dest, char val);
+static void  (CDECL   *p_vcomp_atomic_sub_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_atomic_sub_r8)(double *dest, double val);
+static void  (CDECL   *p_vcomp_atomic_xor_i4)(int *dest, int val);
+static void  (CDECL   *p_vcomp_barrier)(void);
+static void  (CDECL   *p_vcomp_enter_critsect)(CRITICAL_SECTION **critsect);
+static void  (CDECL   *p_vcomp_flush)(void);
+static void  (CDECL   *p_vcomp_for_dynamic_init)(unsigned int flags, unsigned int first, unsigned int last,
+                                                 int step, unsigned int chunksize);
+static int   (CDECL   *p_vcomp_for_dynamic_next)(unsigned int *begin, unsigned int *end);
+static void  (CDECL   *p_vcomp_for_static_end)(void);
+static void  (CDECL   *p_vcomp_for_static_init)(int first, int last, int step, int chunksize, unsigned int *loops,
+                                                int *begin, int *end, int *next, int *lastchunk);
+static void  (CDECL   *p_vcomp_for_static_simple_init)(unsigned int first, unsigned int last, int step,
+                                                       BOOL increment, unsigned int *begin, unsigned int *end);
+static void  (WINAPIV *p_vcomp_fork)(BOOL ifval, int nargs, void *wrapper, ...);
+static void  (CDECL   *p_vcomp_leave_critsect)(CRITICAL_SECTION *critsect);
+static int   (CDECL   *p_vcomp_master_begin)(void);
+static void  (CDECL   *p_vcomp_master_end)(void);
+static void  (CDECL   *p_vcomp_reduction_i4)(unsigned int flags, int *dest, int val);
+static void  (CDECL   *p_vcomp_reduction_r8)(unsigned int flags, double *dest, double val);
+static void  (CDECL   *p_vcomp_sections_init)(int n);
+static int   (CDECL   *p_vcomp_sections_next)(void);
+static void  (CDECL   *p_vcomp_set_num_threads)(int num_threads);
+static int   (CDECL   *p_vcomp_single_begin)(int flags);
+static void  (CDECL   *p_vcomp_single_end)(void);
+static void  (CDECL   *pomp_destroy_lock)(omp_lock_t *lock);
+static void  (CDECL   *pomp_destroy_nest_lock)(omp_nest_lock_t *lock);
+static int   (CDECL   *pomp_get_max_threads)(void);
+static int   (CDECL   *pomp_get_num_procs)(void);
+static int   (CDECL   *pomp_get_num_threads)(void);
+static int   (CDECL   *pomp_get_thread_num)(void);
+static double(CDECL   *pomp_get_wtime)(void);
+static int   (CDECL   *pomp_in_parallel)(void);
+static void  (CDECL   *pomp_init_lock)(omp_lock_t *lock);
+static void  (CDECL   *pomp_init_nest_lock)(omp_nest_lock_t *lock);
+static void  (CDECL   *pomp_set_lock)(omp_lock_t *lock);
+static void  (CDECL   *pomp_set_nest_lock)(omp_nest_lock_t *lock);
+static int   (CDECL   *pomp_test_lock)(omp_lock_t *lock);
+static int   (CDECL   *pomp_test_nest_lock)(omp_nest_lock_t *lock);
+static void  (CDECL   *pomp_unset_lock)(omp_lock_t *lock);
+static void  (CDECL   *pomp_unset_nest_lock)(omp_nest_lock_t *lock);
+
+#define NUM_THREADS 4
+
+static BOOL init_vcomp(void)
+{
+    HMODULE vcomp = LoadLibraryA("vcomp.dll");
+    if (!vcomp)
+    {
+        win_skip("vcomp.dll not available\n");
+        return FALSE;
+    }
+
+#define VCOMP_GET_PROC(func) \
+    do \
+    { \
+        p ## func = (void *)GetProcAddress(vcomp, #func); \
+        if (!p ## func) trace("Failed to get address for %s\n", #func); \
+    } \
+    while (0)
+
+    VCOMP_GET_PROC(_vcomp_atomic_add_i1);
+    VCOMP_GET_PROC(_vcomp_atomic_add_i2);
+    VCOMP_GET_PROC(_vcomp_atomic_add_i4);
+    VCOMP_GET_PROC(_vcomp_atomic_add_i8);
+    VCOMP_GET_PROC(_vcomp_atomic_add_r8);
+    VCOMP_GET_PROC(_vcomp_atomic_div_i4);
+    VCOMP_GET_PROC(_vcomp_atomic_div_r4);
+    VCOMP_GET_PROC(_vcomp_atomic_div_ui4);
+    VCOMP_GET_PROC(_vcomp_atomic_mul_i2);
+    VCOMP_GET_PROC(_vcomp_atomic_mul_i8);
+    VCOMP_GET_PROC(_vcomp_atomic_shl_i4);
+    VCOMP_GET_PROC(_vcomp_atomic_shl_i8);
+    VCOMP_GET_PROC(_vcomp_atomic_shr_i1);
+    VCOMP_GET_PROC(_vcomp_atomic_shr_i4);
+    VCOMP_GET_PROC(_vcomp_atomic_shr_ui4);
+    VCOMP_GET_PROC(_vcomp_atomic_shr_ui8);
+    VCOMP_GET_PROC(_vcomp_atomic_sub_i1);
+    VCOMP_GET_PROC(_vcomp_atomic_sub_i4);
+    VCOMP_GET_PROC(_vcomp_atomic_sub_r8);
+    VCOMP_GET_PROC(_vcomp_atomic_xor_i4);
+    VCOMP_GET_PROC(_vcomp_barrier);
+    VCOMP_GET_PROC(_vcomp_enter_critsect);
+    VCOMP_GET_PROC(_vcomp_flush);
+    VCOMP_GET_PROC(_vcomp_for_dynamic_init);
+    VCOMP_GET_PROC(_vcomp_for_dynamic_next);
+    VCOMP_GET_PROC(_vcomp_for_static_end);
+    VCOMP_GET_PROC(_vcomp_for_static_init);
+    VCOMP_GET_PROC(_vcomp_for_static_simple_init);
+    VCOMP_GET_PROC(_vcomp_fork);
+    VCOMP_GET_PROC(_vcomp_leave_critsect);
+    VCOMP_GET_PROC(_vcomp_master_begin);
+    VCOMP_GET_PROC(_vcomp_master_end);
+    VCOMP_GET_PROC(_vcomp_reduction_i4);
+    VCOMP_GET_PROC(_vcomp_reduction_r8);
+    VCOMP_GET_PROC(_vcomp_sections_init);
+    VCOMP_GET_PROC(_vcomp_sections_next);
+    VCOMP_GET_PROC(_vcomp_set_num_threads);
+    VCOMP_GET_PROC(_vcomp_single_begin);
+    VCOMP_GET_PROC(_vcomp_single_end);
+    VCOMP_GET_PROC(omp_destroy_lock);
+    VCOMP_GET_PROC(omp_destroy_nest_lock);
+    VCOMP_GET_PROC(omp_get_max_threads);
+    VCOMP_GET_PROC(omp_get_num_procs);
+    VCOMP_GET_PROC(omp_get_num_threads);
+    VCOMP_GET_PROC(omp_get_thread_num);
+    VCOMP_GET_PROC(omp_get_wtime);
+    VCOMP_GET_PROC(omp_in_parallel);
+    VCOMP_GET_PROC(omp_init_lock);
+    VCOMP_GET_PROC(omp_init_nest_lock);
+    VCOMP_GET_PROC(omp_set_lock);
+    VCOMP_GET_PROC(omp_set_nest_lock);
+    VCOMP_GET_PROC(omp_test_lock);
+    VCOMP_GET_PROC(omp_test_nest_lock);
+    VCOMP_GET_PROC(omp_unset_lock);
+    VCOMP_GET_PROC(omp_unset_nest_lock);
+
+#undef VCOMP_GET_PROC
+    return TRUE;
+}
+
+static void CDECL fork_ptr_cb(LONG *count, LONG *seen, LONG *in_parallel)
+{
+    int thread_num = pomp_get_thread_num();
+
+    InterlockedIncrement(count);
+    if (thread_num >= 0 && thread_num < NUM_THREADS)
+        InterlockedIncrement(&seen[thread_num]);
+    if (pomp_get_num_threads() == NUM_THREADS && pomp_in_parallel())
+        InterlockedIncrement(in_parallel);
+}
+
+static void CDECL fork_nested_cb(LONG *count)
+{
+    ok(pomp_get_num_threads() == 1, "expected 1 thread in nested region, got %d\n", pomp_get_num_threads());
+    ok(pomp_get_thread_num() == 0, "expected thread 0 in nested region, got %d\n", pomp_get_thread_num());
+    InterlockedIncrement(count);
+}
+
+static void CDECL fork_outer_cb(LONG *count)
+{
+    p_vcomp_fork(TRUE, 1, fork_nested_cb, count);
+}
+
+static void CDECL fork_many_args_cb(int *a, int *b, int *c, int *d, int *e, int *f, LONG *count)
+{
+    if (*a == 1 && *b == 2 && *c == 3 && *d == 4 && *e == 5 && *f == 6)
+        InterlockedIncrement(count);
+}
+
+static void test_vcomp_fork(void)
+{
+    LONG count, seen[NUM_THREADS], in_parallel;
+    int a = 1, b = 2, c = 3, d = 4, e = 5, f = 6;
+    int max_threads, i;
+
+    ok(!pomp_in_parallel(), "expected omp_in_parallel to return FALSE\n");
+    ok(pomp_get_num_threads() == 1, "expected 1 thread, got %d\n", pomp_get_num_threads());
+    ok(pomp_get_num_procs() >= 1, "expected at least one processor, got %d\n", pomp_get_num_procs());
+    max_threads = pomp_get_max_threads();
+    ok(max_threads >= 1, "expected at least one thread, got %d\n", max_threads);
+
+    count = in_parallel = 0;
+    memset(seen, 0, sizeof(seen));
+    p_vcomp_set_num_threads(NUM_THREADS);
+    ok(pomp_get_max_threads() == NUM_THREADS, "expected %d, got %d\n", NUM_THREADS, pomp_get_max_threads());
+    p_vcomp_fork(TRUE, 3, fork_ptr_cb, &count, seen, &in_parallel);
+    ok(count == NUM_THREADS, "expected %d threads, got %d\n", NUM_THREADS, count);
+    ok(in_parallel == NUM_THREADS, "expected %d, got %d\n", NUM_THREADS, in_parallel);
+    for (i = 0; i < NUM_THREADS; i++)
+        ok(seen[i] == 1, "thread %d ran %d times\n", i, seen[i]);
+
+    /* the number of threads only applies to the next parallel region */
+    ok(pomp_get_max_threads() == max_threads, "expected %d, got %d\n", max_threads, pomp_get_max_threads());
+
+    count = in_parallel = 0;
+    memset(seen, 0, sizeof(seen));
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(FALSE, 3, fork_ptr_cb, &count, seen, &in_parallel);
+    ok(count == 1, "expected 1 thread, got %d\n", count);
+    ok(seen[0] == 1, "thread 0 ran %d times\n", seen[0]);
+
+    count = 0;
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 1, fork_outer_cb, &count);
+    ok(count == NUM_THREADS, "expected %d nested regions, got %d\n", NUM_THREADS, count);
+
+    count = 0;
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 7, fork_many_args_cb, &a, &b, &c, &d, &e, &f, &count);
+    ok(count == NUM_THREADS, "expected %d, got %d\n", NUM_THREADS, count);
+}
+
+static void CDECL barrier_cb(LONG *counter, LONG *failures)
+{
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        InterlockedIncrement(counter);
+        p_vcomp_barrier();
+        if (*counter != (i + 1) * NUM_THREADS)
+            InterlockedIncrement(failures);
+        p_vcomp_barrier();
+    }
+}
+
+static void test_vcomp_barrier(void)
+{
+    LONG counter = 0, failures = 0;
+
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 2, barrier_cb, &counter, &failures);
+    ok(counter == 100 * NUM_THREADS, "expected %d, got %d\n", 100 * NUM_THREADS, counter);
+    ok(failures == 0, "barrier was crossed early %d times\n", failures);
+
+    /* outside of a parallel region this is a no-op */
+    p_vcomp_barrier();
+}
+
+static void CDECL single_master_cb(LONG *single, LONG *master)
+{
+    int i;
+
+    for (i = 0; i < 10; i++)
+    {
+        if (p_vcomp_single_begin(0))
+            InterlockedIncrement(single);
+        p_vcomp_single_end();
+    }
+
+    if (p_vcomp_master_begin())
+    {
+        ok(pomp_get_thread_num() == 0, "master block executed by thread %d\n", pomp_get_thread_num());
+        InterlockedIncrement(master);
+        p_vcomp_master_end();
+    }
+}
+
+static void test_vcomp_single_master(void)
+{
+    LONG single = 0, master = 0;
+
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 2, single_master_cb, &single, &master);
+    ok(single == 10, "expected 10 single blocks, got %d\n", single);
+    ok(master == 1, "expected 1 master block, got %d\n", master);
+}
+
+static void CDECL sections_cb(LONG *hits)
+{
+    int i;
+
+    /* two consecutive nowait sections */
+    p_vcomp_sections_init(20);
+    while ((i = p_vcomp_sections_next()) != -1)
+    {
+        if (i >= 0 && i < 20) InterlockedIncrement(&hits[i]);
+    }
+
+    p_vcomp_sections_init(10);
+    while ((i = p_vcomp_sections_next()) != -1)
+    {
+        if (i >= 0 && i < 10) InterlockedIncrement(&hits[20 + i]);
+    }
+}
+
+static void test_vcomp_sections(void)
+{
+    LONG hits[30];
+    int i;
+
+    memset(hits, 0, sizeof(hits));
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 1, sections_cb, hits);
+    for (i = 0; i < 30; i++)
+        ok(hits[i] == 1, "section %d executed %d times\n", i, hits[i]);
+}
+
+struct loop_test
+{
+    int first;
+    int last;
+    int step;
+    BOOL increment;
+    int chunksize;
+};
+
+static const struct loop_test loop_tests[] =
+{
+    {  0, 99, 1, TRUE,  1 },
+    {  0, 99, 3, TRUE,  5 },
+    { 99,  0, 1, FALSE, 1 },
+    { 99,  0, 4, FALSE, 7 },
+    {  5,  7, 1, TRUE,  1 },
+    { 10, 10, 1, TRUE,  1 },
+    {  1, 98, 2, TRUE,  100 },
+};
+
+static void check_loop_hits(const struct loop_test *test, const LONG *hits, const char *name)
+{
+    int expected[100], i;
+
+    memset(expected, 0, sizeof(expected));
+    if (test->increment)
+        for (i = test->first; i <= test->last; i += test->step) expected[i] = 1;
+    else
+        for (i = test->first; i >= test->last; i -= test->step) expected[i] = 1;
+
+    for (i = 0; i < 100; i++)
+        ok(hits[i] == expected[i], "%s %d..%d step %d chunk %d: iteration %d executed %d times\n",
+           name, test->first, test->last, test->step, test->chunksize, i, hits[i]);
+}
+
+static void CDECL for_static_simple_cb(const struct loop_test *test, LONG *hits)
+{
+    unsigned int begin, end;
+    int i;
+
+    p_vcomp_for_static_simple_init(test->first, test->last, test->step, test->increment, &begin, &end);
+    if (test->increment)
+    {
+        for (i = begin; i <= (int)end; i += test->step)
+            if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+    }
+    else
+    {
+        for (i = begin; i >= (int)end; i -= test->step)
+            if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+    }
+    p_vcomp_for_static_end();
+}
+
+static void CDECL for_static_cb(const struct loop_test *test, LONG *hits)
+{
+    int begin, end, next, lastchunk, i;
+    unsigned int loops, l;
+
+    p_vcomp_for_static_init(test->first, test->last, test->step, test->chunksize,
+                            &loops, &begin, &end, &next, &lastchunk);
+    for (l = 0; l < loops; l++, begin += next, end += next)
+    {
+        if (test->increment)
+        {
+            for (i = begin; i <= end && i <= test->last; i += test->step)
+                if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+        }
+        else
+        {
+            for (i = begin; i >= end && i >= test->last; i -= test->step)
+                if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+        }
+    }
+    p_vcomp_for_static_end();
+}
+
+static void CDECL for_dynamic_cb(const struct loop_test *test, unsigned int *flags, LONG *hits)
+{
+    unsigned int begin, end;
+    int i;
+
+    p_vcomp_for_dynamic_init(*flags | (test->increment ? VCOMP_DYNAMIC_FLAGS_INCREMENT : 0),
+                             test->first, test->last, test->step, test->chunksize);
+    while (p_vcomp_for_dynamic_next(&begin, &end))
+    {
+        if (test->increment)
+        {
+            for (i = begin; i <= (int)end; i += test->step)
+                if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+        }
+        else
+        {
+            for (i = begin; i >= (int)end; i -= test->step)
+                if (i >= 0 && i < 100) InterlockedIncrement(&hits[i]);
+        }
+    }
+}
+
+static void test_vcomp_for_loops(void)
+{
+    static const unsigned int dynamic_flags[] =
+    {
+        VCOMP_DYNAMIC_FLAGS_STATIC,
+        VCOMP_DYNAMIC_FLAGS_CHUNKED,
+        VCOMP_DYNAMIC_FLAGS_GUIDED,
+    };
+    LONG hits[100];
+    unsigned int i, j, flags;
+
+    for (i = 0; i < sizeof(loop_tests) / sizeof(loop_tests[0]); i++)
+    {
+        const struct loop_test *test = &loop_tests[i];
+
+        memset(hits, 0, sizeof(hits));
+        p_vcomp_set_num_threads(NUM_THREADS);
+        p_vcomp_fork(TRUE, 2, for_static_simple_cb, test, hits);
+        check_loop_hits(test, hits, "static simple");
+
+        memset(hits, 0, sizeof(hits));
+        p_vcomp_set_num_threads(NUM_THREADS);
+        p_vcomp_fork(TRUE, 2, for_static_cb, test, hits);
+        check_loop_hits(test, hits, "static chunked");
+
+        for (j = 0; j < sizeof(dynamic_flags) / sizeof(dynamic_flags[0]); j++)
+        {
+            flags = dynamic_flags[j];
+            memset(hits, 0, sizeof(hits));
+            p_vcomp_set_num_threads(NUM_THREADS);
+            p_vcomp_fork(TRUE, 3, for_dynamic_cb, test, &flags, hits);
+            check_loop_hits(test, hits, flags == VCOMP_DYNAMIC_FLAGS_STATIC ? "dynamic static" :
+                                        flags == VCOMP_DYNAMIC_FLAGS_CHUNKED ? "dynamic chunked" : "guided");
+        }
+
+        /* outside of a parallel region the whole range belongs to the caller */
+        memset(hits, 0, sizeof(hits));
+        for_static_simple_cb(test, hits);
+        check_loop_hits(test, hits, "serial static simple");
+
+        memset(hits, 0, sizeof(hits));
+        flags = VCOMP_DYNAMIC_FLAGS_GUIDED;
+        for_dynamic_cb(test, &flags, hits);
+        check_loop_hits(test, hits, "serial guided");
+    }
+}
+
+static void CDECL critsect_cb(CRITICAL_SECTION **critsect, int *counter)
+{
+    int i, value;
+
+    for (i = 0; i < 1000; i++)
+    {
+        p_vcomp_enter_critsect(critsect);
+        value = *(volatile int *)counter;
+        p_vcomp_flush();
+        *(volatile int *)counter = value + 1;
+        p_vcomp_leave_critsect(*critsect);
+    }
+}
+
+static void test_vcomp_critsect(void)
+{
+    static CRITICAL_SECTION *critsect;
+    int counter = 0;
+
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 2, critsect_cb, &critsect, &counter);
+    ok(critsect != NULL, "critical section was not allocated\n");
+    ok(counter == 1000 * NUM_THREADS, "expected %d, got %d\n", 1000 * NUM_THREADS, counter);
+}
+
+struct atomic_data
+{
+    char    i1[4];
+    short   i2[2];
+    int     i4;
+    LONG64  i8;
+    double  r8;
+};
+
+static void CDECL atomic_cb(struct atomic_data *data)
+{
+    int i;
+
+    for (i = 0; i < 1000; i++)
+    {
+        p_vcomp_atomic_add_i1(&data->i1[1], 1);
+        p_vcomp_atomic_sub_i1(&data->i1[2], 1);
+        p_vcomp_atomic_add_i2(&data->i2[0], 2);
+        p_vcomp_atomic_add_i2(&data->i2[1], -1);
+        p_vcomp_atomic_add_i4(&data->i4, 3);
+        p_vcomp_atomic_add_i8(&data->i8, (LONG64)1 << 32);
+        p_vcomp_atomic_add_r8(&data->r8, 0.5);
+    }
+}
+
+static void test_vcomp_atomic(void)
+{
+    struct atomic_data data;
+    unsigned int u4;
+    ULONG64 u8;
+    LONG64 i8;
+    float r4;
+    double r8;
+    short i2;
+    char i1;
+    int i4;
+
+    i4 = 42;
+    p_vcomp_atomic_sub_i4(&i4, 2);
+    ok(i4 == 40, "expected 40, got %d\n", i4);
+    p_vcomp_atomic_div_i4(&i4, -8);
+    ok(i4 == -5, "expected -5, got %d\n", i4);
+    p_vcomp_atomic_shl_i4(&i4, 2);
+    ok(i4 == -20, "expected -20, got %d\n", i4);
+    p_vcomp_atomic_shr_i4(&i4, 1);
+    ok(i4 == -10, "expected -10, got %d\n", i4);
+    p_vcomp_atomic_xor_i4(&i4, 0xff);
+    ok(i4 == (-10 ^ 0xff), "expected %d, got %d\n", -10 ^ 0xff, i4);
+
+    u4 = 0x80000000;
+    p_vcomp_atomic_shr_ui4(&u4, 4);
+    ok(u4 == 0x08000000, "expected 0x08000000, got %#x\n", u4);
+    u4 = 0xfffffff0;
+    p_vcomp_atomic_div_ui4(&u4, 16);
+    ok(u4 == 0x0fffffff, "expected 0x0fffffff, got %#x\n", u4);
+
+    i1 = -64;
+    p_vcomp_atomic_shr_i1(&i1, 2);
+    ok(i1 == -16, "expected -16, got %d\n", i1);
+
+    i2 = 300;
+    p_vcomp_atomic_mul_i2(&i2, 100);
+    ok(i2 == (short)30000, "expected 30000, got %d\n", i2);
+
+    i8 = (LONG64)1 << 32;
+    p_vcomp_atomic_mul_i8(&i8, 3);
+    ok(i8 == (LONG64)3 << 32, "expected 0x300000000, got %x%08x\n", (DWORD)(i8 >> 32), (DWORD)i8);
+
+    /* the shift count is only 32-bit */
+    i8 = 3;
+    p_vcomp_atomic_shl_i8(&i8, 40);
+    ok(i8 == (LONG64)3 << 40, "expected 0x30000000000, got %x%08x\n", (DWORD)(i8 >> 32), (DWORD)i8);
+    u8 = (ULONG64)1 << 63;
+    p_vcomp_atomic_shr_ui8(&u8, 60);
+    ok(u8 == 8, "expected 8, got %x%08x\n", (DWORD)(u8 >> 32), (DWORD)u8);
+
+    r4 = 3.0f;
+    p_vcomp_atomic_div_r4(&r4, 2.0f);
+    ok(r4 == 1.5f, "expected 1.5, got %f\n", r4);
+
+    r8 = 1.0;
+    p_vcomp_atomic_sub_r8(&r8, 0.25);
+    ok(r8 == 0.75, "expected 0.75, got %f\n", r8);
+
+    memset(&data, 0, sizeof(data));
+    data.i1[0] = 0x55;
+    data.i1[2] = 100;
+    data.i1[3] = 0x66;
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 1, atomic_cb, &data);
+    ok(data.i1[0] == 0x55, "neighbouring byte was modified: %#x\n", data.i1[0]);
+    ok(data.i1[1] == (char)(1000 * NUM_THREADS), "expected %d, got %d\n", (char)(1000 * NUM_THREADS), data.i1[1]);
+    ok(data.i1[2] == (char)(100 - 1000 * NUM_THREADS), "expected %d, got %d\n",
+       (char)(100 - 1000 * NUM_THREADS), data.i1[2]);
+    ok(data.i1[3] == 0x66, "neighbouring byte was modified: %#x\n", data.i1[3]);
+    ok(data.i2[0] == 2000 * NUM_THREADS, "expected %d, got %d\n", 2000 * NUM_THREADS, data.i2[0]);
+    ok(data.i2[1] == -1000 * NUM_THREADS, "expected %d, got %d\n", -1000 * NUM_THREADS, data.i2[1]);
+    ok(data.i4 == 3000 * NUM_THREADS, "expected %d, got %d\n", 3000 * NUM_THREADS, data.i4);
+    ok(data.i8 == ((LONG64)1000 * NUM_THREADS) << 32, "got %x%08x\n", (DWORD)(data.i8 >> 32), (DWORD)data.i8);
+    ok(data.r8 == 500.0 * NUM_THREADS, "expected %f, got %f\n", 500.0 * NUM_THREADS, data.r8);
+}
+
+struct reduction_data
+{
+    int     sum;
+    int     product;
+    int     bits;
+    int     any;
+    int     all;
+    double  sum_r8;
+};
+
+static void CDECL reduction_cb(struct reduction_data *data)
+{
+    int thread_num = pomp_get_thread_num();
+
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_ADD, &data->sum, thread_num + 1);
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_MUL, &data->product, thread_num + 1);
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_OR, &data->bits, 1 << thread_num);
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_BOOL_OR, &data->any, thread_num == 2);
+    p_vcomp_reduction_i4(VCOMP_REDUCTION_FLAGS_BOOL_AND, &data->all, thread_num != 2);
+    p_vcomp_reduction_r8(VCOMP_REDUCTION_FLAGS_ADD, &data->sum_r8, 0.25);
+}
+
+static void test_vcomp_reduction(void)
+{
+    struct reduction_data data;
+
+    data.sum = 0;
+    data.product = 1;
+    data.bits = 0;
+    data.any = 0;
+    data.all = 1;
+    data.sum_r8 = 0.0;
+
+    p_vcomp_set_num_threads(NUM_THREADS);
+    p_vcomp_fork(TRUE, 1, reduction_cb, &data);
+    ok(data.sum == 10, "expected 10, got %d\n", data.sum);
+    ok(data.product == 24, "expected 24, got %d\n", data.product);
+    ok(data.bits == 0xf, "expected 0xf, got %#x\n", data.bits);
+    ok(data.any == 1, "expected 1, got %d\n", data.any);
+    ok(data.all == 0, "expected 0, got %d\n", data.all);
+    ok(data.sum_r8 == 1.0, "expected 1.0, got %f\n", data.sum_r8);
+}
+
+static void test_omp_lock(void)
+{
+    omp_nest_lock_t nest_lock;
+    omp_lock_t lock;
+    int ret;
+
+    pomp_init_lock(&lock);
+    ret = pomp_test_lock(&lock);
+    ok(ret == 1, "expected 1, got %d\n", ret);
+    ret = pomp_test_lock(&lock);
+    ok(ret == 0, "expected 0, got %d\n", ret);
+    pomp_unset_lock(&lock);
+    pomp_set_lock(&lock);
+    pomp_unset_lock(&lock);
+    pomp_destroy_lock(&lock);
+
+    pomp_init_nest_lock(&nest_lock);
+    pomp_set_nest_lock(&nest_lock);
+    pomp_set_nest_lock(&nest_lock);
+    ret = pomp_test_nest_lock(&nest_lock);
+    ok(ret == 3, "expected 3, got %d\n", ret);
+    pomp_unset_nest_lock(&nest_lock);
+    pomp_unset_nest_lock(&nest_lock);
+    pomp_unset_nest_lock(&nest_lock);
+    pomp_destroy_nest_lock(&nest_lock);
+}
+
+#define BENCH_ITERATIONS 4000000
+
+static void CDECL scaling_cb(double *result)
+{
+    unsigned int begin, end, i;
+    double sum = 0.0;
+
+    p_vcomp_for_static_simple_init(0, BENCH_ITERATIONS - 1, 1, TRUE, &begin, &end);
+    for (i = begin; i <= end && i < BENCH_ITERATIONS; i++)
+        sum += sqrt((double)i) / (i + 1.0);
+    p_vcomp_for_static_end();
+
+    p_vcomp_reduction_r8(VCOMP_REDUCTION_FLAGS_ADD, result, sum);
+}
+
+static void test_scaling(void)
+{
+    double start, elapsed, base = 0.0, result, expected = 0.0;
+    int num_threads, max_threads;
+
+    max_threads = min(2 * pomp_get_num_procs(), 16);
+    for (num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    {
+        result = 0.0;
+        start = pomp_get_wtime();
+        p_vcomp_set_num_threads(num_threads);
+        p_vcomp_fork(TRUE, 1, scaling_cb, &result);
+        elapsed = pomp_get_wtime() - start;
+
+        if (num_threads == 1)
+        {
+            base = elapsed;
+            expected = result;
+        }
+        else
+            ok(fabs(result - expected) < 1e-6 * expected, "%d threads: expected %f, got %f\n",
+               num_threads, expected, result);
+
+        trace("%2d threads: %.3f ms, speedup %.2f\n", num_threads, elapsed * 1000.0,
+              elapsed > 0.0 ? base / elapsed : 0.0);
+    }
+}
+
+START_TEST(vcomp)
+{
+    if (!init_vcomp())
+        return;
+
+    test_vcomp_fork();
+    test_vcomp_barrier();
+    test_vcomp_single_master();
+    test_vcomp_sections();
+    test_vcomp_for_loops();
+    test_vcomp_critsect();
+    test_vcomp_atomic();
+    test_vcomp_reduction();
+    test_omp_lock();
+    test_scaling();
+}
@@ -63,6 +63,9 @@
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #ifdef HAVE_SYS_SOCKET_H
 #include <sys/socket.h>
 #endif
@@ -363,6 +366,17 @@ typedef struct ws2_accept_async
     struct ws2_async    *read;
 } ws2_accept_async;
 
+typedef struct ws2_transmit_async
+{
+    HANDLE                    socket;
+    DWORD                     flags;      /* TF_ flags */
+    DWORD                     chunk_len;  /* maximum size of a single send, 0 for no limit */
+    ULONGLONG                 offset;     /* bytes already sent from the current element */
+    unsigned int              cur;        /* element being sent */
+    unsigned int              count;
+    TRANSMIT_PACKETS_ELEMENT  elements[1];
+} ws2_transmit_async;
+
 /****************************************************************/
 
 /* ----------------------------------- internal data */
@@ -415,7 +429,8 @@ static int ws_protocol_info(SOCKET s, int unicode, WSAPROTOCOL_INFOW *buffer, in
 int WSAIOCTL_GetInterfaceCount(void);
 int WSAIOCTL_GetInterfaceName(int intNumber, char *intName);
 
-static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus, ULONG Information );
+static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
+                              ULONG Information, BOOL async );
 
 #define MAP_OPTION(opt) { WS_##opt, opt }
 
@@ -2030,7 +2045,8 @@ static NTSTATUS WS2_async_accept_recv( void *arg, IO_STATUS_BLOCK *iosb, NTSTATU
     if (wsa->user_overlapped->hEvent)
         SetEvent(wsa->user_overlapped->hEvent);
     if (wsa->cvalue)
-        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status, iosb->Information );
+        WS_AddCompletion( HANDLE2SOCKET(wsa->listen_socket), wsa->cvalue, iosb->u.Status,
+                          iosb->Information, TRUE );
 
     *apc = ws2_async_accept_apc;
     return status;
@@ -2495,6 +2511,345 @@ static void WINAPI WS2_GetAcceptExSockaddrs(PVOID buffer, DWORD data_size, DWORD
     *remote_addr = (struct WS_sockaddr *)(cbuf + sizeof(int));
 }
 
+/***********************************************************************
+ *              send_file_data          (INTERNAL)
+ *
+ * Send data from a file to a socket, if possible without copying it
+ * through user space. The offset is -1 for files that can't seek.
+ */
+static ssize_t send_file_data( int sock_fd, int file_fd, LONGLONG offset, size_t len )
+{
+    char buffer[8192];
+    ssize_t ret, count;
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    if (offset != -1)
+    {
+        off_t pos = offset;
+
+        ret = sendfile( sock_fd, file_fd, &pos, len );
+        if (ret >= 0 || (errno != EINVAL && errno != ENOSYS)) return ret;
+    }
+#endif
+#ifdef HAVE_SPLICE
+    if (offset == -1)
+    {
+        /* this works for pipes, which sendfile doesn't support */
+        ret = splice( file_fd, NULL, sock_fd, NULL, len, SPLICE_F_MOVE );
+        if (ret >= 0 || (errno != EINVAL && errno != ENOSYS)) return ret;
+    }
+#endif
+
+    /* fall back to copying the data */
+    if (len > sizeof(buffer)) len = sizeof(buffer);
+    if (offset != -1)
+    {
+        if ((count = pread( file_fd, buffer, len, offset )) <= 0) return count;
+        return send( sock_fd, buffer, count, 0 );
+    }
+
+    /* what we read can't be read again, so we have to send all of it */
+    if ((count = read( file_fd, buffer, len )) <= 0) return count;
+    for (ret = 0; ret < count; )
+    {
+        ssize_t n = send( sock_fd, buffer + ret, count - ret, 0 );
+
+        if (n >= 0) ret += n;
+        else if (errno == EAGAIN) do_block( sock_fd, POLLOUT, -1 );
+        else if (errno != EINTR) return ret ? ret : -1;
+    }
+    return ret;
+}
+
+/***********************************************************************
+ *              WS2_transmit            (INTERNAL)
+ *
+ * Workhorse for TransmitFile and TransmitPackets: send as much of the
+ * elements as possible without blocking.
+ */
+static NTSTATUS WS2_transmit( int fd, struct ws2_transmit_async *wsa, ULONG_PTR *sent )
+{
+    NTSTATUS status;
+
+    while (wsa->cur < wsa->count)
+    {
+        TRANSMIT_PACKETS_ELEMENT *elem = &wsa->elements[wsa->cur];
+        size_t len = wsa->chunk_len ? wsa->chunk_len : 0x40000000;
+        ssize_t ret;
+
+        if (elem->cLength && elem->cLength - wsa->offset < len) len = elem->cLength - wsa->offset;
+        /* only file elements use a zero length to mean everything */
+        if (!(elem->dwElFlags & TP_ELEMENT_FILE) && !elem->cLength) len = 0;
+
+        if (elem->dwElFlags & TP_ELEMENT_FILE)
+        {
+            LONGLONG offset = elem->u.s.nFileOffset.QuadPart;
+            int file_fd;
+
+            if ((status = wine_server_handle_to_fd( elem->u.s.hFile, FILE_READ_DATA, &file_fd, NULL )))
+                return status;
+            ret = send_file_data( fd, file_fd, offset == -1 ? -1 : offset + wsa->offset, len );
+            wine_server_release_fd( elem->u.s.hFile, file_fd );
+        }
+        else if (len) ret = send( fd, (char *)elem->u.pBuffer + wsa->offset, len, 0 );
+        else ret = 0;
+
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) return STATUS_PENDING;
+            return wsaErrStatus();
+        }
+        *sent += ret;
+        wsa->offset += ret;
+
+        /* a file element without length is sent up to the end of file */
+        if (!ret || (elem->cLength && wsa->offset >= elem->cLength))
+        {
+            wsa->cur++;
+            wsa->offset = 0;
+        }
+    }
+
+    if (wsa->flags & (TF_DISCONNECT | TF_REUSE_SOCKET))
+    {
+        if (wsa->flags & TF_REUSE_SOCKET) FIXME( "TF_REUSE_SOCKET not supported, disconnecting only\n" );
+        if (shutdown( fd, SHUT_WR )) WARN( "shutdown failed: %s\n", strerror(errno) );
+        wsa->flags &= ~(TF_DISCONNECT | TF_REUSE_SOCKET);
+    }
+    return STATUS_SUCCESS;
+}
+
+/* user APC called upon transmit completion */
+static void WINAPI ws2_async_transmit_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserved )
+{
+    HeapFree( GetProcessHeap(), 0, arg );
+}
+
+/***********************************************************************
+ *              WS2_async_transmit      (INTERNAL)
+ *
+ * Handler for overlapped TransmitFile and TransmitPackets operations.
+ */
+static NTSTATUS WS2_async_transmit( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS status, void **apc )
+{
+    struct ws2_transmit_async *wsa = user;
+    ULONG_PTR sent = 0;
+    int fd;
+
+    if (status == STATUS_ALERTED)
+    {
+        if (!(status = wine_server_handle_to_fd( wsa->socket, FILE_WRITE_DATA, &fd, NULL )))
+        {
+            status = WS2_transmit( fd, wsa, &sent );
+            wine_server_release_fd( wsa->socket, fd );
+        }
+        iosb->Information += sent;
+    }
+    if (status != STATUS_PENDING)
+    {
+        iosb->u.Status = status;
+        *apc = ws2_async_transmit_apc;
+    }
+    return status;
+}
+
+/***********************************************************************
+ *              WS2_transmit_elements   (INTERNAL)
+ *
+ * Start sending the elements of a TransmitFile or TransmitPackets call.
+ * Takes ownership of wsa.
+ */
+static BOOL WS2_transmit_elements( SOCKET s, struct ws2_transmit_async *wsa, LPOVERLAPPED overlapped )
+{
+    ULONG_PTR cvalue = (overlapped && ((ULONG_PTR)overlapped->hEvent & 1) == 0) ? (ULONG_PTR)overlapped : 0;
+    IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
+    unsigned int i, options;
+    ULONG_PTR sent = 0;
+    NTSTATUS status;
+    int fd;
+
+    for (i = 0; i < wsa->count; i++)
+    {
+        TRANSMIT_PACKETS_ELEMENT *elem = &wsa->elements[i];
+        LARGE_INTEGER zero;
+
+        if (!(elem->dwElFlags & (TP_ELEMENT_MEMORY | TP_ELEMENT_FILE)) ||
+            (elem->dwElFlags & TP_ELEMENT_MEMORY && elem->cLength && !elem->u.pBuffer))
+        {
+            HeapFree( GetProcessHeap(), 0, wsa );
+            SetLastError( WSAEINVAL );
+            return FALSE;
+        }
+        if (!(elem->dwElFlags & TP_ELEMENT_FILE) || elem->u.s.nFileOffset.QuadPart != -1) continue;
+
+        /* start from the current position, unless the file can't seek */
+        zero.QuadPart = 0;
+        if (!SetFilePointerEx( elem->u.s.hFile, zero, &elem->u.s.nFileOffset, FILE_CURRENT ))
+            elem->u.s.nFileOffset.QuadPart = -1;
+    }
+
+    fd = get_sock_fd( s, FILE_WRITE_DATA, &options );
+    TRACE( "fd=%d, options=%x\n", fd, options );
+    if (fd == -1)
+    {
+        HeapFree( GetProcessHeap(), 0, wsa );
+        return FALSE;
+    }
+
+    status = WS2_transmit( fd, wsa, &sent );
+
+    if (overlapped && !(options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT)))
+    {
+        release_sock_fd( s, fd );
+        iosb->Information = sent;
+
+        if (status == STATUS_PENDING)
+        {
+            iosb->u.Status = STATUS_PENDING;
+
+            SERVER_START_REQ( register_async )
+            {
+                req->type           = ASYNC_TYPE_WRITE;
+                req->async.handle   = wine_server_obj_handle( wsa->socket );
+                req->async.callback = wine_server_client_ptr( WS2_async_transmit );
+                req->async.iosb     = wine_server_client_ptr( iosb );
+                req->async.arg      = wine_server_client_ptr( wsa );
+                req->async.event    = wine_server_obj_handle( overlapped->hEvent );
+                req->async.cvalue   = cvalue;
+                status = wine_server_call( req );
+            }
+            SERVER_END_REQ;
+
+            _enable_event( SOCKET2HANDLE(s), FD_WRITE, 0, 0 );
+
+            if (status != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
+            SetLastError( NtStatusToWSAError( status ));
+            return FALSE;
+        }
+
+        HeapFree( GetProcessHeap(), 0, wsa );
+        iosb->u.Status = status;
+        if (status)
+        {
+            SetLastError( NtStatusToWSAError( status ));
+            return FALSE;
+        }
+        if (cvalue && !(options & FD_OPTION_SKIP_SYNC_COMPLETION))
+            WS_AddCompletion( s, cvalue, STATUS_SUCCESS, sent, FALSE );
+        if (overlapped->hEvent) SetEvent( overlapped->hEvent );
+        SetLastError( 0 );
+        return TRUE;
+    }
+
+    /* synchronous operation, wait until everything is sent */
+    while (status == STATUS_PENDING)
+    {
+        if (do_block( fd, POLLOUT, -1 ) == -1) status = wsaErrStatus();
+        else status = WS2_transmit( fd, wsa, &sent );
+    }
+    release_sock_fd( s, fd );
+    HeapFree( GetProcessHeap(), 0, wsa );
+
+    if (status == STATUS_SUCCESS) _enable_event( SOCKET2HANDLE(s), FD_WRITE, 0, 0 );
+    if (overlapped)
+    {
+        iosb->u.Status = status;
+        iosb->Information = sent;
+    }
+    SetLastError( NtStatusToWSAError( status ));
+    return !status;
+}
+
+/***********************************************************************
+ *     TransmitFile
+ */
+static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE file, DWORD total_len, DWORD chunk_len,
+                                     LPOVERLAPPED overlapped, LPTRANSMIT_FILE_BUFFERS buffers,
+                                     DWORD flags )
+{
+    struct ws2_transmit_async *wsa;
+    unsigned int count = 0;
+
+    TRACE( "socket %04lx, file %p, total_len %u, chunk_len %u, ovl %p, buffers %p, flags %x\n",
+           s, file, total_len, chunk_len, overlapped, buffers, flags );
+
+    if (!(wsa = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ws2_transmit_async, elements[3] ))))
+    {
+        SetLastError( WSAEFAULT );
+        return FALSE;
+    }
+    wsa->socket    = SOCKET2HANDLE(s);
+    wsa->flags     = flags;
+    wsa->chunk_len = chunk_len;
+    wsa->offset    = 0;
+    wsa->cur       = 0;
+
+    if (buffers && buffers->HeadLength)
+    {
+        wsa->elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        wsa->elements[count].cLength   = buffers->HeadLength;
+        wsa->elements[count].u.pBuffer = buffers->Head;
+        count++;
+    }
+    if (file)
+    {
+        wsa->elements[count].dwElFlags = TP_ELEMENT_FILE;
+        wsa->elements[count].cLength   = total_len;
+        wsa->elements[count].u.s.hFile = file;
+        /* overlapped operations start at the offset given in the OVERLAPPED structure */
+        if (overlapped)
+            wsa->elements[count].u.s.nFileOffset.QuadPart = ((ULONGLONG)overlapped->u.s.OffsetHigh << 32) |
+                                                            overlapped->u.s.Offset;
+        else
+            wsa->elements[count].u.s.nFileOffset.QuadPart = -1;
+        count++;
+    }
+    if (buffers && buffers->TailLength)
+    {
+        wsa->elements[count].dwElFlags = TP_ELEMENT_MEMORY;
+        wsa->elements[count].cLength   = buffers->TailLength;
+        wsa->elements[count].u.pBuffer = buffers->Tail;
+        count++;
+    }
+    wsa->count = count;
+
+    return WS2_transmit_elements( s, wsa, overlapped );
+}
+
+/***********************************************************************
+ *     TransmitPackets
+ */
+static BOOL WINAPI WS2_TransmitPackets( SOCKET s, LPTRANSMIT_PACKETS_ELEMENT elements, DWORD count,
+                                        DWORD send_size, LPOVERLAPPED overlapped, DWORD flags )
+{
+    struct ws2_transmit_async *wsa;
+
+    TRACE( "socket %04lx, elements %p, count %u, send_size %u, ovl %p, flags %x\n",
+           s, elements, count, send_size, overlapped, flags );
+
+    if (count && !elements)
+    {
+        SetLastError( WSAEFAULT );
+        return FALSE;
+    }
+
+    if (!(wsa = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct ws2_transmit_async, elements[count] ))))
+    {
+        SetLastError( WSAEFAULT );
+        return FALSE;
+    }
+    wsa->socket    = SOCKET2HANDLE(s);
+    wsa->flags     = flags;
+    wsa->chunk_len = send_size == ~0u ? 0 : send_size;
+    wsa->offset    = 0;
+    wsa->cur       = 0;
+    wsa->count     = count;
+    if (count) memcpy( wsa->elements, elements, count * sizeof(*elements) );
+
+    return WS2_transmit_elements( s, wsa, overlapped );
+}
+
 /***********************************************************************
  *     WSASendMsg
  */
@@ -4007,11 +4362,13 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         }
         else if ( IsEqualGUID(&transmitfile_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitFile\n");
+            *(LPFN_TRANSMITFILE *)out_buff = WS2_TransmitFile;
+            break;
         }
         else if ( IsEqualGUID(&transmitpackets_guid, in_buff) )
         {
-            FIXME("SIO_GET_EXTENSION_FUNCTION_POINTER: unimplemented TransmitPackets\n");
+            *(LPFN_TRANSMITPACKETS *)out_buff = WS2_TransmitPackets;
+            break;
         }
         else if ( IsEqualGUID(&wsarecvmsg_guid, in_buff) )
         {
@@ -4167,7 +4524,7 @@ INT WINAPI WSAIoctl(SOCKET s, DWORD code, LPVOID in_buff, DWORD in_size, LPVOID
         overlapped->Internal = status;
         overlapped->InternalHigh = total;
         if (overlapped->hEvent) NtSetEvent( overlapped->hEvent, NULL );
-        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total );
+        if (cvalue) WS_AddCompletion( HANDLE2SOCKET(s), cvalue, status, total, FALSE );
     }
 
     if (!status)
@@ -4437,9 +4794,11 @@ int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
     return ret;
 }
 
-/* helper to send completion messages for client-only i/o operation case */
+/* helper to send completion messages for client-only i/o operation case; callers that know
+ * the fd options don't send it for operations that completed synchronously if the socket
+ * was set to FILE_SKIP_COMPLETION_PORT_ON_SUCCESS, and the server drops it for the others */
 static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS CompletionStatus,
-                              ULONG Information )
+                              ULONG Information, BOOL async )
 {
     SERVER_START_REQ( add_fd_completion )
     {
@@ -4447,6 +4806,7 @@ static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS C
         req->cvalue      = CompletionValue;
         req->status      = CompletionStatus;
         req->information = Information;
+        req->async       = async;
         wine_server_call( req );
     }
     SERVER_END_REQ;
@@ -4592,7 +4952,8 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         if (lpNumberOfBytesSent) *lpNumberOfBytesSent = n;
         if (!wsa->completion_func)
         {
-            if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+            if (cvalue && !(options & FD_OPTION_SKIP_SYNC_COMPLETION))
+                WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
             if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
             HeapFree( GetProcessHeap(), 0, wsa );
         }
@@ -6561,7 +6922,8 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             {
                 int loc_errno = errno;
                 err = wsaErrno();
-                if (cvalue) WS_AddCompletion( s, cvalue, sock_get_ntstatus(loc_errno), 0 );
+                if (cvalue && !(options & FD_OPTION_SKIP_SYNC_COMPLETION))
+                    WS_AddCompletion( s, cvalue, sock_get_ntstatus(loc_errno), 0, FALSE );
                 goto error;
             }
         }
@@ -6603,7 +6965,8 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             iosb->Information = n;
             if (!wsa->completion_func)
             {
-                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+                if (cvalue && !(options & FD_OPTION_SKIP_SYNC_COMPLETION))
+                    WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n, FALSE );
                 if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
                 HeapFree( GetProcessHeap(), 0, wsa );
             }
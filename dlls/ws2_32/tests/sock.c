@@ -70,6 +70,7 @@ static PCSTR (WINAPI *pInetNtop)(INT,LPVOID,LPSTR,ULONG);
 static int   (WINAPI *pWSALookupServiceBeginW)(LPWSAQUERYSETW,DWORD,LPHANDLE);
 static int   (WINAPI *pWSALookupServiceEnd)(HANDLE);
 static int   (WINAPI *pWSALookupServiceNextW)(HANDLE,DWORD,LPDWORD,LPWSAQUERYSETW);
+static BOOL  (WINAPI *pSetFileCompletionNotificationModes)(HANDLE,UCHAR);
 
 /**************** Structs and typedefs ***************/
 
@@ -1142,6 +1143,8 @@ static void Init (void)
     pWSALookupServiceBeginW = (void *)GetProcAddress(hws2_32, "WSALookupServiceBeginW");
     pWSALookupServiceEnd = (void *)GetProcAddress(hws2_32, "WSALookupServiceEnd");
     pWSALookupServiceNextW = (void *)GetProcAddress(hws2_32, "WSALookupServiceNextW");
+    pSetFileCompletionNotificationModes = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"),
+                                                                 "SetFileCompletionNotificationModes");
 
     ok ( WSAStartup ( ver, &data ) == 0, "WSAStartup failed\n" );
     tls = TlsAlloc();
@@ -5729,6 +5732,183 @@ static void test_getaddrinfo(void)
     }
 }
 
+struct transmit_recv_params
+{
+    SOCKET s;
+    char  *buffer;
+    DWORD  size;
+    DWORD  received;
+};
+
+static DWORD WINAPI transmit_recv_thread( void *arg )
+{
+    struct transmit_recv_params *params = arg;
+    int ret;
+
+    params->received = 0;
+    while (params->received < params->size)
+    {
+        ret = recv( params->s, params->buffer + params->received, params->size - params->received, 0 );
+        if (ret <= 0) break;
+        params->received += ret;
+    }
+    return 0;
+}
+
+static void test_TransmitFile(void)
+{
+    static const DWORD file_size = 8 * 1024 * 1024;
+    static char head[] = "head of the transmission", tail[] = "and its tail";
+    GUID transmitFileGuid = WSAID_TRANSMITFILE, transmitPacketsGuid = WSAID_TRANSMITPACKETS;
+    LPFN_TRANSMITFILE pTransmitFile = NULL;
+    LPFN_TRANSMITPACKETS pTransmitPackets = NULL;
+    struct transmit_recv_params params;
+    TRANSMIT_FILE_BUFFERS buffers;
+    TRANSMIT_PACKETS_ELEMENT elements[3];
+    char path[MAX_PATH], temp_path[MAX_PATH], *data, *recv_buf;
+    SOCKET src, dst;
+    OVERLAPPED ov;
+    HANDLE file, thread;
+    DWORD i, bytes, start, elapsed;
+    BOOL bret;
+    int iret;
+
+    if (tcp_socketpair( &src, &dst ))
+    {
+        ok( 0, "creating socket pair failed, skipping test\n" );
+        return;
+    }
+
+    iret = WSAIoctl( src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitFileGuid, sizeof(transmitFileGuid),
+                     &pTransmitFile, sizeof(pTransmitFile), &bytes, NULL, NULL );
+    if (iret)
+    {
+        win_skip( "WSAIoctl failed to get TransmitFile with ret %d + errno %d\n", iret, WSAGetLastError() );
+        closesocket( src );
+        closesocket( dst );
+        return;
+    }
+    iret = WSAIoctl( src, SIO_GET_EXTENSION_FUNCTION_POINTER, &transmitPacketsGuid, sizeof(transmitPacketsGuid),
+                     &pTransmitPackets, sizeof(pTransmitPackets), &bytes, NULL, NULL );
+    ok( !iret, "WSAIoctl failed to get TransmitPackets with ret %d + errno %d\n", iret, WSAGetLastError() );
+
+    data = HeapAlloc( GetProcessHeap(), 0, file_size );
+    recv_buf = HeapAlloc( GetProcessHeap(), 0, file_size + sizeof(head) + sizeof(tail) );
+    for (i = 0; i < file_size; i++) data[i] = i % 251;
+
+    GetTempPathA( MAX_PATH, temp_path );
+    GetTempFileNameA( temp_path, "wt", 0, path );
+    file = CreateFileA( path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_FLAG_DELETE_ON_CLOSE, NULL );
+    ok( file != INVALID_HANDLE_VALUE, "CreateFile failed with error %u\n", GetLastError() );
+    bret = WriteFile( file, data, file_size, &bytes, NULL );
+    ok( bret && bytes == file_size, "WriteFile failed with error %u\n", GetLastError() );
+
+    params.s = dst;
+    params.buffer = recv_buf;
+
+    /* synchronous, the whole file from the current position with head and tail buffers */
+    SetFilePointer( file, 0, NULL, FILE_BEGIN );
+    buffers.Head = head;
+    buffers.HeadLength = sizeof(head);
+    buffers.Tail = tail;
+    buffers.TailLength = sizeof(tail);
+    params.size = sizeof(head) + file_size + sizeof(tail);
+    thread = CreateThread( NULL, 0, transmit_recv_thread, &params, 0, NULL );
+    start = GetTickCount();
+    bret = pTransmitFile( src, file, 0, 0, NULL, &buffers, 0 );
+    ok( bret, "TransmitFile failed with error %d\n", WSAGetLastError() );
+    WaitForSingleObject( thread, INFINITE );
+    elapsed = GetTickCount() - start;
+    CloseHandle( thread );
+    trace( "transmitted %u bytes in %u ms\n", params.received, elapsed );
+    ok( params.received == params.size, "received %u bytes, expected %u\n", params.received, params.size );
+    ok( !memcmp( recv_buf, head, sizeof(head) ), "wrong head\n" );
+    ok( !memcmp( recv_buf + sizeof(head), data, file_size ), "wrong file data\n" );
+    ok( !memcmp( recv_buf + sizeof(head) + file_size, tail, sizeof(tail) ), "wrong tail\n" );
+
+    /* overlapped, starting at the offset given in the OVERLAPPED structure */
+    memset( &ov, 0, sizeof(ov) );
+    ov.hEvent = CreateEventA( NULL, TRUE, FALSE, NULL );
+    ov.Offset = 1000;
+    params.size = 300000;
+    thread = CreateThread( NULL, 0, transmit_recv_thread, &params, 0, NULL );
+    bret = pTransmitFile( src, file, params.size, 4096, &ov, NULL, 0 );
+    ok( bret || WSAGetLastError() == ERROR_IO_PENDING, "TransmitFile failed with error %d\n", WSAGetLastError() );
+    ok( WaitForSingleObject( ov.hEvent, 10000 ) == WAIT_OBJECT_0, "wait failed\n" );
+    bret = GetOverlappedResult( (HANDLE)src, &ov, &bytes, FALSE );
+    ok( bret, "GetOverlappedResult failed with error %u\n", GetLastError() );
+    ok( bytes == params.size, "sent %u bytes, expected %u\n", bytes, params.size );
+    WaitForSingleObject( thread, INFINITE );
+    CloseHandle( thread );
+    ok( params.received == params.size, "received %u bytes, expected %u\n", params.received, params.size );
+    ok( !memcmp( recv_buf, data + 1000, params.size ), "wrong file data\n" );
+
+    /* packets mixing memory and file elements */
+    if (pTransmitPackets)
+    {
+        memset( elements, 0, sizeof(elements) );
+        elements[0].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[0].cLength = sizeof(head);
+        elements[0].pBuffer = head;
+        elements[1].dwElFlags = TP_ELEMENT_FILE;
+        elements[1].cLength = 65536;
+        elements[1].nFileOffset.QuadPart = 12345;
+        elements[1].hFile = file;
+        elements[2].dwElFlags = TP_ELEMENT_MEMORY | TP_ELEMENT_EOP;
+        elements[2].cLength = sizeof(tail);
+        elements[2].pBuffer = tail;
+        params.size = sizeof(head) + 65536 + sizeof(tail);
+        thread = CreateThread( NULL, 0, transmit_recv_thread, &params, 0, NULL );
+        bret = pTransmitPackets( src, elements, 3, 0, NULL, 0 );
+        ok( bret, "TransmitPackets failed with error %d\n", WSAGetLastError() );
+        WaitForSingleObject( thread, INFINITE );
+        CloseHandle( thread );
+        ok( params.received == params.size, "received %u bytes, expected %u\n", params.received, params.size );
+        ok( !memcmp( recv_buf, head, sizeof(head) ), "wrong head\n" );
+        ok( !memcmp( recv_buf + sizeof(head), data + 12345, 65536 ), "wrong file data\n" );
+        ok( !memcmp( recv_buf + sizeof(head) + 65536, tail, sizeof(tail) ), "wrong tail\n" );
+
+        /* a memory element without length sends nothing */
+        memset( elements, 0, sizeof(elements) );
+        elements[0].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[0].cLength = sizeof(head);
+        elements[0].pBuffer = head;
+        elements[1].dwElFlags = TP_ELEMENT_MEMORY;
+        elements[1].cLength = 0;
+        elements[1].pBuffer = tail;
+        elements[2].dwElFlags = TP_ELEMENT_MEMORY | TP_ELEMENT_EOP;
+        elements[2].cLength = sizeof(tail);
+        elements[2].pBuffer = tail;
+        params.size = sizeof(head) + sizeof(tail);
+        thread = CreateThread( NULL, 0, transmit_recv_thread, &params, 0, NULL );
+        bret = pTransmitPackets( src, elements, 3, 0, NULL, 0 );
+        ok( bret, "TransmitPackets failed with error %d\n", WSAGetLastError() );
+        WaitForSingleObject( thread, INFINITE );
+        CloseHandle( thread );
+        ok( params.received == params.size, "received %u bytes, expected %u\n", params.received, params.size );
+        ok( !memcmp( recv_buf, head, sizeof(head) ), "wrong head\n" );
+        ok( !memcmp( recv_buf + sizeof(head), tail, sizeof(tail) ), "wrong tail\n" );
+    }
+
+    /* the receiver sees the end of the stream after a disconnect */
+    params.size = file_size;
+    SetFilePointer( file, 0, NULL, FILE_BEGIN );
+    thread = CreateThread( NULL, 0, transmit_recv_thread, &params, 0, NULL );
+    bret = pTransmitFile( src, file, 1000, 0, NULL, NULL, TF_DISCONNECT );
+    ok( bret, "TransmitFile failed with error %d\n", WSAGetLastError() );
+    ok( WaitForSingleObject( thread, 10000 ) == WAIT_OBJECT_0, "receiver didn't see the disconnect\n" );
+    CloseHandle( thread );
+    ok( params.received == 1000, "received %u bytes, expected 1000\n", params.received );
+
+    CloseHandle( ov.hEvent );
+    CloseHandle( file );
+    HeapFree( GetProcessHeap(), 0, data );
+    HeapFree( GetProcessHeap(), 0, recv_buf );
+    closesocket( src );
+    closesocket( dst );
+}
+
 static void test_ConnectEx(void)
 {
     SOCKET listener = INVALID_SOCKET;
@@ -7424,6 +7604,104 @@ static void test_completion_port(void)
     CloseHandle(previous_port);
 }
 
+static void test_completion_port_skip_on_success(void)
+{
+    static const DWORD count = 20000;
+    HANDLE port;
+    WSAOVERLAPPED ov, *olp;
+    SOCKET src, dst;
+    char buf[64], echo[64];
+    WSABUF send_buf, recv_buf;
+    DWORD i, num_bytes, flags, start, elapsed, pending = 0;
+    ULONG_PTR key;
+    BOOL bret;
+    int iret;
+
+    if (!pSetFileCompletionNotificationModes)
+    {
+        win_skip( "SetFileCompletionNotificationModes not available\n" );
+        return;
+    }
+    if (tcp_socketpair( &src, &dst ))
+    {
+        skip( "failed to create sockets\n" );
+        return;
+    }
+
+    port = CreateIoCompletionPort( (HANDLE)src, NULL, 125, 0 );
+    ok( port != NULL, "Failed to create completion port %u\n", GetLastError() );
+    port = CreateIoCompletionPort( (HANDLE)dst, port, 126, 0 );
+    ok( port != NULL, "Failed to create completion port %u\n", GetLastError() );
+    bret = pSetFileCompletionNotificationModes( (HANDLE)src, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS );
+    ok( bret, "SetFileCompletionNotificationModes failed %u\n", GetLastError() );
+    bret = pSetFileCompletionNotificationModes( (HANDLE)dst, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS );
+    ok( bret, "SetFileCompletionNotificationModes failed %u\n", GetLastError() );
+
+    memset( buf, 'x', sizeof(buf) );
+    memset( &ov, 0, sizeof(ov) );
+    send_buf.buf = buf;
+    send_buf.len = sizeof(buf);
+    recv_buf.buf = echo;
+    recv_buf.len = sizeof(echo);
+
+    /* an operation that succeeds immediately doesn't queue a completion */
+    iret = WSASend( src, &send_buf, 1, &num_bytes, 0, &ov, NULL );
+    ok( !iret, "WSASend failed %d\n", WSAGetLastError() );
+    ok( num_bytes == sizeof(buf), "sent %u bytes\n", num_bytes );
+    bret = GetQueuedCompletionStatus( port, &num_bytes, &key, &olp, 0 );
+    ok( !bret && GetLastError() == WAIT_TIMEOUT, "got completion %d, error %u\n", bret, GetLastError() );
+
+    Sleep( 100 );
+    flags = 0;
+    iret = WSARecv( dst, &recv_buf, 1, &num_bytes, &flags, &ov, NULL );
+    ok( !iret, "WSARecv failed %d\n", WSAGetLastError() );
+    ok( num_bytes == sizeof(buf), "received %u bytes\n", num_bytes );
+    bret = GetQueuedCompletionStatus( port, &num_bytes, &key, &olp, 0 );
+    ok( !bret && GetLastError() == WAIT_TIMEOUT, "got completion %d, error %u\n", bret, GetLastError() );
+
+    /* an operation that has to wait still does */
+    flags = 0;
+    iret = WSARecv( dst, &recv_buf, 1, &num_bytes, &flags, &ov, NULL );
+    ok( iret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING, "WSARecv returned %d, error %d\n",
+        iret, WSAGetLastError() );
+    iret = send( src, buf, sizeof(buf), 0 );
+    ok( iret == sizeof(buf), "send returned %d\n", iret );
+    olp = NULL;
+    bret = GetQueuedCompletionStatus( port, &num_bytes, &key, &olp, 1000 );
+    ok( bret, "GetQueuedCompletionStatus failed %u\n", GetLastError() );
+    ok( key == 126, "key is %lu\n", key );
+    ok( olp == &ov, "overlapped is %p\n", olp );
+    ok( num_bytes == sizeof(buf), "received %u bytes\n", num_bytes );
+
+    /* loopback echo, measuring how many send/recv pairs we can do */
+    start = GetTickCount();
+    for (i = 0; i < count * 2; i++)
+    {
+        SOCKET from = (i & 1) ? dst : src, to = (i & 1) ? src : dst;
+
+        iret = WSASend( from, &send_buf, 1, &num_bytes, 0, &ov, NULL );
+        if (iret) break;
+        flags = 0;
+        iret = WSARecv( to, &recv_buf, 1, &num_bytes, &flags, &ov, NULL );
+        if (iret)
+        {
+            if (WSAGetLastError() != ERROR_IO_PENDING) break;
+            if (!GetQueuedCompletionStatus( port, &num_bytes, &key, &olp, 1000 )) break;
+            pending++;
+        }
+        if (num_bytes != sizeof(buf)) break;
+    }
+    elapsed = GetTickCount() - start;
+    ok( i == count * 2, "echo stopped after %u operations, error %d\n", i, WSAGetLastError() );
+    i /= 2;
+    trace( "%u echo round trips in %u ms (%u pending), %u ops/sec\n", i, elapsed, pending,
+           elapsed ? (DWORD)(i * 1000.0 / elapsed) : 0 );
+
+    closesocket( src );
+    closesocket( dst );
+    CloseHandle( port );
+}
+
 static DWORD WINAPI inet_ntoa_thread_proc(void *param)
 {
     ULONG addr;
@@ -7692,6 +7970,7 @@ START_TEST( sock )
     test_getaddrinfo();
     test_AcceptEx();
     test_ConnectEx();
+    test_TransmitFile();
 
     test_sioRoutingInterfaceQuery();
 
@@ -7701,6 +7980,7 @@ START_TEST( sock )
     test_WSAAsyncGetServByName();
 
     test_completion_port();
+    test_completion_port_skip_on_success();
 
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
@@ -50,6 +50,7 @@ struct __server_request_info
 };
 
 extern unsigned int wine_server_call( void *req_ptr );
+extern unsigned int wine_server_call_batch( struct __server_request_info *reqs, unsigned int count );
 extern void CDECL wine_server_send_fd( int fd );
 extern int CDECL wine_server_fd_to_handle( int fd, unsigned int access, unsigned int attributes, HANDLE *handle );
 extern int CDECL wine_server_handle_to_fd( HANDLE handle, unsigned int access, int *unix_fd, unsigned int *options );
@@ -89,6 +90,15 @@ static inline void wine_server_set_reply( void *req_ptr, void *ptr, data_size_t
     req->u.req.request_header.reply_size = max_size;
 }
 
+/* initialize a request to be sent with wine_server_call_batch */
+static inline void *wine_server_init_req( struct __server_request_info *req, enum request type )
+{
+    memset( &req->u.req, 0, sizeof(req->u.req) );
+    req->u.req.request_header.req = type;
+    req->data_count = 0;
+    return &req->u.req;
+}
+
 /* convert an object handle to a server handle */
 static inline obj_handle_t wine_server_obj_handle( HANDLE handle )
 {
@@ -203,6 +203,55 @@ struct wake_up_reply
 };
 
 
+struct fast_sync_slot
+{
+    int          state;
+    unsigned int max;
+    int          waiters;
+    int          __pad;
+};
+#define FAST_SYNC_LOCKED (-1)
+
+enum fast_sync_type
+{
+    FAST_SYNC_NONE,
+    FAST_SYNC_AUTO_EVENT,
+    FAST_SYNC_MANUAL_EVENT,
+    FAST_SYNC_SEMAPHORE
+};
+#define FAST_SYNC_MAX_SLOTS 65536
+
+
+struct completion_ring_entry
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    unsigned int  seq;
+};
+
+
+#define COMPLETION_RING_SIZE 256
+struct completion_ring
+{
+    int           count;
+    int           waiters;
+    int           overflow;
+    unsigned int  enqueue_pos;
+    unsigned int  dequeue_pos;
+    int           disabled;
+    int           __pad[2];
+    struct completion_ring_entry entries[COMPLETION_RING_SIZE];
+};
+#define COMPLETION_MAX_RINGS 1024
+
+
+#define BATCH_LAST_HANDLE 0xfffffff8
+
+#define BATCH_ALIGN(size) (((size) + 7) & ~7)
+
+
 typedef __int64 timeout_t;
 #define TIMEOUT_INFINITE (((timeout_t)0x7fffffff) << 32 | 0xffffffff)
 
@@ -652,6 +701,25 @@ struct rawinput_device
     user_handle_t  target;
 };
 
+#define PROFILE_HISTOGRAM_SIZE 16
+
+struct request_profile
+{
+    unsigned int   count;
+    unsigned int   max_time;
+    timeout_t      total_time;
+    unsigned int   histogram[PROFILE_HISTOGRAM_SIZE];
+};
+
+struct process_request_profile
+{
+    process_id_t   pid;
+    unsigned int   requests;
+    unsigned int   round_trips;
+    unsigned int   max_time;
+    timeout_t      total_time;
+};
+
 
 
 
@@ -1310,6 +1378,48 @@ struct open_semaphore_reply
 
 
 
+struct get_fast_sync_region_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fast_sync_region_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
+
+struct get_fast_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_fast_sync_reply
+{
+    struct reply_header __header;
+    int          type;
+    unsigned int slot;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+
+struct fast_sync_wake_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct fast_sync_wake_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -1395,6 +1505,7 @@ struct get_handle_fd_reply
     unsigned int access;
     unsigned int options;
 };
+#define FD_OPTION_SKIP_SYNC_COMPLETION 0x01000000
 enum server_fd_type
 {
     FD_TYPE_INVALID,
@@ -4921,6 +5032,48 @@ struct query_completion_reply
 
 
 
+struct get_completion_ring_region_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_completion_ring_region_reply
+{
+    struct reply_header __header;
+    data_size_t   size;
+    char __pad_12[4];
+};
+
+
+
+struct get_completion_ring_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct get_completion_ring_reply
+{
+    struct reply_header __header;
+    int           index;
+    unsigned int  access;
+};
+
+
+
+struct completion_ring_wake_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+    int           stalled;
+    char __pad_20[4];
+};
+struct completion_ring_wake_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct set_completion_info_request
 {
     struct request_header __header;
@@ -4943,7 +5096,7 @@ struct add_fd_completion_request
     apc_param_t    cvalue;
     apc_param_t    information;
     unsigned int   status;
-    char __pad_36[4];
+    int            async;
 };
 struct add_fd_completion_reply
 {
@@ -4952,6 +5105,20 @@ struct add_fd_completion_reply
 
 
 
+struct set_fd_completion_mode_request
+{
+    struct request_header __header;
+    obj_handle_t   handle;
+    unsigned int   flags;
+    char __pad_20[4];
+};
+struct set_fd_completion_mode_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct get_window_layered_info_request
 {
     struct request_header __header;
@@ -5081,6 +5248,52 @@ struct set_suspend_context_reply
 };
 
 
+
+struct call_batch_request
+{
+    struct request_header __header;
+    /* VARARG(requests,bytes); */
+    char __pad_12[4];
+};
+struct call_batch_reply
+{
+    struct reply_header __header;
+    /* VARARG(replies,bytes); */
+};
+
+
+
+struct get_request_profile_request
+{
+    struct request_header __header;
+    unsigned int flags;
+};
+struct get_request_profile_reply
+{
+    struct reply_header __header;
+    timeout_t    start_time;
+    int          enabled;
+    /* VARARG(profile,request_profiles); */
+    char __pad_20[4];
+};
+#define PROFILE_ENABLE  0x01
+#define PROFILE_DISABLE 0x02
+#define PROFILE_RESET   0x04
+
+
+
+struct get_process_request_profile_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_process_request_profile_reply
+{
+    struct reply_header __header;
+    /* VARARG(profile,process_request_profiles); */
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -5121,6 +5334,9 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_fast_sync_region,
+    REQ_get_fast_sync,
+    REQ_fast_sync_wake,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5328,8 +5544,12 @@ enum request
     REQ_add_completion,
     REQ_remove_completion,
     REQ_query_completion,
+    REQ_get_completion_ring_region,
+    REQ_get_completion_ring,
+    REQ_completion_ring_wake,
     REQ_set_completion_info,
     REQ_add_fd_completion,
+    REQ_set_fd_completion_mode,
     REQ_get_window_layered_info,
     REQ_set_window_layered_info,
     REQ_alloc_user_handle,
@@ -5338,6 +5558,9 @@ enum request
     REQ_update_rawinput_devices,
     REQ_get_suspend_context,
     REQ_set_suspend_context,
+    REQ_call_batch,
+    REQ_get_request_profile,
+    REQ_get_process_request_profile,
     REQ_NB_REQUESTS
 };
 
@@ -5383,6 +5606,9 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_fast_sync_region_request get_fast_sync_region_request;
+    struct get_fast_sync_request get_fast_sync_request;
+    struct fast_sync_wake_request fast_sync_wake_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -5590,8 +5816,12 @@ union generic_request
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
     struct query_completion_request query_completion_request;
+    struct get_completion_ring_region_request get_completion_ring_region_request;
+    struct get_completion_ring_request get_completion_ring_request;
+    struct completion_ring_wake_request completion_ring_wake_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
+    struct set_fd_completion_mode_request set_fd_completion_mode_request;
     struct get_window_layered_info_request get_window_layered_info_request;
     struct set_window_layered_info_request set_window_layered_info_request;
     struct alloc_user_handle_request alloc_user_handle_request;
@@ -5600,6 +5830,9 @@ union generic_request
     struct update_rawinput_devices_request update_rawinput_devices_request;
     struct get_suspend_context_request get_suspend_context_request;
     struct set_suspend_context_request set_suspend_context_request;
+    struct call_batch_request call_batch_request;
+    struct get_request_profile_request get_request_profile_request;
+    struct get_process_request_profile_request get_process_request_profile_request;
 };
 union generic_reply
 {
@@ -5643,6 +5876,9 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_fast_sync_region_reply get_fast_sync_region_reply;
+    struct get_fast_sync_reply get_fast_sync_reply;
+    struct fast_sync_wake_reply fast_sync_wake_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -5850,8 +6086,12 @@ union generic_reply
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
     struct query_completion_reply query_completion_reply;
+    struct get_completion_ring_region_reply get_completion_ring_region_reply;
+    struct get_completion_ring_reply get_completion_ring_reply;
+    struct completion_ring_wake_reply completion_ring_wake_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
+    struct set_fd_completion_mode_reply set_fd_completion_mode_reply;
     struct get_window_layered_info_reply get_window_layered_info_reply;
     struct set_window_layered_info_reply set_window_layered_info_reply;
     struct alloc_user_handle_reply alloc_user_handle_reply;
@@ -5860,8 +6100,282 @@ union generic_reply
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
     struct get_suspend_context_reply get_suspend_context_reply;
     struct set_suspend_context_reply set_suspend_context_reply;
-};
-
-#define SERVER_PROTOCOL_VERSION 454
+    struct call_batch_reply call_batch_reply;
+    struct get_request_profile_reply get_request_profile_reply;
+    struct get_process_request_profile_reply get_process_request_profile_reply;
+};
+
+#ifdef WANT_REQUEST_NAMES
+static const char * const server_request_names[REQ_NB_REQUESTS] =
+{
+    "new_process",
+    "get_new_process_info",
+    "new_thread",
+    "get_startup_info",
+    "init_process_done",
+    "init_thread",
+    "terminate_process",
+    "terminate_thread",
+    "get_process_info",
+    "set_process_info",
+    "get_thread_info",
+    "set_thread_info",
+    "get_dll_info",
+    "suspend_thread",
+    "resume_thread",
+    "load_dll",
+    "unload_dll",
+    "queue_apc",
+    "get_apc_result",
+    "close_handle",
+    "set_handle_info",
+    "dup_handle",
+    "open_process",
+    "open_thread",
+    "select",
+    "create_event",
+    "event_op",
+    "query_event",
+    "open_event",
+    "create_keyed_event",
+    "open_keyed_event",
+    "create_mutex",
+    "release_mutex",
+    "open_mutex",
+    "create_semaphore",
+    "release_semaphore",
+    "query_semaphore",
+    "open_semaphore",
+    "get_fast_sync_region",
+    "get_fast_sync",
+    "fast_sync_wake",
+    "create_file",
+    "open_file_object",
+    "alloc_file_handle",
+    "get_handle_unix_name",
+    "get_handle_fd",
+    "flush_file",
+    "lock_file",
+    "unlock_file",
+    "create_socket",
+    "accept_socket",
+    "accept_into_socket",
+    "set_socket_event",
+    "get_socket_event",
+    "get_socket_info",
+    "enable_socket_event",
+    "set_socket_deferred",
+    "alloc_console",
+    "free_console",
+    "get_console_renderer_events",
+    "open_console",
+    "get_console_wait_event",
+    "get_console_mode",
+    "set_console_mode",
+    "set_console_input_info",
+    "get_console_input_info",
+    "append_console_input_history",
+    "get_console_input_history",
+    "create_console_output",
+    "set_console_output_info",
+    "get_console_output_info",
+    "write_console_input",
+    "read_console_input",
+    "write_console_output",
+    "fill_console_output",
+    "read_console_output",
+    "move_console_output",
+    "send_console_signal",
+    "read_directory_changes",
+    "read_change",
+    "create_mapping",
+    "open_mapping",
+    "get_mapping_info",
+    "get_mapping_committed_range",
+    "add_mapping_committed_range",
+    "create_snapshot",
+    "next_process",
+    "next_thread",
+    "wait_debug_event",
+    "queue_exception_event",
+    "get_exception_status",
+    "output_debug_string",
+    "continue_debug_event",
+    "debug_process",
+    "debug_break",
+    "set_debugger_kill_on_exit",
+    "read_process_memory",
+    "write_process_memory",
+    "create_key",
+    "open_key",
+    "delete_key",
+    "flush_key",
+    "enum_key",
+    "set_key_value",
+    "get_key_value",
+    "enum_key_value",
+    "delete_key_value",
+    "load_registry",
+    "unload_registry",
+    "save_registry",
+    "set_registry_notification",
+    "create_timer",
+    "open_timer",
+    "set_timer",
+    "cancel_timer",
+    "get_timer_info",
+    "get_thread_context",
+    "set_thread_context",
+    "get_selector_entry",
+    "add_atom",
+    "delete_atom",
+    "find_atom",
+    "get_atom_information",
+    "set_atom_information",
+    "empty_atom_table",
+    "init_atom_table",
+    "get_msg_queue",
+    "set_queue_fd",
+    "set_queue_mask",
+    "get_queue_status",
+    "get_process_idle_event",
+    "send_message",
+    "post_quit_message",
+    "send_hardware_message",
+    "get_message",
+    "reply_message",
+    "accept_hardware_message",
+    "get_message_reply",
+    "set_win_timer",
+    "kill_win_timer",
+    "is_window_hung",
+    "get_serial_info",
+    "set_serial_info",
+    "register_async",
+    "cancel_async",
+    "ioctl",
+    "get_ioctl_result",
+    "create_named_pipe",
+    "get_named_pipe_info",
+    "create_window",
+    "destroy_window",
+    "get_desktop_window",
+    "set_window_owner",
+    "get_window_info",
+    "set_window_info",
+    "set_parent",
+    "get_window_parents",
+    "get_window_children",
+    "get_window_children_from_point",
+    "get_window_tree",
+    "set_window_pos",
+    "get_window_rectangles",
+    "get_window_text",
+    "set_window_text",
+    "get_windows_offset",
+    "get_visible_region",
+    "get_surface_region",
+    "get_window_region",
+    "set_window_region",
+    "get_update_region",
+    "update_window_zorder",
+    "redraw_window",
+    "set_window_property",
+    "remove_window_property",
+    "get_window_property",
+    "get_window_properties",
+    "create_winstation",
+    "open_winstation",
+    "close_winstation",
+    "get_process_winstation",
+    "set_process_winstation",
+    "enum_winstation",
+    "create_desktop",
+    "open_desktop",
+    "open_input_desktop",
+    "close_desktop",
+    "get_thread_desktop",
+    "set_thread_desktop",
+    "enum_desktop",
+    "set_user_object_info",
+    "register_hotkey",
+    "unregister_hotkey",
+    "attach_thread_input",
+    "get_thread_input",
+    "get_last_input_time",
+    "get_key_state",
+    "set_key_state",
+    "set_foreground_window",
+    "set_focus_window",
+    "set_active_window",
+    "set_capture_window",
+    "set_caret_window",
+    "set_caret_info",
+    "set_hook",
+    "remove_hook",
+    "start_hook_chain",
+    "finish_hook_chain",
+    "get_hook_info",
+    "create_class",
+    "destroy_class",
+    "set_class_info",
+    "set_clipboard_info",
+    "open_token",
+    "set_global_windows",
+    "adjust_token_privileges",
+    "get_token_privileges",
+    "check_token_privileges",
+    "duplicate_token",
+    "access_check",
+    "get_token_sid",
+    "get_token_groups",
+    "get_token_default_dacl",
+    "set_token_default_dacl",
+    "set_security_object",
+    "get_security_object",
+    "create_mailslot",
+    "set_mailslot_info",
+    "create_directory",
+    "open_directory",
+    "get_directory_entry",
+    "create_symlink",
+    "open_symlink",
+    "query_symlink",
+    "get_object_info",
+    "unlink_object",
+    "get_token_impersonation_level",
+    "allocate_locally_unique_id",
+    "create_device_manager",
+    "create_device",
+    "delete_device",
+    "get_next_device_request",
+    "make_process_system",
+    "get_token_statistics",
+    "create_completion",
+    "open_completion",
+    "add_completion",
+    "remove_completion",
+    "query_completion",
+    "get_completion_ring_region",
+    "get_completion_ring",
+    "completion_ring_wake",
+    "set_completion_info",
+    "add_fd_completion",
+    "set_fd_completion_mode",
+    "get_window_layered_info",
+    "set_window_layered_info",
+    "alloc_user_handle",
+    "free_user_handle",
+    "set_cursor",
+    "update_rawinput_devices",
+    "get_suspend_context",
+    "set_suspend_context",
+    "call_batch",
+    "get_request_profile",
+    "get_process_request_profile",
+};
+#endif /* WANT_REQUEST_NAMES */
+
+#define SERVER_PROTOCOL_VERSION 462
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
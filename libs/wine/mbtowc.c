@@ -19,9 +19,65 @@
  */
 
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "wine/unicode.h"
 
+/* copy a run of 7-bit ASCII chars to wide chars, stopping at the first non-ASCII char */
+/* return the number of chars copied; helper for the various mbstowcs functions */
+unsigned int ascii_mbstowcs( const unsigned char *src, unsigned int srclen, WCHAR *dst )
+{
+    unsigned int pos = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    while (srclen - pos >= 16)
+    {
+        __m128i chars = _mm_loadu_si128( (const __m128i *)(src + pos) );
+        if (_mm_movemask_epi8( chars )) break;  /* found a char >= 0x80 */
+        _mm_storeu_si128( (__m128i *)(dst + pos), _mm_unpacklo_epi8( chars, zero ));
+        _mm_storeu_si128( (__m128i *)(dst + pos + 8), _mm_unpackhi_epi8( chars, zero ));
+        pos += 16;
+    }
+#else
+    while (srclen - pos >= sizeof(unsigned long))
+    {
+        unsigned long word;
+        unsigned int i;
+
+        memcpy( &word, src + pos, sizeof(word) );
+        if (word & (~0ul / 0xff * 0x80)) break;  /* found a char >= 0x80 */
+        for (i = 0; i < sizeof(word); i++) dst[pos + i] = src[pos + i];
+        pos += sizeof(word);
+    }
+#endif
+    while (pos < srclen && src[pos] < 0x80)
+    {
+        dst[pos] = src[pos];
+        pos++;
+    }
+    return pos;
+}
+
+#ifdef __SSE2__
+/* last cp2uni table found to map 0x00-0x7f to itself */
+static const WCHAR *ascii_cp2uni;
+
+/* check whether the table maps all the 7-bit ASCII chars to themselves */
+static inline int is_ascii_cp2uni( const WCHAR *cp2uni )
+{
+    unsigned int i;
+
+    if (cp2uni == ascii_cp2uni) return 1;
+    for (i = 0; i < 0x80; i++) if (cp2uni[i] != i) return 0;
+    ascii_cp2uni = cp2uni;
+    return 1;
+}
+#endif
+
 /* get the decomposition of a Unicode char */
 static int get_decomposition( WCHAR src, WCHAR *dst, unsigned int dstlen )
 {
@@ -80,6 +136,26 @@ static inline int mbstowcs_sbcs( const struct sbcs_table *table, int flags,
         ret = -1;
     }
 
+#ifdef __SSE2__  /* the plain table lookup is faster without vector instructions */
+    if (srclen >= 32 && is_ascii_cp2uni( cp2uni ))
+    {
+        /* copy the ASCII runs directly, and only look up the other chars */
+        while (srclen)
+        {
+            unsigned int len = ascii_mbstowcs( src, srclen, dst );
+            src += len;
+            dst += len;
+            srclen -= len;
+            while (srclen && *src >= 0x80)
+            {
+                *dst++ = cp2uni[*src++];
+                srclen--;
+            }
+        }
+        return ret;
+    }
+#endif
+
     for (;;)
     {
         switch(srclen)
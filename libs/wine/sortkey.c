@@ -330,14 +330,64 @@ static inline int real_length(const WCHAR *str, int len)
     return len;
 }
 
+static inline int is_hyphen_or_apostrophe(WCHAR ch)
+{
+    return ch == '-' || ch == '\'';
+}
+
+/* Compare all three weights in a single pass. This is only possible as long as
+ * the strings stay aligned, that is when no symbols are ignored and no hyphen
+ * or apostrophe is skipped; *done is set to 0 when that is not the case.
+ */
+static inline int compare_all_weights(int flags, const WCHAR *str1, int len1,
+                                      const WCHAR *str2, int len2, int *done)
+{
+    unsigned int ce1, ce2;
+    int diacritic = 0, case_diff = 0, ret;
+
+    *done = 0;
+    if (flags & NORM_IGNORESYMBOLS) return 0;
+
+    for (; len1 > 0 && len2 > 0; str1++, str2++, len1--, len2--)
+    {
+        /* identical chars have identical weights */
+        if (*str1 == *str2) continue;
+
+        if (!(flags & SORT_STRINGSORT) &&
+            is_hyphen_or_apostrophe(*str1) != is_hyphen_or_apostrophe(*str2))
+            return 0;
+
+        ce1 = collation_table[collation_table[*str1 >> 8] + (*str1 & 0xff)];
+        ce2 = collation_table[collation_table[*str2 >> 8] + (*str2 & 0xff)];
+
+        if (ce1 == (unsigned int)-1 || ce2 == (unsigned int)-1)
+        {
+            ret = *str1 - *str2;
+            break;
+        }
+        if ((ret = (ce1 >> 16) - (ce2 >> 16))) break;
+        if (!diacritic) diacritic = ((ce1 >> 8) & 0xff) - ((ce2 >> 8) & 0xff);
+        if (!case_diff) case_diff = ((ce1 >> 4) & 0x0f) - ((ce2 >> 4) & 0x0f);
+    }
+    *done = 1;
+    if (len1 > 0 && len2 > 0) return ret;
+    if ((ret = len1 - len2)) return ret;
+    if (!(flags & NORM_IGNORENONSPACE) && diacritic) return diacritic;
+    if (!(flags & NORM_IGNORECASE)) return case_diff;
+    return 0;
+}
+
 int wine_compare_string(int flags, const WCHAR *str1, int len1,
                         const WCHAR *str2, int len2)
 {
-    int ret;
+    int ret, done;
 
     len1 = real_length(str1, len1);
     len2 = real_length(str2, len2);
 
+    ret = compare_all_weights(flags, str1, len1, str2, len2, &done);
+    if (done) return ret;
+
     ret = compare_unicode_weights(flags, str1, len1, str2, len2);
     if (!ret)
     {
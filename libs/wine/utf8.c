@@ -23,6 +23,11 @@
 #include "wine/unicode.h"
 
 extern WCHAR compose( const WCHAR *str );
+extern unsigned int ascii_mbstowcs( const unsigned char *src, unsigned int srclen, WCHAR *dst );
+extern unsigned int ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst );
+
+/* ASCII runs shorter than this are not worth handing to the ascii_* helpers */
+#define MIN_ASCII_RUN 16
 
 /* number of following bytes in sequence based on first byte value (for bytes above 0x7f) */
 static const char utf8_length[128] =
@@ -110,6 +115,14 @@ int wine_utf8_wcstombs( int flags, const WCHAR *src, int srclen, char *dst, int
         {
             if (!len--) return -1;  /* overflow */
             *dst++ = ch;
+            if (srclen > MIN_ASCII_RUN && len >= MIN_ASCII_RUN)
+            {
+                unsigned int count = ascii_wcstombs( src + 1, min( srclen - 1, len ), dst );
+                src += count;
+                srclen -= count;
+                dst += count;
+                len -= count;
+            }
             continue;
         }
 
@@ -243,6 +256,14 @@ static int utf8_mbstowcs_compose( int flags, const char *src, int srclen, WCHAR
         {
             if (dst >= dstend) return -1;  /* overflow */
             *dst++ = composed[0] = ch;
+            if (srcend - src >= MIN_ASCII_RUN && dstend - dst >= MIN_ASCII_RUN)
+            {
+                unsigned int count = ascii_mbstowcs( (const unsigned char *)src,
+                                                     min( srcend - src, dstend - dst ), dst );
+                src += count;
+                dst += count;
+                composed[0] = dst[-1];
+            }
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
@@ -317,6 +338,13 @@ int wine_utf8_mbstowcs( int flags, const char *src, int srclen, WCHAR *dst, int
         if (ch < 0x80)  /* special fast case for 7-bit ASCII */
         {
             *dst++ = ch;
+            if (srcend - src >= MIN_ASCII_RUN && dstend - dst >= MIN_ASCII_RUN)
+            {
+                unsigned int count = ascii_mbstowcs( (const unsigned char *)src,
+                                                     min( srcend - src, dstend - dst ), dst );
+                src += count;
+                dst += count;
+            }
             continue;
         }
         if ((res = decode_utf8_char( ch, &src, srcend )) <= 0xffff)
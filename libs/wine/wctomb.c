@@ -19,9 +19,45 @@
  */
 
 #include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "wine/unicode.h"
 
+#ifdef __SSE2__
+/* last sbcs table found to map 0x00-0x7f to itself */
+static const unsigned char *ascii_uni2cp;
+#endif
+
+/* copy a run of 7-bit ASCII wide chars to chars, stopping at the first non-ASCII char */
+/* return the number of chars copied; helper for the various wcstombs functions */
+unsigned int ascii_wcstombs( const WCHAR *src, unsigned int srclen, char *dst )
+{
+    unsigned int pos = 0;
+
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi16( (short)0xff80 );
+    const __m128i zero = _mm_setzero_si128();
+
+    while (srclen - pos >= 16)
+    {
+        __m128i lo = _mm_loadu_si128( (const __m128i *)(src + pos) );
+        __m128i hi = _mm_loadu_si128( (const __m128i *)(src + pos + 8) );
+        __m128i high_bits = _mm_and_si128( _mm_or_si128( lo, hi ), mask );
+        if (_mm_movemask_epi8( _mm_cmpeq_epi16( high_bits, zero )) != 0xffff) break;
+        _mm_storeu_si128( (__m128i *)(dst + pos), _mm_packus_epi16( lo, hi ));
+        pos += 16;
+    }
+#endif
+    while (pos < srclen && src[pos] < 0x80)
+    {
+        dst[pos] = src[pos];
+        pos++;
+    }
+    return pos;
+}
+
 /* search for a character in the unicode_compose_table; helper for compose() */
 static inline int binary_search( WCHAR ch, int low, int high )
 {
@@ -126,6 +162,20 @@ static int get_length_sbcs( const struct sbcs_table *table, int flags,
     return ret;
 }
 
+#ifdef __SSE2__
+/* check whether the table maps all the 7-bit ASCII chars to themselves */
+static inline int is_ascii_uni2cp( const struct sbcs_table *table )
+{
+    const unsigned char *uni2cp = table->uni2cp_low + table->uni2cp_high[0];
+    unsigned int i;
+
+    if (uni2cp == ascii_uni2cp) return 1;
+    for (i = 0; i < 0x80; i++) if (uni2cp[i] != i) return 0;
+    ascii_uni2cp = uni2cp;
+    return 1;
+}
+#endif
+
 /* wcstombs for single-byte code page */
 static inline int wcstombs_sbcs( const struct sbcs_table *table,
                                  const WCHAR *src, unsigned int srclen,
@@ -142,6 +192,28 @@ static inline int wcstombs_sbcs( const struct sbcs_table *table,
         ret = -1;
     }
 
+#ifdef __SSE2__
+    /* without vector instructions, the unrolled lookups below are as fast as a plain copy */
+    if (srclen >= 32 && is_ascii_uni2cp( table ))
+    {
+        /* copy the ASCII runs directly, and only look up the other chars */
+        while (srclen)
+        {
+            unsigned int len = ascii_wcstombs( src, srclen, dst );
+            src += len;
+            dst += len;
+            srclen -= len;
+            while (srclen && *src >= 0x80)
+            {
+                *dst++ = uni2cp_low[uni2cp_high[*src >> 8] + (*src & 0xff)];
+                src++;
+                srclen--;
+            }
+        }
+        return ret;
+    }
+#endif
+
     while (srclen >= 16)
     {
         dst[0]  = uni2cp_low[uni2cp_high[src[0]  >> 8] + (src[0]  & 0xff)];
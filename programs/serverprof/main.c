@@ -0,0 +1,227 @@
+/*
+ * Wine server request profile dumper
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winbase.h"
+#include "winternl.h"
+#include "tlhelp32.h"
+#define WANT_REQUEST_NAMES
+#include "wine/server.h"
+
+#define MAX_PROCESSES 4096
+
+static struct request_profile profiles[REQ_NB_REQUESTS];
+
+static void usage(void)
+{
+    printf( "Usage: serverprof [options]\n\n"
+            "Display the request statistics collected by the wineserver.\n\n"
+            "Options:\n"
+            "  -e   enable the collection of statistics\n"
+            "  -d   disable the collection of statistics\n"
+            "  -r   reset the statistics once displayed\n"
+            "  -H   display the latency histogram of each request\n"
+            "  -h   display this help message\n" );
+}
+
+/* upper bound of the latency of a given fraction of the calls, in microseconds */
+static unsigned int get_percentile( const struct request_profile *profile, unsigned int percent )
+{
+    unsigned int i, total = 0, limit = (unsigned int)(((ULONGLONG)profile->count * percent + 99) / 100);
+
+    for (i = 0; i < PROFILE_HISTOGRAM_SIZE - 1; i++)
+        if ((total += profile->histogram[i]) >= limit) break;
+    return i ? 1u << i : 1;
+}
+
+static int compare_profiles( const void *ptr1, const void *ptr2 )
+{
+    const struct request_profile *p1 = &profiles[*(const unsigned int *)ptr1];
+    const struct request_profile *p2 = &profiles[*(const unsigned int *)ptr2];
+
+    if (p1->total_time != p2->total_time) return p1->total_time < p2->total_time ? 1 : -1;
+    return p2->count - p1->count;
+}
+
+static int compare_process_profiles( const void *ptr1, const void *ptr2 )
+{
+    const struct process_request_profile *p1 = ptr1;
+    const struct process_request_profile *p2 = ptr2;
+
+    if (p1->total_time != p2->total_time) return p1->total_time < p2->total_time ? 1 : -1;
+    return p2->requests - p1->requests;
+}
+
+static const char *get_process_name( DWORD pid )
+{
+    static char name[MAX_PATH];
+    PROCESSENTRY32 entry;
+    HANDLE snapshot;
+
+    strcpy( name, "?" );
+    if ((snapshot = CreateToolhelp32Snapshot( TH32CS_SNAPPROCESS, 0 )) == INVALID_HANDLE_VALUE)
+        return name;
+    entry.dwSize = sizeof(entry);
+    if (Process32First( snapshot, &entry ))
+    {
+        do
+        {
+            if (entry.th32ProcessID != pid) continue;
+            lstrcpynA( name, entry.szExeFile, sizeof(name) );
+            break;
+        } while (Process32Next( snapshot, &entry ));
+    }
+    CloseHandle( snapshot );
+    return name;
+}
+
+static void dump_requests( unsigned int flags, BOOL histogram )
+{
+    unsigned int i, j, count = 0, order[REQ_NB_REQUESTS];
+    LARGE_INTEGER now;
+    timeout_t start_time;
+    ULONGLONG total = 0;
+    int enabled;
+    NTSTATUS status;
+
+    SERVER_START_REQ( get_request_profile )
+    {
+        req->flags = flags;
+        wine_server_set_reply( req, profiles, sizeof(profiles) );
+        status = wine_server_call( req );
+        start_time = reply->start_time;
+        enabled = reply->enabled;
+    }
+    SERVER_END_REQ;
+
+    if (status)
+    {
+        fprintf( stderr, "serverprof: cannot retrieve the request statistics (%08x)\n", status );
+        exit( 1 );
+    }
+
+    NtQuerySystemTime( &now );
+    printf( "Request profiling is %s, statistics collected over %.1f seconds\n\n",
+            enabled ? "enabled" : "disabled", (now.QuadPart - start_time) / 10000000.0 );
+
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        if (!profiles[i].count) continue;
+        order[count++] = i;
+        total += profiles[i].total_time;
+    }
+    if (!count) return;
+    qsort( order, count, sizeof(order[0]), compare_profiles );
+
+    printf( "%-32s %10s %12s %6s %9s %9s %9s %9s\n",
+            "request", "count", "total (ms)", "%", "avg (us)", "p50 (us)", "p99 (us)", "max (us)" );
+    for (i = 0; i < count; i++)
+    {
+        const struct request_profile *profile = &profiles[order[i]];
+
+        printf( "%-32s %10u %12.3f %6.2f %9.1f %9u %9u %9u\n", server_request_names[order[i]],
+                profile->count, profile->total_time / 1000.0,
+                total ? profile->total_time * 100.0 / total : 0.0,
+                (double)profile->total_time / profile->count,
+                get_percentile( profile, 50 ), get_percentile( profile, 99 ), profile->max_time );
+        if (!histogram) continue;
+        for (j = 0; j < PROFILE_HISTOGRAM_SIZE; j++)
+        {
+            if (!profile->histogram[j]) continue;
+            if (j == PROFILE_HISTOGRAM_SIZE - 1)
+                printf( "    >= %6u us: %u\n", 1u << (j - 1), profile->histogram[j] );
+            else
+                printf( "    <  %6u us: %u\n", 1u << j, profile->histogram[j] );
+        }
+    }
+    printf( "\n" );
+}
+
+static void dump_processes(void)
+{
+    struct process_request_profile *procs;
+    unsigned int i, count = 0;
+    NTSTATUS status;
+
+    if (!(procs = malloc( MAX_PROCESSES * sizeof(*procs) ))) return;
+
+    SERVER_START_REQ( get_process_request_profile )
+    {
+        wine_server_set_reply( req, procs, MAX_PROCESSES * sizeof(*procs) );
+        if (!(status = wine_server_call( req )))
+            count = wine_server_reply_size( reply ) / sizeof(*procs);
+    }
+    SERVER_END_REQ;
+
+    if (status)
+    {
+        fprintf( stderr, "serverprof: cannot retrieve the process statistics (%08x)\n", status );
+        free( procs );
+        exit( 1 );
+    }
+
+    qsort( procs, count, sizeof(*procs), compare_process_profiles );
+
+    printf( "%-8s %-24s %12s %12s %12s %9s\n",
+            "pid", "process", "requests", "round trips", "total (ms)", "max (us)" );
+    for (i = 0; i < count; i++)
+        printf( "%08x %-24.24s %12u %12u %12.3f %9u\n", procs[i].pid, get_process_name( procs[i].pid ),
+                procs[i].requests, procs[i].round_trips, procs[i].total_time / 1000.0, procs[i].max_time );
+    free( procs );
+}
+
+int main( int argc, char *argv[] )
+{
+    unsigned int flags = 0;
+    BOOL histogram = FALSE;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if ((argv[i][0] != '-' && argv[i][0] != '/') || !argv[i][1] || argv[i][2])
+        {
+            usage();
+            return 1;
+        }
+        switch (argv[i][1])
+        {
+        case 'e': flags |= PROFILE_ENABLE; break;
+        case 'd': flags |= PROFILE_DISABLE; break;
+        case 'r': flags |= PROFILE_RESET; break;
+        case 'H': histogram = TRUE; break;
+        case 'h':
+        case '?':
+            usage();
+            return 0;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    dump_requests( flags, histogram );
+    dump_processes();
+    return 0;
+}
@@ -21,16 +21,43 @@
 
 /* FIXMEs:
  *  - built-in wait queues used which means:
- *    + threads are awaken FIFO and not LIFO as native does
  *    + "max concurrent active threads" parameter not used
  *    + completion handle is waitable, while native isn't
  */
 
+/*
+ * As long as there are free rings, every port gets a ring of packets in a
+ * region shared with all clients. Clients post and remove packets with
+ * lock-free operations on the ring, and only need a server round-trip when
+ * a thread has to block, when a waiter blocked in the server has to be
+ * woken up, or when the ring is full. Packets that don't fit are kept in
+ * the server queue and moved into the ring as clients make room for them.
+ *
+ * The ring is a bounded multi-producer multi-consumer queue: each entry has
+ * a sequence number telling whether it can be written or read at a given
+ * position. The count of packets is updated once a packet is fully written,
+ * and a remover first takes one from the count, so it never has to wait for
+ * more than the writer it's racing with.
+ *
+ * Since any client can write to the ring, the server never loops on it for
+ * long, and stops using a ring whose state makes no sense, or whose head
+ * packet never gets written (its writer died or was suspended). The packets
+ * that were written are then moved to the server queue, and clients see the
+ * disabled flag and go back to requests. Fully written packets are taken with
+ * a compare-and-swap of their sequence number, so each one is removed once,
+ * even by a writer that takes its packet back if it finds the ring disabled.
+ */
+
 #include "config.h"
 #include "wine/port.h"
 
+#include <assert.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -46,13 +73,19 @@
 
 struct completion
 {
-    struct object  obj;
-    struct list    queue;
-    unsigned int   depth;
+    struct object           obj;
+    struct list             queue;
+    unsigned int            depth;
+    struct completion_ring *ring;       /* shared ring of packets, if any */
+    struct completion_ring *dead_ring;  /* ring we stopped using, released with the port */
+    unsigned int            stall_pos;  /* ring position clients reported as not written */
+    timeout_t               stall_time; /* when it was first reported */
 };
 
 static void completion_dump( struct object*, int );
 static struct object_type *completion_get_type( struct object *obj );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int completion_map_access( struct object *obj, unsigned int access );
 static void completion_destroy( struct object * );
@@ -62,8 +95,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     completion_dump,           /* dump */
     completion_get_type,       /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    completion_add_queue,      /* add_queue */
+    completion_remove_queue,   /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
     no_signal,                 /* signal */
@@ -86,6 +119,228 @@ struct comp_msg
     unsigned int  status;
 };
 
+#define RING_REGION_SIZE (COMPLETION_MAX_RINGS * sizeof(struct completion_ring))
+#define RING_MAX_RETRIES COMPLETION_RING_SIZE  /* clients can make a lock-free operation retry */
+
+static const timeout_t ring_stall_timeout = TICKS_PER_SEC;  /* time a writer gets to fill its packet */
+
+static int ring_region_fd = -1;             /* fd of the shared region */
+static struct completion_ring *ring_region; /* server mapping of the region */
+static unsigned int nb_used_rings;          /* rings allocated at least once */
+static unsigned int *free_rings;            /* stack of released rings */
+static unsigned int nb_free_rings;
+
+/* create the shared region on first use */
+static int init_ring_region(void)
+{
+    void *ptr;
+
+    if (ring_region) return 1;
+    if (!free_rings && !(free_rings = mem_alloc( COMPLETION_MAX_RINGS * sizeof(*free_rings) )))
+        return 0;
+    if (ring_region_fd == -1 && (ring_region_fd = create_temp_file( RING_REGION_SIZE )) == -1)
+        return 0;
+    if ((ptr = mmap( NULL, RING_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     ring_region_fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        return 0;
+    }
+    ring_region = ptr;
+    return 1;
+}
+
+static struct completion_ring *alloc_ring(void)
+{
+    struct completion_ring *ring;
+    unsigned int i;
+
+    if (!init_ring_region()) return NULL;
+    if (nb_free_rings) ring = ring_region + free_rings[--nb_free_rings];
+    else if (nb_used_rings < COMPLETION_MAX_RINGS) ring = ring_region + nb_used_rings++;
+    else return NULL;
+
+    ring->count       = 0;
+    ring->waiters     = 0;
+    ring->overflow    = 0;
+    ring->enqueue_pos = 0;
+    ring->dequeue_pos = 0;
+    ring->disabled    = 0;
+    for (i = 0; i < COMPLETION_RING_SIZE; i++) ring->entries[i].seq = i;
+    return ring;
+}
+
+static void free_ring( struct completion_ring *ring )
+{
+    assert( ring >= ring_region && ring < ring_region + nb_used_rings );
+    free_rings[nb_free_rings++] = ring - ring_region;
+}
+
+/* append a packet to the ring; fails if it's full (or a remover is lagging behind) */
+static int ring_push( struct completion_ring *ring, apc_param_t ckey, apc_param_t cvalue,
+                      unsigned int status, apc_param_t information )
+{
+    struct completion_ring_entry *entry;
+    unsigned int pos, retries;
+    int diff;
+
+    for (retries = 0; ; retries++)
+    {
+        if (retries == RING_MAX_RETRIES) return 0;  /* the packet will be queued instead */
+        pos = *(volatile unsigned int *)&ring->enqueue_pos;
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        diff = *(volatile unsigned int *)&entry->seq - pos;
+        if (diff < 0) return 0;
+        if (!diff && (unsigned int)interlocked_cmpxchg( (int *)&ring->enqueue_pos, pos + 1, pos ) == pos)
+            break;
+    }
+    entry->ckey        = ckey;
+    entry->cvalue      = cvalue;
+    entry->information = information;
+    entry->status      = status;
+    interlocked_xchg( (int *)&entry->seq, pos + 1 );
+    interlocked_xchg_add( &ring->count, 1 );
+    return 1;
+}
+
+/* remove the first packet of the ring; unlike clients, we don't wait for a writer to finish */
+static int ring_pop( struct completion_ring *ring, struct comp_msg *msg )
+{
+    struct completion_ring_entry *entry;
+    unsigned int pos, retries;
+    int count, diff;
+
+    for (retries = 0; ; retries++)
+    {
+        if (retries == RING_MAX_RETRIES) return 0;
+        if ((count = *(volatile int *)&ring->count) <= 0) return 0;
+        if (interlocked_cmpxchg( &ring->count, count - 1, count ) == count) break;
+    }
+
+    for (retries = 0; retries < RING_MAX_RETRIES; retries++)
+    {
+        pos = *(volatile unsigned int *)&ring->dequeue_pos;
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        diff = *(volatile unsigned int *)&entry->seq - (pos + 1);
+        if (diff < 0) break;
+        if (!diff && (unsigned int)interlocked_cmpxchg( (int *)&ring->dequeue_pos, pos + 1, pos ) == pos)
+        {
+            msg->ckey        = entry->ckey;
+            msg->cvalue      = entry->cvalue;
+            msg->information = entry->information;
+            msg->status      = entry->status;
+            if ((unsigned int)interlocked_cmpxchg( (int *)&entry->seq, pos + COMPLETION_RING_SIZE,
+                                                   pos + 1 ) == pos + 1)
+                return 1;
+            break;  /* a client disabled the ring and took the packet back */
+        }
+    }
+    /* the packet we took from the count is still being written, leave it to the clients */
+    interlocked_xchg_add( &ring->count, 1 );
+    return 0;
+}
+
+/* stop using the ring, moving the packets that were fully written to the server queue */
+static void disable_ring( struct completion *completion )
+{
+    struct completion_ring *ring = completion->ring;
+    struct completion_ring_entry *entry;
+    struct list *prev = &completion->queue;
+    struct comp_msg *msg = NULL;
+    unsigned int i, pos;
+    int moved = 0;
+
+    interlocked_xchg( &ring->disabled, 1 );
+    pos = *(volatile unsigned int *)&ring->dequeue_pos;
+    for (i = 0; i < COMPLETION_RING_SIZE; i++, pos++)
+    {
+        entry = &ring->entries[pos % COMPLETION_RING_SIZE];
+        if (*(volatile unsigned int *)&entry->seq != pos + 1) continue;
+        if (!msg && !(msg = mem_alloc( sizeof(*msg) ))) break;
+        msg->ckey        = entry->ckey;
+        msg->cvalue      = entry->cvalue;
+        msg->information = entry->information;
+        msg->status      = entry->status;
+        /* a client may remove the packet at the same time */
+        if ((unsigned int)interlocked_cmpxchg( (int *)&entry->seq, pos - 1, pos + 1 ) != pos + 1) continue;
+        /* these were posted before the ones that overflowed */
+        list_add_after( prev, &msg->queue_entry );
+        prev = &msg->queue_entry;
+        completion->depth++;
+        msg = NULL;
+        moved++;
+    }
+    free( msg );
+
+    completion->dead_ring = ring;
+    completion->ring = NULL;
+    if (moved) wake_up( &completion->obj, moved );
+}
+
+/* check a ring that clients may have written garbage to, or disabled themselves */
+static void check_ring( struct completion *completion )
+{
+    struct completion_ring *ring = completion->ring;
+    unsigned int end, pos;
+    int count;
+
+    if (!ring) return;
+    if (*(volatile int *)&ring->disabled)
+    {
+        disable_ring( completion );
+        return;
+    }
+    /* read in that order, no sequence of client operations can make these fail */
+    end = *(volatile unsigned int *)&ring->enqueue_pos;
+    pos = *(volatile unsigned int *)&ring->dequeue_pos;
+    count = *(volatile int *)&ring->count;
+    if ((int)(end - pos) > COMPLETION_RING_SIZE || count < 0 ||
+        count > (int)(*(volatile unsigned int *)&ring->enqueue_pos - pos))
+        disable_ring( completion );
+}
+
+/* a client gave up waiting for the packet at the head of the ring to be written */
+static void check_ring_stall( struct completion *completion )
+{
+    struct completion_ring *ring;
+    unsigned int pos;
+
+    check_ring( completion );
+    if (!(ring = completion->ring)) return;
+
+    pos = *(volatile unsigned int *)&ring->dequeue_pos;
+    if (*(volatile unsigned int *)&ring->entries[pos % COMPLETION_RING_SIZE].seq != pos ||
+        *(volatile unsigned int *)&ring->enqueue_pos == pos)
+        return;  /* written by now */
+
+    if (completion->stall_pos != pos || !completion->stall_time)
+    {
+        completion->stall_pos  = pos;
+        completion->stall_time = current_time;
+    }
+    else if (current_time - completion->stall_time >= ring_stall_timeout)
+        disable_ring( completion );
+}
+
+/* move the packets that didn't fit into the ring, return how many were moved */
+static int refill_ring( struct completion *completion )
+{
+    struct comp_msg *msg, *next;
+    int moved = 0;
+
+    LIST_FOR_EACH_ENTRY_SAFE( msg, next, &completion->queue, struct comp_msg, queue_entry )
+    {
+        if (!ring_push( completion->ring, msg->ckey, msg->cvalue, msg->status, msg->information ))
+            break;
+        interlocked_xchg_add( &completion->ring->overflow, -1 );
+        list_remove( &msg->queue_entry );
+        completion->depth--;
+        free( msg );
+        moved++;
+    }
+    return moved;
+}
+
 static void completion_destroy( struct object *obj)
 {
     struct completion *completion = (struct completion *) obj;
@@ -95,6 +350,8 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    if (completion->ring) free_ring( completion->ring );
+    if (completion->dead_ring) free_ring( completion->dead_ring );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -104,7 +361,8 @@ static void completion_dump( struct object *obj, int verbose )
     assert( obj->ops == &completion_ops );
     fprintf( stderr, "Completion " );
     dump_object_name( &completion->obj );
-    fprintf( stderr, " (%u packets pending)\n", completion->depth );
+    fprintf( stderr, " (%u packets pending%s)\n", completion->depth +
+             (completion->ring ? completion->ring->count : 0), completion->ring ? ", shared" : "" );
 }
 
 static struct object_type *completion_get_type( struct object *obj )
@@ -114,10 +372,33 @@ static struct object_type *completion_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    /* let clients know they need to wake us up, before checking the state */
+    if (completion->ring) interlocked_xchg_add( &completion->ring->waiters, 1 );
+    /* wake up the most recent waiter first, like native */
+    grab_object( obj );
+    entry->obj = obj;
+    list_add_head( &obj->wait_queue, &entry->entry );
+    return 1;
+}
+
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    if (completion->ring) interlocked_xchg_add( &completion->ring->waiters, -1 );
+    remove_queue( obj, entry );
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
 
+    /* the packet isn't taken here, the woken thread races for it with the others */
+    if (completion->ring) return *(volatile int *)&completion->ring->count > 0;
     return !list_empty( &completion->queue );
 }
 
@@ -140,6 +421,11 @@ static struct completion *create_completion( struct directory *root, const struc
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->dead_ring = NULL;
+            completion->stall_pos = 0;
+            completion->stall_time = 0;
+            completion->ring = alloc_ring();
+            clear_error();  /* running out of rings is not an error, the port uses requests instead */
         }
     }
 
@@ -154,10 +440,31 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg;
+    int moved;
+
+    check_ring( completion );
+    if (completion->ring)
+    {
+        /* count the packet as overflowed before trying the ring, so that a client
+         * freeing an entry we couldn't use will ask us to refill it */
+        interlocked_xchg_add( &completion->ring->overflow, 1 );
+        moved = refill_ring( completion );
+        if (list_empty( &completion->queue ) &&
+            ring_push( completion->ring, ckey, cvalue, status, information ))
+        {
+            interlocked_xchg_add( &completion->ring->overflow, -1 );
+            wake_up( &completion->obj, moved + 1 );
+            return;
+        }
+        if (moved) wake_up( &completion->obj, moved );
+    }
 
-    if (!msg)
+    if (!(msg = mem_alloc( sizeof( *msg ) )))
+    {
+        if (completion->ring) interlocked_xchg_add( &completion->ring->overflow, -1 );
         return;
+    }
 
     msg->ckey = ckey;
     msg->cvalue = cvalue;
@@ -166,7 +473,7 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
-    wake_up( &completion->obj, 1 );
+    if (!completion->ring) wake_up( &completion->obj, 1 );
 }
 
 /* create a completion */
@@ -231,12 +538,25 @@ DECL_HANDLER(remove_completion)
 {
     struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
     struct list *entry;
-    struct comp_msg *msg;
+    struct comp_msg *msg, ring_msg;
+    int moved;
 
     if (!completion) return;
 
-    entry = list_head( &completion->queue );
-    if (!entry)
+    check_ring( completion );
+    if (completion->ring)
+    {
+        if (ring_pop( completion->ring, &ring_msg ))
+        {
+            reply->ckey = ring_msg.ckey;
+            reply->cvalue = ring_msg.cvalue;
+            reply->status = ring_msg.status;
+            reply->information = ring_msg.information;
+            if ((moved = refill_ring( completion ))) wake_up( &completion->obj, moved );
+        }
+        else set_error( STATUS_PENDING );
+    }
+    else if (!(entry = list_head( &completion->queue )))
         set_error( STATUS_PENDING );
     else
     {
@@ -261,6 +581,41 @@ DECL_HANDLER(query_completion)
     if (!completion) return;
 
     reply->depth = completion->depth;
+    if (completion->ring) reply->depth += max( completion->ring->count, 0 );
+
+    release_object( completion );
+}
+
+/* retrieve the shared memory region holding the completion port rings */
+DECL_HANDLER(get_completion_ring_region)
+{
+    if (!init_ring_region()) return;
+    send_client_fd( current->process, ring_region_fd, 0 );
+    reply->size = RING_REGION_SIZE;
+}
+
+/* retrieve the shared memory ring of a completion port */
+DECL_HANDLER(get_completion_ring)
+{
+    struct completion *completion = get_completion_obj( current->process, req->handle, 0 );
+
+    if (!completion) return;
+
+    reply->index  = completion->ring ? completion->ring - ring_region : -1;
+    reply->access = get_handle_access( current->process, req->handle );
+    release_object( completion );
+}
+
+/* wake up a server-side waiter and move overflowed packets into the ring */
+DECL_HANDLER(completion_ring_wake)
+{
+    struct completion *completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+
+    if (!completion) return;
 
+    if (req->stalled) check_ring_stall( completion );
+    else check_ring( completion );
+    /* the client may have added a packet, and made room for others */
+    if (completion->ring) wake_up( &completion->obj, refill_ring( completion ) + 1 );
     release_object( completion );
 }
@@ -41,22 +41,26 @@ struct event
     struct object  obj;             /* object header */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    struct fast_sync_slot *fast_sync; /* shared state, once a client asked for it */
 };
 
 static void event_dump( struct object *obj, int verbose );
 static struct object_type *event_get_type( struct object *obj );
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int event_map_access( struct object *obj, unsigned int access );
 static int event_signal( struct object *obj, unsigned int access);
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
     sizeof(struct event),      /* size */
     event_dump,                /* dump */
     event_get_type,            /* get_type */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    event_add_queue,           /* add_queue */
+    event_remove_queue,        /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
     event_signal,              /* signal */
@@ -67,7 +71,7 @@ static const struct object_ops event_ops =
     no_lookup_name,            /* lookup_name */
     no_open_file,              /* open_file */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -115,6 +119,7 @@ struct event *create_event( struct directory *root, const struct unicode_str *na
             /* initialize it if it didn't already exist */
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            event->fast_sync    = NULL;
             if (sd) default_set_sd( &event->obj, sd, OWNER_SECURITY_INFORMATION|
                                                      GROUP_SECURITY_INFORMATION|
                                                      DACL_SECURITY_INFORMATION|
@@ -129,32 +134,56 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+/* the state lives in the shared slot once clients can access it directly */
+static inline int get_event_state( struct event *event )
+{
+    if (event->fast_sync) return event->fast_sync->state;
+    return event->signaled;
+}
+
+static inline void set_event_state( struct event *event, int state )
+{
+    if (event->fast_sync) interlocked_xchg( &event->fast_sync->state, state );
+    else event->signaled = state;
+}
+
 void pulse_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_event_state( event, 0 );
+}
+
+/* retrieve the shared slot of an event, allocating it if needed */
+struct fast_sync_slot *get_event_fast_sync( struct object *obj, int *type )
+{
+    struct event *event = (struct event *)obj;
+
+    if (obj->ops != &event_ops) return NULL;
+    if (!event->fast_sync) event->fast_sync = alloc_fast_sync_slot( obj, event->signaled, 1 );
+    if (event->fast_sync) *type = event->manual_reset ? FAST_SYNC_MANUAL_EVENT : FAST_SYNC_AUTO_EVENT;
+    return event->fast_sync;
 }
 
 static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d ",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d%s ",
+             event->manual_reset, get_event_state( event ), event->fast_sync ? " (shared)" : "" );
     dump_object_name( &event->obj );
     fputc( '\n', stderr );
 }
@@ -166,11 +195,31 @@ static struct object_type *event_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    /* let clients know they need to wake us up, before checking the state */
+    if (event->fast_sync) interlocked_xchg_add( &event->fast_sync->waiters, 1 );
+    return add_queue( obj, entry );
+}
+
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->fast_sync) interlocked_xchg_add( &event->fast_sync->waiters, -1 );
+    remove_queue( obj, entry );
+}
+
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    if (!event->fast_sync || event->manual_reset) return get_event_state( event );
+    /* clients may reset the event at any time, so grab it right away, or along
+     * with the other objects of a wait-all */
+    return fast_sync_acquire_for_wait( event->fast_sync, entry );
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -178,7 +227,7 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (!event->manual_reset && !event->fast_sync) event->signaled = 0;
 }
 
 static unsigned int event_map_access( struct object *obj, unsigned int access )
@@ -204,6 +253,13 @@ static int event_signal( struct object *obj, unsigned int access )
     return 1;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->fast_sync) free_fast_sync_slot( event->fast_sync );
+}
+
 struct keyed_event *create_keyed_event( struct directory *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -365,7 +421,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
 
     release_object( event );
 }
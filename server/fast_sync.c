@@ -0,0 +1,201 @@
+/*
+ * Server-side shared memory state for synchronization objects
+ *
+ * Copyright 2014 Wine project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Events and semaphores that a client asked about get their state moved
+ * into a slot of a region shared with all clients. Clients can then
+ * signal, reset and acquire them with atomic operations, and only need
+ * a server round-trip when the wait has to block, or when a waiter that
+ * is blocked in the server has to be woken up.
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <unistd.h>
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "thread.h"
+#include "request.h"
+
+#define FAST_SYNC_REGION_SIZE (FAST_SYNC_MAX_SLOTS * sizeof(struct fast_sync_slot))
+
+static int region_fd = -1;                  /* fd of the shared region */
+static struct fast_sync_slot *region;       /* server mapping of the region */
+static unsigned int nb_used_slots;          /* slots allocated at least once */
+static unsigned int *free_slots;            /* stack of released slots */
+static unsigned int nb_free_slots;
+
+/* create the shared region on first use */
+static int init_region(void)
+{
+    void *ptr;
+
+    if (region) return 1;
+    if (!free_slots && !(free_slots = mem_alloc( FAST_SYNC_MAX_SLOTS * sizeof(*free_slots) )))
+        return 0;
+    if (region_fd == -1 && (region_fd = create_temp_file( FAST_SYNC_REGION_SIZE )) == -1)
+        return 0;
+    if ((ptr = mmap( NULL, FAST_SYNC_REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     region_fd, 0 )) == MAP_FAILED)
+    {
+        file_set_error();
+        return 0;
+    }
+    region = ptr;
+    return 1;
+}
+
+/* allocate a slot for an object, initialized with its current state */
+struct fast_sync_slot *alloc_fast_sync_slot( struct object *obj, int state, unsigned int max )
+{
+    struct fast_sync_slot *slot;
+
+    if (!init_region()) return NULL;
+    if (nb_free_slots) slot = region + free_slots[--nb_free_slots];
+    else if (nb_used_slots < FAST_SYNC_MAX_SLOTS) slot = region + nb_used_slots++;
+    else return NULL;
+
+    slot->state   = state;
+    slot->max     = max;
+    slot->waiters = list_count( &obj->wait_queue );
+    return slot;
+}
+
+/* release the slot of a destroyed object */
+void free_fast_sync_slot( struct fast_sync_slot *slot )
+{
+    assert( slot >= region && slot < region + nb_used_slots );
+    slot->state   = 0;
+    slot->max     = 0;
+    slot->waiters = 0;
+    free_slots[nb_free_slots++] = slot - region;
+}
+
+/* atomically decrement the state if it is positive; return 1 on success */
+int fast_sync_try_acquire( struct fast_sync_slot *slot )
+{
+    int cur;
+
+    while ((cur = slot->state) > 0)
+        if (interlocked_cmpxchg( &slot->state, cur - 1, cur ) == cur) return 1;
+    return 0;
+}
+
+/* acquire the slot on behalf of a waiter; a wait-all only checks it here, all its
+ * slots are acquired together by fast_sync_acquire_all once they are all signaled */
+int fast_sync_acquire_for_wait( struct fast_sync_slot *slot, struct wait_queue_entry *entry )
+{
+    if (get_wait_queue_select_op( entry ) != SELECT_WAIT_ALL) return fast_sync_try_acquire( slot );
+    entry->acquired = slot;
+    return *(volatile int *)&slot->state > 0;
+}
+
+/* acquire the slots of the count entries of a wait-all at once; returns 1 on success.
+ * Clients may change the slots at any time, so each one is locked first. If one of them
+ * isn't signaled anymore, the others get back their exact state, since clients can't
+ * change a locked slot. */
+int fast_sync_acquire_all( struct wait_queue_entry *entries, unsigned int count )
+{
+    struct fast_sync_slot *slot;
+    int states[MAXIMUM_WAIT_OBJECTS], taken[MAXIMUM_WAIT_OBJECTS];
+    unsigned int i, j;
+    int cur, ret = 1;
+
+    assert( count <= MAXIMUM_WAIT_OBJECTS );
+
+    for (i = 0; i < count; i++)
+    {
+        taken[i] = 0;
+        if (!(slot = entries[i].acquired)) continue;
+        /* the same object may be waited for more than once */
+        for (j = 0; j < i; j++) if (entries[j].acquired == slot && taken[j]) break;
+        if (j < i)
+        {
+            if (states[j] - taken[j] <= 0) break;
+            taken[j]++;
+            continue;
+        }
+        while ((cur = *(volatile int *)&slot->state) > 0)
+            if (interlocked_cmpxchg( &slot->state, FAST_SYNC_LOCKED, cur ) == cur) break;
+        if (cur <= 0) break;
+        states[i] = cur;
+        taken[i] = 1;
+    }
+    if (i < count) ret = 0;
+
+    while (i-- > 0)
+    {
+        if (!taken[i]) continue;
+        interlocked_xchg( &entries[i].acquired->state, ret ? states[i] - taken[i] : states[i] );
+    }
+    return ret;
+}
+
+/* retrieve the shared memory region used for fast synchronization */
+DECL_HANDLER(get_fast_sync_region)
+{
+    if (!init_region()) return;
+    send_client_fd( current->process, region_fd, 0 );
+    reply->size = FAST_SYNC_REGION_SIZE;
+}
+
+/* retrieve the shared memory slot of an event or semaphore */
+DECL_HANDLER(get_fast_sync)
+{
+    struct object *obj;
+    struct fast_sync_slot *slot;
+    int type = FAST_SYNC_NONE;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if ((slot = get_event_fast_sync( obj, &type )) || (slot = get_semaphore_fast_sync( obj, &type )))
+    {
+        reply->slot   = slot - region;
+        reply->access = get_handle_access( current->process, req->handle );
+    }
+    reply->type = type;
+    clear_error();  /* running out of slots is not an error, the client uses requests instead */
+    release_object( obj );
+}
+
+/* wake up the server-side waiters of an object signaled through its slot */
+DECL_HANDLER(fast_sync_wake)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    wake_up( obj, 0 );
+    release_object( obj );
+}
@@ -100,6 +100,7 @@
 #include "process.h"
 #include "request.h"
 
+#include "winbase.h"
 #include "winternl.h"
 #include "winioctl.h"
 
@@ -191,6 +192,7 @@ struct fd
     struct async_queue  *wait_q;      /* other async waiters of this fd */
     struct completion   *completion;  /* completion object attached to this fd */
     apc_param_t          comp_key;    /* completion key to set in completion events */
+    unsigned int         comp_flags;  /* completion notification flags (FILE_SKIP_*) */
 };
 
 static void fd_dump( struct object *obj, int verbose );
@@ -347,13 +349,18 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    int                   index;      /* index in the timeout heap, -1 once expired */
+    struct list           entry;      /* entry in the expired list */
     timeout_t             when;       /* timeout expiry (absolute time) */
+    unsigned int          seq;        /* insertion order, for timeouts expiring at the same time */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+static struct timeout_user **timeout_heap;   /* binary heap of pending timeouts */
+static int timeout_count;                    /* number of pending timeouts */
+static int timeout_heap_size;                /* allocated size of the heap */
+static unsigned int timeout_seq;             /* sequence number for the next timeout */
 timeout_t current_time;
 
 static inline void set_current_time(void)
@@ -364,32 +371,101 @@ static inline void set_current_time(void)
     current_time = (timeout_t)now.tv_sec * TICKS_PER_SEC + now.tv_usec * 10 + ticks_1601_to_1970;
 }
 
+/* check if a timeout expires before another one */
+static inline int timeout_before( const struct timeout_user *a, const struct timeout_user *b )
+{
+    if (a->when != b->when) return a->when < b->when;
+    /* among equal times, the most recently added one expires first */
+    return (int)(a->seq - b->seq) > 0;
+}
+
+static inline void set_timeout_heap_entry( int index, struct timeout_user *user )
+{
+    timeout_heap[index] = user;
+    user->index = index;
+}
+
+/* move a timeout up the heap until its parent expires before it */
+static void timeout_heap_up( struct timeout_user *user )
+{
+    int index = user->index;
+
+    while (index)
+    {
+        int parent = (index - 1) / 2;
+        if (!timeout_before( user, timeout_heap[parent] )) break;
+        set_timeout_heap_entry( index, timeout_heap[parent] );
+        index = parent;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* move a timeout down the heap until its children expire after it */
+static void timeout_heap_down( struct timeout_user *user )
+{
+    int index = user->index;
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= timeout_count) break;
+        if (child + 1 < timeout_count && timeout_before( timeout_heap[child + 1], timeout_heap[child] ))
+            child++;
+        if (!timeout_before( timeout_heap[child], user )) break;
+        set_timeout_heap_entry( index, timeout_heap[child] );
+        index = child;
+    }
+    set_timeout_heap_entry( index, user );
+}
+
+/* remove a timeout from the heap */
+static void timeout_heap_remove( struct timeout_user *user )
+{
+    struct timeout_user *last = timeout_heap[--timeout_count];
+
+    if (last != user)
+    {
+        set_timeout_heap_entry( user->index, last );
+        if (timeout_before( last, user )) timeout_heap_up( last );
+        else timeout_heap_down( last );
+    }
+    user->index = -1;
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
+    if (timeout_count == timeout_heap_size)
+    {
+        int new_size = max( 64, timeout_heap_size * 2 );
+        struct timeout_user **new_heap;
+
+        if (!(new_heap = realloc( timeout_heap, new_size * sizeof(*new_heap) )))
+        {
+            set_error( STATUS_NO_MEMORY );
+            return NULL;
+        }
+        timeout_heap = new_heap;
+        timeout_heap_size = new_size;
+    }
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = (when > 0) ? when : current_time - when;
+    user->seq      = timeout_seq++;
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
-
-    LIST_FOR_EACH( ptr, &timeout_list )
-    {
-        struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-        if (timeout->when >= user->when) break;
-    }
-    list_add_before( ptr, &user->entry );
+    user->index = timeout_count++;
+    timeout_heap_up( user );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index != -1) timeout_heap_remove( user );
+    else list_remove( &user->entry );  /* expired but its callback hasn't run yet */
     free( user );
 }
 
@@ -835,20 +911,20 @@ static void remove_poll_user( struct fd *fd, int user )
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
-    if (!list_empty( &timeout_list ))
+    if (timeout_count)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heap */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &timeout_list )) != NULL)
+        while (timeout_count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = timeout_heap[0];
 
             if (timeout->when <= current_time)
             {
-                list_remove( &timeout->entry );
+                timeout_heap_remove( timeout );
                 list_add_tail( &expired_list, &timeout->entry );
             }
             else break;
@@ -864,9 +940,9 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &timeout_list )) != NULL)
+        if (timeout_count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = timeout_heap[0];
             int diff = (timeout->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             return diff;
@@ -1588,6 +1664,7 @@ static struct fd *alloc_fd_object(void)
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
     fd->completion = NULL;
+    fd->comp_flags = 0;
     list_init( &fd->inode_entry );
     list_init( &fd->locks );
 
@@ -1623,6 +1700,7 @@ struct fd *alloc_pseudo_fd( const struct fd_ops *fd_user_ops, struct object *use
     fd->write_q    = NULL;
     fd->wait_q     = NULL;
     fd->completion = NULL;
+    fd->comp_flags = 0;
     fd->no_fd_status = STATUS_BAD_DEVICE_TYPE;
     list_init( &fd->inode_entry );
     list_init( &fd->locks );
@@ -2281,6 +2359,8 @@ DECL_HANDLER(get_handle_fd)
             reply->type = fd->fd_ops->get_fd_type( fd );
             reply->cacheable = fd->cacheable;
             reply->options = fd->options;
+            if (fd->comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)
+                reply->options |= FD_OPTION_SKIP_SYNC_COMPLETION;
             reply->access = get_handle_access( current->process, req->handle );
             send_client_fd( current->process, unix_fd, req->handle );
         }
@@ -2365,8 +2445,23 @@ DECL_HANDLER(add_fd_completion)
     struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
     if (fd)
     {
-        if (fd->completion)
+        /* operations that completed synchronously don't queue a completion if the app asked us not to */
+        if (fd->completion && (req->async || !(fd->comp_flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)))
             add_completion( fd->completion, fd->comp_key, req->cvalue, req->status, req->information );
         release_object( fd );
     }
 }
+
+/* set the completion notification flags of a fd */
+DECL_HANDLER(set_fd_completion_mode)
+{
+    struct fd *fd = get_handle_fd_obj( current->process, req->handle, 0 );
+    if (fd)
+    {
+        /* like on Windows, the flags can't be cleared once set, so clients may cache them */
+        if (!(fd->options & (FILE_SYNCHRONOUS_IO_ALERT | FILE_SYNCHRONOUS_IO_NONALERT)))
+            fd->comp_flags |= req->flags;
+        else set_error( STATUS_INVALID_PARAMETER );
+        release_object( fd );
+    }
+}
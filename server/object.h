@@ -109,6 +109,7 @@ struct wait_queue_entry
     struct list         entry;
     struct object      *obj;
     struct thread_wait *wait;
+    struct fast_sync_slot *acquired;  /* shared slot to acquire once a wait-all is satisfied */
 };
 
 extern void *mem_alloc( size_t size );  /* malloc wrapper */
@@ -124,6 +125,7 @@ extern void *create_named_object( struct namespace *namespace, const struct obje
 extern void unlink_named_object( struct object *obj );
 extern void make_object_static( struct object *obj );
 extern struct namespace *create_namespace( unsigned int hash_size );
+extern void free_namespace( struct namespace *namespace );
 /* grab/release_object can take any pointer, but you better make sure */
 /* that the thing pointed to starts with a struct object... */
 extern struct object *grab_object( void *obj );
@@ -164,6 +166,19 @@ extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_han
 extern void pulse_event( struct event *event );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern struct fast_sync_slot *get_event_fast_sync( struct object *obj, int *type );
+
+/* semaphore functions */
+
+extern struct fast_sync_slot *get_semaphore_fast_sync( struct object *obj, int *type );
+
+/* fast synchronization functions */
+
+extern struct fast_sync_slot *alloc_fast_sync_slot( struct object *obj, int state, unsigned int max );
+extern void free_fast_sync_slot( struct fast_sync_slot *slot );
+extern int fast_sync_try_acquire( struct fast_sync_slot *slot );
+extern int fast_sync_acquire_for_wait( struct fast_sync_slot *slot, struct wait_queue_entry *entry );
+extern int fast_sync_acquire_all( struct wait_queue_entry *entries, unsigned int count );
 
 /* mutex functions */
 
@@ -186,6 +201,7 @@ extern void debug_exit_thread( struct thread *thread );
 
 /* registry functions */
 
+extern int registry_cache;
 extern unsigned int get_prefix_cpu_mask(void);
 extern void init_registry(void);
 extern void flush_registry(void);
@@ -334,6 +334,10 @@ struct thread *create_process( int fd, struct thread *parent_thread, int inherit
     process->desktop         = 0;
     process->token           = NULL;
     process->trace_data      = 0;
+    process->nb_requests     = 0;
+    process->nb_round_trips  = 0;
+    process->max_request_time = 0;
+    process->request_time    = 0;
     process->rawinput_mouse  = NULL;
     process->rawinput_kbd    = NULL;
     list_init( &process->thread_list );
@@ -437,7 +441,8 @@ static void process_dump( struct object *obj, int verbose )
     struct process *process = (struct process *)obj;
     assert( obj->ops == &process_ops );
 
-    fprintf( stderr, "Process id=%04x handles=%p\n", process->id, process->handles );
+    fprintf( stderr, "Process id=%04x handles=%p requests=%u round_trips=%u\n",
+             process->id, process->handles, process->nb_requests, process->nb_round_trips );
 }
 
 static int process_signaled( struct object *obj, struct wait_queue_entry *entry )
@@ -1293,3 +1298,29 @@ DECL_HANDLER(make_process_system)
             shutdown_timeout = add_timeout_user( master_socket_timeout, server_shutdown_timeout, NULL );
     }
 }
+
+/* retrieve the request statistics of the running processes */
+DECL_HANDLER(get_process_request_profile)
+{
+    struct process *process;
+    struct process_request_profile *profile;
+    unsigned int count = 0;
+
+    LIST_FOR_EACH_ENTRY( process, &process_list, struct process, entry )
+        if (process->running_threads) count++;
+
+    count = min( count, get_reply_max_size() / sizeof(*profile) );
+    if (!count || !(profile = set_reply_data_size( count * sizeof(*profile) ))) return;
+
+    LIST_FOR_EACH_ENTRY( process, &process_list, struct process, entry )
+    {
+        if (!process->running_threads) continue;
+        profile->pid         = process->id;
+        profile->requests    = process->nb_requests;
+        profile->round_trips = process->nb_round_trips;
+        profile->max_time    = process->max_request_time;
+        profile->total_time  = process->request_time;
+        profile++;
+        if (!--count) break;
+    }
+}
@@ -88,6 +88,10 @@ struct process
     client_ptr_t         peb;             /* PEB address in client address space */
     client_ptr_t         ldt_copy;        /* pointer to LDT copy in client addr space */
     unsigned int         trace_data;      /* opaque data used by the process tracing mechanism */
+    unsigned int         nb_requests;     /* number of server requests made */
+    unsigned int         nb_round_trips;  /* number of server round trips, batches counting once */
+    unsigned int         max_request_time;/* longest request in microseconds, when profiling */
+    timeout_t            request_time;    /* time spent in its requests in microseconds, when profiling */
     struct list          rawinput_devices;/* list of registered rawinput devices */
     const struct rawinput_device *rawinput_mouse; /* rawinput mouse device, if any */
     const struct rawinput_device *rawinput_kbd;   /* rawinput keyboard device, if any */
@@ -90,7 +90,7 @@ static int open_proc_lwpctl( struct thread *thread )
 /* handle a SIGCHLD signal */
 void sigchld_callback(void)
 {
-    assert( 0 );  /* should only be called when using ptrace */
+    /* only the registry writer is a child of the server here, registry.c reaps it */
 }
 
 /* initialize the process tracing mechanism */
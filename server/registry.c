@@ -35,6 +35,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#include <sys/time.h>
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
 #include <unistd.h>
 
 #include "ntstatus.h"
@@ -78,6 +85,7 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    const struct cache_key *cache; /* values not loaded yet from the registry cache */
 };
 
 /* key flags */
@@ -98,6 +106,51 @@ struct key_value
     void             *data;    /* pointer to value data */
 };
 
+/*
+ * Binary cache of a registry branch, saved next to the text file. It is only
+ * used when the text file is unchanged since the cache was written. The keys
+ * are stored depth-first, each one followed by its values and then its subkeys;
+ * all records are 8-byte aligned. The values are copied out of the mapping the
+ * first time the key is accessed.
+ */
+struct cache_header
+{
+    char              magic[8];   /* cache_magic */
+    unsigned int      version;    /* CACHE_VERSION */
+    unsigned int      prefix;     /* prefix type */
+    file_pos_t        reg_size;   /* size of the text file */
+    file_pos_t        reg_mtime;  /* modification time of the text file */
+    file_pos_t        reg_ctime;  /* change time of the text file */
+    file_pos_t        reg_ino;    /* inode of the text file */
+    file_pos_t        size;       /* total size of the cache */
+};
+
+struct cache_key   /* followed by the name, the class and the values */
+{
+    timeout_t         modif;       /* last modification time */
+    unsigned int      flags;       /* key flags */
+    unsigned int      nb_subkeys;  /* number of subkeys */
+    unsigned int      nb_values;   /* number of values */
+    unsigned int      values_size; /* total size of the value records */
+    unsigned short    namelen;     /* length of key name */
+    unsigned short    classlen;    /* length of class name */
+    unsigned int      pad;
+};
+
+struct cache_value /* followed by the name and the data */
+{
+    data_size_t       len;     /* value data length in bytes */
+    unsigned short    namelen; /* length of value name */
+    unsigned short    type;    /* value type */
+};
+
+#define CACHE_VERSION 1
+#define CACHE_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+static const char cache_magic[8] = "WINEREG";
+
+int registry_cache = 0;  /* whether to use the binary registry cache, see --registry-cache */
+
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
 
@@ -118,7 +171,7 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
 
 /* information about where to save a registry branch */
 struct save_branch_info
@@ -131,6 +184,18 @@ struct save_branch_info
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+/* results sent back by the background writer process */
+struct save_result
+{
+    int          saved[MAX_SAVE_BRANCH_INFO];  /* branch successfully saved */
+    unsigned int time;                         /* time spent writing, in microseconds */
+};
+
+static const timeout_t save_poll_period = -TICKS_PER_SEC / 10;  /* delay between writer checks */
+static pid_t save_pid = -1;                            /* pid of the background writer */
+static int save_pipe = -1;                             /* pipe to receive the writer results */
+static int save_pending[MAX_SAVE_BRANCH_INFO];         /* branches being saved by the writer */
+
 
 /* information about a file being loaded */
 struct file_load_info
@@ -178,6 +243,62 @@ static inline int is_wow6432node( const WCHAR *name, unsigned int len )
             !memicmpW( name, wow6432node, sizeof(wow6432node)/sizeof(WCHAR) ));
 }
 
+static inline size_t get_cache_key_size( const struct cache_key *ck )
+{
+    return CACHE_ALIGN( sizeof(*ck) + ck->namelen + ck->classlen );
+}
+
+static inline size_t get_cache_value_size( const struct cache_value *cv )
+{
+    return CACHE_ALIGN( sizeof(*cv) + cv->namelen + cv->len );
+}
+
+/* copy the values of a key out of the registry cache */
+/* on failure the key keeps using the cache, so that it is never saved without its values */
+static int load_cached_values( struct key *key )
+{
+    const struct cache_key *ck = key->cache;
+    const struct cache_value *cv;
+    struct key_value *value;
+    const char *ptr;
+    unsigned int i;
+
+    if (!ck) return 1;
+    if (!(key->values = mem_alloc( max( ck->nb_values, MIN_VALUES ) * sizeof(*key->values) ))) return 0;
+
+    ptr = (const char *)ck + get_cache_key_size( ck );
+    for (i = 0; i < ck->nb_values; i++, ptr += get_cache_value_size( cv ))
+    {
+        cv = (const struct cache_value *)ptr;
+        value = &key->values[i];
+        value->name    = NULL;
+        value->data    = NULL;
+        value->namelen = cv->namelen;
+        value->type    = cv->type;
+        value->len     = cv->len;
+        if (cv->namelen && !(value->name = memdup( cv + 1, cv->namelen ))) goto failed;
+        if (cv->len && !(value->data = memdup( (const char *)(cv + 1) + cv->namelen, cv->len )))
+        {
+            free( value->name );
+            goto failed;
+        }
+    }
+    key->cache = NULL;
+    key->nb_values = max( ck->nb_values, MIN_VALUES );
+    key->last_value = ck->nb_values - 1;
+    return 1;
+
+failed:
+    while (i--)
+    {
+        free( key->values[i].name );
+        free( key->values[i].data );
+    }
+    free( key->values );
+    key->values = NULL;
+    return 0;
+}
+
 /*
  * The registry text file format v2 used by this code is similar to the one
  * used by REGEDIT import/export functionality, with the following differences:
@@ -252,12 +373,13 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
-/* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+/* save a registry and all its subkeys to a text file; return 0 if some values couldn't be loaded */
+static int save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
-    if (key->flags & KEY_VOLATILE) return;
+    if (key->flags & KEY_VOLATILE) return 1;
+    if (!load_cached_values( key )) return 0;
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -274,7 +396,9 @@ static void save_subkeys( const struct key *key, const struct key *base, FILE *f
         if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
         for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
     }
-    for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!save_subkeys( key->subkeys[i], base, f )) return 0;
+    return 1;
 }
 
 static void dump_operation( const struct key *key, const struct key_value *value, const char *op )
@@ -481,6 +605,7 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->values      = NULL;
         key->modif       = modif;
         key->parent      = NULL;
+        key->cache       = NULL;
         list_init( &key->notify_list );
         if (name->len && !(key->name = memdup( name->str, name->len )))
         {
@@ -861,7 +986,7 @@ static struct key *create_key_recursive( struct key *key, const struct unicode_s
 }
 
 /* query information about a key or a subkey */
-static void enum_key( const struct key *key, int index, int info_class,
+static void enum_key( struct key *key, int index, int info_class,
                       struct enum_key_reply *reply )
 {
     int i;
@@ -904,6 +1029,7 @@ static void enum_key( const struct key *key, int index, int info_class,
             len = subkey->classlen / sizeof(WCHAR);
             if (len > max_class) max_class = len;
         }
+        if (!load_cached_values( key )) return;
         for (i = 0; i <= key->last_value; i++)
         {
             len = key->values[i].namelen / sizeof(WCHAR);
@@ -922,7 +1048,7 @@ static void enum_key( const struct key *key, int index, int info_class,
         return;
     }
     reply->subkeys = key->last_subkey + 1;
-    reply->values  = key->last_value + 1;
+    reply->values  = key->cache ? key->cache->nb_values : key->last_value + 1;
     reply->modif   = key->modif;
     reply->total   = namelen + classlen;
 
@@ -1005,11 +1131,17 @@ static int grow_values( struct key *key )
 }
 
 /* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+/* the index is set to -1 if the cached values couldn't be loaded */
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (!load_cached_values( key ))
+    {
+        *index = -1;
+        return NULL;
+    }
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1037,6 +1169,7 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     WCHAR *new_name = NULL;
     int i;
 
+    if (index < 0) return NULL;  /* the cached values couldn't be loaded */
     if (name->len > MAX_VALUE_LEN * sizeof(WCHAR))
     {
         set_error( STATUS_NAME_TOO_LONG );
@@ -1120,7 +1253,7 @@ static void get_value( struct key *key, const struct unicode_str *name, int *typ
     else
     {
         *type = -1;
-        set_error( STATUS_OBJECT_NAME_NOT_FOUND );
+        if (index >= 0) set_error( STATUS_OBJECT_NAME_NOT_FOUND );
     }
 }
 
@@ -1129,6 +1262,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 {
     struct key_value *value;
 
+    if (!load_cached_values( key )) return;
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
@@ -1183,7 +1317,7 @@ static void delete_value( struct key *key, const struct unicode_str *name )
 
     if (!(value = find_value( key, name, &index )))
     {
-        set_error( STATUS_OBJECT_NAME_NOT_FOUND );
+        if (index >= 0) set_error( STATUS_OBJECT_NAME_NOT_FOUND );
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
@@ -1644,12 +1778,298 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/* get the current time in microseconds, for timing measurements */
+static unsigned int get_time_usec(void)
+{
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    return now.tv_sec * 1000000 + now.tv_usec;
+}
+
+/* buffer used to build a registry cache */
+struct cache_buffer
+{
+    char   *data;   /* buffer data */
+    size_t  size;   /* allocated size */
+    size_t  pos;    /* current position */
+    int     error;  /* out of memory */
+};
+
+/* return the name of the cache file for a registry file */
+static char *get_cache_name( const char *path )
+{
+    char *name;
+
+    if ((name = malloc( strlen(path) + sizeof(".cache") ))) sprintf( name, "%s.cache", path );
+    return name;
+}
+
+/* reserve zero-filled space at the end of the cache buffer */
+static void *reserve_cache_space( struct cache_buffer *buf, size_t size )
+{
+    void *ret;
+
+    if (buf->error) return NULL;
+    if (buf->pos + size > buf->size)
+    {
+        size_t new_size = max( buf->size * 2, buf->pos + size );
+        char *new_data;
+
+        if (!(new_data = realloc( buf->data, new_size )))
+        {
+            buf->error = 1;
+            return NULL;
+        }
+        buf->data = new_data;
+        buf->size = new_size;
+    }
+    ret = buf->data + buf->pos;
+    memset( ret, 0, size );
+    buf->pos += size;
+    return ret;
+}
+
+/* add a key and its subkeys to the cache; return 1 if the key was stored */
+static int cache_subkeys( struct cache_buffer *buf, struct key *key, int is_base )
+{
+    struct cache_key *ck;
+    struct cache_value *cv;
+    size_t start = buf->pos, values;
+    int i, count = 0, saved;
+
+    if (key->flags & KEY_VOLATILE) return 0;
+    if (!load_cached_values( key ))
+    {
+        buf->error = 1;
+        return 0;
+    }
+    /* skip the same keys as save_subkeys, so that the cache matches the text file */
+    saved = is_base || (key->last_value >= 0) || (key->last_subkey == -1) ||
+            key->class || (key->flags & KEY_SYMLINK);
+
+    if (!(ck = reserve_cache_space( buf, CACHE_ALIGN( sizeof(*ck) + key->namelen + key->classlen ))))
+        return 0;
+    /* the text file only stores seconds */
+    ck->modif = (key->modif - ticks_1601_to_1970) / TICKS_PER_SEC * TICKS_PER_SEC + ticks_1601_to_1970;
+    ck->flags = key->flags & KEY_SYMLINK;
+    ck->nb_values = key->last_value + 1;
+    ck->namelen = key->namelen;
+    ck->classlen = key->classlen;
+    memcpy( ck + 1, key->name, key->namelen );
+    memcpy( (char *)(ck + 1) + key->namelen, key->class, key->classlen );
+
+    values = buf->pos;
+    for (i = 0; i <= key->last_value; i++)
+    {
+        struct key_value *value = &key->values[i];
+
+        if (!(cv = reserve_cache_space( buf, CACHE_ALIGN( sizeof(*cv) + value->namelen + value->len ))))
+            return 0;
+        cv->len = value->len;
+        cv->namelen = value->namelen;
+        cv->type = value->type;
+        memcpy( cv + 1, value->name, value->namelen );
+        memcpy( (char *)(cv + 1) + value->namelen, value->data, value->len );
+    }
+    ((struct cache_key *)(buf->data + start))->values_size = buf->pos - values;
+
+    for (i = 0; i <= key->last_subkey; i++) count += cache_subkeys( buf, key->subkeys[i], 0 );
+    if (buf->error) return 0;
+    if (!count && !saved)
+    {
+        buf->pos = start;
+        return 0;
+    }
+    ((struct cache_key *)(buf->data + start))->nb_subkeys = count;
+    return 1;
+}
+
+/* check whether the cache of a registry file matches it */
+static int is_cache_current( const char *name, const struct stat *st )
+{
+    struct cache_header header;
+    ssize_t ret;
+    int fd;
+
+    if ((fd = open( name, O_RDONLY )) == -1) return 0;
+    ret = read( fd, &header, sizeof(header) );
+    close( fd );
+    return ret == sizeof(header) && !memcmp( header.magic, cache_magic, sizeof(header.magic) ) &&
+           header.version == CACHE_VERSION && header.prefix == prefix_type &&
+           header.reg_size == st->st_size && header.reg_mtime == st->st_mtime &&
+           header.reg_ctime == st->st_ctime && header.reg_ino == st->st_ino;
+}
+
+/* save the binary cache of a registry branch that matches the file at path, unless it is already there */
+static void save_cache( struct key *key, const char *path )
+{
+    struct cache_buffer buf;
+    struct cache_header *header;
+    struct stat st;
+    char *name = NULL, *tmp = NULL;
+    size_t pos;
+    ssize_t ret;
+    int fd;
+
+    if (!registry_cache) return;
+    if (stat( path, &st ) == -1 || !S_ISREG( st.st_mode )) return;
+    if (!(name = get_cache_name( path ))) return;
+    if (is_cache_current( name, &st )) goto done;
+
+    memset( &buf, 0, sizeof(buf) );
+    reserve_cache_space( &buf, sizeof(*header) );
+    cache_subkeys( &buf, key, 1 );
+    if (buf.error) goto done;
+
+    header = (struct cache_header *)buf.data;
+    memcpy( header->magic, cache_magic, sizeof(header->magic) );
+    header->version   = CACHE_VERSION;
+    header->prefix    = prefix_type;
+    header->reg_size  = st.st_size;
+    header->reg_mtime = st.st_mtime;
+    header->reg_ctime = st.st_ctime;
+    header->reg_ino   = st.st_ino;
+    header->size      = buf.pos;
+
+    if (!(tmp = malloc( strlen(name) + 20 ))) goto done;
+    sprintf( tmp, "%s.tmp%lx", name, (long)getpid() );
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1) goto done;
+
+    for (pos = 0; pos < buf.pos; pos += ret)
+    {
+        if ((ret = write( fd, buf.data + pos, buf.pos - pos )) > 0) continue;
+        if (ret == -1 && errno == EINTR) ret = 0;
+        else break;
+    }
+    if (close( fd ) || pos < buf.pos || rename( tmp, name )) unlink( tmp );
+
+done:
+    free( tmp );
+    free( name );
+    free( buf.data );
+}
+
+/* check the structure of a key in the cache; return the end of its subkeys */
+static const char *check_cache_key( const char *ptr, const char *end )
+{
+    const struct cache_key *ck = (const struct cache_key *)ptr;
+    const struct cache_value *cv;
+    const char *values_end;
+    unsigned int i;
+
+    if ((size_t)(end - ptr) < sizeof(*ck)) return NULL;
+    if (ck->namelen > MAX_NAME_LEN * sizeof(WCHAR) || ck->namelen % sizeof(WCHAR)) return NULL;
+    if ((size_t)(end - ptr) < get_cache_key_size( ck )) return NULL;
+    ptr += get_cache_key_size( ck );
+    if ((size_t)(end - ptr) < ck->values_size) return NULL;
+    values_end = ptr + ck->values_size;
+
+    for (i = 0; i < ck->nb_values; i++)
+    {
+        cv = (const struct cache_value *)ptr;
+        if ((size_t)(values_end - ptr) < sizeof(*cv)) return NULL;
+        if (cv->namelen > MAX_VALUE_LEN * sizeof(WCHAR)) return NULL;
+        if (cv->len > (size_t)(values_end - ptr)) return NULL;
+        if ((size_t)(values_end - ptr) < get_cache_value_size( cv )) return NULL;
+        ptr += get_cache_value_size( cv );
+    }
+    if (ptr != values_end) return NULL;
+
+    for (i = 0; i < ck->nb_subkeys; i++)
+        if (!(ptr = check_cache_key( ptr, end ))) return NULL;
+    return ptr;
+}
+
+/* create a key and its subkeys from the cache; the values are loaded on demand */
+static const char *load_cache_key( struct key *key, const char *ptr )
+{
+    const struct cache_key *ck = (const struct cache_key *)ptr;
+    struct unicode_str name;
+    struct key *subkey;
+    unsigned int i;
+
+    if (ck->classlen)
+    {
+        free( key->class );
+        if (!(key->class = memdup( (const char *)(ck + 1) + ck->namelen, ck->classlen ))) return NULL;
+        key->classlen = ck->classlen;
+    }
+    key->flags |= ck->flags & KEY_SYMLINK;
+    if (ck->nb_values) key->cache = ck;
+
+    ptr += get_cache_key_size( ck ) + ck->values_size;
+    for (i = 0; i < ck->nb_subkeys; i++)
+    {
+        const struct cache_key *sub = (const struct cache_key *)ptr;
+
+        name.str = (const WCHAR *)(sub + 1);
+        name.len = sub->namelen;
+        if (!(subkey = alloc_subkey( key, &name, key->last_subkey + 1, sub->modif ))) return NULL;
+        if (!(ptr = load_cache_key( subkey, ptr ))) return NULL;
+    }
+    return ptr;
+}
+
+/* load a registry branch from its cache, if it is still valid */
+static int load_cache( struct key *key, const char *path )
+{
+    const struct cache_header *header;
+    struct stat st, cache_st;
+    char *name;
+    void *ptr;
+    int fd;
+
+    if (!registry_cache) return 0;
+    /* the cache can only replace loading into an empty key */
+    if (key->last_subkey != -1 || key->last_value != -1) return 0;
+    if (stat( path, &st ) == -1) return 0;
+    if (!(name = get_cache_name( path ))) return 0;
+    fd = open( name, O_RDONLY );
+    free( name );
+    if (fd == -1) return 0;
+    if (fstat( fd, &cache_st ) == -1 || cache_st.st_size < sizeof(*header))
+    {
+        close( fd );
+        return 0;
+    }
+    ptr = mmap( NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return 0;
+
+    header = ptr;
+    if (memcmp( header->magic, cache_magic, sizeof(header->magic) )) goto failed;
+    if (header->version != CACHE_VERSION) goto failed;
+    if (header->size != cache_st.st_size) goto failed;
+    if (header->reg_size != st.st_size || header->reg_mtime != st.st_mtime ||
+        header->reg_ctime != st.st_ctime || header->reg_ino != st.st_ino) goto failed;
+    if (header->prefix != PREFIX_UNKNOWN && prefix_type != PREFIX_UNKNOWN &&
+        header->prefix != prefix_type) goto failed;  /* let the text parser report it */
+    if (check_cache_key( (const char *)(header + 1), (const char *)ptr + cache_st.st_size ) !=
+        (const char *)ptr + cache_st.st_size) goto failed;
+
+    if (header->prefix != PREFIX_UNKNOWN) prefix_type = header->prefix;
+    /* keys point into the mapping until their values are loaded, so it is never unmapped */
+    load_cache_key( key, (const char *)(header + 1) );
+    return 1;
+
+failed:
+    munmap( ptr, cache_st.st_size );
+    return 0;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
+    unsigned int start = get_time_usec();
+    int ret = 1;
     FILE *f;
 
-    if ((f = fopen( filename, "r" )))
+    if (load_cache( key, filename ))
+    {
+        if (debug_level) fprintf( stderr, "wineserver: loaded %s from cache in %u us\n",
+                                  filename, get_time_usec() - start );
+    }
+    else if ((f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
@@ -1658,14 +2078,18 @@ static int load_init_registry_from_file( const char *filename, struct key *key )
             fprintf( stderr, "%s is not a valid registry file\n", filename );
             return 1;
         }
+        if (debug_level) fprintf( stderr, "wineserver: loaded %s in %u us\n",
+                                  filename, get_time_usec() - start );
+        save_cache( key, filename );
     }
+    else ret = 0;
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
     save_branch_info[save_branch_count].path = filename;
     save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
     make_object_static( &key->obj );
-    return (f != NULL);
+    return ret;
 }
 
 static WCHAR *format_user_registry_path( const SID *sid, struct unicode_str *path )
@@ -1795,7 +2219,7 @@ void init_registry(void)
 }
 
 /* save a registry branch to a file */
-static void save_all_subkeys( struct key *key, FILE *f )
+static int save_all_subkeys( struct key *key, FILE *f )
 {
     fprintf( f, "WINE REGISTRY Version 2\n" );
     fprintf( f, ";; All keys relative to " );
@@ -1812,7 +2236,7 @@ static void save_all_subkeys( struct key *key, FILE *f )
     default:
         break;
     }
-    save_subkeys( key, key, f );
+    return save_subkeys( key, key, f );
 }
 
 /* save a registry branch to a file handle */
@@ -1829,8 +2253,9 @@ static void save_registry( struct key *key, obj_handle_t handle )
         FILE *f = fdopen( fd, "w" );
         if (f)
         {
-            save_all_subkeys( key, f );
+            int ret = save_all_subkeys( key, f );
             if (fclose( f )) file_set_error();
+            else if (!ret) set_error( STATUS_NO_MEMORY );
         }
         else
         {
@@ -1898,8 +2323,8 @@ static int save_branch( struct key *key, const char *path )
         dump_operation( key, NULL, "saving" );
     }
 
-    save_all_subkeys( key, f );
-    ret = !fclose(f);
+    ret = save_all_subkeys( key, f );
+    if (fclose(f)) ret = 0;
 
     if (tmp)
     {
@@ -1914,17 +2339,112 @@ done:
     return ret;
 }
 
+/* process the results of the background writer; return 0 if it isn't done yet */
+static int finish_background_save( int wait )
+{
+    struct save_result result;
+    int i, ret;
+
+    if (save_pid == -1) return 1;
+
+    fcntl( save_pipe, F_SETFL, wait ? 0 : O_NONBLOCK );
+    do ret = read( save_pipe, &result, sizeof(result) );
+    while (ret == -1 && errno == EINTR);
+    if (ret == -1 && errno == EAGAIN) return 0;
+    if (ret != sizeof(result)) memset( &result, 0, sizeof(result) );  /* the writer died */
+
+    for (i = 0; i < save_branch_count; i++)
+    {
+        if (!save_pending[i]) continue;
+        save_pending[i] = 0;
+        if (result.saved[i]) continue;
+        fprintf( stderr, "wineserver: could not save registry branch to %s\n", save_branch_info[i].path );
+        make_dirty( save_branch_info[i].key );  /* try again next time */
+    }
+    if (debug_level) fprintf( stderr, "wineserver: registry writer took %u us\n", result.time );
+
+    close( save_pipe );
+    /* the SIGCHLD handler may have reaped it already */
+    waitpid( save_pid, NULL, 0 );
+    save_pipe = -1;
+    save_pid = -1;
+    return 1;
+}
+
+/* save the dirty branches from a forked copy of the server, so that
+ * writing the files doesn't block request processing */
+static int start_background_save(void)
+{
+    struct save_result result;
+    unsigned int start;
+    int i, fds[2], count = 0;
+
+    for (i = 0; i < save_branch_count; i++)
+        if (save_branch_info[i].key->flags & KEY_DIRTY) count++;
+    if (!count) return 1;
+
+    if (pipe( fds ) == -1) return 0;
+    switch ((save_pid = fork()))
+    {
+    case -1:
+        close( fds[0] );
+        close( fds[1] );
+        return 0;
+    case 0:  /* child, works on a copy-on-write snapshot of the registry */
+        close( fds[0] );
+        start = get_time_usec();
+        memset( &result, 0, sizeof(result) );
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key->flags & KEY_DIRTY)
+                result.saved[i] = save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        result.time = get_time_usec() - start;
+        write( fds[1], &result, sizeof(result) );
+        _exit( 0 );
+    }
+
+    /* changes made from now on will be saved next time */
+    close( fds[1] );
+    save_pipe = fds[0];
+    for (i = 0; i < save_branch_count; i++)
+    {
+        save_pending[i] = (save_branch_info[i].key->flags & KEY_DIRTY) != 0;
+        if (save_pending[i]) make_clean( save_branch_info[i].key );
+    }
+    return 1;
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
+    unsigned int start = get_time_usec();
     int i;
 
-    if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
-    for (i = 0; i < save_branch_count; i++)
+    if (!finish_background_save( 0 ))
+    {
+        /* the previous save is still running, check again later */
+        save_timeout_user = add_timeout_user( save_poll_period, periodic_save, arg );
+        return;
+    }
+    if (arg)  /* only polling for the writer */
+    {
+        set_periodic_save_timer();
+        return;
+    }
+
+    if (fchdir( config_dir_fd ) == -1) return;
+    if (start_background_save())
+    {
+        if (save_pid != -1)
+            save_timeout_user = add_timeout_user( save_poll_period, periodic_save, (void *)1 );
+    }
+    else for (i = 0; i < save_branch_count; i++)  /* fall back to saving synchronously */
         save_branch( save_branch_info[i].key, save_branch_info[i].path );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
-    set_periodic_save_timer();
+
+    if (debug_level) fprintf( stderr, "wineserver: registry save stalled the server for %u us\n",
+                              get_time_usec() - start );
+    if (!save_timeout_user) set_periodic_save_timer();
 }
 
 /* start the periodic save timer */
@@ -1939,6 +2459,9 @@ void flush_registry(void)
 {
     int i;
 
+    /* make sure an older snapshot doesn't overwrite what we are about to save */
+    finish_background_save( 1 );
+
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
@@ -1948,6 +2471,8 @@ void flush_registry(void)
                      save_branch_info[i].path );
             perror( " " );
         }
+        /* the cache is only used at startup, so it is only written when the server exits */
+        else save_cache( save_branch_info[i].key, save_branch_info[i].path );
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
@@ -125,6 +125,11 @@ unsigned int global_error = 0;  /* global error code for when no thread is curre
 timeout_t server_start_time = 0;  /* server startup time */
 int server_dir_fd = -1;    /* file descriptor for the server dir */
 int config_dir_fd = -1;    /* file descriptor for the config dir */
+int profile_requests = 0;  /* whether request profiling is enabled */
+
+static struct request_profile req_profiles[REQ_NB_REQUESTS];  /* request profiling statistics */
+static timeout_t profile_start_time;  /* time when the statistics were last reset */
+static timeout_t profile_total_time;  /* time spent in all the profiled requests */
 
 static struct master_socket *master_socket;  /* the master socket object */
 static struct timeout_user *master_timeout;
@@ -230,30 +235,87 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
-/* call a request handler */
-static void call_req_handler( struct thread *thread )
+/* get the current time in microseconds, for request profiling */
+static inline timeout_t get_profile_time(void)
 {
-    union generic_reply reply;
-    enum request req = thread->req.request_header.req;
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    return (timeout_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+/* account for the time spent handling a request, except for the nested time
+ * already accounted to the requests it dispatched */
+static void profile_request( enum request req, timeout_t start, timeout_t nested )
+{
+    struct request_profile *profile = &req_profiles[req];
+    timeout_t elapsed = get_profile_time() - start;
+    unsigned int time, bucket = 0;
+
+    if (elapsed < 0) elapsed = 0;  /* the clock went backwards */
+    profile_total_time += elapsed;
+    elapsed -= nested;
+    if (elapsed < 0) elapsed = 0;
+    time = min( elapsed, 0xffffffff );
+    while (bucket < PROFILE_HISTOGRAM_SIZE - 1 && time >= (1u << bucket)) bucket++;
+
+    profile->count++;
+    profile->total_time += time;
+    profile->histogram[bucket]++;
+    if (time > profile->max_time) profile->max_time = time;
+
+    if (!current) return;
+    current->process->request_time += time;
+    if (time > current->process->max_request_time) current->process->max_request_time = time;
+}
+
+/* run the handler of the current request and fill the reply header */
+static void handle_request( union generic_reply *reply )
+{
+    enum request req = current->req.request_header.req;
+    int profiling = profile_requests;
+    timeout_t start = 0, total = 0;
 
-    current = thread;
     current->reply_size = 0;
+    current->process->nb_requests++;
     clear_error();
-    memset( &reply, 0, sizeof(reply) );
+    memset( reply, 0, sizeof(*reply) );
 
     if (debug_level) trace_request();
+    if (profiling)
+    {
+        start = get_profile_time();
+        total = profile_total_time;
+    }
 
     if (req < REQ_NB_REQUESTS)
-        req_handlers[req]( &current->req, &reply );
+        req_handlers[req]( &current->req, reply );
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
+    /* the sub-requests of a batch are accounted separately, only count its own overhead */
+    if (profiling && req < REQ_NB_REQUESTS) profile_request( req, start, profile_total_time - total );
+
+    if (current)
+    {
+        reply->reply_header.error = current->error;
+        reply->reply_header.reply_size = current->reply_size;
+    }
+}
+
+/* call a request handler */
+static void call_req_handler( struct thread *thread )
+{
+    union generic_reply reply;
+    enum request req = thread->req.request_header.req;
+
+    current = thread;
+    current->process->nb_round_trips++;
+    handle_request( &reply );
+
     if (current)
     {
         if (current->reply_fd)
         {
-            reply.reply_header.error = current->error;
-            reply.reply_header.reply_size = current->reply_size;
             if (debug_level) trace_reply( req, &reply );
             send_reply( &reply );
         }
@@ -266,6 +328,128 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* execute the requests of a batch and return all the replies together */
+DECL_HANDLER(call_batch)
+{
+    struct thread *thread = (struct thread *)grab_object( current );
+    union generic_request batch_req = thread->req;
+    char *batch_data = thread->req_data;
+    const char *ptr = batch_data, *end = ptr + get_req_data_size();
+    data_size_t size = 0, max_size = get_reply_max_size();
+    obj_handle_t last_handle = 0;
+    char *replies = NULL;
+
+    /* each request gets its own copy of the data, since the thread
+     * frees it if it gets killed while processing the request */
+    thread->req_data = NULL;
+    if (max_size && !(replies = mem_alloc( max_size ))) goto done;
+
+    while (ptr < end)
+    {
+        union generic_reply sub_reply;
+        unsigned int i, mask, offset;
+        data_size_t data_size;
+        enum request req;
+
+        if (end - ptr < sizeof(thread->req))
+        {
+            fatal_protocol_error( thread, "truncated batch\n" );
+            break;
+        }
+        memcpy( &thread->req, ptr, sizeof(thread->req) );
+        ptr += sizeof(thread->req);
+        req = thread->req.request_header.req;
+        data_size = thread->req.request_header.request_size;
+        if (req == REQ_call_batch || BATCH_ALIGN( data_size ) > end - ptr)
+        {
+            fatal_protocol_error( thread, "bad batch request %d\n", req );
+            break;
+        }
+        if (data_size && !(thread->req_data = memdup( ptr, data_size ))) break;
+        ptr += BATCH_ALIGN( data_size );
+
+        /* replace the handles that refer to the result of an earlier request */
+        if (req < REQ_NB_REQUESTS)
+        {
+            for (i = 0, mask = req_handle_fields[req]; mask; i++, mask >>= 1)
+            {
+                obj_handle_t *handle = (obj_handle_t *)&thread->req + i;
+                if ((mask & 1) && *handle == BATCH_LAST_HANDLE) *handle = last_handle;
+            }
+        }
+
+        handle_request( &sub_reply );
+        if (!current) break;  /* the thread was killed */
+        if (debug_level) trace_reply( req, &sub_reply );
+        free( thread->req_data );
+        thread->req_data = NULL;
+
+        if (req < REQ_NB_REQUESTS && (offset = reply_handle_offsets[req]))
+            memcpy( &last_handle, (char *)&sub_reply + offset, sizeof(last_handle) );
+
+        if (sizeof(sub_reply) + BATCH_ALIGN( thread->reply_size ) > max_size - size)
+        {
+            free( thread->reply_data );
+            thread->reply_data = NULL;
+            fatal_protocol_error( thread, "batch reply too large\n" );
+            break;
+        }
+        memcpy( replies + size, &sub_reply, sizeof(sub_reply) );
+        size += sizeof(sub_reply);
+        memcpy( replies + size, thread->reply_data, thread->reply_size );
+        memset( replies + size + thread->reply_size, 0,
+                BATCH_ALIGN( thread->reply_size ) - thread->reply_size );
+        size += BATCH_ALIGN( thread->reply_size );
+        free( thread->reply_data );
+        thread->reply_data = NULL;
+    }
+
+done:
+    if (current)
+    {
+        free( thread->req_data );
+        thread->req = batch_req;
+        thread->req_data = batch_data;
+        if (ptr < end) free( replies );  /* out of memory, the whole batch fails */
+        else
+        {
+            clear_error();
+            set_reply_data_ptr( replies, size );
+        }
+    }
+    else
+    {
+        free( batch_data );
+        free( replies );
+    }
+    release_object( thread );
+}
+
+/* control request profiling and retrieve the statistics for each request type */
+DECL_HANDLER(get_request_profile)
+{
+    data_size_t size = min( get_reply_max_size(), sizeof(req_profiles) );
+
+    if (req->flags & PROFILE_ENABLE)
+    {
+        if (!profile_start_time) profile_start_time = current_time;
+        profile_requests = 1;
+    }
+    if (req->flags & PROFILE_DISABLE) profile_requests = 0;
+
+    reply->start_time = profile_start_time ? profile_start_time : server_start_time;
+    reply->enabled    = profile_requests;
+    size -= size % sizeof(req_profiles[0]);
+    set_reply_data( req_profiles, size );
+
+    /* the statistics are reset once they have been retrieved */
+    if (req->flags & PROFILE_RESET)
+    {
+        memset( req_profiles, 0, sizeof(req_profiles) );
+        profile_start_time = current_time;
+    }
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
@@ -57,6 +57,7 @@ extern void shutdown_master_socket(void);
 extern int wait_for_lock(void);
 extern int kill_lock_owner( int sig );
 extern int server_dir_fd, config_dir_fd;
+extern int profile_requests;
 
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
@@ -144,6 +145,9 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_fast_sync_region);
+DECL_HANDLER(get_fast_sync);
+DECL_HANDLER(fast_sync_wake);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -351,8 +355,12 @@ DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
 DECL_HANDLER(query_completion);
+DECL_HANDLER(get_completion_ring_region);
+DECL_HANDLER(get_completion_ring);
+DECL_HANDLER(completion_ring_wake);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
+DECL_HANDLER(set_fd_completion_mode);
 DECL_HANDLER(get_window_layered_info);
 DECL_HANDLER(set_window_layered_info);
 DECL_HANDLER(alloc_user_handle);
@@ -361,6 +369,9 @@ DECL_HANDLER(set_cursor);
 DECL_HANDLER(update_rawinput_devices);
 DECL_HANDLER(get_suspend_context);
 DECL_HANDLER(set_suspend_context);
+DECL_HANDLER(call_batch);
+DECL_HANDLER(get_request_profile);
+DECL_HANDLER(get_process_request_profile);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -405,6 +416,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_fast_sync_region,
+    (req_handler)req_get_fast_sync,
+    (req_handler)req_fast_sync_wake,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -612,8 +626,12 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
     (req_handler)req_query_completion,
+    (req_handler)req_get_completion_ring_region,
+    (req_handler)req_get_completion_ring,
+    (req_handler)req_completion_ring_wake,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
+    (req_handler)req_set_fd_completion_mode,
     (req_handler)req_get_window_layered_info,
     (req_handler)req_set_window_layered_info,
     (req_handler)req_alloc_user_handle,
@@ -622,6 +640,549 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_update_rawinput_devices,
     (req_handler)req_get_suspend_context,
     (req_handler)req_set_suspend_context,
+    (req_handler)req_call_batch,
+    (req_handler)req_get_request_profile,
+    (req_handler)req_get_process_request_profile,
+};
+
+/* obj_handle_t fields of the requests, as a bitmask of 32-bit words */
+static const unsigned short req_handle_fields[REQ_NB_REQUESTS] =
+{
+    0x0040, /* new_process */
+    0x0008, /* get_new_process_info */
+    0x0000, /* new_thread */
+    0x0000, /* get_startup_info */
+    0x0000, /* init_process_done */
+    0x0000, /* init_thread */
+    0x0008, /* terminate_process */
+    0x0008, /* terminate_thread */
+    0x0008, /* get_process_info */
+    0x0008, /* set_process_info */
+    0x0008, /* get_thread_info */
+    0x0108, /* set_thread_info */
+    0x0008, /* get_dll_info */
+    0x0008, /* suspend_thread */
+    0x0008, /* resume_thread */
+    0x0008, /* load_dll */
+    0x0000, /* unload_dll */
+    0x0008, /* queue_apc */
+    0x0008, /* get_apc_result */
+    0x0008, /* close_handle */
+    0x0008, /* set_handle_info */
+    0x0038, /* dup_handle */
+    0x0000, /* open_process */
+    0x0000, /* open_thread */
+    0x0100, /* select */
+    0x0000, /* create_event */
+    0x0008, /* event_op */
+    0x0008, /* query_event */
+    0x0020, /* open_event */
+    0x0000, /* create_keyed_event */
+    0x0020, /* open_keyed_event */
+    0x0000, /* create_mutex */
+    0x0008, /* release_mutex */
+    0x0020, /* open_mutex */
+    0x0000, /* create_semaphore */
+    0x0008, /* release_semaphore */
+    0x0008, /* query_semaphore */
+    0x0020, /* open_semaphore */
+    0x0000, /* get_fast_sync_region */
+    0x0008, /* get_fast_sync */
+    0x0008, /* fast_sync_wake */
+    0x0000, /* create_file */
+    0x0020, /* open_file_object */
+    0x0000, /* alloc_file_handle */
+    0x0008, /* get_handle_unix_name */
+    0x0008, /* get_handle_fd */
+    0x0008, /* flush_file */
+    0x0008, /* lock_file */
+    0x0008, /* unlock_file */
+    0x0000, /* create_socket */
+    0x0008, /* accept_socket */
+    0x0018, /* accept_into_socket */
+    0x0028, /* set_socket_event */
+    0x0028, /* get_socket_event */
+    0x0008, /* get_socket_info */
+    0x0008, /* enable_socket_event */
+    0x0018, /* set_socket_deferred */
+    0x0000, /* alloc_console */
+    0x0000, /* free_console */
+    0x0008, /* get_console_renderer_events */
+    0x0008, /* open_console */
+    0x0000, /* get_console_wait_event */
+    0x0008, /* get_console_mode */
+    0x0008, /* set_console_mode */
+    0x0028, /* set_console_input_info */
+    0x0008, /* get_console_input_info */
+    0x0008, /* append_console_input_history */
+    0x0008, /* get_console_input_history */
+    0x0008, /* create_console_output */
+    0x0008, /* set_console_output_info */
+    0x0008, /* get_console_output_info */
+    0x0008, /* write_console_input */
+    0x0008, /* read_console_input */
+    0x0008, /* write_console_output */
+    0x0008, /* fill_console_output */
+    0x0008, /* read_console_output */
+    0x0008, /* move_console_output */
+    0x0000, /* send_console_signal */
+    0x0000, /* read_directory_changes */
+    0x0008, /* read_change */
+    0x0100, /* create_mapping */
+    0x0020, /* open_mapping */
+    0x0008, /* get_mapping_info */
+    0x0008, /* get_mapping_committed_range */
+    0x0008, /* add_mapping_committed_range */
+    0x0000, /* create_snapshot */
+    0x0008, /* next_process */
+    0x0008, /* next_thread */
+    0x0000, /* wait_debug_event */
+    0x0000, /* queue_exception_event */
+    0x0008, /* get_exception_status */
+    0x0000, /* output_debug_string */
+    0x0000, /* continue_debug_event */
+    0x0000, /* debug_process */
+    0x0008, /* debug_break */
+    0x0000, /* set_debugger_kill_on_exit */
+    0x0008, /* read_process_memory */
+    0x0008, /* write_process_memory */
+    0x0008, /* create_key */
+    0x0008, /* open_key */
+    0x0008, /* delete_key */
+    0x0008, /* flush_key */
+    0x0008, /* enum_key */
+    0x0008, /* set_key_value */
+    0x0008, /* get_key_value */
+    0x0008, /* enum_key_value */
+    0x0008, /* delete_key_value */
+    0x0018, /* load_registry */
+    0x0008, /* unload_registry */
+    0x0018, /* save_registry */
+    0x0018, /* set_registry_notification */
+    0x0020, /* create_timer */
+    0x0020, /* open_timer */
+    0x0008, /* set_timer */
+    0x0008, /* cancel_timer */
+    0x0008, /* get_timer_info */
+    0x0008, /* get_thread_context */
+    0x0008, /* set_thread_context */
+    0x0008, /* get_selector_entry */
+    0x0008, /* add_atom */
+    0x0008, /* delete_atom */
+    0x0008, /* find_atom */
+    0x0008, /* get_atom_information */
+    0x0008, /* set_atom_information */
+    0x0008, /* empty_atom_table */
+    0x0000, /* init_atom_table */
+    0x0000, /* get_msg_queue */
+    0x0008, /* set_queue_fd */
+    0x0000, /* set_queue_mask */
+    0x0000, /* get_queue_status */
+    0x0008, /* get_process_idle_event */
+    0x0000, /* send_message */
+    0x0000, /* post_quit_message */
+    0x0000, /* send_hardware_message */
+    0x0000, /* get_message */
+    0x0000, /* reply_message */
+    0x0000, /* accept_hardware_message */
+    0x0000, /* get_message_reply */
+    0x0000, /* set_win_timer */
+    0x0000, /* kill_win_timer */
+    0x0000, /* is_window_hung */
+    0x0008, /* get_serial_info */
+    0x0008, /* set_serial_info */
+    0x0000, /* register_async */
+    0x0008, /* cancel_async */
+    0x0000, /* ioctl */
+    0x0008, /* get_ioctl_result */
+    0x0020, /* create_named_pipe */
+    0x0008, /* get_named_pipe_info */
+    0x0000, /* create_window */
+    0x0000, /* destroy_window */
+    0x0000, /* get_desktop_window */
+    0x0000, /* set_window_owner */
+    0x0000, /* get_window_info */
+    0x0000, /* set_window_info */
+    0x0000, /* set_parent */
+    0x0000, /* get_window_parents */
+    0x0008, /* get_window_children */
+    0x0000, /* get_window_children_from_point */
+    0x0000, /* get_window_tree */
+    0x0000, /* set_window_pos */
+    0x0000, /* get_window_rectangles */
+    0x0000, /* get_window_text */
+    0x0000, /* set_window_text */
+    0x0000, /* get_windows_offset */
+    0x0000, /* get_visible_region */
+    0x0000, /* get_surface_region */
+    0x0000, /* get_window_region */
+    0x0000, /* set_window_region */
+    0x0000, /* get_update_region */
+    0x0000, /* update_window_zorder */
+    0x0000, /* redraw_window */
+    0x0000, /* set_window_property */
+    0x0000, /* remove_window_property */
+    0x0000, /* get_window_property */
+    0x0000, /* get_window_properties */
+    0x0000, /* create_winstation */
+    0x0000, /* open_winstation */
+    0x0008, /* close_winstation */
+    0x0000, /* get_process_winstation */
+    0x0008, /* set_process_winstation */
+    0x0000, /* enum_winstation */
+    0x0000, /* create_desktop */
+    0x0008, /* open_desktop */
+    0x0000, /* open_input_desktop */
+    0x0008, /* close_desktop */
+    0x0000, /* get_thread_desktop */
+    0x0008, /* set_thread_desktop */
+    0x0008, /* enum_desktop */
+    0x0008, /* set_user_object_info */
+    0x0000, /* register_hotkey */
+    0x0000, /* unregister_hotkey */
+    0x0000, /* attach_thread_input */
+    0x0000, /* get_thread_input */
+    0x0000, /* get_last_input_time */
+    0x0000, /* get_key_state */
+    0x0000, /* set_key_state */
+    0x0000, /* set_foreground_window */
+    0x0000, /* set_focus_window */
+    0x0000, /* set_active_window */
+    0x0000, /* set_capture_window */
+    0x0000, /* set_caret_window */
+    0x0000, /* set_caret_info */
+    0x0000, /* set_hook */
+    0x0000, /* remove_hook */
+    0x0000, /* start_hook_chain */
+    0x0000, /* finish_hook_chain */
+    0x0000, /* get_hook_info */
+    0x0000, /* create_class */
+    0x0000, /* destroy_class */
+    0x0000, /* set_class_info */
+    0x0000, /* set_clipboard_info */
+    0x0008, /* open_token */
+    0x0000, /* set_global_windows */
+    0x0008, /* adjust_token_privileges */
+    0x0008, /* get_token_privileges */
+    0x0008, /* check_token_privileges */
+    0x0008, /* duplicate_token */
+    0x0008, /* access_check */
+    0x0008, /* get_token_sid */
+    0x0008, /* get_token_groups */
+    0x0008, /* get_token_default_dacl */
+    0x0008, /* set_token_default_dacl */
+    0x0008, /* set_security_object */
+    0x0008, /* get_security_object */
+    0x0020, /* create_mailslot */
+    0x0008, /* set_mailslot_info */
+    0x0020, /* create_directory */
+    0x0020, /* open_directory */
+    0x0008, /* get_directory_entry */
+    0x0020, /* create_symlink */
+    0x0020, /* open_symlink */
+    0x0008, /* query_symlink */
+    0x0008, /* get_object_info */
+    0x0008, /* unlink_object */
+    0x0008, /* get_token_impersonation_level */
+    0x0000, /* allocate_locally_unique_id */
+    0x0000, /* create_device_manager */
+    0x0120, /* create_device */
+    0x0008, /* delete_device */
+    0x0018, /* get_next_device_request */
+    0x0000, /* make_process_system */
+    0x0008, /* get_token_statistics */
+    0x0040, /* create_completion */
+    0x0020, /* open_completion */
+    0x0008, /* add_completion */
+    0x0008, /* remove_completion */
+    0x0008, /* query_completion */
+    0x0000, /* get_completion_ring_region */
+    0x0008, /* get_completion_ring */
+    0x0008, /* completion_ring_wake */
+    0x0048, /* set_completion_info */
+    0x0008, /* add_fd_completion */
+    0x0008, /* set_fd_completion_mode */
+    0x0000, /* get_window_layered_info */
+    0x0000, /* set_window_layered_info */
+    0x0000, /* alloc_user_handle */
+    0x0000, /* free_user_handle */
+    0x0000, /* set_cursor */
+    0x0000, /* update_rawinput_devices */
+    0x0000, /* get_suspend_context */
+    0x0000, /* set_suspend_context */
+    0x0000, /* call_batch */
+    0x0000, /* get_request_profile */
+    0x0000, /* get_process_request_profile */
+};
+
+/* offset of the first obj_handle_t field of the replies, 0 if none */
+static const unsigned char reply_handle_offsets[REQ_NB_REQUESTS] =
+{
+     8, /* new_process */
+     0, /* get_new_process_info */
+    12, /* new_thread */
+     8, /* get_startup_info */
+     0, /* init_process_done */
+     0, /* init_thread */
+     0, /* terminate_process */
+     0, /* terminate_thread */
+     0, /* get_process_info */
+     0, /* set_process_info */
+     0, /* get_thread_info */
+     0, /* set_thread_info */
+     0, /* get_dll_info */
+     0, /* suspend_thread */
+     0, /* resume_thread */
+     0, /* load_dll */
+     0, /* unload_dll */
+     8, /* queue_apc */
+     0, /* get_apc_result */
+     0, /* close_handle */
+     0, /* set_handle_info */
+     8, /* dup_handle */
+     8, /* open_process */
+     8, /* open_thread */
+    56, /* select */
+     8, /* create_event */
+     0, /* event_op */
+     0, /* query_event */
+     8, /* open_event */
+     8, /* create_keyed_event */
+     8, /* open_keyed_event */
+     8, /* create_mutex */
+     0, /* release_mutex */
+     8, /* open_mutex */
+     8, /* create_semaphore */
+     0, /* release_semaphore */
+     0, /* query_semaphore */
+     8, /* open_semaphore */
+     0, /* get_fast_sync_region */
+     0, /* get_fast_sync */
+     0, /* fast_sync_wake */
+     8, /* create_file */
+     8, /* open_file_object */
+     8, /* alloc_file_handle */
+     0, /* get_handle_unix_name */
+     0, /* get_handle_fd */
+     8, /* flush_file */
+     8, /* lock_file */
+     0, /* unlock_file */
+     8, /* create_socket */
+     8, /* accept_socket */
+     0, /* accept_into_socket */
+     0, /* set_socket_event */
+     0, /* get_socket_event */
+     0, /* get_socket_info */
+     0, /* enable_socket_event */
+     0, /* set_socket_deferred */
+     8, /* alloc_console */
+     0, /* free_console */
+     0, /* get_console_renderer_events */
+     8, /* open_console */
+     8, /* get_console_wait_event */
+     0, /* get_console_mode */
+     0, /* set_console_mode */
+     0, /* set_console_input_info */
+     0, /* get_console_input_info */
+     0, /* append_console_input_history */
+     0, /* get_console_input_history */
+     8, /* create_console_output */
+     0, /* set_console_output_info */
+     0, /* get_console_output_info */
+     0, /* write_console_input */
+     0, /* read_console_input */
+     0, /* write_console_output */
+     0, /* fill_console_output */
+     0, /* read_console_output */
+     0, /* move_console_output */
+     0, /* send_console_signal */
+     0, /* read_directory_changes */
+     0, /* read_change */
+     8, /* create_mapping */
+     8, /* open_mapping */
+    32, /* get_mapping_info */
+     0, /* get_mapping_committed_range */
+     0, /* add_mapping_committed_range */
+     8, /* create_snapshot */
+     0, /* next_process */
+     0, /* next_thread */
+    16, /* wait_debug_event */
+     8, /* queue_exception_event */
+     0, /* get_exception_status */
+     0, /* output_debug_string */
+     0, /* continue_debug_event */
+     0, /* debug_process */
+     0, /* debug_break */
+     0, /* set_debugger_kill_on_exit */
+     0, /* read_process_memory */
+     0, /* write_process_memory */
+     8, /* create_key */
+     8, /* open_key */
+     0, /* delete_key */
+     0, /* flush_key */
+     0, /* enum_key */
+     0, /* set_key_value */
+     0, /* get_key_value */
+     0, /* enum_key_value */
+     0, /* delete_key_value */
+     0, /* load_registry */
+     0, /* unload_registry */
+     0, /* save_registry */
+     0, /* set_registry_notification */
+     8, /* create_timer */
+     8, /* open_timer */
+     0, /* set_timer */
+     0, /* cancel_timer */
+     0, /* get_timer_info */
+     0, /* get_thread_context */
+     0, /* set_thread_context */
+     0, /* get_selector_entry */
+     0, /* add_atom */
+     0, /* delete_atom */
+     0, /* find_atom */
+     0, /* get_atom_information */
+     0, /* set_atom_information */
+     0, /* empty_atom_table */
+     8, /* init_atom_table */
+     8, /* get_msg_queue */
+     0, /* set_queue_fd */
+     0, /* set_queue_mask */
+     0, /* get_queue_status */
+     8, /* get_process_idle_event */
+     0, /* send_message */
+     0, /* post_quit_message */
+     0, /* send_hardware_message */
+     0, /* get_message */
+     0, /* reply_message */
+     0, /* accept_hardware_message */
+     0, /* get_message_reply */
+     0, /* set_win_timer */
+     0, /* kill_win_timer */
+     0, /* is_window_hung */
+     0, /* get_serial_info */
+     0, /* set_serial_info */
+     0, /* register_async */
+     0, /* cancel_async */
+     8, /* ioctl */
+     0, /* get_ioctl_result */
+     8, /* create_named_pipe */
+     0, /* get_named_pipe_info */
+     0, /* create_window */
+     0, /* destroy_window */
+     0, /* get_desktop_window */
+     0, /* set_window_owner */
+     0, /* get_window_info */
+     0, /* set_window_info */
+     0, /* set_parent */
+     0, /* get_window_parents */
+     0, /* get_window_children */
+     0, /* get_window_children_from_point */
+     0, /* get_window_tree */
+     0, /* set_window_pos */
+     0, /* get_window_rectangles */
+     0, /* get_window_text */
+     0, /* set_window_text */
+     0, /* get_windows_offset */
+     0, /* get_visible_region */
+     0, /* get_surface_region */
+     0, /* get_window_region */
+     0, /* set_window_region */
+     0, /* get_update_region */
+     0, /* update_window_zorder */
+     0, /* redraw_window */
+     0, /* set_window_property */
+     0, /* remove_window_property */
+     0, /* get_window_property */
+     0, /* get_window_properties */
+     8, /* create_winstation */
+     8, /* open_winstation */
+     0, /* close_winstation */
+     8, /* get_process_winstation */
+     0, /* set_process_winstation */
+     0, /* enum_winstation */
+     8, /* create_desktop */
+     8, /* open_desktop */
+     8, /* open_input_desktop */
+     0, /* close_desktop */
+     8, /* get_thread_desktop */
+     0, /* set_thread_desktop */
+     0, /* enum_desktop */
+     0, /* set_user_object_info */
+     0, /* register_hotkey */
+     0, /* unregister_hotkey */
+     0, /* attach_thread_input */
+     0, /* get_thread_input */
+     0, /* get_last_input_time */
+     0, /* get_key_state */
+     0, /* set_key_state */
+     0, /* set_foreground_window */
+     0, /* set_focus_window */
+     0, /* set_active_window */
+     0, /* set_capture_window */
+     0, /* set_caret_window */
+     0, /* set_caret_info */
+     0, /* set_hook */
+     0, /* remove_hook */
+     0, /* start_hook_chain */
+     0, /* finish_hook_chain */
+     0, /* get_hook_info */
+     0, /* create_class */
+     0, /* destroy_class */
+     0, /* set_class_info */
+     0, /* set_clipboard_info */
+     8, /* open_token */
+     0, /* set_global_windows */
+     0, /* adjust_token_privileges */
+     0, /* get_token_privileges */
+     0, /* check_token_privileges */
+     8, /* duplicate_token */
+     0, /* access_check */
+     0, /* get_token_sid */
+     0, /* get_token_groups */
+     0, /* get_token_default_dacl */
+     0, /* set_token_default_dacl */
+     0, /* set_security_object */
+     0, /* get_security_object */
+     8, /* create_mailslot */
+     0, /* set_mailslot_info */
+     8, /* create_directory */
+     8, /* open_directory */
+     0, /* get_directory_entry */
+     8, /* create_symlink */
+     8, /* open_symlink */
+     0, /* query_symlink */
+     0, /* get_object_info */
+     0, /* unlink_object */
+     0, /* get_token_impersonation_level */
+     0, /* allocate_locally_unique_id */
+     8, /* create_device_manager */
+     8, /* create_device */
+     0, /* delete_device */
+     8, /* get_next_device_request */
+     8, /* make_process_system */
+     0, /* get_token_statistics */
+     8, /* create_completion */
+     8, /* open_completion */
+     0, /* add_completion */
+     0, /* remove_completion */
+     0, /* query_completion */
+     0, /* get_completion_ring_region */
+     0, /* get_completion_ring */
+     0, /* completion_ring_wake */
+     0, /* set_completion_info */
+     0, /* add_fd_completion */
+     0, /* set_fd_completion_mode */
+     0, /* get_window_layered_info */
+     0, /* set_window_layered_info */
+     0, /* alloc_user_handle */
+     0, /* free_user_handle */
+     0, /* set_cursor */
+     0, /* update_rawinput_devices */
+     0, /* get_suspend_context */
+     0, /* set_suspend_context */
+     0, /* call_batch */
+     0, /* get_request_profile */
+     0, /* get_process_request_profile */
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -901,6 +1462,17 @@ C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_region_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_region_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_fast_sync_region_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_fast_sync_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, type) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, slot) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_fast_sync_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_fast_sync_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct fast_sync_wake_request, handle) == 12 );
+C_ASSERT( sizeof(struct fast_sync_wake_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, attributes) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 20 );
@@ -2154,6 +2726,17 @@ C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
 C_ASSERT( sizeof(struct query_completion_reply) == 16 );
+C_ASSERT( sizeof(struct get_completion_ring_region_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_ring_region_reply, size) == 8 );
+C_ASSERT( sizeof(struct get_completion_ring_region_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_ring_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_completion_ring_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_ring_reply, index) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_completion_ring_reply, access) == 12 );
+C_ASSERT( sizeof(struct get_completion_ring_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct completion_ring_wake_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct completion_ring_wake_request, stalled) == 16 );
+C_ASSERT( sizeof(struct completion_ring_wake_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, ckey) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_completion_info_request, chandle) == 24 );
@@ -2162,7 +2745,11 @@ C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, handle) == 12 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, status) == 32 );
+C_ASSERT( FIELD_OFFSET(struct add_fd_completion_request, async) == 36 );
 C_ASSERT( sizeof(struct add_fd_completion_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, handle) == 12 );
+C_ASSERT( FIELD_OFFSET(struct set_fd_completion_mode_request, flags) == 16 );
+C_ASSERT( sizeof(struct set_fd_completion_mode_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_window_layered_info_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_window_layered_info_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_window_layered_info_reply, color_key) == 8 );
@@ -2200,6 +2787,15 @@ C_ASSERT( sizeof(struct update_rawinput_devices_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_reply) == 8 );
 C_ASSERT( sizeof(struct set_suspend_context_request) == 16 );
+C_ASSERT( sizeof(struct call_batch_request) == 16 );
+C_ASSERT( sizeof(struct call_batch_reply) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_request, flags) == 12 );
+C_ASSERT( sizeof(struct get_request_profile_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_reply, start_time) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_request_profile_reply, enabled) == 16 );
+C_ASSERT( sizeof(struct get_request_profile_reply) == 24 );
+C_ASSERT( sizeof(struct get_process_request_profile_request) == 16 );
+C_ASSERT( sizeof(struct get_process_request_profile_reply) == 8 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
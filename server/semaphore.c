@@ -41,22 +41,26 @@ struct semaphore
     struct object  obj;    /* object header */
     unsigned int   count;  /* current count */
     unsigned int   max;    /* maximum possible count */
+    struct fast_sync_slot *fast_sync; /* shared state, once a client asked for it */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
 static struct object_type *semaphore_get_type( struct object *obj );
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static unsigned int semaphore_map_access( struct object *obj, unsigned int access );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static void semaphore_destroy( struct object *obj );
 
 static const struct object_ops semaphore_ops =
 {
     sizeof(struct semaphore),      /* size */
     semaphore_dump,                /* dump */
     semaphore_get_type,            /* get_type */
-    add_queue,                     /* add_queue */
-    remove_queue,                  /* remove_queue */
+    semaphore_add_queue,           /* add_queue */
+    semaphore_remove_queue,        /* remove_queue */
     semaphore_signaled,            /* signaled */
     semaphore_satisfied,           /* satisfied */
     semaphore_signal,              /* signal */
@@ -67,7 +71,7 @@ static const struct object_ops semaphore_ops =
     no_lookup_name,                /* lookup_name */
     no_open_file,                  /* open_file */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
 
@@ -89,6 +93,7 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            sem->fast_sync = NULL;
             if (sd) default_set_sd( &sem->obj, sd, OWNER_SECURITY_INFORMATION|
                                                    GROUP_SECURITY_INFORMATION|
                                                    DACL_SECURITY_INFORMATION|
@@ -98,9 +103,38 @@ static struct semaphore *create_semaphore( struct directory *root, const struct
     return sem;
 }
 
+static inline unsigned int get_semaphore_count( struct semaphore *sem )
+{
+    if (sem->fast_sync) return sem->fast_sync->state;
+    return sem->count;
+}
+
+static int release_fast_sync_semaphore( struct semaphore *sem, unsigned int count,
+                                        unsigned int *prev )
+{
+    unsigned int cur;
+
+    do
+    {
+        cur = sem->fast_sync->state;
+        if (prev) *prev = cur;
+        if (cur + count < cur || cur + count > sem->max)
+        {
+            set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
+            return 0;
+        }
+    } while ((unsigned int)interlocked_cmpxchg( &sem->fast_sync->state, cur + count, cur ) != cur);
+
+    /* clients may have raised the count without waking anybody, so always check */
+    wake_up( &sem->obj, count );
+    return 1;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
+    if (sem->fast_sync) return release_fast_sync_semaphore( sem, count, prev );
+
     if (prev) *prev = sem->count;
     if (sem->count + count < sem->count || sem->count + count > sem->max)
     {
@@ -124,7 +158,8 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d ", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d%s ", get_semaphore_count( sem ), sem->max,
+             sem->fast_sync ? " (shared)" : "" );
     dump_object_name( &sem->obj );
     fputc( '\n', stderr );
 }
@@ -136,17 +171,38 @@ static struct object_type *semaphore_get_type( struct object *obj )
     return get_object_type( &str );
 }
 
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    /* let clients know they need to wake us up, before checking the count */
+    if (sem->fast_sync) interlocked_xchg_add( &sem->fast_sync->waiters, 1 );
+    return add_queue( obj, entry );
+}
+
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) interlocked_xchg_add( &sem->fast_sync->waiters, -1 );
+    remove_queue( obj, entry );
+}
+
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    if (!sem->fast_sync) return (sem->count > 0);
+    /* clients may decrement the count at any time, so grab it right away, or along
+     * with the other objects of a wait-all */
+    return fast_sync_acquire_for_wait( sem->fast_sync, entry );
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) return;  /* already acquired in semaphore_signaled */
     assert( sem->count );
     sem->count--;
 }
@@ -173,6 +229,24 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+static void semaphore_destroy( struct object *obj )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->fast_sync) free_fast_sync_slot( sem->fast_sync );
+}
+
+/* retrieve the shared slot of a semaphore, allocating it if needed */
+struct fast_sync_slot *get_semaphore_fast_sync( struct object *obj, int *type )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+
+    if (obj->ops != &semaphore_ops) return NULL;
+    if (!sem->fast_sync) sem->fast_sync = alloc_fast_sync_slot( obj, sem->count, sem->max );
+    if (sem->fast_sync) *type = FAST_SYNC_SEMAPHORE;
+    return sem->fast_sync;
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -246,7 +320,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = get_semaphore_count( sem );
         reply->max = sem->max;
         release_object( sem );
     }
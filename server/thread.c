@@ -604,6 +604,7 @@ static int wait_on( const select_op_t *select_op, unsigned int count, struct obj
     {
         struct object *obj = objects[i];
         entry->wait = wait;
+        entry->acquired = NULL;
         if (!obj->ops->add_queue( obj, entry ))
         {
             wait->count = i;
@@ -654,8 +655,12 @@ static int check_wait( struct thread *thread )
         /* Note: we must check them all anyway, as some objects may
          * want to do something when signaled, even if others are not */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
+        {
+            entry->acquired = NULL;
             not_ok |= !entry->obj->ops->signaled( entry->obj, entry );
-        if (not_ok) goto other_checks;
+        }
+        /* clients may have taken a shared object meanwhile */
+        if (not_ok || !fast_sync_acquire_all( wait->queues, wait->count )) goto other_checks;
         /* Wait satisfied: tell it to all objects */
         for (i = 0, entry = wait->queues; i < wait->count; i++, entry++)
             entry->obj->ops->satisfied( entry->obj, entry );
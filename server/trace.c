@@ -1091,6 +1091,49 @@ static void dump_varargs_rawinput_devices(const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_request_profiles( const char *prefix, data_size_t size )
+{
+    const struct request_profile *profile;
+    unsigned int i;
+    int first = 1;
+
+    fprintf( stderr, "%s{", prefix );
+    for (i = 0; size >= sizeof(*profile); i++)
+    {
+        profile = cur_data;
+        if (profile->count)
+        {
+            if (!first) fputc( ',', stderr );
+            first = 0;
+            fprintf( stderr, "{req=%u,count=%u,max_time=%u", i, profile->count, profile->max_time );
+            dump_uint64( ",total_time=", (const unsigned __int64 *)&profile->total_time );
+            fputc( '}', stderr );
+        }
+        size -= sizeof(*profile);
+        remove_data( sizeof(*profile) );
+    }
+    fputc( '}', stderr );
+}
+
+static void dump_varargs_process_request_profiles( const char *prefix, data_size_t size )
+{
+    const struct process_request_profile *profile;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*profile))
+    {
+        profile = cur_data;
+        fprintf( stderr, "{pid=%04x,requests=%u,round_trips=%u,max_time=%u",
+                 profile->pid, profile->requests, profile->round_trips, profile->max_time );
+        dump_uint64( ",total_time=", (const unsigned __int64 *)&profile->total_time );
+        fputc( '}', stderr );
+        size -= sizeof(*profile);
+        remove_data( sizeof(*profile) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 typedef void (*dump_func)( const void *req );
 
 /* Everything below this line is generated automatically by tools/make_requests */
@@ -1567,6 +1610,32 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_fast_sync_region_request( const struct get_fast_sync_region_request *req )
+{
+}
+
+static void dump_get_fast_sync_region_reply( const struct get_fast_sync_region_reply *req )
+{
+    fprintf( stderr, " size=%u", req->size );
+}
+
+static void dump_get_fast_sync_request( const struct get_fast_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_fast_sync_reply( const struct get_fast_sync_reply *req )
+{
+    fprintf( stderr, " type=%d", req->type );
+    fprintf( stderr, ", slot=%08x", req->slot );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_fast_sync_wake_request( const struct fast_sync_wake_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -4004,6 +4073,32 @@ static void dump_query_completion_reply( const struct query_completion_reply *re
     fprintf( stderr, " depth=%08x", req->depth );
 }
 
+static void dump_get_completion_ring_region_request( const struct get_completion_ring_region_request *req )
+{
+}
+
+static void dump_get_completion_ring_region_reply( const struct get_completion_ring_region_reply *req )
+{
+    fprintf( stderr, " size=%u", req->size );
+}
+
+static void dump_get_completion_ring_request( const struct get_completion_ring_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_completion_ring_reply( const struct get_completion_ring_reply *req )
+{
+    fprintf( stderr, " index=%d", req->index );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_completion_ring_wake_request( const struct completion_ring_wake_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", stalled=%d", req->stalled );
+}
+
 static void dump_set_completion_info_request( const struct set_completion_info_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4017,6 +4112,13 @@ static void dump_add_fd_completion_request( const struct add_fd_completion_reque
     dump_uint64( ", cvalue=", &req->cvalue );
     dump_uint64( ", information=", &req->information );
     fprintf( stderr, ", status=%08x", req->status );
+    fprintf( stderr, ", async=%d", req->async );
+}
+
+static void dump_set_fd_completion_mode_request( const struct set_fd_completion_mode_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+    fprintf( stderr, ", flags=%08x", req->flags );
 }
 
 static void dump_get_window_layered_info_request( const struct get_window_layered_info_request *req )
@@ -4095,6 +4197,37 @@ static void dump_set_suspend_context_request( const struct set_suspend_context_r
     dump_varargs_context( " context=", cur_size );
 }
 
+static void dump_call_batch_request( const struct call_batch_request *req )
+{
+    dump_varargs_bytes( " requests=", cur_size );
+}
+
+static void dump_call_batch_reply( const struct call_batch_reply *req )
+{
+    dump_varargs_bytes( " replies=", cur_size );
+}
+
+static void dump_get_request_profile_request( const struct get_request_profile_request *req )
+{
+    fprintf( stderr, " flags=%08x", req->flags );
+}
+
+static void dump_get_request_profile_reply( const struct get_request_profile_reply *req )
+{
+    dump_timeout( " start_time=", &req->start_time );
+    fprintf( stderr, ", enabled=%d", req->enabled );
+    dump_varargs_request_profiles( ", profile=", cur_size );
+}
+
+static void dump_get_process_request_profile_request( const struct get_process_request_profile_request *req )
+{
+}
+
+static void dump_get_process_request_profile_reply( const struct get_process_request_profile_reply *req )
+{
+    dump_varargs_process_request_profiles( " profile=", cur_size );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_get_new_process_info_request,
@@ -4134,6 +4267,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_fast_sync_region_request,
+    (dump_func)dump_get_fast_sync_request,
+    (dump_func)dump_fast_sync_wake_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -4341,8 +4477,12 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
     (dump_func)dump_query_completion_request,
+    (dump_func)dump_get_completion_ring_region_request,
+    (dump_func)dump_get_completion_ring_request,
+    (dump_func)dump_completion_ring_wake_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
+    (dump_func)dump_set_fd_completion_mode_request,
     (dump_func)dump_get_window_layered_info_request,
     (dump_func)dump_set_window_layered_info_request,
     (dump_func)dump_alloc_user_handle_request,
@@ -4351,6 +4491,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_update_rawinput_devices_request,
     (dump_func)dump_get_suspend_context_request,
     (dump_func)dump_set_suspend_context_request,
+    (dump_func)dump_call_batch_request,
+    (dump_func)dump_get_request_profile_request,
+    (dump_func)dump_get_process_request_profile_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -4392,6 +4535,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_fast_sync_region_reply,
+    (dump_func)dump_get_fast_sync_reply,
+    NULL,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -4599,6 +4745,10 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_remove_completion_reply,
     (dump_func)dump_query_completion_reply,
+    (dump_func)dump_get_completion_ring_region_reply,
+    (dump_func)dump_get_completion_ring_reply,
+    NULL,
+    NULL,
     NULL,
     NULL,
     (dump_func)dump_get_window_layered_info_reply,
@@ -4609,6 +4759,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_suspend_context_reply,
     NULL,
+    (dump_func)dump_call_batch_reply,
+    (dump_func)dump_get_request_profile_reply,
+    (dump_func)dump_get_process_request_profile_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -4650,6 +4803,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_fast_sync_region",
+    "get_fast_sync",
+    "fast_sync_wake",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -4857,8 +5013,12 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "add_completion",
     "remove_completion",
     "query_completion",
+    "get_completion_ring_region",
+    "get_completion_ring",
+    "completion_ring_wake",
     "set_completion_info",
     "add_fd_completion",
+    "set_fd_completion_mode",
     "get_window_layered_info",
     "set_window_layered_info",
     "alloc_user_handle",
@@ -4867,6 +5027,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "update_rawinput_devices",
     "get_suspend_context",
     "set_suspend_context",
+    "call_batch",
+    "get_request_profile",
+    "get_process_request_profile",
 };
 
 static const struct